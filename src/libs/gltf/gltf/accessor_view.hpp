@@ -0,0 +1,178 @@
+#pragma once
+
+#include <gltf/gltf_base.hpp>
+
+#include <utils/conditions_helpers.hpp>
+
+#include <compare>
+#include <cstring>
+#include <iterator>
+
+namespace sandbox::gltf
+{
+    // typed read only view of accessor elements which respects buffer view byte stride.
+    // elements are read with memcpy, so unaligned data is fine.
+    template<typename T>
+    class accessor_view
+    {
+    public:
+        class iterator
+        {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = T;
+
+            iterator() = default;
+
+            iterator(const uint8_t* data, size_t stride)
+                : m_data(data)
+                , m_stride(stride)
+            {
+            }
+
+            T operator*() const
+            {
+                T result;
+                std::memcpy(&result, m_data, sizeof(T));
+                return result;
+            }
+
+            T operator[](difference_type offset) const
+            {
+                return *(*this + offset);
+            }
+
+            iterator& operator++()
+            {
+                m_data += m_stride;
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                auto result = *this;
+                ++(*this);
+                return result;
+            }
+
+            iterator& operator--()
+            {
+                m_data -= m_stride;
+                return *this;
+            }
+
+            iterator operator--(int)
+            {
+                auto result = *this;
+                --(*this);
+                return result;
+            }
+
+            iterator& operator+=(difference_type offset)
+            {
+                m_data += offset * static_cast<difference_type>(m_stride);
+                return *this;
+            }
+
+            iterator& operator-=(difference_type offset)
+            {
+                m_data -= offset * static_cast<difference_type>(m_stride);
+                return *this;
+            }
+
+            friend iterator operator+(iterator it, difference_type offset)
+            {
+                return it += offset;
+            }
+
+            friend iterator operator+(difference_type offset, iterator it)
+            {
+                return it += offset;
+            }
+
+            friend iterator operator-(iterator it, difference_type offset)
+            {
+                return it -= offset;
+            }
+
+            friend difference_type operator-(const iterator& l, const iterator& r)
+            {
+                return (l.m_data - r.m_data) / static_cast<difference_type>(l.m_stride);
+            }
+
+            friend bool operator==(const iterator& l, const iterator& r)
+            {
+                return l.m_data == r.m_data;
+            }
+
+            friend auto operator<=>(const iterator& l, const iterator& r)
+            {
+                return l.m_data <=> r.m_data;
+            }
+
+        private:
+            const uint8_t* m_data{nullptr};
+            size_t m_stride{sizeof(T)};
+        };
+
+        accessor_view() = default;
+
+        accessor_view(const uint8_t* data, size_t count, size_t stride = sizeof(T))
+            : m_data(data)
+            , m_count(count)
+            , m_stride(stride)
+        {
+        }
+
+        accessor_view(const model& mdl, const accessor& acc)
+            : m_data(acc.get_data(mdl))
+            , m_count(acc.get_count())
+            , m_stride(acc.get_byte_stride(mdl))
+        {
+            CHECK_MSG(sizeof(T) == get_buffer_element_size(acc.get_type(), acc.get_component_type()), "Accessor element size does not match view type.");
+        }
+
+        T operator[](size_t index) const
+        {
+            return begin()[static_cast<std::ptrdiff_t>(index)];
+        }
+
+        iterator begin() const
+        {
+            return {m_data, m_stride};
+        }
+
+        iterator end() const
+        {
+            return {m_data + m_count * m_stride, m_stride};
+        }
+
+        size_t size() const
+        {
+            return m_count;
+        }
+
+        bool empty() const
+        {
+            return m_count == 0;
+        }
+
+        size_t get_stride() const
+        {
+            return m_stride;
+        }
+
+        const uint8_t* data() const
+        {
+            return m_data;
+        }
+
+    private:
+        const uint8_t* m_data{nullptr};
+        size_t m_count{0};
+        size_t m_stride{sizeof(T)};
+    };
+} // namespace sandbox::gltf
@@ -0,0 +1,182 @@
+#include "asset_registry.hpp"
+
+#include <filesystem/mapped_file.hpp>
+#include <utils/hash.hpp>
+
+#include <filesystem>
+
+using namespace sandbox;
+using namespace sandbox::gltf;
+
+asset_registry::asset_registry(uint64_t memory_budget)
+    : m_memory_budget(memory_budget)
+{
+}
+
+
+std::string asset_registry::get_canonical_path(const std::string& path)
+{
+    std::error_code error{};
+    auto result = std::filesystem::weakly_canonical(std::filesystem::path(path), error);
+
+    if (error) {
+        result = std::filesystem::absolute(std::filesystem::path(path)).lexically_normal();
+    }
+
+    return result.generic_string();
+}
+
+
+uint64_t asset_registry::make_key(std::string_view kind, std::string_view canonical_path, uint64_t content_hash)
+{
+    uint64_t result = utils::hash64(kind.data(), kind.size());
+    result = utils::hash64(canonical_path.data(), canonical_path.size(), result);
+    result = utils::hash64_value(content_hash, result);
+
+    return result;
+}
+
+
+uint64_t asset_registry::get_content_hash(const std::string& canonical_path)
+{
+    const std::filesystem::path path{canonical_path};
+    const uint64_t size = std::filesystem::file_size(path);
+    const int64_t write_time = std::filesystem::last_write_time(path).time_since_epoch().count();
+
+    {
+        std::lock_guard lock{m_mutex};
+
+        if (const auto it = m_content_hashes.find(canonical_path); it != m_content_hashes.end()) {
+            if (it->second.size == size && it->second.write_time == write_time) {
+                return it->second.hash;
+            }
+        }
+    }
+
+    hal::filesystem::mapped_file file{};
+    file.open(canonical_path);
+    const auto file_data = file.read_all();
+    const auto hash = utils::hash64(file_data.get_data(), file_data.get_size());
+
+    std::lock_guard lock{m_mutex};
+    m_content_hashes[canonical_path] = {.size = size, .write_time = write_time, .hash = hash};
+
+    return hash;
+}
+
+
+std::shared_ptr<const utils::data> asset_registry::acquire_file(const std::string& path, const std::function<utils::data()>& loader)
+{
+    const auto canonical_path = get_canonical_path(path);
+    const auto key = make_key("file", canonical_path, get_content_hash(canonical_path));
+
+    return acquire<utils::data>(key, [&loader]() {
+        auto data = loader();
+        const auto size = data.get_size();
+        return std::pair{std::move(data), uint64_t(size)};
+    });
+}
+
+
+void asset_registry::set_memory_budget(uint64_t memory_budget)
+{
+    std::lock_guard lock{m_mutex};
+    m_memory_budget = memory_budget;
+    evict(m_memory_budget);
+}
+
+
+void asset_registry::trim()
+{
+    std::lock_guard lock{m_mutex};
+    evict(m_memory_budget);
+}
+
+
+void asset_registry::clear_unused()
+{
+    std::lock_guard lock{m_mutex};
+
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->second.asset.use_count() > 1) {
+            ++it;
+            continue;
+        }
+
+        m_memory_usage -= it->second.size;
+        m_evictions++;
+        m_lru.erase(it->second.lru_position);
+        it = m_entries.erase(it);
+    }
+}
+
+
+asset_registry::statistics asset_registry::get_statistics() const
+{
+    std::lock_guard lock{m_mutex};
+
+    return {
+        .memory_usage = m_memory_usage,
+        .memory_budget = m_memory_budget,
+        .assets_count = m_entries.size(),
+        .hits = m_hits,
+        .misses = m_misses,
+        .evictions = m_evictions};
+}
+
+
+std::shared_ptr<const void> asset_registry::find_entry(uint64_t key)
+{
+    std::lock_guard lock{m_mutex};
+
+    const auto it = m_entries.find(key);
+
+    if (it == m_entries.end()) {
+        m_misses++;
+        return nullptr;
+    }
+
+    m_hits++;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru_position);
+
+    return it->second.asset;
+}
+
+
+std::shared_ptr<const void> asset_registry::insert_entry(uint64_t key, std::shared_ptr<const void> asset, uint64_t size)
+{
+    std::lock_guard lock{m_mutex};
+
+    // another thread has created the same asset in the meantime.
+    if (const auto it = m_entries.find(key); it != m_entries.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru_position);
+        return it->second.asset;
+    }
+
+    m_lru.push_front(key);
+    m_entries.emplace(key, entry{.asset = asset, .size = size, .lru_position = m_lru.begin()});
+    m_memory_usage += size;
+
+    evict(m_memory_budget);
+
+    return asset;
+}
+
+
+void asset_registry::evict(uint64_t memory_budget)
+{
+    // assets which are held outside of the registry cannot be freed, so the usage may stay over the budget.
+    for (auto it = m_lru.rbegin(); it != m_lru.rend() && m_memory_usage > memory_budget;) {
+        const auto entry_it = m_entries.find(*it);
+
+        if (entry_it->second.asset.use_count() > 1) {
+            ++it;
+            continue;
+        }
+
+        m_memory_usage -= entry_it->second.size;
+        m_evictions++;
+        m_entries.erase(entry_it);
+        it = std::list<uint64_t>::reverse_iterator(m_lru.erase(std::next(it).base()));
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <utils/data.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace sandbox::gltf
+{
+    // assets shared by models: files, baked models, decoded images and gpu resources.
+    // an asset is kept while anything holds it. unused assets are kept too and evicted
+    // in least recently used order when the memory of all assets exceeds the budget.
+    class asset_registry
+    {
+    public:
+        constexpr static uint64_t default_memory_budget = uint64_t(512) << 20;
+
+        struct statistics
+        {
+            uint64_t memory_usage{0};
+            uint64_t memory_budget{0};
+            size_t assets_count{0};
+            size_t hits{0};
+            size_t misses{0};
+            size_t evictions{0};
+        };
+
+        explicit asset_registry(uint64_t memory_budget = default_memory_budget);
+        asset_registry(const asset_registry&) = delete;
+        asset_registry& operator=(const asset_registry&) = delete;
+
+        // the same path written differently gives the same key.
+        static std::string get_canonical_path(const std::string& path);
+        // kind separates assets which are built from the same source, e.g. a file and the image decoded from it.
+        static uint64_t make_key(std::string_view kind, std::string_view canonical_path, uint64_t content_hash);
+
+        // hash of the file content. it is recalculated only if the file size or write time was changed.
+        uint64_t get_content_hash(const std::string& canonical_path);
+
+        // returns the file data loaded by the loader if the file with the same content was not loaded before.
+        std::shared_ptr<const utils::data> acquire_file(const std::string& path, const std::function<utils::data()>& loader);
+
+        template<typename T>
+        std::shared_ptr<const T> find(uint64_t key)
+        {
+            return std::static_pointer_cast<const T>(find_entry(key));
+        }
+
+        // factory returns the asset and the memory it takes. it is called without the lock,
+        // so if two threads create the same asset at once the first inserted one is returned to both.
+        template<typename T, typename Factory>
+        std::shared_ptr<const T> acquire(uint64_t key, const Factory& factory)
+        {
+            if (auto asset = find_entry(key)) {
+                return std::static_pointer_cast<const T>(std::move(asset));
+            }
+
+            auto [asset, size] = factory();
+
+            return std::static_pointer_cast<const T>(insert_entry(key, std::make_shared<const T>(std::move(asset)), size));
+        }
+
+        void set_memory_budget(uint64_t memory_budget);
+        // evicts unused assets until the budget is met. it is called on every insertion.
+        void trim();
+        // evicts all unused assets regardless of the budget.
+        void clear_unused();
+
+        statistics get_statistics() const;
+
+    private:
+        struct entry
+        {
+            std::shared_ptr<const void> asset{};
+            uint64_t size{0};
+            std::list<uint64_t>::iterator lru_position{};
+        };
+
+        struct content_hash
+        {
+            uint64_t size{0};
+            int64_t write_time{0};
+            uint64_t hash{0};
+        };
+
+        std::shared_ptr<const void> find_entry(uint64_t key);
+        std::shared_ptr<const void> insert_entry(uint64_t key, std::shared_ptr<const void> asset, uint64_t size);
+        void evict(uint64_t memory_budget);
+
+        mutable std::mutex m_mutex{};
+
+        std::unordered_map<uint64_t, entry> m_entries{};
+        // front is the most recently used asset.
+        std::list<uint64_t> m_lru{};
+        std::unordered_map<std::string, content_hash> m_content_hashes{};
+
+        uint64_t m_memory_budget{default_memory_budget};
+        uint64_t m_memory_usage{0};
+
+        size_t m_hits{0};
+        size_t m_misses{0};
+        size_t m_evictions{0};
+    };
+} // namespace sandbox::gltf
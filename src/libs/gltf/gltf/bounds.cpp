@@ -0,0 +1,344 @@
+#include "bounds.hpp"
+
+#include <gltf/vertex_conversion.hpp>
+
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SANDBOX_BOUNDS_SSE2 1
+    #include <xmmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define SANDBOX_BOUNDS_NEON 1
+    #include <arm_neon.h>
+#endif
+
+using namespace sandbox::gltf;
+
+namespace
+{
+    constexpr size_t positions_chunk_size = 1024;
+
+
+    // the smallest sphere which encloses both spheres.
+    void merge_spheres(glm::vec3& center, float& radius, const glm::vec3& other_center, float other_radius)
+    {
+        const auto offset = other_center - center;
+        const float distance = glm::length(offset);
+
+        if (distance + other_radius <= radius) {
+            return;
+        }
+
+        if (distance + radius <= other_radius) {
+            center = other_center;
+            radius = other_radius;
+            return;
+        }
+
+        const float new_radius = (distance + radius + other_radius) * 0.5f;
+        center += offset * ((new_radius - radius) / distance);
+        radius = new_radius;
+    }
+
+
+    // the box sphere may be tighter than merged or transformed spheres, e.g. for boxes which are merged side by side.
+    void fit_sphere_to_box(bounds& b)
+    {
+        const float box_radius = glm::length(b.max - b.min) * 0.5f;
+
+        if (box_radius < b.radius) {
+            b.center = (b.min + b.max) * 0.5f;
+            b.radius = box_radius;
+        }
+    }
+
+
+    // calls the callback with float positions. float accessors are passed as they are, others are converted by chunks.
+    void for_each_positions_chunk(
+        const primitive::vertex_attribute& positions,
+        const std::function<void(const uint8_t* data, size_t stride, uint64_t count)>& callback)
+    {
+        const auto src_format = to_vertex_format(positions.accessor_type, positions.component_type, positions.normalized);
+        constexpr vertex_format dst_format{.component = vertex_component::float32, .components_count = 3};
+
+        if (src_format == dst_format) {
+            callback(positions.attribute_data, positions.byte_stride, positions.elements_count);
+            return;
+        }
+
+        std::array<glm::vec3, positions_chunk_size> chunk{};
+
+        for (uint64_t first = 0; first < positions.elements_count; first += chunk.size()) {
+            const auto count = std::min<uint64_t>(chunk.size(), positions.elements_count - first);
+
+            convert_vertices(
+                positions.attribute_data + first * positions.byte_stride,
+                positions.byte_stride,
+                src_format,
+                reinterpret_cast<uint8_t*>(chunk.data()),
+                sizeof(glm::vec3),
+                dst_format,
+                count);
+
+            callback(reinterpret_cast<const uint8_t*>(chunk.data()), sizeof(glm::vec3), count);
+        }
+    }
+
+
+    glm::vec3 load_position(const uint8_t* data)
+    {
+        glm::vec3 result;
+        std::memcpy(&result, data, sizeof(result));
+        return result;
+    }
+
+
+    bounds get_subtree_bounds(
+        const model& mdl,
+        const std::vector<bounds>& meshes_bounds,
+        int32_t node,
+        const glm::mat4& parent_matrix,
+        std::vector<bounds>& nodes_bounds)
+    {
+        const auto& curr_node = mdl.get_nodes()[node];
+        const auto matrix = parent_matrix * curr_node.get_matrix();
+
+        bounds result{};
+
+        if (curr_node.get_mesh() >= 0) {
+            result = meshes_bounds[curr_node.get_mesh()].transform(matrix);
+        }
+
+        for (const auto child : curr_node.get_children()) {
+            result.extend(get_subtree_bounds(mdl, meshes_bounds, child, matrix, nodes_bounds));
+        }
+
+        nodes_bounds[node] = result;
+
+        return result;
+    }
+} // namespace
+
+
+bool bounds::is_empty() const
+{
+    return radius < 0;
+}
+
+
+void bounds::extend(const bounds& other)
+{
+    if (other.is_empty()) {
+        return;
+    }
+
+    if (is_empty()) {
+        *this = other;
+        return;
+    }
+
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+
+    merge_spheres(center, radius, other.center, other.radius);
+    fit_sphere_to_box(*this);
+}
+
+
+bounds bounds::transform(const glm::mat4& matrix) const
+{
+    if (is_empty()) {
+        return {};
+    }
+
+    const glm::vec3 box_center = (min + max) * 0.5f;
+    const glm::vec3 box_extent = (max - min) * 0.5f;
+
+    // extents of the transformed box are sums of the absolute axes of the matrix scaled by the extents.
+    const glm::vec3 new_center = glm::vec3(matrix * glm::vec4(box_center, 1.0f));
+    const glm::vec3 new_extent =
+        glm::abs(glm::vec3(matrix[0])) * box_extent.x +
+        glm::abs(glm::vec3(matrix[1])) * box_extent.y +
+        glm::abs(glm::vec3(matrix[2])) * box_extent.z;
+
+    const float scale = std::max({
+        glm::length(glm::vec3(matrix[0])),
+        glm::length(glm::vec3(matrix[1])),
+        glm::length(glm::vec3(matrix[2]))});
+
+    bounds result{};
+    result.min = new_center - new_extent;
+    result.max = new_center + new_extent;
+    result.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+    result.radius = radius * scale;
+
+    fit_sphere_to_box(result);
+
+    return result;
+}
+
+
+bounds bounds::from_box(const glm::vec3& min, const glm::vec3& max)
+{
+    bounds result{};
+    result.min = min;
+    result.max = max;
+    result.center = (min + max) * 0.5f;
+    result.radius = glm::length(max - min) * 0.5f;
+
+    return result;
+}
+
+
+void sandbox::gltf::find_min_max(const uint8_t* positions, size_t stride, uint64_t count, glm::vec3& min, glm::vec3& max)
+{
+    if (count == 0) {
+        return;
+    }
+
+    uint64_t i = 0;
+
+#if defined(SANDBOX_BOUNDS_SSE2) || defined(SANDBOX_BOUNDS_NEON)
+    // every position is loaded as 4 floats, the fourth one lies in the next position and is dropped.
+    // the last position has no next one, so it goes to the scalar tail.
+    alignas(16) std::array<float, 4> min_lanes{min.x, min.y, min.z, 0};
+    alignas(16) std::array<float, 4> max_lanes{max.x, max.y, max.z, 0};
+
+    #ifdef SANDBOX_BOUNDS_SSE2
+    __m128 min0 = _mm_load_ps(min_lanes.data());
+    __m128 max0 = _mm_load_ps(max_lanes.data());
+    __m128 min1 = min0;
+    __m128 max1 = max0;
+
+    // two accumulators hide latency of min and max.
+    for (; i + 2 < count; i += 2) {
+        const __m128 p0 = _mm_loadu_ps(reinterpret_cast<const float*>(positions + i * stride));
+        const __m128 p1 = _mm_loadu_ps(reinterpret_cast<const float*>(positions + (i + 1) * stride));
+        min0 = _mm_min_ps(min0, p0);
+        max0 = _mm_max_ps(max0, p0);
+        min1 = _mm_min_ps(min1, p1);
+        max1 = _mm_max_ps(max1, p1);
+    }
+
+    _mm_store_ps(min_lanes.data(), _mm_min_ps(min0, min1));
+    _mm_store_ps(max_lanes.data(), _mm_max_ps(max0, max1));
+    #else
+    float32x4_t min0 = vld1q_f32(min_lanes.data());
+    float32x4_t max0 = vld1q_f32(max_lanes.data());
+    float32x4_t min1 = min0;
+    float32x4_t max1 = max0;
+
+    for (; i + 2 < count; i += 2) {
+        const float32x4_t p0 = vld1q_f32(reinterpret_cast<const float*>(positions + i * stride));
+        const float32x4_t p1 = vld1q_f32(reinterpret_cast<const float*>(positions + (i + 1) * stride));
+        min0 = vminq_f32(min0, p0);
+        max0 = vmaxq_f32(max0, p0);
+        min1 = vminq_f32(min1, p1);
+        max1 = vmaxq_f32(max1, p1);
+    }
+
+    vst1q_f32(min_lanes.data(), vminq_f32(min0, min1));
+    vst1q_f32(max_lanes.data(), vmaxq_f32(max0, max1));
+    #endif
+
+    min = glm::vec3{min_lanes[0], min_lanes[1], min_lanes[2]};
+    max = glm::vec3{max_lanes[0], max_lanes[1], max_lanes[2]};
+#endif
+
+    for (; i < count; ++i) {
+        const auto position = load_position(positions + i * stride);
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+}
+
+
+bounds sandbox::gltf::get_primitive_bounds(const model& mdl, const primitive& prim)
+{
+    const auto positions = prim.attribute_at_path(mdl, attribute_path::position);
+
+    if (positions.accessor < 0 || positions.elements_count == 0) {
+        return {};
+    }
+
+    const auto& accessor = mdl.get_accessors()[positions.accessor];
+
+    // min and max of quantized accessors are stored in their component type, so only float ones are used as they are.
+    const bool has_float_positions = positions.component_type == component_type::float32 && !positions.normalized;
+
+    if (has_float_positions && accessor.has_min_max()) {
+        return bounds::from_box(glm::vec3(accessor.get_min()), glm::vec3(accessor.get_max()));
+    }
+
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+    for_each_positions_chunk(positions, [&min, &max](const uint8_t* data, size_t stride, uint64_t count) {
+        find_min_max(data, stride, count, min, max);
+    });
+
+    // the sphere is centered in the box, its radius is the distance to the farthest position instead of the box corner.
+    auto result = bounds::from_box(min, max);
+    float max_distance = 0;
+
+    for_each_positions_chunk(positions, [&result, &max_distance](const uint8_t* data, size_t stride, uint64_t count) {
+        for (uint64_t i = 0; i < count; ++i) {
+            const auto offset = load_position(data + i * stride) - result.center;
+            max_distance = std::max(max_distance, glm::dot(offset, offset));
+        }
+    });
+
+    result.radius = std::min(result.radius, std::sqrt(max_distance));
+
+    return result;
+}
+
+
+bounds sandbox::gltf::get_mesh_bounds(const model& mdl, const mesh& msh)
+{
+    bounds result{};
+
+    for (const auto& prim : msh.get_primitives()) {
+        result.extend(get_primitive_bounds(mdl, prim));
+    }
+
+    return result;
+}
+
+
+std::vector<bounds> sandbox::gltf::get_nodes_bounds(const model& mdl)
+{
+    const auto& nodes = mdl.get_nodes();
+
+    std::vector<bounds> meshes_bounds{};
+    meshes_bounds.reserve(mdl.get_meshes().size());
+
+    for (const auto& msh : mdl.get_meshes()) {
+        meshes_bounds.emplace_back(get_mesh_bounds(mdl, msh));
+    }
+
+    std::vector<bool> has_parent(nodes.size(), false);
+
+    for (const auto& node : nodes) {
+        for (const auto child : node.get_children()) {
+            has_parent[child] = true;
+        }
+    }
+
+    std::vector<bounds> result(nodes.size());
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!has_parent[i]) {
+            get_subtree_bounds(mdl, meshes_bounds, static_cast<int32_t>(i), glm::mat4{1}, result);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <gltf/gltf_base.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace sandbox::gltf
+{
+    // axis aligned box and a sphere which encloses the same points. the sphere is not derived from the box,
+    // it is kept as tight as the source allows, so tests may use whatever is cheaper for them.
+    struct bounds
+    {
+        glm::vec3 min{std::numeric_limits<float>::max()};
+        glm::vec3 max{std::numeric_limits<float>::lowest()};
+        glm::vec3 center{0};
+        float radius{-1};
+
+        // bounds of nothing, e.g. of a node without meshes. extending them gives the extending bounds.
+        bool is_empty() const;
+
+        void extend(const bounds&);
+        // box is transformed as a whole, the sphere radius is scaled by the largest axis scale.
+        bounds transform(const glm::mat4&) const;
+
+        static bounds from_box(const glm::vec3& min, const glm::vec3& max);
+    };
+
+    // extends min and max by float triples which are stride bytes apart, stride is at least 12 bytes.
+    void find_min_max(const uint8_t* positions, size_t stride, uint64_t count, glm::vec3& min, glm::vec3& max);
+
+    // object space bounds of the primitive positions. float positions use accessor min and max if the model has them,
+    // quantized ones and positions without them are read. empty if the primitive has no positions.
+    bounds get_primitive_bounds(const gltf::model&, const gltf::primitive&);
+    bounds get_mesh_bounds(const gltf::model&, const gltf::mesh&);
+
+    // world space bounds of every node with all its descendants, indexed as model nodes. nodes without a parent are
+    // roots, so nodes which no scene references get bounds too. skinned meshes are bounded by their bind pose.
+    std::vector<bounds> get_nodes_bounds(const gltf::model&);
+} // namespace sandbox::gltf
@@ -0,0 +1,808 @@
+#include "glb_writer.hpp"
+
+#include <utils/conditions_helpers.hpp>
+#include <utils/hash.hpp>
+#include <filesystem/vfs.hpp>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+
+using namespace sandbox;
+using namespace sandbox::gltf;
+
+namespace
+{
+    using json = nlohmann::json;
+
+    constexpr uint32_t glb_magic = 0x46546C67; // "glTF"
+    constexpr uint32_t glb_version = 2;
+    constexpr size_t glb_alignment = 4;
+
+    constexpr uint32_t array_buffer_target = 34962;
+    constexpr uint32_t element_array_buffer_target = 34963;
+
+
+    // accessors used in several ways get the usage which comes last here, vertex views need their target and stride.
+    enum class accessor_usage : uint8_t
+    {
+        unused,
+        other,
+        index,
+        vertex
+    };
+
+
+    size_t align(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+
+    // floats are written with the shortest text which reads back to the same float.
+    double to_json_number(float value)
+    {
+        std::array<char, 32> text;
+        const auto end = std::to_chars(text.data(), text.data() + text.size(), value).ptr;
+
+        double result = value;
+        std::from_chars(text.data(), end, result);
+
+        return result;
+    }
+
+
+    json to_json_array(const float* values, size_t count)
+    {
+        auto result = json::array();
+
+        for (size_t i = 0; i < count; ++i) {
+            result.push_back(to_json_number(values[i]));
+        }
+
+        return result;
+    }
+
+
+    double read_component(const uint8_t* src, component_type type)
+    {
+        switch (type) {
+            case component_type::signed_byte:
+                return *reinterpret_cast<const int8_t*>(src);
+            case component_type::unsigned_byte:
+                return *src;
+            case component_type::signed_short: {
+                int16_t value;
+                std::memcpy(&value, src, sizeof(value));
+                return value;
+            }
+            case component_type::unsigned_short: {
+                uint16_t value;
+                std::memcpy(&value, src, sizeof(value));
+                return value;
+            }
+            case component_type::unsigned_int: {
+                uint32_t value;
+                std::memcpy(&value, src, sizeof(value));
+                return value;
+            }
+            case component_type::float32: {
+                float value;
+                std::memcpy(&value, src, sizeof(value));
+                return value;
+            }
+        }
+
+        throw std::runtime_error("Bad component type " + to_string(type));
+    }
+
+
+    // core gltf allows only these vertex formats, the rest comes from KHR_mesh_quantization.
+    bool is_core_attribute_format(attribute_path path, component_type type, bool normalized)
+    {
+        const bool is_float = type == component_type::float32;
+        const bool is_unorm = normalized && (type == component_type::unsigned_byte || type == component_type::unsigned_short);
+
+        switch (path) {
+            case attribute_path::position:
+            case attribute_path::normal:
+            case attribute_path::tangent:
+                return is_float;
+            case attribute_path::joints_0:
+                return !normalized && (type == component_type::unsigned_byte || type == component_type::unsigned_short);
+            default:
+                return is_float || is_unorm;
+        }
+    }
+
+
+    const char* sniff_image_mime(const uint8_t* data, size_t size, image_mime_type declared)
+    {
+        constexpr uint8_t png_signature[]{0x89, 'P', 'N', 'G'};
+
+        if (size >= sizeof(png_signature) && std::memcmp(data, png_signature, sizeof(png_signature)) == 0) {
+            return image_mime_type_value::IMAGE_MIME_TYPE_PNG;
+        }
+
+        if (size >= 2 && data[0] == 0xff && data[1] == 0xd8) {
+            return image_mime_type_value::IMAGE_MIME_TYPE_JPEG;
+        }
+
+        switch (declared) {
+            case image_mime_type::png:
+                return image_mime_type_value::IMAGE_MIME_TYPE_PNG;
+            case image_mime_type::jpeg:
+                return image_mime_type_value::IMAGE_MIME_TYPE_JPEG;
+            default:
+                throw std::runtime_error("Unknown image format.");
+        }
+    }
+
+
+    json write_texture_data(const material::texture_data& texture)
+    {
+        json result{{"index", texture.index}};
+
+        if (texture.coord_set != material::texture_data::coords_set::texcoord_0) {
+            result["texCoord"] = static_cast<uint32_t>(texture.coord_set);
+        }
+
+        return result;
+    }
+
+
+    class glb_builder
+    {
+    public:
+        glb_builder(const model& mdl, const glb_write_options& options)
+            : m_model(mdl)
+            , m_options(options)
+        {
+        }
+
+        std::vector<uint8_t> build();
+
+    private:
+        struct view_record
+        {
+            size_t offset{0};
+            size_t size{0};
+            size_t stride{0};
+            uint32_t target{0};
+        };
+
+        int64_t add_view(const uint8_t* data, size_t size, size_t stride, uint32_t target);
+
+        void mark_accessors();
+        void write_accessors();
+        void write_images();
+        void write_scenes();
+        void write_meshes();
+        void write_materials();
+        void write_textures();
+        void write_cameras();
+        void write_skins();
+        void write_animations();
+
+        int64_t get_accessor(uint64_t index) const;
+
+        const model& m_model;
+        glb_write_options m_options;
+
+        json m_root = json::object();
+        std::vector<uint8_t> m_bin{};
+
+        std::vector<view_record> m_views{};
+        std::unordered_multimap<uint64_t, size_t> m_views_by_hash{};
+
+        std::vector<accessor_usage> m_accessors_usage{};
+        std::vector<bool> m_position_accessors{};
+        std::vector<int64_t> m_accessors_remap{};
+
+        bool m_uses_quantization{false};
+    };
+
+
+    int64_t glb_builder::add_view(const uint8_t* data, size_t size, size_t stride, uint32_t target)
+    {
+        if (size == 0) {
+            return -1;
+        }
+
+        uint64_t hash = 0;
+
+        if (m_options.deduplicate_buffer_views) {
+            hash = utils::hash64(data, size);
+            hash = utils::hash64_value(stride, hash);
+            hash = utils::hash64_value(target, hash);
+
+            const auto [begin, end] = m_views_by_hash.equal_range(hash);
+
+            for (auto it = begin; it != end; ++it) {
+                const auto& view = m_views[it->second];
+
+                if (view.size == size && view.stride == stride && view.target == target && std::memcmp(m_bin.data() + view.offset, data, size) == 0) {
+                    return int64_t(it->second);
+                }
+            }
+        }
+
+        const view_record view{.offset = align(m_bin.size(), glb_alignment), .size = size, .stride = stride, .target = target};
+        m_bin.resize(view.offset + size);
+        std::memcpy(m_bin.data() + view.offset, data, size);
+
+        json view_json{{"buffer", 0}, {"byteLength", size}};
+
+        if (view.offset != 0) {
+            view_json["byteOffset"] = view.offset;
+        }
+
+        if (stride != 0) {
+            view_json["byteStride"] = stride;
+        }
+
+        if (target != 0) {
+            view_json["target"] = target;
+        }
+
+        m_root["bufferViews"].push_back(std::move(view_json));
+
+        const auto index = m_views.size();
+        m_views.push_back(view);
+
+        if (m_options.deduplicate_buffer_views) {
+            m_views_by_hash.emplace(hash, index);
+        }
+
+        return int64_t(index);
+    }
+
+
+    void glb_builder::mark_accessors()
+    {
+        const auto& accessors = m_model.get_accessors();
+
+        m_accessors_usage.assign(accessors.size(), m_options.remove_unused_accessors ? accessor_usage::unused : accessor_usage::other);
+        m_position_accessors.assign(accessors.size(), false);
+
+        auto mark = [this](uint64_t index, accessor_usage usage) {
+            CHECK_MSG(index < m_accessors_usage.size(), "Bad accessor index.");
+            m_accessors_usage[index] = std::max(m_accessors_usage[index], usage);
+        };
+
+        for (const auto& mesh : m_model.get_meshes()) {
+            for (const auto& primitive : mesh.get_primitives()) {
+                for (const auto& attribute : primitive.get_attributes()) {
+                    mark(attribute.accessor, accessor_usage::vertex);
+
+                    const auto& accessor = accessors[attribute.accessor];
+                    m_position_accessors[attribute.accessor] = m_position_accessors[attribute.accessor] || attribute.path == attribute_path::position;
+
+                    if (!is_core_attribute_format(attribute.path, accessor.get_component_type(), accessor.is_normalized())) {
+                        m_uses_quantization = true;
+                    }
+                }
+
+                if (primitive.get_indices() >= 0) {
+                    mark(primitive.get_indices(), accessor_usage::index);
+                }
+            }
+        }
+
+        for (const auto& skin : m_model.get_skins()) {
+            mark(skin.get_inv_bind_matrices(), accessor_usage::other);
+        }
+
+        for (const auto& animation : m_model.get_animations()) {
+            for (const auto& sampler : animation.get_samplers()) {
+                mark(sampler.get_input(), accessor_usage::other);
+                mark(sampler.get_output(), accessor_usage::other);
+            }
+        }
+    }
+
+
+    void glb_builder::write_accessors()
+    {
+        const auto& accessors = m_model.get_accessors();
+        m_accessors_remap.assign(accessors.size(), -1);
+
+        std::vector<uint8_t> data{};
+        std::vector<uint8_t> padded{};
+
+        for (size_t i = 0; i < accessors.size(); ++i) {
+            if (m_accessors_usage[i] == accessor_usage::unused) {
+                continue;
+            }
+
+            const auto& accessor = accessors[i];
+            const auto element_size = get_buffer_element_size(accessor.get_type(), accessor.get_component_type());
+            const auto components_count = accessor_components_count(accessor.get_type());
+
+            data.resize(element_size * accessor.get_count());
+            accessor.copy_data(m_model, data.data());
+
+            json accessor_json{
+                {"componentType", static_cast<uint32_t>(accessor.get_component_type())},
+                {"count", accessor.get_count()},
+                {"type", to_string(accessor.get_type())}};
+
+            if (accessor.is_normalized()) {
+                accessor_json["normalized"] = true;
+            }
+
+            // position bounds are required, they are recalculated since sparse data could change them.
+            if (m_position_accessors[i] && accessor.get_count() > 0) {
+                std::vector<double> min(components_count, std::numeric_limits<double>::max());
+                std::vector<double> max(components_count, std::numeric_limits<double>::lowest());
+                const auto component_size = element_size / components_count;
+
+                for (uint64_t e = 0; e < accessor.get_count(); ++e) {
+                    for (size_t c = 0; c < components_count; ++c) {
+                        const auto value = read_component(data.data() + e * element_size + c * component_size, accessor.get_component_type());
+                        min[c] = std::min(min[c], value);
+                        max[c] = std::max(max[c], value);
+                    }
+                }
+
+                if (accessor.get_component_type() == component_type::float32) {
+                    std::vector<float> min_values(min.begin(), min.end());
+                    std::vector<float> max_values(max.begin(), max.end());
+                    accessor_json["min"] = to_json_array(min_values.data(), components_count);
+                    accessor_json["max"] = to_json_array(max_values.data(), components_count);
+                } else {
+                    accessor_json["min"] = std::vector<int64_t>(min.begin(), min.end());
+                    accessor_json["max"] = std::vector<int64_t>(max.begin(), max.end());
+                }
+            }
+
+            int64_t view = -1;
+
+            if (m_accessors_usage[i] == accessor_usage::vertex) {
+                // every vertex element must start at 4 bytes boundary.
+                const auto stride = align(element_size, glb_alignment);
+
+                if (stride != element_size) {
+                    padded.assign(stride * accessor.get_count(), 0);
+
+                    for (uint64_t e = 0; e < accessor.get_count(); ++e) {
+                        std::memcpy(padded.data() + e * stride, data.data() + e * element_size, element_size);
+                    }
+
+                    view = add_view(padded.data(), padded.size(), stride, array_buffer_target);
+                } else {
+                    view = add_view(data.data(), data.size(), 0, array_buffer_target);
+                }
+            } else if (m_accessors_usage[i] == accessor_usage::index) {
+                view = add_view(data.data(), data.size(), 0, element_array_buffer_target);
+            } else {
+                view = add_view(data.data(), data.size(), 0, 0);
+            }
+
+            if (view >= 0) {
+                accessor_json["bufferView"] = view;
+            }
+
+            m_accessors_remap[i] = int64_t(m_root["accessors"].size());
+            m_root["accessors"].push_back(std::move(accessor_json));
+        }
+    }
+
+
+    void glb_builder::write_images()
+    {
+        const auto& buffers = m_model.get_buffers();
+        const auto& views = m_model.get_buffer_views();
+
+        for (const auto& image : m_model.get_images()) {
+            utils::data owned_data{};
+
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+
+            if (image.get_buffer_view() >= 0) {
+                const auto& view = views[image.get_buffer_view()];
+                data = view.get_data(buffers.data(), buffers.size());
+                size = view.get_byte_length();
+            } else if (is_data_uri(image.get_uri())) {
+                owned_data = decode_data_uri(image.get_uri());
+                data = owned_data.get_data();
+                size = owned_data.get_size();
+            } else {
+                // images are read through the file system of the model, the same way as its buffers.
+                hal::filesystem::vfs_file file{m_model.get_file_system()};
+                file.open((std::filesystem::path(m_model.get_cwd()) / image.get_uri()).string());
+                owned_data = file.read_all_and_move();
+                data = owned_data.get_data();
+                size = owned_data.get_size();
+            }
+
+            const auto view = add_view(data, size, 0, 0);
+            CHECK_MSG(view >= 0, "Empty image " + image.get_uri() + ".");
+
+            m_root["images"].push_back({{"bufferView", view}, {"mimeType", sniff_image_mime(data, size, image.get_mime())}});
+        }
+    }
+
+
+    void glb_builder::write_scenes()
+    {
+        for (const auto& scene : m_model.get_scenes()) {
+            json scene_json = json::object();
+
+            if (!scene.get_nodes().empty()) {
+                scene_json["nodes"] = std::vector<int32_t>(scene.get_nodes().begin(), scene.get_nodes().end());
+            }
+
+            m_root["scenes"].push_back(std::move(scene_json));
+        }
+
+        if (!m_model.get_scenes().empty()) {
+            m_root["scene"] = m_model.get_current_scene();
+        }
+
+        for (const auto& node : m_model.get_nodes()) {
+            json node_json = json::object();
+
+            if (node.get_mesh() >= 0) {
+                node_json["mesh"] = node.get_mesh();
+            }
+
+            if (node.get_skin() >= 0) {
+                node_json["skin"] = node.get_skin();
+            }
+
+            if (node.get_camera() >= 0) {
+                node_json["camera"] = node.get_camera();
+            }
+
+            if (!node.get_children().empty()) {
+                node_json["children"] = std::vector<int32_t>(node.get_children().begin(), node.get_children().end());
+            }
+
+            if (node.has_matrix()) {
+                const auto matrix = node.get_matrix();
+
+                if (matrix != glm::mat4{1}) {
+                    node_json["matrix"] = to_json_array(glm::value_ptr(matrix), 16);
+                }
+            } else {
+                const auto transform = node.get_transform();
+
+                if (transform.translation != glm::vec3{0}) {
+                    node_json["translation"] = to_json_array(glm::value_ptr(transform.translation), 3);
+                }
+
+                if (transform.rotation != glm::identity<glm::quat>()) {
+                    const std::array<float, 4> rotation{transform.rotation.x, transform.rotation.y, transform.rotation.z, transform.rotation.w};
+                    node_json["rotation"] = to_json_array(rotation.data(), rotation.size());
+                }
+
+                if (transform.scale != glm::vec3{1}) {
+                    node_json["scale"] = to_json_array(glm::value_ptr(transform.scale), 3);
+                }
+            }
+
+            m_root["nodes"].push_back(std::move(node_json));
+        }
+    }
+
+
+    void glb_builder::write_meshes()
+    {
+        // the model appends the default material which is used by primitives without one.
+        const auto materials_count = int32_t(m_model.get_materials().size()) - 1;
+
+        for (const auto& mesh : m_model.get_meshes()) {
+            json mesh_json{{"primitives", json::array()}};
+
+            for (const auto& primitive : mesh.get_primitives()) {
+                json primitive_json{{"attributes", json::object()}};
+
+                for (const auto& attribute : primitive.get_attributes()) {
+                    primitive_json["attributes"][to_string(attribute.path)] = get_accessor(attribute.accessor);
+                }
+
+                if (primitive.get_indices() >= 0) {
+                    primitive_json["indices"] = get_accessor(primitive.get_indices());
+                }
+
+                if (primitive.get_material() >= 0 && primitive.get_material() < materials_count) {
+                    primitive_json["material"] = primitive.get_material();
+                }
+
+                if (primitive.get_mode() != primitive_mode::triangles) {
+                    primitive_json["mode"] = static_cast<int32_t>(primitive.get_mode());
+                }
+
+                mesh_json["primitives"].push_back(std::move(primitive_json));
+            }
+
+            m_root["meshes"].push_back(std::move(mesh_json));
+        }
+    }
+
+
+    void glb_builder::write_materials()
+    {
+        const auto& materials = m_model.get_materials();
+
+        for (size_t i = 0; i + 1 < materials.size(); ++i) {
+            const auto& material = materials[i];
+            const auto& pbr = material.get_pbr_metallic_roughness();
+
+            json pbr_json = json::object();
+
+            if (pbr.base_color != glm::vec4{1}) {
+                pbr_json["baseColorFactor"] = to_json_array(glm::value_ptr(pbr.base_color), 4);
+            }
+
+            if (pbr.base_color_texture.index >= 0) {
+                pbr_json["baseColorTexture"] = write_texture_data(pbr.base_color_texture);
+            }
+
+            if (pbr.metallic_factor != 1.f) {
+                pbr_json["metallicFactor"] = to_json_number(pbr.metallic_factor);
+            }
+
+            if (pbr.roughness_factor != 1.f) {
+                pbr_json["roughnessFactor"] = to_json_number(pbr.roughness_factor);
+            }
+
+            if (pbr.metallic_roughness_texture.index >= 0) {
+                pbr_json["metallicRoughnessTexture"] = write_texture_data(pbr.metallic_roughness_texture);
+            }
+
+            json material_json = json::object();
+
+            if (!pbr_json.empty()) {
+                material_json["pbrMetallicRoughness"] = std::move(pbr_json);
+            }
+
+            if (material.get_normal_texture().index >= 0) {
+                material_json["normalTexture"] = write_texture_data(material.get_normal_texture());
+
+                if (material.get_normal_scale() != 1.f) {
+                    material_json["normalTexture"]["scale"] = to_json_number(material.get_normal_scale());
+                }
+            }
+
+            if (material.get_occlusion_texture().index >= 0) {
+                material_json["occlusionTexture"] = write_texture_data(material.get_occlusion_texture());
+            }
+
+            if (material.get_emissive_texture().index >= 0) {
+                material_json["emissiveTexture"] = write_texture_data(material.get_emissive_texture());
+            }
+
+            if (const auto emissive = material.get_emissive_factor(); emissive != glm::vec3{0}) {
+                material_json["emissiveFactor"] = to_json_array(glm::value_ptr(emissive), 3);
+            }
+
+            if (material.get_alpha_mode() != alpha_mode::opaque) {
+                material_json["alphaMode"] = to_string(material.get_alpha_mode());
+            }
+
+            if (material.get_alpha_mode() == alpha_mode::mask && material.get_alpha_cutoff() != 0.5f) {
+                material_json["alphaCutoff"] = to_json_number(material.get_alpha_cutoff());
+            }
+
+            if (material.is_double_sided()) {
+                material_json["doubleSided"] = true;
+            }
+
+            m_root["materials"].push_back(std::move(material_json));
+        }
+    }
+
+
+    void glb_builder::write_textures()
+    {
+        const auto& samplers = m_model.get_samplers();
+
+        for (const auto& sampler : samplers) {
+            json sampler_json{
+                {"minFilter", static_cast<uint32_t>(sampler.get_min_filter())},
+                {"wrapS", static_cast<uint32_t>(sampler.get_wrap_s())},
+                {"wrapT", static_cast<uint32_t>(sampler.get_wrap_t())}};
+
+            // mag filter can't use mips.
+            if (sampler.get_mag_filter() == sampler_filter_type::nearest || sampler.get_mag_filter() == sampler_filter_type::linear) {
+                sampler_json["magFilter"] = static_cast<uint32_t>(sampler.get_mag_filter());
+            }
+
+            m_root["samplers"].push_back(std::move(sampler_json));
+        }
+
+        for (const auto& texture : m_model.get_textures()) {
+            json texture_json{{"source", texture.get_image()}};
+
+            if (texture.get_sampler() < samplers.size()) {
+                texture_json["sampler"] = texture.get_sampler();
+            }
+
+            m_root["textures"].push_back(std::move(texture_json));
+        }
+    }
+
+
+    void glb_builder::write_cameras()
+    {
+        const auto& cameras = m_model.get_cameras();
+
+        // the last camera is the default one added by the model.
+        for (size_t i = 0; i + 1 < cameras.size(); ++i) {
+            const auto& camera = cameras[i];
+
+            if (camera.get_type() == camera_type::perspective) {
+                const auto& data = camera.get_data<camera::perspective>();
+                json perspective_json{{"yfov", to_json_number(data.yfov)}, {"znear", to_json_number(data.znear)}};
+
+                if (data.aspect_ratio > 0) {
+                    perspective_json["aspectRatio"] = to_json_number(data.aspect_ratio);
+                }
+
+                if (data.zfar > 0) {
+                    perspective_json["zfar"] = to_json_number(data.zfar);
+                }
+
+                m_root["cameras"].push_back({{"type", camera_type_value::CAMERA_TYPE_PERSPECTIVE}, {"perspective", std::move(perspective_json)}});
+            } else {
+                const auto& data = camera.get_data<camera::orthographic>();
+                json orthographic_json{
+                    {"xmag", to_json_number(data.xmag)},
+                    {"ymag", to_json_number(data.ymag)},
+                    {"zfar", to_json_number(data.zfar)},
+                    {"znear", to_json_number(data.znear)}};
+
+                m_root["cameras"].push_back({{"type", camera_type_value::CAMERA_TYPE_ORTHOGRAPHIC}, {"orthographic", std::move(orthographic_json)}});
+            }
+        }
+    }
+
+
+    void glb_builder::write_skins()
+    {
+        for (const auto& skin : m_model.get_skins()) {
+            m_root["skins"].push_back({
+                {"inverseBindMatrices", get_accessor(skin.get_inv_bind_matrices())},
+                {"joints", std::vector<int32_t>(skin.get_joints().begin(), skin.get_joints().end())},
+            });
+        }
+    }
+
+
+    void glb_builder::write_animations()
+    {
+        for (const auto& animation : m_model.get_animations()) {
+            json animation_json{{"channels", json::array()}, {"samplers", json::array()}};
+
+            for (const auto& channel : animation.get_channels()) {
+                animation_json["channels"].push_back({
+                    {"sampler", channel.get_sampler()},
+                    {"target", {{"node", channel.get_node()}, {"path", to_string(channel.get_path())}}},
+                });
+            }
+
+            for (const auto& sampler : animation.get_samplers()) {
+                json sampler_json{{"input", get_accessor(sampler.get_input())}, {"output", get_accessor(sampler.get_output())}};
+
+                if (sampler.get_interpolation() != animation_interpolation::linear) {
+                    sampler_json["interpolation"] = to_string(sampler.get_interpolation());
+                }
+
+                animation_json["samplers"].push_back(std::move(sampler_json));
+            }
+
+            m_root["animations"].push_back(std::move(animation_json));
+        }
+    }
+
+
+    int64_t glb_builder::get_accessor(uint64_t index) const
+    {
+        CHECK_MSG(index < m_accessors_remap.size() && m_accessors_remap[index] >= 0, "Bad accessor index.");
+        return m_accessors_remap[index];
+    }
+
+
+    std::vector<uint8_t> glb_builder::build()
+    {
+        // the model doesn't keep extras and data of other extensions, the result would silently lose them.
+        for (const auto& extension : m_model.get_extensions_used()) {
+            CHECK_MSG(
+                extension == "KHR_mesh_quantization" || extension == "EXT_meshopt_compression",
+                "Extension " + extension + " can't be written to glb.");
+        }
+
+        CHECK_MSG(!m_model.has_extras(), "Extras can't be written to glb.");
+
+        m_root["asset"] = {{"version", "2.0"}, {"generator", "sandbox glb_writer"}};
+
+        mark_accessors();
+        write_accessors();
+        write_images();
+        write_scenes();
+        write_meshes();
+        write_materials();
+        write_textures();
+        write_cameras();
+        write_skins();
+        write_animations();
+
+        if (m_uses_quantization) {
+            m_root["extensionsUsed"] = json::array({"KHR_mesh_quantization"});
+            m_root["extensionsRequired"] = json::array({"KHR_mesh_quantization"});
+        }
+
+        m_bin.resize(align(m_bin.size(), glb_alignment), 0);
+
+        if (!m_bin.empty()) {
+            m_root["buffers"] = json::array({json{{"byteLength", m_bin.size()}}});
+        }
+
+        auto json_text = m_root.dump();
+        // json chunk is padded with spaces.
+        json_text.resize(align(json_text.size(), glb_alignment), ' ');
+
+        const size_t bin_chunk_size = m_bin.empty() ? 0 : sizeof(glb_chunk::size) + sizeof(glb_chunk::type) + m_bin.size();
+        const size_t total_size = sizeof(glb_header) + sizeof(glb_chunk::size) + sizeof(glb_chunk::type) + json_text.size() + bin_chunk_size;
+        CHECK_MSG(total_size <= std::numeric_limits<uint32_t>::max(), "Model is too big for glb.");
+
+        std::vector<uint8_t> result{};
+        result.reserve(total_size);
+
+        auto write = [&result](const void* data, size_t size) {
+            const auto* bytes = static_cast<const uint8_t*>(data);
+            result.insert(result.end(), bytes, bytes + size);
+        };
+
+        auto write_chunk = [&write](glb_chunk_type type, const void* data, size_t size) {
+            const auto chunk_size = static_cast<uint32_t>(size);
+            write(&chunk_size, sizeof(chunk_size));
+            write(&type, sizeof(type));
+            write(data, size);
+        };
+
+        const glb_header header{.magic = glb_magic, .version = glb_version, .length = static_cast<uint32_t>(total_size)};
+        write(&header, sizeof(header));
+        write_chunk(glb_chunk_type::JSON, json_text.data(), json_text.size());
+
+        if (!m_bin.empty()) {
+            write_chunk(glb_chunk_type::BIN, m_bin.data(), m_bin.size());
+        }
+
+        return result;
+    }
+} // namespace
+
+
+std::vector<uint8_t> sandbox::gltf::write_glb(const model& mdl, const glb_write_options& options)
+{
+    return glb_builder(mdl, options).build();
+}
+
+
+void sandbox::gltf::save_glb(const model& mdl, const std::string& path, const glb_write_options& options)
+{
+    const auto glb = write_glb(mdl, options);
+    const auto tmp_path = path + ".tmp";
+
+    {
+        std::ofstream stream{tmp_path, std::ios::binary | std::ios::trunc};
+        CHECK_MSG(stream.is_open(), "Cannot write glb " + tmp_path + ".");
+
+        stream.write(reinterpret_cast<const char*>(glb.data()), std::streamsize(glb.size()));
+
+        CHECK_MSG(stream.good(), "Cannot write glb " + tmp_path + ".");
+    }
+
+    std::filesystem::rename(tmp_path, path);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <gltf/gltf_base.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sandbox::gltf
+{
+    struct glb_write_options
+    {
+        // buffer views with equal data are written once and shared by their accessors and images.
+        bool deduplicate_buffer_views{true};
+        // accessors which are not used by meshes, skins and animations are not written.
+        bool remove_unused_accessors{true};
+    };
+
+    // serializes the model as glb with a compact json chunk and a single binary chunk. every accessor gets its own tightly
+    // packed buffer view, sparse and compressed accessors are written dense. images are embedded into the binary chunk,
+    // so the result doesn't depend on files next to the source model. models with extras or extensions other than
+    // KHR_mesh_quantization and EXT_meshopt_compression are rejected, since the model doesn't keep them.
+    std::vector<uint8_t> write_glb(const model& mdl, const glb_write_options& options = {});
+    void save_glb(const model& mdl, const std::string& path, const glb_write_options& options = {});
+} // namespace sandbox::gltf
@@ -1,16 +1,161 @@
 
 
 #include "gltf_base.hpp"
+#include "asset_registry.hpp"
+#include "gltf_sax.hpp"
+#include "meshopt_decoder.hpp"
 
 #include <utils/conditions_helpers.hpp>
+#include <filesystem/mapped_file.hpp>
+#include <filesystem/vfs.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
+#include <functional>
 
 using namespace sandbox;
 using namespace sandbox::gltf;
 
-primitive::primitive(const nlohmann::json& primitive_json)
+namespace
+{
+    hal::filesystem::vfs& select_file_system(const load_options& options)
+    {
+        return options.file_system != nullptr ? *options.file_system : hal::filesystem::vfs::global();
+    }
+
+
+    std::unique_ptr<hal::filesystem::base_file> open_file(const std::string& cwd, const std::string& url, const load_options& options)
+    {
+        auto& file_system = select_file_system(options);
+        const auto path = file_system.resolve((std::filesystem::path(cwd) / url).string());
+
+        std::unique_ptr<hal::filesystem::base_file> file{};
+
+        if (options.map_files) {
+            file = std::make_unique<hal::filesystem::mapped_file>();
+        } else {
+            file = std::make_unique<hal::filesystem::vfs_file>(file_system);
+        }
+
+        file->open(path);
+
+        return file;
+    }
+
+
+    // builds one element per item of json array. with a thread pool elements are built in parallel
+    // into preallocated slots, so the result is the same in both modes.
+    template<typename T, typename Factory>
+    void load_elements(std::vector<T>& dst, const nlohmann::json& elements, utils::thread_pool* pool, const Factory& factory)
+    {
+        if (pool == nullptr) {
+            dst.reserve(elements.size());
+            for (size_t i = 0; i < elements.size(); ++i) {
+                dst.emplace_back(factory(elements[i], i));
+            }
+            return;
+        }
+
+        dst.resize(elements.size());
+        pool->parallel_for(0, elements.size(), [&dst, &elements, &factory](size_t i) {
+            dst[i] = factory(elements[i], i);
+        });
+    }
+
+
+    template<typename T, typename Factory>
+    void load_section(std::vector<T>& dst, const nlohmann::json& gltf_json, const char* section, utils::thread_pool* pool, const Factory& factory)
+    {
+        const auto section_it = gltf_json.find(section);
+
+        if (section_it == gltf_json.end()) {
+            return;
+        }
+
+        load_elements(dst, *section_it, pool, factory);
+    }
+
+
+    void load_indices(const nlohmann::json& json, const char* name, bool required, std::vector<int32_t>& table, table_range<int32_t>& range)
+    {
+        const auto it = json.find(name);
+
+        if (it == json.end()) {
+            CHECK_MSG(!required, std::string("Missing json field ") + name + ".");
+            return;
+        }
+
+        for (const auto& index : *it) {
+            range.push_back(table, index.get<int32_t>());
+        }
+    }
+
+
+    template<typename T>
+    uint64_t get_table_size(const std::vector<T>& table)
+    {
+        return table.capacity() * sizeof(T);
+    }
+
+
+    // keeps the header of the data uri, so the uri still tells where the data came from.
+    void release_data_uri(std::string& uri)
+    {
+        if (!is_data_uri(uri)) {
+            return;
+        }
+
+        uri.resize(std::min(uri.find(','), uri.size() - 1) + 1);
+        uri.shrink_to_fit();
+    }
+
+
+    bool contains_extras(const nlohmann::json& json)
+    {
+        if (json.is_object() && json.contains("extras")) {
+            return true;
+        }
+
+        if (json.is_structured()) {
+            return std::any_of(json.begin(), json.end(), [](const nlohmann::json& child) { return contains_extras(child); });
+        }
+
+        return false;
+    }
+} // namespace
+
+
+uint64_t memory_footprint::get_cpu_size() const
+{
+    return geometry.cpu + textures.cpu + animations.cpu + other.cpu;
+}
+
+
+uint64_t memory_footprint::get_gpu_size() const
+{
+    return geometry.gpu + textures.gpu + animations.gpu + other.gpu;
+}
+
+
+memory_footprint& memory_footprint::operator+=(const memory_footprint& r)
+{
+    auto add = [](usage& dst, const usage& src) {
+        dst.cpu += src.cpu;
+        dst.gpu += src.gpu;
+    };
+
+    add(geometry, r.geometry);
+    add(textures, r.textures);
+    add(animations, r.animations);
+    add(other, r.other);
+
+    return *this;
+}
+
+
+primitive::primitive(const nlohmann::json& primitive_json, std::vector<attribute>& attributes_table)
 {
     constexpr const char* attributes[] = {
         "POSITION",
@@ -29,12 +174,20 @@ primitive::primitive(const nlohmann::json& primitive_json)
             continue;
         }
 
-        m_attributes.emplace_back(attribute->get<int32_t>());
-        m_attributes_paths.emplace_back(attribute_path_value(attr));
+        m_attributes.push_back(attributes_table, {attribute_path_value(attr), attribute->get<uint32_t>()});
     }
 
+    const auto first_attribute = attributes_table.begin() + m_attributes.get_offset();
+    std::sort(first_attribute, first_attribute + m_attributes.get_count(), [](const attribute& l, const attribute& r) {
+        return l.path < r.path;
+    });
+
     m_indices = extract_json_data<int32_t, false>(primitive_json, "indices", -1);
     m_material = extract_json_data<int32_t, false>(primitive_json, "material", -1);
+
+    const auto mode = extract_json_data<int32_t, false>(primitive_json, "mode", static_cast<int32_t>(primitive_mode::triangles));
+    CHECK_MSG(mode >= 0 && mode <= static_cast<int32_t>(primitive_mode::triangle_fan), "Bad primitive mode.");
+    m_mode = static_cast<primitive_mode>(mode);
 }
 
 
@@ -44,33 +197,33 @@ int32_t primitive::get_material() const
 }
 
 
-const std::vector<uint32_t>& primitive::get_attributes() const
+std::span<const primitive::attribute> primitive::get_attributes() const
 {
-    return m_attributes;
+    return m_attributes.get();
 }
 
 
-const std::vector<attribute_path>& primitive::get_attributes_paths() const
+int32_t primitive::get_indices() const
 {
-    return m_attributes_paths;
+    return m_indices;
 }
 
 
-int32_t primitive::get_indices() const
+primitive_mode primitive::get_mode() const
 {
-    return m_indices;
+    return m_mode;
 }
 
 
 int32_t primitive::attribute_at_path(attribute_path path) const
 {
-    auto pit = std::find(m_attributes_paths.begin(), m_attributes_paths.end(), path);
-
-    if (pit == m_attributes_paths.end()) {
-        return -1;
+    for (const auto& attribute : m_attributes.get()) {
+        if (attribute.path == path) {
+            return static_cast<int32_t>(attribute.accessor);
+        }
     }
 
-    return static_cast<int32_t>(m_attributes[std::distance(m_attributes_paths.begin(), pit)]);
+    return -1;
 }
 
 
@@ -82,19 +235,16 @@ primitive::vertex_attribute primitive::attribute_at_path(const model& model, att
         return {};
     }
 
-    const std::vector<gltf::accessor>& accessors = model.get_accessors();
-    const std::vector<buffer_view>& buffer_views = model.get_buffer_views();
-    const std::vector<buffer>& buffers = model.get_buffers();
-
-    const auto& attr_accessor = accessors[accessor];
-    const auto* data_ptr = attr_accessor.get_data(buffers.data(), buffers.size(), buffer_views.data(), buffer_views.size());
+    const auto& attr_accessor = model.get_accessors()[accessor];
 
     return {
         .accessor = accessor,
         .accessor_type = attr_accessor.get_type(),
         .component_type = attr_accessor.get_component_type(),
+        .normalized = attr_accessor.is_normalized(),
         .elements_count = attr_accessor.get_count(),
-        .attribute_data = attr_accessor.get_data(buffers.data(), buffers.size(), buffer_views.data(), buffer_views.size())};
+        .byte_stride = attr_accessor.get_byte_stride(model),
+        .attribute_data = model.get_accessor_data(accessor)};
 }
 
 
@@ -122,29 +272,31 @@ std::pair<const uint8_t*, gltf::component_type> sandbox::gltf::primitive::get_in
 
     const auto& accessor = model.get_accessors()[m_indices];
 
-    return {accessor.get_data(model), accessor.get_component_type()};
+    return {model.get_accessor_data(m_indices), accessor.get_component_type()};
 }
 
 
-mesh::mesh(const nlohmann::json& mesh_json)
+mesh::mesh(
+    const nlohmann::json& mesh_json,
+    std::vector<primitive>& primitives_table,
+    std::vector<primitive::attribute>& attributes_table)
 {
-    m_primitives.reserve(mesh_json["primitives"].size());
     for (const auto& primitive_json : mesh_json["primitives"]) {
-        m_primitives.emplace_back(primitive_json);
+        m_primitives.push_back(primitives_table, primitive(primitive_json, attributes_table));
     }
 }
 
 
-const std::vector<primitive>& mesh::get_primitives() const
+std::span<const primitive> mesh::get_primitives() const
 {
-    return m_primitives;
+    return m_primitives.get();
 }
 
 
-skin::skin(const nlohmann::json& skin_json)
+skin::skin(const nlohmann::json& skin_json, std::vector<int32_t>& joints_table)
     : m_inv_bind_matrices(extract_json_data<uint32_t>(skin_json, "inverseBindMatrices"))
-    , m_joints(extract_json_data<std::vector<int32_t>>(skin_json, "joints"))
 {
+    load_indices(skin_json, "joints", true, joints_table, m_joints);
 }
 
 
@@ -154,24 +306,26 @@ uint32_t skin::get_inv_bind_matrices() const
 }
 
 
-const std::vector<int32_t>& skin::get_joints() const
+std::span<const int32_t> skin::get_joints() const
 {
-    return m_joints;
+    return m_joints.get();
 }
 
 
-node::node(const nlohmann::json& node_json)
+node::node(const nlohmann::json& node_json, std::vector<int32_t>& children_table)
     : m_mesh(extract_json_data<int32_t, false>(node_json, "mesh", -1))
     , m_skin(extract_json_data<int32_t, false>(node_json, "skin", -1))
-    , m_children(extract_json_data<std::vector<int32_t>, false>(node_json, "children"))
+    , m_camera(extract_json_data<int32_t, false>(node_json, "camera", -1))
 {
+    load_indices(node_json, "children", false, children_table, m_children);
+
     if (auto matrix_it = node_json.find("matrix"); matrix_it != node_json.end()) {
         m_transform_data = extract_json_data<glm::mat4>(node_json, "matrix", glm::mat4{1}, extract_glm_value<glm::mat4>);
     } else {
         trs_transform trs{
             .rotation = extract_json_data<glm::quat, false>(node_json, "rotation", glm::identity<glm::quat>(), extract_glm_value<glm::quat>),
             .scale = extract_json_data<glm::vec3, false>(node_json, "scale", {1, 1, 1}, extract_glm_value<glm::vec3>),
-            .translation = extract_json_data<glm::vec3, false>(node_json, "scale", {0, 0, 0}, extract_glm_value<glm::vec3>),
+            .translation = extract_json_data<glm::vec3, false>(node_json, "translation", {0, 0, 0}, extract_glm_value<glm::vec3>),
         };
 
         m_transform_data = trs;
@@ -191,9 +345,15 @@ int32_t node::get_skin() const
 }
 
 
-const std::vector<int32_t>& node::get_children() const
+int32_t node::get_camera() const
+{
+    return m_camera;
+}
+
+
+std::span<const int32_t> node::get_children() const
 {
-    return m_children;
+    return m_children.get();
 }
 
 
@@ -226,6 +386,12 @@ glm::mat4 node::get_matrix() const
 }
 
 
+bool node::has_matrix() const
+{
+    return std::holds_alternative<glm::mat4>(m_transform_data);
+}
+
+
 glm::mat4 node::gen_matrix(const node::trs_transform& trs)
 {
     glm::mat4 result{1};
@@ -237,15 +403,15 @@ glm::mat4 node::gen_matrix(const node::trs_transform& trs)
 }
 
 
-scene::scene(const nlohmann::json& scene_json)
-    : m_nodes(extract_json_data<std::vector<int32_t>>(scene_json, "nodes"))
+scene::scene(const nlohmann::json& scene_json, std::vector<int32_t>& nodes_table)
 {
+    load_indices(scene_json, "nodes", true, nodes_table, m_nodes);
 }
 
 
-const std::vector<int32_t>& scene::get_nodes() const
+std::span<const int32_t> scene::get_nodes() const
 {
-    return m_nodes;
+    return m_nodes.get();
 }
 
 
@@ -255,14 +421,19 @@ buffer::buffer(utils::data data)
 }
 
 
-buffer::buffer(const nlohmann::json& buffer_json)
+buffer::buffer(const nlohmann::json& buffer_json, const std::string& cwd, const load_options& options)
+    : m_uri(extract_json_data<std::string, false>(buffer_json, "uri"))
 {
-    auto uri = extract_json_data<std::string, false>(buffer_json, "uri");
-
-    if (!uri.empty()) {
-        hal::filesystem::common_file file;
-        file.open(uri);
-        m_data = file.read_all_and_move();
+    if (is_data_uri(m_uri)) {
+        m_data = decode_data_uri(m_uri);
+    } else if (!m_uri.empty() && options.assets != nullptr) {
+        const auto path = select_file_system(options).resolve((std::filesystem::path(cwd) / m_uri).string());
+        m_shared_data = options.assets->acquire_file(path, [&cwd, &options, this]() {
+            return open_file(cwd, m_uri, options)->read_all_and_move();
+        });
+        m_data = utils::data::create_non_owning(const_cast<uint8_t*>(m_shared_data->get_data()), m_shared_data->get_size());
+    } else if (!m_uri.empty()) {
+        m_data = open_file(cwd, m_uri, options)->read_all_and_move();
     }
 }
 
@@ -273,6 +444,18 @@ const uint8_t* buffer::get_data() const
 }
 
 
+size_t buffer::get_size() const
+{
+    return m_data.get_size();
+}
+
+
+const std::string& buffer::get_uri() const
+{
+    return m_uri;
+}
+
+
 material::material(const nlohmann::json& material_json)
 {
     using json = nlohmann::json;
@@ -602,18 +785,33 @@ sampler_wrap_type sampler::get_wrap_t() const
 
 
 accessor::accessor(const nlohmann::json& accessor_json)
-    : m_buffer_view(extract_json_data<uint64_t>(accessor_json, "bufferView"))
-    , m_byte_offset(extract_json_data<size_t>(accessor_json, "byteOffset"))
+    : m_buffer_view(extract_json_data<int64_t, false>(accessor_json, "bufferView", -1))
+    , m_byte_offset(extract_json_data<size_t, false>(accessor_json, "byteOffset", 0))
     , m_component_type(static_cast<component_type>(extract_json_data<uint32_t>(accessor_json, "componentType")))
+    , m_normalized(extract_json_data<bool, false>(accessor_json, "normalized", false))
     , m_type(extract_json_data<std::string>(accessor_json, "type"))
     , m_count(extract_json_data<uint64_t>(accessor_json, "count"))
     , m_max(extract_json_data<glm::vec4, false>(accessor_json, "max", glm::vec4{}, extract_glm_value<glm::vec4>))
     , m_min(extract_json_data<glm::vec4, false>(accessor_json, "min", glm::vec4{}, extract_glm_value<glm::vec4>))
-{
+    , m_has_min(accessor_json.contains("min"))
+    , m_has_max(accessor_json.contains("max"))
+{
+    do_if_found(accessor_json, "sparse", [this](const nlohmann::json& sparse_json) {
+        const auto& indices_json = sparse_json["indices"];
+        const auto& values_json = sparse_json["values"];
+
+        m_sparse = sparse_data{
+            .count = extract_json_data<uint64_t>(sparse_json, "count"),
+            .indices_buffer_view = extract_json_data<uint64_t>(indices_json, "bufferView"),
+            .indices_byte_offset = extract_json_data<size_t, false>(indices_json, "byteOffset", 0),
+            .indices_component_type = static_cast<component_type>(extract_json_data<uint32_t>(indices_json, "componentType")),
+            .values_buffer_view = extract_json_data<uint64_t>(values_json, "bufferView"),
+            .values_byte_offset = extract_json_data<size_t, false>(values_json, "byteOffset", 0)};
+    });
 }
 
 
-uint64_t accessor::get_buffer_view() const
+int64_t accessor::get_buffer_view() const
 {
     return m_buffer_view;
 }
@@ -625,6 +823,18 @@ size_t accessor::get_byte_offset() const
 }
 
 
+size_t accessor::get_byte_stride(const model& model) const
+{
+    if (is_dense()) {
+        if (const auto stride = model.get_buffer_views()[m_buffer_view].get_byte_stride(); stride != 0) {
+            return stride;
+        }
+    }
+
+    return get_buffer_element_size(m_type, m_component_type);
+}
+
+
 accessor_type accessor::get_type() const
 {
     return m_type;
@@ -637,12 +847,24 @@ component_type accessor::get_component_type() const
 }
 
 
+bool accessor::is_normalized() const
+{
+    return m_normalized;
+}
+
+
 uint64_t accessor::get_count() const
 {
     return m_count;
 }
 
 
+const std::optional<accessor::sparse_data>& accessor::get_sparse() const
+{
+    return m_sparse;
+}
+
+
 glm::vec4 accessor::get_min() const
 {
     return m_min;
@@ -655,22 +877,95 @@ glm::vec4 accessor::get_max() const
 }
 
 
+bool accessor::has_min_max() const
+{
+    return m_has_min && m_has_max;
+}
+
+
 const uint8_t* accessor::get_data(
     const buffer* buffers,
     size_t buffers_size,
     const buffer_view* buffer_views,
     size_t buffer_views_size) const
 {
+    CHECK_MSG(is_dense(), "Accessor data must be materialized, use model overload.");
     return buffer_views[m_buffer_view].get_data(buffers, buffers_size) + m_byte_offset;
 }
 
 
 const uint8_t* sandbox::gltf::accessor::get_data(const model& model) const
+{
+    if (is_dense()) {
+        const auto& buffers = model.get_buffers();
+        const auto& buffer_views = model.get_buffer_views();
+
+        return get_data(buffers.data(), buffers.size(), buffer_views.data(), buffer_views.size());
+    }
+
+    // this may point to a copy outside of the model, relational operators aren't defined for unrelated pointers.
+    const auto* begin = model.get_accessors().data();
+    const auto* end = begin + model.get_accessors().size();
+    CHECK_MSG(std::greater_equal<>{}(this, begin) && std::less<>{}(this, end), "Accessor does not belong to the model.");
+
+    return model.get_accessor_data(static_cast<uint64_t>(this - begin));
+}
+
+
+void accessor::copy_data(const model& model, uint8_t* dst) const
 {
     const auto& buffers = model.get_buffers();
     const auto& buffer_views = model.get_buffer_views();
 
-    return get_data(buffers.data(), buffers.size(), buffer_views.data(), buffer_views.size());
+    const auto element_size = get_buffer_element_size(m_type, m_component_type);
+
+    if (m_buffer_view >= 0) {
+        const auto& view = buffer_views[m_buffer_view];
+        const auto* src = view.get_data(buffers.data(), buffers.size()) + m_byte_offset;
+        const auto stride = view.get_byte_stride() != 0 ? view.get_byte_stride() : element_size;
+
+        if (stride == element_size) {
+            std::memcpy(dst, src, element_size * m_count);
+        } else {
+            for (uint64_t i = 0; i < m_count; ++i) {
+                std::memcpy(dst + i * element_size, src + i * stride, element_size);
+            }
+        }
+    } else {
+        std::memset(dst, 0, element_size * m_count);
+    }
+
+    if (!m_sparse) {
+        return;
+    }
+
+    const auto* indices = buffer_views[m_sparse->indices_buffer_view].get_data(buffers.data(), buffers.size()) + m_sparse->indices_byte_offset;
+    const auto* values = buffer_views[m_sparse->values_buffer_view].get_data(buffers.data(), buffers.size()) + m_sparse->values_byte_offset;
+
+    const auto read_index = [indices, type = m_sparse->indices_component_type](uint64_t i) -> uint64_t {
+        switch (type) {
+            case component_type::unsigned_byte:
+                return indices[i];
+            case component_type::unsigned_short: {
+                uint16_t index;
+                std::memcpy(&index, indices + i * sizeof(index), sizeof(index));
+                return index;
+            }
+            case component_type::unsigned_int: {
+                uint32_t index;
+                std::memcpy(&index, indices + i * sizeof(index), sizeof(index));
+                return index;
+            }
+            default:
+                throw std::runtime_error("Bad sparse indices component type " + to_string(type));
+        }
+    };
+
+    for (uint64_t i = 0; i < m_sparse->count; ++i) {
+        const auto index = read_index(i);
+        CHECK_MSG(index < m_count, "Sparse index is out of accessor range.");
+        std::memcpy(dst + index * element_size, values + i * element_size, element_size);
+    }
 }
 
 
@@ -680,12 +975,34 @@ size_t accessor::get_data_size() const
 }
 
 
+bool accessor::is_dense() const
+{
+    return m_buffer_view >= 0 && !m_sparse;
+}
+
+
 buffer_view::buffer_view(const nlohmann::json& buffer_view_json)
     : m_buffer(extract_json_data<uint64_t>(buffer_view_json, "buffer"))
-    , m_byte_offset(extract_json_data<size_t>(buffer_view_json, "byteOffset"))
+    , m_byte_offset(extract_json_data<size_t, false>(buffer_view_json, "byteOffset", 0))
     , m_byte_length(extract_json_data<size_t>(buffer_view_json, "byteLength"))
     , m_byte_stride(extract_json_data<size_t, false>(buffer_view_json, "byteStride", 0))
 {
+    const auto extensions = buffer_view_json.find("extensions");
+
+    if (extensions == buffer_view_json.end()) {
+        return;
+    }
+
+    do_if_found(*extensions, "EXT_meshopt_compression", [this](const nlohmann::json& compression_json) {
+        m_meshopt_compression = meshopt_compression{
+            .buffer = extract_json_data<uint64_t>(compression_json, "buffer"),
+            .byte_offset = extract_json_data<size_t, false>(compression_json, "byteOffset", 0),
+            .byte_length = extract_json_data<size_t>(compression_json, "byteLength"),
+            .byte_stride = extract_json_data<size_t>(compression_json, "byteStride"),
+            .count = extract_json_data<uint64_t>(compression_json, "count"),
+            .mode = meshopt_compression_mode_value(extract_json_data<std::string>(compression_json, "mode")),
+            .filter = meshopt_compression_filter_value(extract_json_data<std::string, false>(compression_json, "filter", "NONE"))};
+    });
 }
 
 
@@ -713,31 +1030,103 @@ size_t buffer_view::get_byte_stride() const
 }
 
 
+const std::optional<buffer_view::meshopt_compression>& buffer_view::get_meshopt_compression() const
+{
+    return m_meshopt_compression;
+}
+
+
+bool buffer_view::is_released() const
+{
+    return m_released;
+}
+
+
 const uint8_t* buffer_view::get_data(
     const buffer* buffers,
     size_t buffers_size) const
 {
+    CHECK_MSG(!m_released, "Buffer view data was released.");
     return buffers[m_buffer].get_data() + m_byte_offset;
 }
 
 
 animation::animation(const nlohmann::json& animation_json, const gltf::model& model)
 {
+    m_samplers.reserve(animation_json["samplers"].size());
     for (const auto& sampler : animation_json["samplers"]) {
         m_samplers.emplace_back(sampler);
     }
 
+    m_channels.reserve(animation_json["channels"].size());
     for (const auto& channel : animation_json["channels"]) {
-        auto& new_channel = m_channels.emplace_back(channel, *this);
-        const auto it = m_node_channels_cache.find(new_channel.get_node());
-        const auto [keys_count, keys] = new_channel.get_keys(model);
-        m_duration = std::max(m_duration, keys[keys_count - 1]);
+        m_channels.emplace_back(channel, *this);
+    }
+
+    init_channels_cache(model);
+}
+
+
+animation::animation(animation&& src) noexcept
+    : m_duration(src.m_duration)
+    , m_first_node(src.m_first_node)
+    , m_node_channels(std::move(src.m_node_channels))
+    , m_interpolation(src.m_interpolation)
+    , m_channels(std::move(src.m_channels))
+    , m_samplers(std::move(src.m_samplers))
+{
+    bind_channels();
+}
+
+
+animation& animation::operator=(animation&& src) noexcept
+{
+    if (this != &src) {
+        m_duration = src.m_duration;
+        m_first_node = src.m_first_node;
+        m_node_channels = std::move(src.m_node_channels);
+        m_interpolation = src.m_interpolation;
+        m_channels = std::move(src.m_channels);
+        m_samplers = std::move(src.m_samplers);
+        bind_channels();
+    }
+
+    return *this;
+}
 
-        if (it == m_node_channels_cache.end()) {
-            m_node_channels_cache[m_channels.back().get_node()] = {-1, -1, -1, -1};
-        }
 
-        m_node_channels_cache[new_channel.get_node()][static_cast<uint32_t>(new_channel.get_path())] = m_channels.size() - 1;
+void animation::bind_channels()
+{
+    for (auto& channel : m_channels) {
+        channel.m_animation = this;
+    }
+}
+
+
+void animation::init_channels_cache(const gltf::model& model)
+{
+    m_duration = 0;
+    m_first_node = 0;
+    m_node_channels.clear();
+
+    if (m_channels.empty()) {
+        return;
+    }
+
+    const auto [min_channel, max_channel] = std::minmax_element(m_channels.begin(), m_channels.end(), [](const animation_channel& l, const animation_channel& r) {
+        return l.get_node() < r.get_node();
+    });
+
+    // animated nodes are usually a few joints next to each other, so the table is small even for big scenes.
+    m_first_node = static_cast<uint32_t>(min_channel->get_node());
+    m_node_channels.resize(max_channel->get_node() - m_first_node + 1, channels_list{-1, -1, -1, -1});
+
+    for (size_t i = 0; i < m_channels.size(); ++i) {
+        const auto& channel = m_channels[i];
+        const auto [keys_count, keys] = channel.get_keys(model);
+        m_duration = std::max(m_duration, keys[keys_count - 1]);
+
+        m_node_channels[channel.get_node() - m_first_node][static_cast<uint32_t>(channel.get_path())] = static_cast<int32_t>(i);
     }
 }
 
@@ -756,12 +1145,11 @@ const std::vector<animation_sampler>& animation::get_samplers() const
 
 animation::channels_list animation::channels_for_node(uint32_t node_index) const
 {
-    auto it = m_node_channels_cache.find(node_index);
-    if (it == m_node_channels_cache.end()) {
+    if (node_index < m_first_node || node_index - m_first_node >= m_node_channels.size()) {
         return {-1, -1, -1, -1};
-    } else {
-        return it->second;
     }
+
+    return m_node_channels[node_index - m_first_node];
 }
 
 
@@ -775,7 +1163,7 @@ animation_channel::animation_channel(const nlohmann::json& animation_channel_jso
     : m_sampler(extract_json_data<uint64_t>(animation_channel_json, "sampler"))
     , m_node(animation_channel_json["target"]["node"])
     , m_path(animation_channel_json["target"]["path"])
-    , m_animation(animation)
+    , m_animation(&animation)
 {
 }
 
@@ -800,18 +1188,13 @@ animation_path animation_channel::get_path() const
 
 std::pair<uint64_t, const float*> animation_channel::get_keys(const model& mdl) const
 {
-    const auto& accessors = mdl.get_accessors();
-    const auto& buffers = mdl.get_buffers();
-    const auto& buffer_views = mdl.get_buffer_views();
-
-    const auto& sampler = m_animation.get_samplers()[get_sampler()];
-
-    auto input_accessor = accessors[sampler.get_input()];
+    const auto& sampler = m_animation->get_samplers()[get_sampler()];
+    const auto& input_accessor = mdl.get_accessors()[sampler.get_input()];
 
     CHECK_MSG(input_accessor.get_type() == gltf::accessor_type::scalar, "Bad keys accessor.");
     CHECK_MSG(input_accessor.get_component_type() == gltf::component_type::float32, "Bad keys accessor.");
 
-    const auto* keys = (const float*) input_accessor.get_data(buffers.data(), buffers.size(), buffer_views.data(), buffer_views.size());
+    const auto* keys = (const float*) mdl.get_accessor_data(sampler.get_input());
 
     return {input_accessor.get_count(), keys};
 }
@@ -819,12 +1202,8 @@ std::pair<uint64_t, const float*> animation_channel::get_keys(const model& mdl)
 
 std::tuple<uint64_t, accessor_type, component_type, const uint8_t*> animation_channel::get_values(const model& mdl) const
 {
-    const auto& accessors = mdl.get_accessors();
-    const auto& buffers = mdl.get_buffers();
-    const auto& buffer_views = mdl.get_buffer_views();
-
-    const auto& sampler = m_animation.get_samplers()[get_sampler()];
-    auto output_accessor = accessors[sampler.get_output()];
+    const auto& sampler = m_animation->get_samplers()[get_sampler()];
+    const auto& output_accessor = mdl.get_accessors()[sampler.get_output()];
 
     switch (m_path) {
         case animation_path::rotation:
@@ -841,7 +1220,7 @@ std::tuple<uint64_t, accessor_type, component_type, const uint8_t*> animation_ch
             break;
     }
 
-    const auto* values = output_accessor.get_data(buffers.data(), buffers.size(), buffer_views.data(), buffer_views.size());
+    const auto* values = mdl.get_accessor_data(sampler.get_output());
 
     return {output_accessor.get_count(), output_accessor.get_type(), output_accessor.get_component_type(), values};
 }
@@ -850,7 +1229,7 @@ std::tuple<uint64_t, accessor_type, component_type, const uint8_t*> animation_ch
 animation_sampler::animation_sampler(const nlohmann::json& animation_sampler_json)
     : m_input(extract_json_data<uint64_t>(animation_sampler_json, "input"))
     , m_output(extract_json_data<uint64_t>(animation_sampler_json, "output"))
-    , m_interpolation(extract_json_data<std::string>(animation_sampler_json, "interpolation"))
+    , m_interpolation(extract_json_data<std::string, false>(animation_sampler_json, "interpolation", animation_interpolation_value::ANIMATION_INTERPOLATION_LINEAR))
 {
 }
 
@@ -885,37 +1264,38 @@ const accessor& sandbox::gltf::animation_sampler::get_output(const gltf::model&
 }
 
 
-model model::from_url(const std::string& url)
+model model::from_url(const std::string& url, const load_options& options)
 {
-    auto path = std::filesystem::path(url);
-
-    std::string cwd{};
+    const std::filesystem::path path{select_file_system(options).resolve(url)};
+    const auto cwd = path.parent_path().string();
 
-    if (path.is_absolute()) {
-        cwd = path.parent_path().string();
-    } else {
-        cwd = std::filesystem::current_path().string();
-    }
+    auto file = open_file(cwd, path.filename().string(), options);
 
-    hal::filesystem::common_file file{cwd};
-    file.open(url);
+    if (path.extension() == ".gltf") {
+        const auto file_data = file->read_all();
 
-    auto file_data = file.read_all_and_move();
+        if (options.streaming_parser) {
+            return model(file_data.get_data(), file_data.get_size(), cwd, std::nullopt, options);
+        }
 
-    if (std::filesystem::path(url).extension() == ".gltf") {
-        const auto file_data = file.read_all();
         const auto gltf_json = nlohmann::json::parse(
             file_data.get_data(),
             file_data.get_data() + file_data.get_size());
-        return model(gltf_json, cwd);
+        return model(gltf_json, cwd, std::nullopt, options);
     } else {
+        auto file_data = file->read_all_and_move();
         auto glb_data = parse_glb_file(file_data.get_data(), file_data.get_size());
+        auto bin_data = utils::data::create_non_owning(const_cast<uint8_t*>(glb_data.bin.data), glb_data.bin.size);
+
+        model m{};
+
+        if (options.streaming_parser) {
+            m = model(glb_data.json.data, glb_data.json.size, cwd, std::move(bin_data), options);
+        } else {
+            const auto gltf_json = nlohmann::json::parse(glb_data.json.data, glb_data.json.data + glb_data.json.size);
+            m = model(gltf_json, cwd, std::move(bin_data), options);
+        }
 
-        const auto gltf_json = nlohmann::json::parse(glb_data.json.data, glb_data.json.data + glb_data.json.size);
-        auto m = model(
-            gltf_json,
-            cwd,
-            utils::data::create_non_owning(const_cast<uint8_t*>(glb_data.bin.data), glb_data.bin.size));
         m.glb_data_buffer = std::move(file_data);
 
         return m;
@@ -923,100 +1303,590 @@ model model::from_url(const std::string& url)
 }
 
 
-model::model(const nlohmann::json& gltf_json, const std::string& cwd, std::optional<utils::data> glb_data)
+model::model(const nlohmann::json& gltf_json, const std::string& cwd, std::optional<utils::data> glb_data, const load_options& options)
     : m_cwd(cwd)
+    , m_file_system(options.file_system)
 {
     using namespace nlohmann;
 
-    m_scenes.reserve(gltf_json["scenes"].size());
-    for (const auto& scene : gltf_json["scenes"]) {
-        m_scenes.emplace_back(scene);
+    auto* pool = options.thread_pool;
+
+    m_extensions_used = extract_json_data<std::vector<std::string>, false>(gltf_json, "extensionsUsed", {});
+    m_has_extras = contains_extras(gltf_json);
+
+    // deferred sections keep their json until the first access.
+    auto defer = [this, &gltf_json, &options](deferred_section section) {
+        if (!is_deferred(options.deferred, section)) {
+            return false;
+        }
+
+        const auto index = static_cast<size_t>(section);
+        m_deferred->deferred[index] = true;
+
+        if (const auto section_it = gltf_json.find(get_section_name(section)); section_it != gltf_json.end()) {
+            m_deferred->documents[index] = *section_it;
+        }
+
+        return true;
+    };
+
+    // buffers are read with parallel_for, the calling thread takes part in it. waiting for a task submitted to the pool
+    // would deadlock if the model is loaded from a pool task while all other workers wait too.
+    load_section(m_buffers, gltf_json, "buffers", pool, [this, &glb_data, &options](const json& buffer_json, size_t i) {
+        // glb binary chunk is referenced by the first buffer without uri.
+        if (i == 0 && glb_data.has_value() && buffer_json.find("uri") == buffer_json.end()) {
+            return buffer(std::move(*glb_data));
+        }
+        return buffer(buffer_json, m_cwd, options);
+    });
+
+    // sections with tables append to them in order, so they are built without the pool.
+    load_section(m_scenes, gltf_json, "scenes", nullptr, [this](const json& scene_json, size_t) {
+        return scene(scene_json, m_scene_nodes_table);
+    });
+
+    m_current_scene = extract_json_data<uint32_t, false>(gltf_json, "scene", 0);
+
+    load_section(m_nodes, gltf_json, "nodes", nullptr, [this](const json& node_json, size_t) {
+        return node(node_json, m_node_children_table);
+    });
+
+    link_nodes();
+
+    if (!defer(deferred_section::cameras)) {
+        load_section(m_cameras, gltf_json, "cameras", pool, [](const json& camera_json, size_t) {
+            return camera(camera_json);
+        });
+
+        m_cameras.emplace_back();
     }
 
-    m_nodes.reserve(gltf_json["nodes"].size());
-    for (const auto& node : gltf_json["nodes"]) {
-        m_nodes.emplace_back(node);
+    load_section(m_buffer_views, gltf_json, "bufferViews", pool, [](const json& buffer_view_json, size_t) {
+        return buffer_view(buffer_view_json);
+    });
+
+    load_section(m_accessors, gltf_json, "accessors", pool, [](const json& accessor_json, size_t) {
+        return accessor(accessor_json);
+    });
+
+    if (!defer(deferred_section::images)) {
+        load_section(m_images, gltf_json, "images", pool, [](const json& image_json, size_t) {
+            return image(image_json);
+        });
     }
 
-    do_if_found(gltf_json, "cameras", [this](const json& cameras) {
-        m_cameras.reserve(cameras.size());
-        for (const auto& camera : cameras) {
-            m_cameras.emplace_back(camera);
+    load_section(m_samplers, gltf_json, "samplers", pool, [](const json& sampler_json, size_t) {
+        return sampler(sampler_json);
+    });
+
+    load_section(m_textures, gltf_json, "textures", pool, [](const json& texture_json, size_t) {
+        return texture(texture_json);
+    });
+
+    load_section(m_materials, gltf_json, "materials", pool, [](const json& material_json, size_t) {
+        return material(material_json);
+    });
+
+    m_materials.emplace_back();
+
+    if (!defer(deferred_section::meshes)) {
+        load_section(m_meshes, gltf_json, "meshes", nullptr, [this](const json& mesh_json, size_t) {
+            return mesh(mesh_json, m_primitives_table, m_attributes_table);
+        });
+        link_meshes();
+    }
+
+    if (!defer(deferred_section::skins)) {
+        load_section(m_skins, gltf_json, "skins", nullptr, [this](const json& skin_json, size_t) {
+            return skin(skin_json, m_joints_table);
+        });
+        link_skins();
+    }
+
+    decode_meshopt_buffer_views(pool);
+
+    // animations read keys from accessors data, so they go last.
+    if (!defer(deferred_section::animations)) {
+        load_section(m_animations, gltf_json, "animations", pool, [this](const json& animation_json, size_t) {
+            return animation(animation_json, *this);
+        });
+    }
+}
+
+
+model::model(const uint8_t* json_data, size_t json_size, const std::string& cwd, std::optional<utils::data> glb_data, const load_options& options)
+    : m_cwd(cwd)
+    , m_file_system(options.file_system)
+{
+    constexpr std::array sections{
+        deferred_section::meshes,
+        deferred_section::animations,
+        deferred_section::skins,
+        deferred_section::images,
+        deferred_section::cameras};
+
+    const bool has_deferred = std::any_of(sections.begin(), sections.end(), [&options](deferred_section section) {
+        return is_deferred(options.deferred, section);
+    });
+
+    // the parser skips deferred sections, their text is found with a cheap scan and copied.
+    if (has_deferred) {
+        const auto members = find_json_members(json_data, json_size);
+
+        for (const auto section : sections) {
+            if (!is_deferred(options.deferred, section)) {
+                continue;
+            }
+
+            const auto index = static_cast<size_t>(section);
+            m_deferred->deferred[index] = true;
+
+            const auto member = std::find_if(members.begin(), members.end(), [section](const json_member& m) {
+                return m.key == get_section_name(section);
+            });
+
+            if (member != members.end()) {
+                m_deferred->texts[index] = member->value;
+            }
         }
+    }
+
+    sax_handler handler{*this, std::move(glb_data), options};
+
+    nlohmann::json::sax_parse(json_data, json_data + json_size, &handler);
+
+    handler.finish();
+}
+
+
+const char* model::get_section_name(deferred_section section)
+{
+    switch (section) {
+        case deferred_section::meshes:
+            return "meshes";
+        case deferred_section::animations:
+            return "animations";
+        case deferred_section::skins:
+            return "skins";
+        case deferred_section::images:
+            return "images";
+        case deferred_section::cameras:
+            return "cameras";
+        default:
+            throw std::runtime_error("Bad deferred section.");
+    }
+}
+
+
+bool model::is_deferred(const deferred_sections& sections, deferred_section section)
+{
+    switch (section) {
+        case deferred_section::meshes:
+            return sections.meshes;
+        case deferred_section::animations:
+            return sections.animations;
+        case deferred_section::skins:
+            return sections.skins;
+        case deferred_section::images:
+            return sections.images;
+        case deferred_section::cameras:
+            return sections.cameras;
+        default:
+            return false;
+    }
+}
+
+
+void model::load_deferred(deferred_section section) const
+{
+    const auto index = static_cast<size_t>(section);
+
+    if (!m_deferred->deferred[index]) {
+        return;
+    }
+
+    // the section vector is filled once and only read after it, so const getters stay thread safe.
+    std::call_once(m_deferred->loaded[index], [this, section]() {
+        const_cast<model*>(this)->load_deferred_section(section);
     });
+}
+
+
+void model::load_deferred_section(deferred_section section)
+{
+    using namespace nlohmann;
+
+    const auto index = static_cast<size_t>(section);
+    auto& document = m_deferred->documents[index];
 
-    m_cameras.emplace_back();
+    if (!m_deferred->texts[index].empty()) {
+        document = json::parse(m_deferred->texts[index]);
+        m_deferred->texts[index] = {};
+    }
+
+    const json elements = document.is_array() ? std::move(document) : json::array();
+    document = json{};
+
+    m_deferred->extras[index] = contains_extras(elements);
+
+    switch (section) {
+        case deferred_section::meshes:
+            load_elements(m_meshes, elements, nullptr, [this](const json& mesh_json, size_t) {
+                return mesh(mesh_json, m_primitives_table, m_attributes_table);
+            });
+            link_meshes();
+            break;
+        case deferred_section::animations:
+            load_elements(m_animations, elements, nullptr, [this](const json& animation_json, size_t) {
+                return animation(animation_json, *this);
+            });
+            break;
+        case deferred_section::skins:
+            load_elements(m_skins, elements, nullptr, [this](const json& skin_json, size_t) {
+                return skin(skin_json, m_joints_table);
+            });
+            link_skins();
+            break;
+        case deferred_section::images:
+            load_elements(m_images, elements, nullptr, [](const json& image_json, size_t) {
+                return image(image_json);
+            });
+            break;
+        case deferred_section::cameras:
+            load_elements(m_cameras, elements, nullptr, [](const json& camera_json, size_t) {
+                return camera(camera_json);
+            });
+            m_cameras.emplace_back();
+            break;
+        default:
+            break;
+    }
+}
+
+
+void model::link_nodes()
+{
+    for (auto& scene : m_scenes) {
+        scene.m_nodes.link(m_scene_nodes_table);
+    }
 
-    if (glb_data.has_value()) {
-        m_buffers.emplace_back(std::move(*glb_data));
+    for (auto& node : m_nodes) {
+        node.m_children.link(m_node_children_table);
     }
+}
 
-    m_buffers.reserve(gltf_json["buffers"].size() + m_buffers.size());
 
-    for (auto& buffer : gltf_json["buffers"]) {
-        m_buffers.emplace_back(buffer);
+void model::link_meshes()
+{
+    for (auto& primitive : m_primitives_table) {
+        primitive.m_attributes.link(m_attributes_table);
     }
 
-    for (auto& buffer_view : gltf_json["bufferViews"]) {
-        m_buffer_views.emplace_back(buffer_view);
+    for (auto& mesh : m_meshes) {
+        mesh.m_primitives.link(m_primitives_table);
     }
+}
 
-    for (auto& accessor_json : gltf_json["accessors"]) {
-        auto new_accessor = accessor(accessor_json);
-        m_accessors.emplace_back(std::move(new_accessor));
+
+void model::link_skins()
+{
+    for (auto& skin : m_skins) {
+        skin.m_joints.link(m_joints_table);
     }
+}
 
-    do_if_found(gltf_json, "images", [this](const json& images) {
-        m_images.reserve(images.size());
-        for (const auto& image : images) {
-            m_images.emplace_back(image);
+
+void model::decode_meshopt_buffer_views(utils::thread_pool* pool)
+{
+    constexpr size_t decoded_alignment = 16;
+
+    std::vector<size_t> compressed_views{};
+    size_t decoded_size = 0;
+
+    for (size_t i = 0; i < m_buffer_views.size(); ++i) {
+        const auto& view = m_buffer_views[i];
+
+        if (!view.m_meshopt_compression) {
+            continue;
         }
-    });
 
-    do_if_found(gltf_json, "samplers", [this](const json& samplers) {
-        m_samplers.reserve(samplers.size());
-        for (const auto& sampler : samplers) {
-            m_samplers.emplace_back(sampler);
+        const auto& compression = *view.m_meshopt_compression;
+        CHECK_MSG(compression.count * compression.byte_stride <= view.m_byte_length, "Meshopt data doesn't fit buffer view.");
+
+        compressed_views.push_back(i);
+        decoded_size = (decoded_size + decoded_alignment - 1) & ~(decoded_alignment - 1);
+        decoded_size += view.m_byte_length;
+    }
+
+    if (compressed_views.empty()) {
+        return;
+    }
+
+    // views are decoded straight into the buffer which they read from then, so accessors don't know about compression.
+    // fallback buffers of compressed views have no data and are left as they are.
+    auto* decoded = new uint8_t[decoded_size];
+    const auto decoded_buffer = m_buffers.size();
+    m_buffers.emplace_back(utils::data::create_owning(
+        decoded, [](uint8_t* data) { delete[] data; }, decoded_size));
+
+    size_t offset = 0;
+
+    for (const auto i : compressed_views) {
+        auto& view = m_buffer_views[i];
+        offset = (offset + decoded_alignment - 1) & ~(decoded_alignment - 1);
+        view.m_buffer = decoded_buffer;
+        view.m_byte_offset = offset;
+        offset += view.m_byte_length;
+    }
+
+    auto decode_view = [this, decoded, &compressed_views](size_t i) {
+        const auto& view = m_buffer_views[compressed_views[i]];
+        const auto& compression = *view.m_meshopt_compression;
+
+        CHECK_MSG(compression.buffer < m_buffers.size(), "Bad meshopt buffer.");
+        const auto& src = m_buffers[compression.buffer];
+        CHECK_MSG(compression.byte_offset + compression.byte_length <= src.get_size(), "Meshopt data is out of buffer range.");
+
+        decode_meshopt_buffer_view(
+            compression.mode,
+            compression.filter,
+            src.get_data() + compression.byte_offset,
+            compression.byte_length,
+            decoded + view.m_byte_offset,
+            compression.count,
+            compression.byte_stride);
+    };
+
+    if (pool != nullptr) {
+        pool->parallel_for(0, compressed_views.size(), decode_view);
+    } else {
+        for (size_t i = 0; i < compressed_views.size(); ++i) {
+            decode_view(i);
         }
-    });
+    }
+}
+
 
-    do_if_found(gltf_json, "textures", [this](const json& textures) {
-        m_textures.reserve(textures.size());
-        for (const auto& texture : textures) {
-            m_textures.emplace_back(texture);
+std::vector<uint8_t> model::get_accessors_payloads() const
+{
+    std::vector<uint8_t> result(m_accessors.size(), 0);
+
+    auto mark = [&result](uint64_t accessor, uint8_t payload) {
+        if (accessor < result.size()) {
+            result[accessor] |= payload;
         }
-    });
+    };
 
-    do_if_found(gltf_json, "materials", [this](const json& materials) {
-        m_materials.reserve(materials.size());
-        for (const auto& material : materials) {
-            m_materials.emplace_back(material);
+    for (const auto& primitive : m_primitives_table) {
+        for (const auto& attribute : primitive.get_attributes()) {
+            mark(attribute.accessor, payload_geometry);
         }
-    });
 
-    m_materials.emplace_back();
+        if (primitive.get_indices() >= 0) {
+            mark(primitive.get_indices(), payload_geometry);
+        }
+    }
 
-    m_meshes.reserve(gltf_json["meshes"].size());
-    for (const auto& mesh : gltf_json["meshes"]) {
-        m_meshes.emplace_back(mesh);
+    for (const auto& skin : m_skins) {
+        mark(skin.get_inv_bind_matrices(), payload_animations);
     }
 
-    do_if_found(gltf_json, "animations", [this](const json& animations) {
-        m_animations.reserve(animations.size());
-        for (const auto& animation : animations) {
-            m_animations.emplace_back(animation, *this);
+    for (const auto& animation : m_animations) {
+        for (const auto& sampler : animation.get_samplers()) {
+            mark(sampler.get_input(), payload_animations);
+            mark(sampler.get_output(), payload_animations);
         }
-    });
+    }
+
+    return result;
+}
+
 
-    do_if_found(gltf_json, "skins", [this](const json& skins) {
-        m_skins.reserve(skins.size());
-        for (const auto& skin : skins) {
-            m_skins.emplace_back(skin);
+std::vector<uint8_t> model::get_buffer_views_payloads(const std::vector<uint8_t>& accessors_payloads) const
+{
+    std::vector<uint8_t> result(m_buffer_views.size(), 0);
+
+    auto mark = [&result](int64_t view, uint8_t payload) {
+        if (view >= 0 && static_cast<uint64_t>(view) < result.size()) {
+            result[view] |= payload;
         }
-    });
+    };
+
+    for (size_t i = 0; i < m_accessors.size(); ++i) {
+        const auto& accessor = m_accessors[i];
+        mark(accessor.get_buffer_view(), accessors_payloads[i]);
+
+        if (const auto& sparse = accessor.get_sparse()) {
+            mark(sparse->indices_buffer_view, accessors_payloads[i]);
+            mark(sparse->values_buffer_view, accessors_payloads[i]);
+        }
+    }
+
+    for (const auto& image : m_images) {
+        mark(image.get_buffer_view(), payload_textures);
+    }
+
+    return result;
+}
+
+
+void model::release_payloads(const retained_payloads& retained)
+{
+    for (size_t i = 0; i < deferred_sections_state::count; ++i) {
+        load_deferred(static_cast<deferred_section>(i));
+    }
+
+    const uint8_t retained_bits =
+        (retained.geometry ? payload_geometry : 0) |
+        (retained.textures ? payload_textures : 0) |
+        (retained.animations ? payload_animations : 0);
+
+    const auto views_payloads = get_buffer_views_payloads(get_accessors_payloads());
+
+    constexpr size_t retained_alignment = 16;
+
+    std::vector<size_t> retained_views{};
+    size_t retained_size = 0;
+
+    for (size_t i = 0; i < m_buffer_views.size(); ++i) {
+        if (m_buffer_views[i].m_released || (views_payloads[i] & retained_bits) == 0) {
+            continue;
+        }
+
+        retained_views.push_back(i);
+        retained_size = (retained_size + retained_alignment - 1) & ~(retained_alignment - 1);
+        retained_size += m_buffer_views[i].m_byte_length;
+    }
+
+    // retained views are copied out before buffers are dropped, they may point into a previously retained buffer.
+    uint8_t* retained_data = retained_size > 0 ? new uint8_t[retained_size] : nullptr;
+    size_t offset = 0;
+
+    for (const auto i : retained_views) {
+        auto& view = m_buffer_views[i];
+        offset = (offset + retained_alignment - 1) & ~(retained_alignment - 1);
+
+        CHECK_MSG(view.m_buffer < m_buffers.size() && view.m_byte_offset + view.m_byte_length <= m_buffers[view.m_buffer].get_size(), "Buffer view is out of buffer range.");
+        std::memcpy(retained_data + offset, view.get_data(m_buffers.data(), m_buffers.size()), view.m_byte_length);
+
+        view.m_buffer = m_buffers.size();
+        view.m_byte_offset = offset;
+        offset += view.m_byte_length;
+    }
+
+    for (size_t i = 0; i < m_buffer_views.size(); ++i) {
+        m_buffer_views[i].m_released = m_buffer_views[i].m_released || (views_payloads[i] & retained_bits) == 0;
+    }
+
+    for (auto& buffer : m_buffers) {
+        buffer.m_data = {};
+        buffer.m_shared_data.reset();
+        release_data_uri(buffer.m_uri);
+    }
+
+    if (retained_data != nullptr) {
+        m_buffers.emplace_back(utils::data::create_owning(
+            retained_data, [](uint8_t* data) { delete[] data; }, retained_size));
+    }
+
+    if (!retained.textures) {
+        for (auto& image : m_images) {
+            release_data_uri(image.m_uri);
+        }
+    }
+
+    // the glb chunk buffer is a view into the file data.
+    glb_data_buffer = {};
+
+    std::lock_guard lock{m_dense_accessors->mutex};
+    m_dense_accessors->data.clear();
 }
 
 
+memory_footprint model::get_memory_footprint() const
+{
+    memory_footprint result{};
+
+    get_meshes();
+    get_skins();
+    get_animations();
+    get_images();
+
+    const auto accessors_payloads = get_accessors_payloads();
+    const auto views_payloads = get_buffer_views_payloads(accessors_payloads);
+
+    // data used by several kinds of elements is counted once.
+    auto get_usage = [&result](uint8_t payloads) -> memory_footprint::usage& {
+        if (payloads & payload_geometry) {
+            return result.geometry;
+        }
+
+        if (payloads & payload_animations) {
+            return result.animations;
+        }
+
+        if (payloads & payload_textures) {
+            return result.textures;
+        }
+
+        return result.other;
+    };
+
+    uint64_t views_size = 0;
+
+    for (size_t i = 0; i < m_buffer_views.size(); ++i) {
+        if (!m_buffer_views[i].m_released) {
+            get_usage(views_payloads[i]).cpu += m_buffer_views[i].m_byte_length;
+            views_size += m_buffer_views[i].m_byte_length;
+        }
+    }
+
+    uint64_t buffers_size = 0;
+
+    for (const auto& buffer : m_buffers) {
+        buffers_size += buffer.get_size();
+        result.other.cpu += buffer.get_uri().size();
+    }
+
+    // the glb file is kept whole, its binary chunk is the first buffer.
+    if (glb_data_buffer.get_size() > 0 && !m_buffers.empty()) {
+        buffers_size += glb_data_buffer.get_size() - std::min(m_buffers.front().get_size(), glb_data_buffer.get_size());
+    }
+
+    // views may overlap, so bytes which no view covers are only estimated.
+    result.other.cpu += buffers_size - std::min(views_size, buffers_size);
+
+    for (const auto& image : m_images) {
+        (is_data_uri(image.get_uri()) ? result.textures : result.other).cpu += image.get_uri().size();
+    }
+
+    {
+        std::lock_guard lock{m_dense_accessors->mutex};
+        for (const auto& [index, data] : m_dense_accessors->data) {
+            get_usage(accessors_payloads[index]).cpu += data.capacity();
+        }
+    }
+
+    for (const auto& animation : m_animations) {
+        result.animations.cpu += get_table_size(animation.get_channels()) + get_table_size(animation.get_samplers());
+    }
+
+    result.animations.cpu += get_table_size(m_animations) + get_table_size(m_skins) + get_table_size(m_joints_table);
+    result.geometry.cpu += get_table_size(m_meshes) + get_table_size(m_primitives_table) + get_table_size(m_attributes_table);
+    result.textures.cpu += get_table_size(m_images) + get_table_size(m_samplers) + get_table_size(m_textures);
+
+    result.other.cpu +=
+        get_table_size(m_scenes) + get_table_size(m_nodes) + get_table_size(m_cameras) +
+        get_table_size(m_buffers) + get_table_size(m_buffer_views) + get_table_size(m_accessors) +
+        get_table_size(m_materials) + get_table_size(m_scene_nodes_table) + get_table_size(m_node_children_table);
+
+    for (const auto& text : m_deferred->texts) {
+        result.other.cpu += text.capacity();
+    }
+
+    return result;
+}
+
 const std::vector<scene>& model::get_scenes() const
 {
     return m_scenes;
@@ -1025,6 +1895,7 @@ const std::vector<scene>& model::get_scenes() const
 
 const std::vector<camera>& model::get_cameras() const
 {
+    load_deferred(deferred_section::cameras);
     return m_cameras;
 }
 
@@ -1053,8 +1924,36 @@ const std::vector<accessor>& model::get_accessors() const
 }
 
 
+const uint8_t* model::get_accessor_data(uint64_t index) const
+{
+    CHECK_MSG(index < m_accessors.size(), "Bad accessor index.");
+    const auto& accessor = m_accessors[index];
+
+    if (accessor.is_dense()) {
+        return accessor.get_data(m_buffers.data(), m_buffers.size(), m_buffer_views.data(), m_buffer_views.size());
+    }
+
+    auto& cache = *m_dense_accessors;
+
+    {
+        std::lock_guard lock{cache.mutex};
+        if (auto it = cache.data.find(index); it != cache.data.end()) {
+            return it->second.data();
+        }
+    }
+
+    std::vector<uint8_t> dense_data(accessor.get_data_size());
+    accessor.copy_data(*this, dense_data.data());
+
+    // vector storage does not move on rehash, so returned pointers stay valid.
+    std::lock_guard lock{cache.mutex};
+    return cache.data.try_emplace(index, std::move(dense_data)).first->second.data();
+}
+
+
 const std::vector<image>& model::get_images() const
 {
+    load_deferred(deferred_section::images);
     return m_images;
 }
 
@@ -1079,18 +1978,21 @@ const std::vector<material>& model::get_materials() const
 
 const std::vector<mesh>& model::get_meshes() const
 {
+    load_deferred(deferred_section::meshes);
     return m_meshes;
 }
 
 
 const std::vector<animation>& model::get_animations() const
 {
+    load_deferred(deferred_section::animations);
     return m_animations;
 }
 
 
 const std::vector<skin>& model::get_skins() const
 {
+    load_deferred(deferred_section::skins);
     return m_skins;
 }
 
@@ -1101,7 +2003,29 @@ uint32_t model::get_current_scene() const
 }
 
 
+std::span<const std::string> model::get_extensions_used() const
+{
+    return m_extensions_used;
+}
+
+
+bool model::has_extras() const
+{
+    for (size_t i = 0; i < deferred_sections_state::count; ++i) {
+        load_deferred(static_cast<deferred_section>(i));
+    }
+
+    return m_has_extras || std::find(m_deferred->extras.begin(), m_deferred->extras.end(), true) != m_deferred->extras.end();
+}
+
+
 const std::string& model::get_cwd() const
 {
     return m_cwd;
 }
+
+
+hal::filesystem::vfs& model::get_file_system() const
+{
+    return m_file_system != nullptr ? *m_file_system : hal::filesystem::vfs::global();
+}
@@ -2,8 +2,10 @@
 
 #include <gltf/utils.hpp>
 
-#include <filesystem/common_file.hpp>
+#include <filesystem/base_file.hpp>
+#include <filesystem/vfs.hpp>
 #include <utils/data.hpp>
+#include <utils/thread_pool.hpp>
 
 #include <nlohmann/json.hpp>
 
@@ -13,7 +15,11 @@
 
 #include <glm/gtc/quaternion.hpp>
 
+#include <array>
+#include <mutex>
 #include <optional>
+#include <span>
+#include <unordered_map>
 #include <variant>
 
 #define _USE_MATH_DEFINES
@@ -27,81 +33,245 @@ namespace sandbox::gltf
     class buffer_view;
     class accessor;
     class animation;
+    class sax_handler;
+    class asset_registry;
+
+    // sections which are built on the first call of their getter instead of on load.
+    // every section is parsed on its own, so tools which don't read a section never pay for it.
+    struct deferred_sections
+    {
+        bool meshes{false};
+        bool animations{false};
+        bool skins{false};
+        bool images{false};
+        bool cameras{false};
+    };
+
+    struct load_options
+    {
+        // map model files into memory instead of reading them. buffers become views into the mapping.
+        bool map_files{false};
+        // build the model directly from json tokens instead of parsing the whole json document first.
+        bool streaming_parser{true};
+        // build sections and read external buffers on the pool. the result is the same as without it.
+        utils::thread_pool* thread_pool{nullptr};
+        // resolves model and buffer urls. the global file system is used if it is not set.
+        hal::filesystem::vfs* file_system{nullptr};
+        deferred_sections deferred{};
+        // external buffers are shared with other models which are loaded with the same registry.
+        asset_registry* assets{nullptr};
+    };
+
+    // bytes which a model keeps, split by what they are used for. gltf models fill the cpu part, vk models both parts.
+    struct memory_footprint
+    {
+        struct usage
+        {
+            uint64_t cpu{0};
+            uint64_t gpu{0};
+        };
+
+        usage geometry{};
+        usage textures{};
+        // animation keys, skins and the animation hierarchy.
+        usage animations{};
+        // materials, element tables, json of deferred sections and data which no element references.
+        usage other{};
+
+        uint64_t get_cpu_size() const;
+        uint64_t get_gpu_size() const;
+
+        memory_footprint& operator+=(const memory_footprint&);
+    };
+
+    // payloads which model::release_payloads keeps, everything else is dropped. elements are always kept.
+    struct retained_payloads
+    {
+        bool geometry{false};
+        bool textures{false};
+        // cpu_animation_controller reads keys from the model, so they are kept if it is used.
+        bool animations{false};
+    };
+
+    // slice of a model table. the offset is known while the table grows, the pointer is set
+    // once the section which owns the table is built, tables are never resized after it.
+    template<typename T>
+    class table_range
+    {
+    public:
+        std::span<const T> get() const
+        {
+            return {m_data, m_count};
+        }
+
+        uint32_t get_offset() const
+        {
+            return m_offset;
+        }
+
+        uint32_t get_count() const
+        {
+            return m_count;
+        }
+
+        // values of one range must be appended one after another.
+        void push_back(std::vector<T>& table, const T& value)
+        {
+            if (m_count == 0) {
+                m_offset = static_cast<uint32_t>(table.size());
+            }
+
+            table.push_back(value);
+            ++m_count;
+        }
+
+        void link(const std::vector<T>& table)
+        {
+            m_data = table.data() + m_offset;
+        }
+
+    private:
+        const T* m_data{nullptr};
+        uint32_t m_offset{0};
+        uint32_t m_count{0};
+    };
 
     class buffer
     {
     public:
+        buffer() = default;
         explicit buffer(utils::data);
-        explicit buffer(const nlohmann::json& buffer_json);
+        buffer(const nlohmann::json& buffer_json, const std::string& cwd, const load_options& options);
 
         const uint8_t* get_data() const;
+        size_t get_size() const;
+        // empty for glb chunk buffers.
+        const std::string& get_uri() const;
 
     private:
+        friend class model;
+
         utils::data m_data;
+        // owns the data if the file is shared through the asset registry, m_data is a view into it then.
+        std::shared_ptr<const utils::data> m_shared_data{};
+        std::string m_uri{};
     };
 
 
     class accessor
     {
     public:
+        // indices and values of elements which replace elements of the base view (or zeros if there is no base view).
+        struct sparse_data
+        {
+            uint64_t count{};
+            uint64_t indices_buffer_view{};
+            size_t indices_byte_offset{};
+            component_type indices_component_type{};
+            uint64_t values_buffer_view{};
+            size_t values_byte_offset{};
+        };
+
+        // works only for accessors which data lies in a buffer as is.
         const uint8_t* get_data(
             const buffer* buffers,
             size_t buffers_size,
             const buffer_view* buffer_views,
             size_t buffer_views_size) const;
 
+        // sparse accessors and accessors without buffer view are materialized on the first call and cached in the model.
         const uint8_t* get_data(const model&) const;
 
+        // writes accessor elements straight into dst without caching, dst must have get_data_size() bytes.
+        void copy_data(const model&, uint8_t* dst) const;
+
+        accessor() = default;
         explicit accessor(const nlohmann::json& accessor_json);
 
-        uint64_t get_buffer_view() const;
+        int64_t get_buffer_view() const;
         size_t get_byte_offset() const;
+        // distance between elements returned by get_data(model).
+        size_t get_byte_stride(const model&) const;
         accessor_type get_type() const;
         component_type get_component_type() const;
+        bool is_normalized() const;
         uint64_t get_count() const;
+        const std::optional<sparse_data>& get_sparse() const;
 
         glm::vec4 get_min() const;
         glm::vec4 get_max() const;
+        // min and max are optional for all accessors but positions.
+        bool has_min_max() const;
 
         size_t get_data_size() const;
 
+        bool is_dense() const;
+
     private:
-        uint64_t m_buffer_view{};
+        friend class sax_handler;
+
+        int64_t m_buffer_view{-1};
         size_t m_byte_offset{};
         accessor_type_value m_type{};
         component_type m_component_type{};
+        bool m_normalized{false};
         uint64_t m_count{};
+        std::optional<sparse_data> m_sparse{};
 
         glm::vec4 m_min{};
         glm::vec4 m_max{};
+        bool m_has_min{false};
+        bool m_has_max{false};
     };
 
 
     class buffer_view
     {
     public:
+        // EXT_meshopt_compression source of the view. the view itself is moved to the decoded data on load.
+        struct meshopt_compression
+        {
+            uint64_t buffer{};
+            size_t byte_offset{};
+            size_t byte_length{};
+            size_t byte_stride{};
+            uint64_t count{};
+            meshopt_compression_mode mode{};
+            meshopt_compression_filter filter{};
+        };
+
         const uint8_t* get_data(
             const buffer* buffers,
             size_t buffers_size) const;
 
+        buffer_view() = default;
         buffer_view(const nlohmann::json& buffer_view_json);
 
         uint64_t get_buffer() const;
         size_t get_byte_offset() const;
         size_t get_byte_length() const;
         size_t get_byte_stride() const;
+        const std::optional<meshopt_compression>& get_meshopt_compression() const;
+        // data of released views can't be read, see model::release_payloads.
+        bool is_released() const;
 
     private:
+        friend class model;
+        friend class sax_handler;
+
         uint64_t m_buffer{};
         size_t m_byte_offset{};
         size_t m_byte_length{};
         size_t m_byte_stride{};
+        std::optional<meshopt_compression> m_meshopt_compression{};
+        bool m_released{false};
     };
 
 
     class texture
     {
     public:
+        texture() = default;
         explicit texture(const nlohmann::json& texture_json);
 
         uint32_t get_sampler() const;
@@ -116,6 +286,7 @@ namespace sandbox::gltf
     class image
     {
     public:
+        image() = default;
         explicit image(const nlohmann::json& image_json);
 
         const std::string& get_uri() const;
@@ -124,17 +295,11 @@ namespace sandbox::gltf
         image_mime_type get_mime() const;
 
     private:
-        using image_handler = std::unique_ptr<uint8_t, std::function<void(const uint8_t*)>>;
-
-        size_t m_width{0};
-        size_t m_height{0};
-        size_t m_components_count{0};
+        friend class model;
 
         std::string m_uri{};
         int32_t m_buffer_view = -1;
 
-        image_handler m_data{nullptr, [](const uint8_t*) {}};
-
         image_mime_type_value m_mime_type{};
     };
 
@@ -142,6 +307,7 @@ namespace sandbox::gltf
     class sampler
     {
     public:
+        sampler() = default;
         explicit sampler(const nlohmann::json& sampler_json);
 
         sampler_filter_type get_mag_filter() const;
@@ -167,40 +333,27 @@ namespace sandbox::gltf
             int32_t accessor = -1;
             accessor_type accessor_type{};
             component_type component_type{};
+            bool normalized = false;
             uint64_t elements_count = 0;
+            size_t byte_stride = 0;
             const uint8_t* attribute_data = nullptr;
+        };
 
-            template<typename T, typename CallbackT, typename ConverterT>
-            void for_each_element(
-                CallbackT&& callback,
-                gltf::accessor_type desired_accessor_type,
-                gltf::component_type desired_component_type,
-                ConverterT&& converter) const
-            {
-                if (attribute_data == nullptr) {
-                    return;
-                }
-
-                const bool is_format_matches = accessor_type == desired_accessor_type && desired_component_type == component_type;
-
-                auto element_size = get_buffer_element_size(accessor_type, component_type);
-                for (size_t i = 0; i < elements_count; ++i) {
-                    if (is_format_matches) {
-                        callback(*reinterpret_cast<const T*>(attribute_data + (i * element_size)), i);
-                    } else {
-                        callback(converter(attribute_data + (i * element_size), accessor_type, component_type, desired_accessor_type, desired_component_type), i);
-                    }
-                }
-            }
+        struct attribute
+        {
+            attribute_path path{};
+            uint32_t accessor{0};
         };
 
-        explicit primitive(const nlohmann::json& primitive_json);
+        primitive() = default;
+        primitive(const nlohmann::json& primitive_json, std::vector<attribute>& attributes_table);
 
-        const std::vector<uint32_t>& get_attributes() const;
-        const std::vector<attribute_path>& get_attributes_paths() const;
+        // sorted by path.
+        std::span<const attribute> get_attributes() const;
 
         int32_t get_material() const;
         int32_t get_indices() const;
+        primitive_mode get_mode() const;
 
         int32_t attribute_at_path(attribute_path path) const;
         vertex_attribute attribute_at_path(const gltf::model& model, attribute_path path) const;
@@ -210,43 +363,58 @@ namespace sandbox::gltf
         std::pair<const uint8_t*, gltf::component_type> get_indices_data(const gltf::model&) const;
 
     private:
-        std::vector<uint32_t> m_attributes{};
-        std::vector<attribute_path> m_attributes_paths{};
+        friend class model;
+        friend class sax_handler;
+
+        table_range<attribute> m_attributes{};
 
         int32_t m_material{-1};
         int32_t m_indices{-1};
+        primitive_mode m_mode{primitive_mode::triangles};
     };
 
 
     class mesh
     {
     public:
-        explicit mesh(const nlohmann::json& mesh_json);
+        mesh() = default;
+        mesh(
+            const nlohmann::json& mesh_json,
+            std::vector<primitive>& primitives_table,
+            std::vector<primitive::attribute>& attributes_table);
 
-        const std::vector<primitive>& get_primitives() const;
+        std::span<const primitive> get_primitives() const;
 
     private:
-        std::vector<primitive> m_primitives{};
+        friend class model;
+        friend class sax_handler;
+
+        table_range<primitive> m_primitives{};
     };
 
 
     class skin
     {
     public:
-        explicit skin(const nlohmann::json& skin_json);
+        skin() = default;
+        skin(const nlohmann::json& skin_json, std::vector<int32_t>& joints_table);
 
         uint32_t get_inv_bind_matrices() const;
-        const std::vector<int32_t>& get_joints() const;
+        std::span<const int32_t> get_joints() const;
 
     private:
+        friend class model;
+        friend class sax_handler;
+
         uint32_t m_inv_bind_matrices{};
-        std::vector<int32_t> m_joints{};
+        table_range<int32_t> m_joints{};
     };
 
 
     class animation_channel
     {
     public:
+        animation_channel() = default;
         animation_channel(const nlohmann::json&, const gltf::animation&);
 
         uint64_t get_sampler() const;
@@ -257,7 +425,10 @@ namespace sandbox::gltf
         std::tuple<uint64_t, accessor_type, component_type, const uint8_t*> get_values(const gltf::model& mdl) const;
 
     private:
-        const gltf::animation& m_animation;
+        friend class animation;
+        friend class sax_handler;
+
+        const gltf::animation* m_animation{nullptr};
         uint64_t m_sampler{0};
         uint64_t m_node{0};
         animation_path_value m_path{};
@@ -267,6 +438,7 @@ namespace sandbox::gltf
     class animation_sampler
     {
     public:
+        animation_sampler() = default;
         explicit animation_sampler(const nlohmann::json& animation_sampler_json);
 
         animation_interpolation get_interpolation() const;
@@ -277,6 +449,8 @@ namespace sandbox::gltf
         const accessor& get_output(const gltf::model& model) const;
 
     private:
+        friend class sax_handler;
+
         animation_interpolation_value m_interpolation{};
         uint64_t m_input{0};
         uint64_t m_output{0};
@@ -288,7 +462,13 @@ namespace sandbox::gltf
     public:
         using channels_list = std::array<int32_t, 4>;
 
+        animation() = default;
         animation(const nlohmann::json& animation_json, const gltf::model& model);
+        animation(const animation&) = delete;
+        animation& operator=(const animation&) = delete;
+        animation(animation&&) noexcept;
+        animation& operator=(animation&&) noexcept;
+        ~animation() = default;
 
         const std::vector<animation_channel>& get_channels() const;
         const std::vector<animation_sampler>& get_samplers() const;
@@ -296,8 +476,15 @@ namespace sandbox::gltf
         float get_duration() const;
 
     private:
+        friend class sax_handler;
+
+        void bind_channels();
+        void init_channels_cache(const gltf::model& model);
+
         float m_duration{0};
-        std::unordered_map<uint32_t, channels_list> m_node_channels_cache{};
+        // channels of nodes from m_first_node up to the last animated node.
+        uint32_t m_first_node{0};
+        std::vector<channels_list> m_node_channels{};
         animation_interpolation_value m_interpolation{};
         std::vector<animation_channel> m_channels{};
         std::vector<animation_sampler> m_samplers{};
@@ -316,18 +503,26 @@ namespace sandbox::gltf
 
         static glm::mat4 gen_matrix(const trs_transform&);
 
-        explicit node(const nlohmann::json& node_json);
+        node() = default;
+        node(const nlohmann::json& node_json, std::vector<int32_t>& children_table);
 
         int32_t get_mesh() const;
         int32_t get_skin() const;
-        const std::vector<int32_t>& get_children() const;
+        int32_t get_camera() const;
+        std::span<const int32_t> get_children() const;
         trs_transform get_transform() const;
         glm::mat4 get_matrix() const;
+        // true if the transform was given as a matrix, it may be not decomposable into trs then.
+        bool has_matrix() const;
 
     private:
+        friend class model;
+        friend class sax_handler;
+
         int32_t m_mesh = -1;
         int32_t m_skin = -1;
-        std::vector<int32_t> m_children{};
+        int32_t m_camera = -1;
+        table_range<int32_t> m_children{};
 
         std::variant<trs_transform, glm::mat4> m_transform_data{trs_transform{}};
     };
@@ -431,33 +626,49 @@ namespace sandbox::gltf
     class scene
     {
     public:
-        explicit scene(const nlohmann::json& scene_json);
+        scene() = default;
+        scene(const nlohmann::json& scene_json, std::vector<int32_t>& nodes_table);
 
-        const std::vector<int32_t>& get_nodes() const;
+        std::span<const int32_t> get_nodes() const;
 
     private:
-        std::vector<int32_t> m_nodes{};
+        friend class model;
+        friend class sax_handler;
+
+        table_range<int32_t> m_nodes{};
     };
 
 
     class model
     {
     public:
-        static model from_url(const std::string& url);
+        static model from_url(const std::string& url, const load_options& options = {});
 
         model() = default;
 
         explicit model(
             const nlohmann::json& gltf_json,
             const std::string& cwd,
-            std::optional<utils::data> glb_data = std::nullopt);
+            std::optional<utils::data> glb_data = std::nullopt,
+            const load_options& options = {});
+
+        model(
+            const uint8_t* json_data,
+            size_t json_size,
+            const std::string& cwd,
+            std::optional<utils::data> glb_data = std::nullopt,
+            const load_options& options = {});
 
         const std::vector<scene>& get_scenes() const;
         const std::vector<camera>& get_cameras() const;
         const std::vector<node>& get_nodes() const;
+        // if the model has EXT_meshopt_compression views, the last buffer keeps their decoded data.
         const std::vector<buffer>& get_buffers() const;
         const std::vector<buffer_view>& get_buffer_views() const;
         const std::vector<accessor>& get_accessors() const;
+        // data of the accessor with the index, see accessor::get_data(const model&). unlike the accessor overload it can't
+        // be given a copy of the accessor which doesn't belong to the model.
+        const uint8_t* get_accessor_data(uint64_t index) const;
         const std::vector<image>& get_images() const;
         const std::vector<sampler>& get_samplers() const;
         const std::vector<texture>& get_textures() const;
@@ -465,12 +676,86 @@ namespace sandbox::gltf
         const std::vector<mesh>& get_meshes() const;
         const std::vector<animation>& get_animations() const;
         const std::vector<skin>& get_skins() const;
+        // the scene set by the model file, 0 if it doesn't set one.
         uint32_t get_current_scene() const;
+        // extensionsUsed of the model file. the model keeps data of EXT_meshopt_compression and KHR_mesh_quantization only.
+        std::span<const std::string> get_extensions_used() const;
+        // true if any element of the model file has extras, the model doesn't keep them. deferred sections are built first.
+        bool has_extras() const;
 
         const std::string& get_cwd() const;
+        // the file system from load options which resolves urls of the model, the global one if it is not set.
+        hal::filesystem::vfs& get_file_system() const;
+
+        // drops binary data which is not needed anymore, e.g. once vk_model_builder::create baked the model.
+        // retained buffer views are copied into one buffer appended to the model buffers, other views are released.
+        // deferred sections are built before it, since animations read their keys while being built.
+        void release_payloads(const retained_payloads& retained = {});
+        // cpu bytes of the model. deferred sections are built to find what buffer views are used for.
+        memory_footprint get_memory_footprint() const;
 
     private:
+        friend class sax_handler;
+
+        enum payload_bits : uint8_t
+        {
+            payload_geometry = 1 << 0,
+            payload_textures = 1 << 1,
+            payload_animations = 1 << 2,
+        };
+
+        struct dense_accessors_cache
+        {
+            std::mutex mutex{};
+            std::unordered_map<uint64_t, std::vector<uint8_t>> data{};
+        };
+
+        enum class deferred_section : uint8_t
+        {
+            meshes,
+            animations,
+            skins,
+            images,
+            cameras,
+            count
+        };
+
+        // section json is kept as text by the streaming parser and as a document by the json one.
+        struct deferred_sections_state
+        {
+            constexpr static size_t count = static_cast<size_t>(deferred_section::count);
+
+            std::array<bool, count> deferred{};
+            std::array<std::once_flag, count> loaded{};
+            std::array<std::string, count> texts{};
+            std::array<nlohmann::json, count> documents{};
+            // every section sets only its own flag, so sections can be built concurrently.
+            std::array<bool, count> extras{};
+        };
+
+        static const char* get_section_name(deferred_section);
+        static bool is_deferred(const deferred_sections&, deferred_section);
+
+        // getters call it before returning deferred sections. it is safe to call from several threads.
+        void load_deferred(deferred_section) const;
+        void load_deferred_section(deferred_section);
+
+        // set pointers of element ranges once their tables are complete.
+        void link_nodes();
+        void link_meshes();
+        void link_skins();
+
+        // decodes compressed buffer views into one buffer appended to the model buffers and points the views to it.
+        // views are decoded in parallel, so it must be called once all buffers are loaded.
+        void decode_meshopt_buffer_views(utils::thread_pool* pool);
+
+        // payload bits of every accessor and buffer view, an element may be used by several kinds of elements.
+        std::vector<uint8_t> get_accessors_payloads() const;
+        std::vector<uint8_t> get_buffer_views_payloads(const std::vector<uint8_t>& accessors_payloads) const;
+
         uint32_t m_current_scene{0};
+        std::vector<std::string> m_extensions_used{};
+        bool m_has_extras{false};
 
         std::vector<scene> m_scenes{};
         std::vector<node> m_nodes{};
@@ -491,13 +776,27 @@ namespace sandbox::gltf
         std::vector<animation> m_animations{};
         std::vector<skin> m_skins{};
 
+        // variable length parts of elements. a section fills only its own tables,
+        // so building of a deferred section doesn't move ranges of other ones.
+        // they are not one arena: deferred sections are built on first access from any thread, and growing a shared
+        // allocation would move ranges which other threads read. five allocations per model cost nothing next to it.
+        std::vector<int32_t> m_scene_nodes_table{};
+        std::vector<int32_t> m_node_children_table{};
+        std::vector<primitive> m_primitives_table{};
+        std::vector<primitive::attribute> m_attributes_table{};
+        std::vector<int32_t> m_joints_table{};
+
         std::string m_cwd{};
+        hal::filesystem::vfs* m_file_system{nullptr};
         utils::data glb_data_buffer{};
+
+        std::unique_ptr<dense_accessors_cache> m_dense_accessors{std::make_unique<dense_accessors_cache>()};
+        std::unique_ptr<deferred_sections_state> m_deferred{std::make_unique<deferred_sections_state>()};
     };
 
     template<typename Callable, typename... Args>
     void for_each_node_child(
-        const std::vector<int32_t>& curr_nodes,
+        std::span<const int32_t> curr_nodes,
         const std::vector<gltf::node>& all_nodes,
         const Callable& callback,
         Args&&... args)
@@ -521,19 +820,48 @@ namespace sandbox::gltf
     }
 
     template<typename Callable, typename... Args>
-    void for_each_scene_node(
+    void for_each_node_in_scene(
         const gltf::model& model,
+        uint32_t scene,
         const Callable& callback,
         Args&&... args)
     {
         const auto& scenes = model.get_scenes();
-        const auto& all_nodes = model.get_nodes();
 
-        const auto& scene_nodes = scenes[model.get_current_scene()].get_nodes();
+        if (scene >= scenes.size()) {
+            return;
+        }
+
+        for_each_node_child(
+            scenes[scene].get_nodes(),
+            model.get_nodes(),
+            callback,
+            std::forward<Args>(args)...);
+    }
+
+    // visits nodes of the scene which the model sets as the default one.
+    template<typename Callable, typename... Args>
+    void for_each_scene_node(
+        const gltf::model& model,
+        const Callable& callback,
+        Args&&... args)
+    {
+        for_each_node_in_scene(model, model.get_current_scene(), callback, std::forward<Args>(args)...);
+    }
+
+    // visits the node and all its descendants.
+    template<typename Callable, typename... Args>
+    void for_each_subtree_node(
+        const gltf::model& model,
+        uint32_t node,
+        const Callable& callback,
+        Args&&... args)
+    {
+        const std::array<int32_t, 1> root{static_cast<int32_t>(node)};
 
         for_each_node_child(
-            scene_nodes,
-            all_nodes,
+            root,
+            model.get_nodes(),
             callback,
             std::forward<Args>(args)...);
     }
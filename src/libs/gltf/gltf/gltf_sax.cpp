@@ -0,0 +1,910 @@
+#include "gltf_sax.hpp"
+
+#include <utils/conditions_helpers.hpp>
+#include <utils/static_string_map.hpp>
+
+#include <algorithm>
+
+using namespace sandbox;
+using namespace sandbox::gltf;
+
+enum class sax_handler::field : uint8_t
+{
+    unknown,
+
+    accessors,
+    animations,
+    buffers,
+    buffer_views,
+    cameras,
+    images,
+    materials,
+    meshes,
+    nodes,
+    samplers,
+    scenes,
+    skins,
+    textures,
+    extensions_used,
+
+    attributes,
+    buffer,
+    buffer_view,
+    byte_length,
+    byte_offset,
+    byte_stride,
+    camera,
+    channels,
+    children,
+    component_type,
+    count,
+    extensions,
+    ext_meshopt_compression,
+    filter,
+    indices,
+    input,
+    interpolation,
+    inverse_bind_matrices,
+    joints,
+    material,
+    matrix,
+    max,
+    mesh,
+    min,
+    mode,
+    node,
+    normalized,
+    output,
+    path,
+    primitives,
+    rotation,
+    sampler,
+    scale,
+    scene,
+    skin,
+    sparse,
+    target,
+    translation,
+    type,
+    values
+};
+
+namespace
+{
+    using field = sax_handler::field;
+
+    constexpr auto fields = utils::make_static_string_map<field>({
+        {"accessors", field::accessors},
+        {"animations", field::animations},
+        {"buffers", field::buffers},
+        {"bufferViews", field::buffer_views},
+        {"cameras", field::cameras},
+        {"images", field::images},
+        {"materials", field::materials},
+        {"meshes", field::meshes},
+        {"nodes", field::nodes},
+        {"samplers", field::samplers},
+        {"scenes", field::scenes},
+        {"skins", field::skins},
+        {"textures", field::textures},
+        {"extensionsUsed", field::extensions_used},
+        {"attributes", field::attributes},
+        {"buffer", field::buffer},
+        {"bufferView", field::buffer_view},
+        {"byteLength", field::byte_length},
+        {"byteOffset", field::byte_offset},
+        {"byteStride", field::byte_stride},
+        {"camera", field::camera},
+        {"channels", field::channels},
+        {"children", field::children},
+        {"componentType", field::component_type},
+        {"count", field::count},
+        {"extensions", field::extensions},
+        {"EXT_meshopt_compression", field::ext_meshopt_compression},
+        {"filter", field::filter},
+        {"indices", field::indices},
+        {"input", field::input},
+        {"interpolation", field::interpolation},
+        {"inverseBindMatrices", field::inverse_bind_matrices},
+        {"joints", field::joints},
+        {"material", field::material},
+        {"matrix", field::matrix},
+        {"max", field::max},
+        {"mesh", field::mesh},
+        {"min", field::min},
+        {"mode", field::mode},
+        {"node", field::node},
+        {"normalized", field::normalized},
+        {"output", field::output},
+        {"path", field::path},
+        {"primitives", field::primitives},
+        {"rotation", field::rotation},
+        {"sampler", field::sampler},
+        {"scale", field::scale},
+        {"scene", field::scene},
+        {"skin", field::skin},
+        {"sparse", field::sparse},
+        {"target", field::target},
+        {"translation", field::translation},
+        {"type", field::type},
+        {"values", field::values},
+    });
+
+    bool is_streamed_section(field section)
+    {
+        switch (section) {
+            case field::accessors:
+            case field::buffer_views:
+            case field::nodes:
+            case field::meshes:
+            case field::skins:
+            case field::scenes:
+            case field::animations:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_dom_section(field section)
+    {
+        switch (section) {
+            case field::buffers:
+            case field::images:
+            case field::samplers:
+            case field::textures:
+            case field::materials:
+            case field::cameras:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+
+    // deferred sections are skipped here, model keeps their text and parses it on the first access.
+    bool is_deferred_section(const deferred_sections& deferred, field section)
+    {
+        switch (section) {
+            case field::meshes:
+                return deferred.meshes;
+            case field::animations:
+                return deferred.animations;
+            case field::skins:
+                return deferred.skins;
+            case field::images:
+                return deferred.images;
+            case field::cameras:
+                return deferred.cameras;
+            default:
+                return false;
+        }
+    }
+} // namespace
+
+
+sax_handler::sax_handler(model& mdl, std::optional<utils::data> glb_data, const load_options& options)
+    : m_model(mdl)
+    , m_glb_data(std::move(glb_data))
+    , m_options(options)
+{
+}
+
+
+bool sax_handler::null()
+{
+    if (m_skip_depth > 0) {
+        return true;
+    }
+
+    if (!m_dom_stack.empty()) {
+        return dom_value(nullptr);
+    }
+
+    return on_value({});
+}
+
+
+bool sax_handler::boolean(bool value)
+{
+    if (m_skip_depth > 0) {
+        return true;
+    }
+
+    if (!m_dom_stack.empty()) {
+        return dom_value(value);
+    }
+
+    return on_value({.number = double(value), .integer = uint64_t(value)});
+}
+
+
+bool sax_handler::number_integer(json::number_integer_t value)
+{
+    if (m_skip_depth > 0) {
+        return true;
+    }
+
+    if (!m_dom_stack.empty()) {
+        return dom_value(value);
+    }
+
+    return on_value({.number = double(value), .integer = uint64_t(value)});
+}
+
+
+bool sax_handler::number_unsigned(json::number_unsigned_t value)
+{
+    if (m_skip_depth > 0) {
+        return true;
+    }
+
+    if (!m_dom_stack.empty()) {
+        return dom_value(value);
+    }
+
+    return on_value({.number = double(value), .integer = uint64_t(value)});
+}
+
+
+bool sax_handler::number_float(json::number_float_t value, const json::string_t&)
+{
+    if (m_skip_depth > 0) {
+        return true;
+    }
+
+    if (!m_dom_stack.empty()) {
+        return dom_value(value);
+    }
+
+    return on_value({.number = value, .integer = value > 0 ? uint64_t(value) : 0});
+}
+
+
+bool sax_handler::string(json::string_t& value)
+{
+    if (m_skip_depth > 0) {
+        return true;
+    }
+
+    if (!m_dom_stack.empty()) {
+        return dom_value(std::move(value));
+    }
+
+    return on_value({.string = value});
+}
+
+
+bool sax_handler::binary(json::binary_t&)
+{
+    return true;
+}
+
+
+bool sax_handler::start_object(size_t)
+{
+    return on_start(false);
+}
+
+
+bool sax_handler::key(json::string_t& value)
+{
+    // extras are checked in skipped values too, the model only tells if it had them.
+    if (value == "extras") {
+        m_model.m_has_extras = true;
+    }
+
+    if (m_skip_depth > 0) {
+        return true;
+    }
+
+    if (!m_dom_stack.empty()) {
+        m_dom_stack.push_back(&(*m_dom_stack.back())[value]);
+        return true;
+    }
+
+    if (m_stack.size() == 6 && m_stack[1].key == field::meshes && m_stack.back().key == field::attributes) {
+        m_attribute_key = find_attribute_path(value);
+        m_key = field::attributes;
+        return true;
+    }
+
+    m_key = fields.find(value).value_or(field::unknown);
+
+    return true;
+}
+
+
+bool sax_handler::end_object()
+{
+    return on_end();
+}
+
+
+bool sax_handler::start_array(size_t)
+{
+    return on_start(true);
+}
+
+
+bool sax_handler::end_array()
+{
+    return on_end();
+}
+
+
+bool sax_handler::parse_error(size_t, const std::string&, const nlohmann::detail::exception& ex)
+{
+    throw std::runtime_error(ex.what());
+}
+
+
+void sax_handler::finish()
+{
+    if (!m_options.deferred.cameras) {
+        m_model.m_cameras.emplace_back();
+    }
+
+    m_model.m_materials.emplace_back();
+
+    m_model.link_nodes();
+    m_model.link_meshes();
+    m_model.link_skins();
+
+    // waiting for tasks submitted to the pool would deadlock if the model is loaded from a pool task.
+    if (!m_pending_buffers.empty()) {
+        m_options.thread_pool->parallel_for(0, m_pending_buffers.size(), [this](size_t i) {
+            const auto& [index, buffer_json] = m_pending_buffers[i];
+            m_model.m_buffers[index] = buffer(buffer_json, m_model.m_cwd, m_options);
+        });
+    }
+
+    m_pending_buffers.clear();
+
+    m_model.decode_meshopt_buffer_views(m_options.thread_pool);
+
+    auto init_animation = [this](size_t i) {
+        auto& animation = m_model.m_animations[i];
+        animation.bind_channels();
+        animation.init_channels_cache(m_model);
+    };
+
+    if (m_options.thread_pool != nullptr) {
+        m_options.thread_pool->parallel_for(0, m_model.m_animations.size(), init_animation);
+    } else {
+        for (size_t i = 0; i < m_model.m_animations.size(); ++i) {
+            init_animation(i);
+        }
+    }
+}
+
+
+template<typename T>
+bool sax_handler::dom_value(T&& value)
+{
+    auto* container = m_dom_stack.back();
+
+    if (container->is_array()) {
+        container->push_back(std::forward<T>(value));
+    } else {
+        // key() pushed the object member, value fills it and closes it.
+        *container = std::forward<T>(value);
+        m_dom_stack.pop_back();
+    }
+
+    return true;
+}
+
+
+bool sax_handler::dom_start(json&& container)
+{
+    auto* parent = m_dom_stack.back();
+
+    if (parent->is_array()) {
+        parent->push_back(std::move(container));
+        m_dom_stack.push_back(&parent->back());
+    } else {
+        *parent = std::move(container);
+    }
+
+    return true;
+}
+
+
+bool sax_handler::dom_end()
+{
+    m_dom_stack.pop_back();
+
+    if (m_dom_stack.empty()) {
+        section_end_element(m_stack[1].key, std::move(m_dom_root));
+        m_dom_root = json{};
+    }
+
+    return true;
+}
+
+
+sax_handler::field sax_handler::current_key() const
+{
+    if (!m_stack.empty() && m_stack.back().is_array) {
+        return m_stack.back().key;
+    }
+
+    return m_key;
+}
+
+
+size_t sax_handler::current_index() const
+{
+    return m_stack.back().index;
+}
+
+
+sax_handler::field sax_handler::key_at(size_t depth) const
+{
+    return m_stack[depth].key;
+}
+
+
+bool sax_handler::on_start(bool is_array)
+{
+    if (m_skip_depth > 0) {
+        m_skip_depth++;
+        return true;
+    }
+
+    if (!m_dom_stack.empty()) {
+        return dom_start(is_array ? json::array() : json::object());
+    }
+
+    const auto key = current_key();
+    const auto depth = m_stack.size();
+
+    if (depth > 0 && m_stack.back().is_array) {
+        m_stack.back().index++;
+    }
+
+    switch (depth) {
+        case 0:
+            break;
+
+        case 1:
+            if (is_array && key == field::extensions_used) {
+                break;
+            }
+
+            if (!is_array || (!is_streamed_section(key) && !is_dom_section(key)) || is_deferred_section(m_options.deferred, key)) {
+                m_skip_depth = 1;
+                return true;
+            }
+            break;
+
+        case 2:
+            if (!m_stack[1].is_array || is_array) {
+                m_skip_depth = 1;
+                return true;
+            }
+
+            if (is_dom_section(m_stack[1].key)) {
+                m_dom_root = json::object();
+                m_dom_stack.push_back(&m_dom_root);
+                return true;
+            }
+
+            section_start_element(m_stack[1].key);
+            break;
+
+        default:
+            // only buffer view extensions are streamed, the rest is skipped.
+            if (key == field::unknown || (key == field::extensions && m_stack[1].key != field::buffer_views)) {
+                m_skip_depth = 1;
+                return true;
+            }
+
+            if (m_stack[1].key == field::buffer_views && depth == 4 && key == field::ext_meshopt_compression) {
+                m_model.m_buffer_views.back().m_meshopt_compression.emplace();
+            }
+
+            if (m_stack[1].key == field::nodes && depth == 3 && key == field::matrix) {
+                m_model.m_nodes.back().m_transform_data = glm::mat4{1};
+            } else if (m_stack[1].key == field::meshes && depth == 4 && key == field::primitives && !is_array) {
+                m_model.m_meshes.back().m_primitives.push_back(m_model.m_primitives_table, primitive{});
+            } else if (m_stack[1].key == field::animations && depth == 4 && !is_array) {
+                auto& animation = m_model.m_animations.back();
+                if (key == field::channels) {
+                    animation.m_channels.emplace_back();
+                } else if (key == field::samplers) {
+                    animation.m_samplers.emplace_back();
+                }
+            }
+            break;
+    }
+
+    m_stack.push_back({.key = key, .is_array = is_array, .index = 0});
+
+    return true;
+}
+
+
+bool sax_handler::on_end()
+{
+    if (m_skip_depth > 0) {
+        m_skip_depth--;
+        return true;
+    }
+
+    if (!m_dom_stack.empty()) {
+        return dom_end();
+    }
+
+    const auto closed = m_stack.back();
+    m_stack.pop_back();
+
+    if (m_stack.size() == 4 && m_stack[1].key == field::meshes && closed.key == field::primitives && !closed.is_array) {
+        const auto& attributes_range = m_model.m_primitives_table.back().m_attributes;
+        const auto attributes = m_model.m_attributes_table.begin() + attributes_range.get_offset();
+
+        // keep attributes in attribute_path order like the json constructor does.
+        std::sort(attributes, attributes + attributes_range.get_count(), [](const primitive::attribute& l, const primitive::attribute& r) {
+            return l.path < r.path;
+        });
+    }
+
+    return true;
+}
+
+
+bool sax_handler::on_value(const value& val)
+{
+    if (m_stack.size() == 1 && m_key == field::scene) {
+        m_model.m_current_scene = static_cast<uint32_t>(val.integer);
+    }
+
+    if (m_stack.size() == 2 && m_stack[1].key == field::extensions_used) {
+        m_model.m_extensions_used.emplace_back(val.string);
+    }
+
+    if (m_stack.size() >= 3) {
+        switch (m_stack[1].key) {
+            case field::accessors:
+                accessor_value(val);
+                break;
+            case field::buffer_views:
+                buffer_view_value(val);
+                break;
+            case field::nodes:
+                node_value(val);
+                break;
+            case field::meshes:
+                mesh_value(val);
+                break;
+            case field::skins:
+                skin_value(val);
+                break;
+            case field::scenes:
+                scene_value(val);
+                break;
+            case field::animations:
+                animation_value(val);
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (!m_stack.empty() && m_stack.back().is_array) {
+        m_stack.back().index++;
+    }
+
+    return true;
+}
+
+
+void sax_handler::section_start_element(field section)
+{
+    switch (section) {
+        case field::accessors:
+            m_model.m_accessors.emplace_back();
+            break;
+        case field::buffer_views:
+            m_model.m_buffer_views.emplace_back();
+            break;
+        case field::nodes:
+            m_model.m_nodes.emplace_back();
+            break;
+        case field::meshes:
+            m_model.m_meshes.emplace_back();
+            break;
+        case field::skins:
+            m_model.m_skins.emplace_back();
+            break;
+        case field::scenes:
+            m_model.m_scenes.emplace_back();
+            break;
+        case field::animations:
+            m_model.m_animations.emplace_back();
+            break;
+        default:
+            break;
+    }
+}
+
+
+void sax_handler::section_end_element(field section, json&& element_json)
+{
+    switch (section) {
+        case field::buffers:
+            // glb binary chunk is referenced by the first buffer without uri.
+            if (m_model.m_buffers.empty() && m_glb_data.has_value() && element_json.find("uri") == element_json.end()) {
+                m_model.m_buffers.emplace_back(std::move(*m_glb_data));
+                m_glb_data.reset();
+            } else if (m_options.thread_pool != nullptr) {
+                // files are read in parallel once the whole json is parsed.
+                m_pending_buffers.emplace_back(m_model.m_buffers.size(), std::move(element_json));
+                m_model.m_buffers.emplace_back();
+            } else {
+                m_model.m_buffers.emplace_back(element_json, m_model.m_cwd, m_options);
+            }
+            break;
+        case field::images:
+            m_model.m_images.emplace_back(element_json);
+            break;
+        case field::samplers:
+            m_model.m_samplers.emplace_back(element_json);
+            break;
+        case field::textures:
+            m_model.m_textures.emplace_back(element_json);
+            break;
+        case field::materials:
+            m_model.m_materials.emplace_back(element_json);
+            break;
+        case field::cameras:
+            m_model.m_cameras.emplace_back(element_json);
+            break;
+        default:
+            break;
+    }
+}
+
+
+void sax_handler::accessor_value(const value& val)
+{
+    auto& accessor = m_model.m_accessors.back();
+    const auto key = current_key();
+
+    if (m_stack.size() == 3) {
+        switch (key) {
+            case field::buffer_view:
+                accessor.m_buffer_view = val.integer;
+                break;
+            case field::byte_offset:
+                accessor.m_byte_offset = val.integer;
+                break;
+            case field::component_type:
+                accessor.m_component_type = static_cast<component_type>(val.integer);
+                break;
+            case field::normalized:
+                accessor.m_normalized = val.integer != 0;
+                break;
+            case field::count:
+                accessor.m_count = val.integer;
+                break;
+            case field::type:
+                accessor.m_type = accessor_type_value{val.string};
+                break;
+            default:
+                break;
+        }
+    } else if (m_stack.size() >= 4 && key_at(3) == field::sparse) {
+        if (!accessor.m_sparse) {
+            accessor.m_sparse.emplace();
+        }
+
+        auto& sparse = *accessor.m_sparse;
+        const auto section = m_stack.size() == 5 ? key_at(4) : field::unknown;
+
+        if (m_stack.size() == 4 && key == field::count) {
+            sparse.count = val.integer;
+        } else if (section == field::indices) {
+            if (key == field::buffer_view) {
+                sparse.indices_buffer_view = val.integer;
+            } else if (key == field::byte_offset) {
+                sparse.indices_byte_offset = val.integer;
+            } else if (key == field::component_type) {
+                sparse.indices_component_type = static_cast<component_type>(val.integer);
+            }
+        } else if (section == field::values) {
+            if (key == field::buffer_view) {
+                sparse.values_buffer_view = val.integer;
+            } else if (key == field::byte_offset) {
+                sparse.values_byte_offset = val.integer;
+            }
+        }
+    } else if (m_stack.size() == 4 && current_index() < 4) {
+        if (key == field::min) {
+            glm::value_ptr(accessor.m_min)[current_index()] = float(val.number);
+            accessor.m_has_min = true;
+        } else if (key == field::max) {
+            glm::value_ptr(accessor.m_max)[current_index()] = float(val.number);
+            accessor.m_has_max = true;
+        }
+    }
+}
+
+
+void sax_handler::buffer_view_value(const value& val)
+{
+    if (m_stack.size() == 5 && key_at(4) == field::ext_meshopt_compression) {
+        auto& compression = *m_model.m_buffer_views.back().m_meshopt_compression;
+
+        switch (current_key()) {
+            case field::buffer:
+                compression.buffer = val.integer;
+                break;
+            case field::byte_offset:
+                compression.byte_offset = val.integer;
+                break;
+            case field::byte_length:
+                compression.byte_length = val.integer;
+                break;
+            case field::byte_stride:
+                compression.byte_stride = val.integer;
+                break;
+            case field::count:
+                compression.count = val.integer;
+                break;
+            case field::mode:
+                compression.mode = meshopt_compression_mode_value(val.string);
+                break;
+            case field::filter:
+                compression.filter = meshopt_compression_filter_value(val.string);
+                break;
+            default:
+                break;
+        }
+        return;
+    }
+
+    if (m_stack.size() != 3) {
+        return;
+    }
+
+    auto& buffer_view = m_model.m_buffer_views.back();
+
+    switch (current_key()) {
+        case field::buffer:
+            buffer_view.m_buffer = val.integer;
+            break;
+        case field::byte_offset:
+            buffer_view.m_byte_offset = val.integer;
+            break;
+        case field::byte_length:
+            buffer_view.m_byte_length = val.integer;
+            break;
+        case field::byte_stride:
+            buffer_view.m_byte_stride = val.integer;
+            break;
+        default:
+            break;
+    }
+}
+
+
+void sax_handler::node_value(const value& val)
+{
+    auto& node = m_model.m_nodes.back();
+    const auto key = current_key();
+
+    if (m_stack.size() == 3) {
+        if (key == field::mesh) {
+            node.m_mesh = static_cast<int32_t>(val.integer);
+        } else if (key == field::skin) {
+            node.m_skin = static_cast<int32_t>(val.integer);
+        } else if (key == field::camera) {
+            node.m_camera = static_cast<int32_t>(val.integer);
+        }
+        return;
+    }
+
+    if (m_stack.size() != 4) {
+        return;
+    }
+
+    const auto index = current_index();
+
+    if (key == field::children) {
+        node.m_children.push_back(m_model.m_node_children_table, static_cast<int32_t>(val.integer));
+    } else if (auto* matrix = std::get_if<glm::mat4>(&node.m_transform_data); matrix != nullptr) {
+        if (key == field::matrix && index < 16) {
+            glm::value_ptr(*matrix)[index] = float(val.number);
+        }
+    } else if (auto* trs = std::get_if<node::trs_transform>(&node.m_transform_data); trs != nullptr) {
+        if (key == field::rotation && index < 4) {
+            glm::value_ptr(trs->rotation)[index] = float(val.number);
+        } else if (key == field::scale && index < 3) {
+            glm::value_ptr(trs->scale)[index] = float(val.number);
+        } else if (key == field::translation && index < 3) {
+            glm::value_ptr(trs->translation)[index] = float(val.number);
+        }
+    }
+}
+
+
+void sax_handler::mesh_value(const value& val)
+{
+    if (m_stack.size() < 5 || key_at(3) != field::primitives) {
+        return;
+    }
+
+    auto& primitive = m_model.m_primitives_table.back();
+    const auto key = current_key();
+
+    if (m_stack.size() == 5) {
+        if (key == field::indices) {
+            primitive.m_indices = static_cast<int32_t>(val.integer);
+        } else if (key == field::material) {
+            primitive.m_material = static_cast<int32_t>(val.integer);
+        } else if (key == field::mode) {
+            CHECK_MSG(val.integer <= static_cast<uint64_t>(primitive_mode::triangle_fan), "Bad primitive mode.");
+            primitive.m_mode = static_cast<primitive_mode>(val.integer);
+        }
+    } else if (m_stack.size() == 6 && key == field::attributes && m_attribute_key.has_value()) {
+        primitive.m_attributes.push_back(m_model.m_attributes_table, {*m_attribute_key, static_cast<uint32_t>(val.integer)});
+    }
+}
+
+
+void sax_handler::skin_value(const value& val)
+{
+    auto& skin = m_model.m_skins.back();
+    const auto key = current_key();
+
+    if (m_stack.size() == 3 && key == field::inverse_bind_matrices) {
+        skin.m_inv_bind_matrices = static_cast<uint32_t>(val.integer);
+    } else if (m_stack.size() == 4 && key == field::joints) {
+        skin.m_joints.push_back(m_model.m_joints_table, static_cast<int32_t>(val.integer));
+    }
+}
+
+
+void sax_handler::scene_value(const value& val)
+{
+    if (m_stack.size() == 4 && current_key() == field::nodes) {
+        m_model.m_scenes.back().m_nodes.push_back(m_model.m_scene_nodes_table, static_cast<int32_t>(val.integer));
+    }
+}
+
+
+void sax_handler::animation_value(const value& val)
+{
+    if (m_stack.size() < 5) {
+        return;
+    }
+
+    auto& animation = m_model.m_animations.back();
+    const auto key = current_key();
+
+    if (key_at(3) == field::channels) {
+        auto& channel = animation.m_channels.back();
+
+        if (m_stack.size() == 5 && key == field::sampler) {
+            channel.m_sampler = val.integer;
+        } else if (m_stack.size() == 6 && key_at(5) == field::target) {
+            if (key == field::node) {
+                channel.m_node = val.integer;
+            } else if (key == field::path) {
+                channel.m_path = animation_path_value{val.string};
+            }
+        }
+    } else if (key_at(3) == field::samplers && m_stack.size() == 5) {
+        auto& sampler = animation.m_samplers.back();
+
+        if (key == field::input) {
+            sampler.m_input = val.integer;
+        } else if (key == field::output) {
+            sampler.m_output = val.integer;
+        } else if (key == field::interpolation) {
+            sampler.m_interpolation = animation_interpolation_value{val.string};
+        }
+    }
+}
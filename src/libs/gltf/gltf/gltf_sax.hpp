@@ -0,0 +1,92 @@
+#pragma once
+
+#include <gltf/gltf_base.hpp>
+
+namespace sandbox::gltf
+{
+    // nlohmann sax consumer which fills model sections directly from json tokens.
+    // big sections (accessors, buffer views, nodes, meshes, skins, scenes, animations) are parsed in place,
+    // the rest is collected into small per element documents and passed to the json constructors.
+    class sax_handler
+    {
+    public:
+        using json = nlohmann::json;
+
+        sax_handler(model& mdl, std::optional<utils::data> glb_data, const load_options& options);
+
+        bool null();
+        bool boolean(bool value);
+        bool number_integer(json::number_integer_t value);
+        bool number_unsigned(json::number_unsigned_t value);
+        bool number_float(json::number_float_t value, const json::string_t&);
+        bool string(json::string_t& value);
+        bool binary(json::binary_t& value);
+
+        bool start_object(size_t);
+        bool key(json::string_t& value);
+        bool end_object();
+
+        bool start_array(size_t);
+        bool end_array();
+
+        bool parse_error(size_t position, const std::string& last_token, const nlohmann::detail::exception& ex);
+
+        void finish();
+
+        enum class field : uint8_t;
+
+    private:
+        struct frame
+        {
+            field key;
+            bool is_array;
+            size_t index;
+        };
+
+        struct value
+        {
+            double number{0};
+            uint64_t integer{0};
+            std::string_view string{};
+        };
+
+        template<typename T>
+        bool dom_value(T&& value);
+        bool dom_start(json&& container);
+        bool dom_end();
+
+        bool on_value(const value& val);
+        bool on_start(bool is_array);
+        bool on_end();
+
+        void section_start_element(field section);
+        void section_end_element(field section, json&& element_json);
+
+        void accessor_value(const value& val);
+        void buffer_view_value(const value& val);
+        void node_value(const value& val);
+        void mesh_value(const value& val);
+        void skin_value(const value& val);
+        void scene_value(const value& val);
+        void animation_value(const value& val);
+
+        field current_key() const;
+        size_t current_index() const;
+        field key_at(size_t depth) const;
+
+        model& m_model;
+        std::optional<utils::data> m_glb_data;
+        load_options m_options;
+
+        std::vector<frame> m_stack{};
+        field m_key{};
+        std::optional<attribute_path> m_attribute_key{};
+        size_t m_skip_depth{0};
+
+        json m_dom_root{};
+        std::vector<json*> m_dom_stack{};
+
+        // external buffers are read in finish with parallel_for, the calling thread takes part in it.
+        std::vector<std::pair<size_t, json>> m_pending_buffers{};
+    };
+} // namespace sandbox::gltf
@@ -1,11 +1,24 @@
 #include "gltf_vk.hpp"
 
+#include <gltf/accessor_view.hpp>
+#include <gltf/asset_registry.hpp>
+#include <gltf/bounds.hpp>
+#include <gltf/mesh_optimizer.hpp>
+#include <gltf/vertex_conversion.hpp>
 #include <gltf/vk_utils.hpp>
 #include <render/vk/utils.hpp>
 #include <utils/conditions_helpers.hpp>
+#include <utils/hash.hpp>
+#include <filesystem/async_reader.hpp>
+#include <filesystem/mapped_file.hpp>
+#include <filesystem/vfs.hpp>
 
 #include <stb/stb_image.h>
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
 #include <filesystem>
 #include <numeric>
 
@@ -15,240 +28,1462 @@ using namespace sandbox::hal::render;
 
 namespace
 {
+    float srgb_to_linear(uint8_t value)
+    {
+        const float v = value / 255.f;
+        return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+    }
+
+
+    uint8_t linear_to_srgb(float value)
+    {
+        const float v = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>(std::clamp(v, 0.f, 1.f) * 255.f + 0.5f);
+    }
+
+
+    // 2x2 box filter in linear space, as the blit of srgb images does. alpha of rgba images is linear.
+    std::vector<std::vector<uint8_t>> gen_srgb_mips(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height)
+    {
+        const uint32_t channels = pixels.size() / (size_t(width) * height);
+        const uint32_t color_channels = std::min(channels, 3u);
+
+        static const auto to_linear = []() {
+            std::array<float, 256> result{};
+            for (size_t i = 0; i < result.size(); ++i) {
+                result[i] = srgb_to_linear(i);
+            }
+            return result;
+        }();
+
+        std::vector<std::vector<uint8_t>> result{};
+        // the same count of levels which image_pool generates on gpu.
+        result.reserve(std::bit_width(std::max(width, height)));
+        result.emplace_back(pixels);
+
+        while (width > 1 || height > 1) {
+            const auto& src = result.back();
+            const uint32_t dst_width = std::max(width >> 1, 1u);
+            const uint32_t dst_height = std::max(height >> 1, 1u);
+
+            std::vector<uint8_t> dst(size_t(dst_width) * dst_height * channels);
+
+            for (uint32_t y = 0; y < dst_height; ++y) {
+                const uint32_t y0 = std::min(y * 2, height - 1);
+                const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+
+                for (uint32_t x = 0; x < dst_width; ++x) {
+                    const uint32_t x0 = std::min(x * 2, width - 1);
+                    const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+
+                    const std::array<size_t, 4> texels{
+                        (size_t(y0) * width + x0) * channels,
+                        (size_t(y0) * width + x1) * channels,
+                        (size_t(y1) * width + x0) * channels,
+                        (size_t(y1) * width + x1) * channels};
+
+                    auto* dst_texel = dst.data() + (size_t(y) * dst_width + x) * channels;
+
+                    for (uint32_t c = 0; c < channels; ++c) {
+                        if (c < color_channels) {
+                            float sum = 0;
+                            for (const auto texel : texels) {
+                                sum += to_linear[src[texel + c]];
+                            }
+                            dst_texel[c] = linear_to_srgb(sum * 0.25f);
+                        } else {
+                            uint32_t sum = 0;
+                            for (const auto texel : texels) {
+                                sum += src[texel + c];
+                            }
+                            dst_texel[c] = (sum + 2) / 4;
+                        }
+                    }
+                }
+            }
+
+            width = dst_width;
+            height = dst_height;
+            result.emplace_back(std::move(dst));
+        }
+
+        return result;
+    }
+
+
+    vk_model_cache::bounding_volume to_bounding_volume(const bounds& b)
+    {
+        return {
+            .min = {b.min.x, b.min.y, b.min.z},
+            .max = {b.max.x, b.max.y, b.max.z},
+            .center = {b.center.x, b.center.y, b.center.z},
+            .radius = b.radius};
+    }
+
+
+    bounds from_bounding_volume(const vk_model_cache::bounding_volume& volume)
+    {
+        bounds result{};
+        result.min = glm::vec3{volume.min[0], volume.min[1], volume.min[2]};
+        result.max = glm::vec3{volume.max[0], volume.max[1], volume.max[2]};
+        result.center = glm::vec3{volume.center[0], volume.center[1], volume.center[2]};
+        result.radius = volume.radius;
+
+        return result;
+    }
+
+
+    // caches without lods have the primitive indices as the only one.
+    std::vector<vk_lod> get_lods(const vk_model_cache::primitive& primitive)
+    {
+        if (primitive.lods_count == 0) {
+            return {vk_lod{.first_index = 0, .indices_count = primitive.indices_count}};
+        }
+
+        std::vector<vk_lod> result{};
+        result.reserve(primitive.lods_count);
+
+        for (uint32_t i = 0; i < primitive.lods_count; ++i) {
+            const auto& lod = primitive.lods[i];
+            result.emplace_back(vk_lod{.first_index = lod.first_index, .indices_count = lod.indices_count, .error = lod.error});
+        }
+
+        return result;
+    }
+
+
+    // reads indices and float positions of the primitive. returns false if the primitive is not an indexed triangle list
+    // with positions, so its triangles are baked as they are. points, lines, strips and fans are never reordered.
+    bool read_triangles(const model& mdl, const primitive& prim, std::vector<uint32_t>& indices, std::vector<glm::vec3>& positions)
+    {
+        if (prim.get_mode() != primitive_mode::triangles) {
+            return false;
+        }
+
+        const auto position_attribute = prim.attribute_at_path(mdl, attribute_path::position);
+        const auto indices_count = prim.get_indices_count(mdl);
+
+        if (position_attribute.attribute_data == nullptr || indices_count == 0 || indices_count % 3 != 0) {
+            return false;
+        }
+
+        const auto& indices_accessor = mdl.get_accessors()[prim.get_indices()];
+        const auto index_size = get_component_type_size(indices_accessor.get_component_type());
+
+        std::vector<uint8_t> source_indices(indices_accessor.get_data_size());
+        indices_accessor.copy_data(mdl, source_indices.data());
+
+        indices.resize(indices_count);
+
+        for (uint64_t i = 0; i < indices_count; ++i) {
+            uint32_t index = 0;
+            std::memcpy(&index, source_indices.data() + i * index_size, index_size);
+            indices[i] = index;
+        }
+
+        const auto vertices_count = position_attribute.elements_count;
+
+        // broken indices are baked as they are, reordering would read out of bounds.
+        if (std::any_of(indices.begin(), indices.end(), [vertices_count](uint32_t index) { return index >= vertices_count; })) {
+            return false;
+        }
+
+        positions.resize(vertices_count);
+
+        convert_vertices(
+            position_attribute.attribute_data,
+            position_attribute.byte_stride,
+            to_vertex_format(position_attribute.accessor_type, position_attribute.component_type, position_attribute.normalized),
+            reinterpret_cast<uint8_t*>(positions.data()),
+            sizeof(glm::vec3),
+            vertex_format{.component = vertex_component::float32, .components_count = 3},
+            vertices_count);
+
+        return true;
+    }
+
+
+    // double sided clusters are never backfacing, so they get cones which are never culled.
+    std::vector<vk_model_cache::cluster> get_clusters(
+        const std::vector<index_cluster>& clusters,
+        const std::vector<uint32_t>& indices,
+        const std::vector<glm::vec3>& positions,
+        bool double_sided)
+    {
+        std::vector<vk_model_cache::cluster> result{};
+        result.reserve(clusters.size());
+
+        for (const auto& cluster : clusters) {
+            const auto first_index = cluster.first_triangle * 3;
+            const auto indices_count = cluster.triangles_count * 3;
+
+            auto cluster_indices = std::span<const uint32_t>(indices).subspan(first_index, indices_count);
+            auto volume = get_cluster_bounds(cluster_indices, reinterpret_cast<const uint8_t*>(positions.data()), sizeof(glm::vec3));
+
+            if (double_sided) {
+                volume.cone_axis = glm::vec3{0};
+                volume.cone_cutoff = 1;
+            }
+
+            result.emplace_back(vk_model_cache::cluster{
+                .center = {volume.center.x, volume.center.y, volume.center.z},
+                .radius = volume.radius,
+                .cone_axis = {volume.cone_axis.x, volume.cone_axis.y, volume.cone_axis.z},
+                .cone_cutoff = volume.cone_cutoff,
+                .first_index = first_index,
+                .indices_count = indices_count});
+        }
+
+        return result;
+    }
+
+
+    // lods stop at errors which are a visible part of the primitive at any distance where they would be picked.
+    constexpr float max_lod_error = 0.1f;
+    // vertices which skin weights differ more are not merged by simplification, so joint boundaries keep their shape.
+    constexpr float max_skin_distance = 0.5f;
+
+
+    // joints and weights of every vertex of a skinned primitive.
+    struct vertex_skin
+    {
+        std::vector<glm::uvec4> joints{};
+        std::vector<glm::vec4> weights{};
+
+        // sum of weight differences per joint, 0 for the same skinning and 2 for skinning by different joints.
+        float get_distance(uint32_t lhs, uint32_t rhs) const
+        {
+            float result = 0;
+
+            for (int32_t i = 0; i < 4; ++i) {
+                float rhs_weight = 0;
+
+                for (int32_t j = 0; j < 4; ++j) {
+                    rhs_weight += joints[rhs][j] == joints[lhs][i] ? weights[rhs][j] : 0.0f;
+                }
+
+                result += std::abs(weights[lhs][i] - rhs_weight);
+            }
+
+            for (int32_t j = 0; j < 4; ++j) {
+                const bool shared = joints[rhs][j] == joints[lhs][0] || joints[rhs][j] == joints[lhs][1]
+                                    || joints[rhs][j] == joints[lhs][2] || joints[rhs][j] == joints[lhs][3];
+                result += shared ? 0.0f : weights[rhs][j];
+            }
+
+            return result;
+        }
+    };
+
+
+    // empty for primitives without joints or weights.
+    vertex_skin get_vertex_skin(const model& mdl, const primitive& prim)
+    {
+        const auto joints = prim.attribute_at_path(mdl, attribute_path::joints_0);
+        const auto weights = prim.attribute_at_path(mdl, attribute_path::weights_0);
+
+        vertex_skin result{};
+
+        if (joints.attribute_data == nullptr || weights.attribute_data == nullptr || joints.elements_count != weights.elements_count) {
+            return result;
+        }
+
+        result.joints.resize(joints.elements_count);
+        result.weights.resize(weights.elements_count);
+
+        convert_vertices(
+            joints.attribute_data,
+            joints.byte_stride,
+            to_vertex_format(joints.accessor_type, joints.component_type, joints.normalized),
+            reinterpret_cast<uint8_t*>(result.joints.data()),
+            sizeof(glm::uvec4),
+            vertex_format{.component = vertex_component::uint32, .components_count = 4},
+            joints.elements_count);
+
+        convert_vertices(
+            weights.attribute_data,
+            weights.byte_stride,
+            to_vertex_format(weights.accessor_type, weights.component_type, weights.normalized),
+            reinterpret_cast<uint8_t*>(result.weights.data()),
+            sizeof(glm::vec4),
+            vertex_format{.component = vertex_component::float32, .components_count = 4},
+            weights.elements_count);
+
+        return result;
+    }
+
+
     template<typename T>
-    struct attribute_converter;
+    void apply_remap(std::vector<T>& values, const std::vector<uint32_t>& remap)
+    {
+        std::vector<T> source(std::move(values));
+        values.resize(source.size());
+
+        for (size_t i = 0; i < remap.size(); ++i) {
+            values[remap[i]] = source[i];
+        }
+    }
+
+
+    // every lod is simplified from the primitive itself, so errors don't pile up from lod to lod. positions and skin
+    // are indexed as source vertices, remap moves them to vertices which indices refer to.
+    std::vector<simplification_result> generate_primitive_lods(
+        const model& mdl,
+        const primitive& prim,
+        const std::vector<uint32_t>& indices,
+        std::vector<glm::vec3> positions,
+        const std::vector<uint32_t>& remap,
+        uint32_t lods_count,
+        float max_error,
+        bool optimize)
+    {
+        auto skin = get_vertex_skin(mdl, prim);
+
+        if (!remap.empty()) {
+            apply_remap(positions, remap);
+
+            if (!skin.joints.empty()) {
+                apply_remap(skin.joints, remap);
+                apply_remap(skin.weights, remap);
+            }
+        }
+
+        std::function<bool(uint32_t, uint32_t)> can_collapse{};
+
+        if (!skin.joints.empty()) {
+            can_collapse = [&skin](uint32_t from, uint32_t to) {
+                return skin.get_distance(from, to) <= max_skin_distance;
+            };
+        }
+
+        std::vector<simplification_result> result{};
+        size_t target_indices_count = indices.size();
+        size_t previous_indices_count = indices.size();
+
+        for (uint32_t i = 0; i < lods_count; ++i) {
+            target_indices_count = target_indices_count / 6 * 3;
+
+            auto lod = simplify(
+                indices,
+                reinterpret_cast<const uint8_t*>(positions.data()),
+                sizeof(glm::vec3),
+                positions.size(),
+                target_indices_count,
+                max_error,
+                can_collapse);
+
+            // a lod which drops few triangles isn't worth switching to, and the next ones would stop at the same error.
+            if (lod.indices.empty() || lod.indices.size() > previous_indices_count * 3 / 4) {
+                break;
+            }
+
+            previous_indices_count = lod.indices.size();
+
+            if (optimize) {
+                optimize_vertex_cache(lod.indices, positions.size());
+            }
+
+            result.emplace_back(std::move(lod));
+        }
+
+        return result;
+    }
+
+
+    // uniform block of cluster_culling.comp.
+    struct gpu_culling_data
+    {
+        glm::mat4 model{1};
+        std::array<glm::vec4, 6> frustum_planes{};
+        // xyz is the camera position in model space, w is the largest axis scale of the model matrix.
+        glm::vec4 camera{0};
+    };
+
+    static_assert(sizeof(gpu_culling_data) == sizeof(float) * 4 * 11);
+
+
+    // world space planes of the frustum which normals point inside. the near plane is taken for the -w..w depth range,
+    // so it is conservative for 0..w too. planes which degenerate, e.g. the far plane of infinite projections, pass all.
+    std::array<glm::vec4, 6> get_frustum_planes(const glm::mat4& view_proj)
+    {
+        auto row = [&view_proj](int32_t i) {
+            return glm::vec4{view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]};
+        };
+
+        std::array<glm::vec4, 6> result{
+            row(3) + row(0),
+            row(3) - row(0),
+            row(3) + row(1),
+            row(3) - row(1),
+            row(3) + row(2),
+            row(3) - row(2)};
+
+        for (auto& plane : result) {
+            const float length = glm::length(glm::vec3(plane));
+            plane = length > std::numeric_limits<float>::epsilon() ? plane / length : glm::vec4{0, 0, 0, 1};
+        }
+
+        return result;
+    }
+
+
+    // see vk_model_builder::compact_vertices, joints are widened for skins which don't fit 8 bits.
+    std::array<vk::Format, 8> get_compact_vertex_format(const model& mdl)
+    {
+        const bool wide_joints = std::any_of(mdl.get_skins().begin(), mdl.get_skins().end(), [](const skin& s) {
+            return s.get_joints().size() > std::numeric_limits<uint8_t>::max() + 1;
+        });
+
+        return {
+            vk::Format::eR32G32B32Sfloat,
+            vk::Format::eR16G16Snorm,
+            vk::Format::eR8G8B8A8Snorm,
+            vk::Format::eR16G16Sfloat,
+            vk::Format::eR16G16Sfloat,
+            vk::Format::eR8G8B8A8Unorm,
+            wide_joints ? vk::Format::eR16G16B16A16Uint : vk::Format::eR8G8B8A8Uint,
+            vk::Format::eR8G8B8A8Unorm};
+    }
+
+
+    glm::vec3 to_vec3(const float (&value)[3])
+    {
+        return glm::vec3{value[0], value[1], value[2]};
+    }
+
+
+    // images which mips are generated on gpu get the same levels as gen_srgb_mips bakes.
+    uint64_t get_image_size(const vk_model_cache::image& image)
+    {
+        if (image.gen_mips == 0) {
+            return image.pixels.size;
+        }
+
+        const uint64_t texel_size = image.pixels.size / (uint64_t(image.width) * image.height);
+
+        uint64_t result = 0;
+        uint32_t width = image.width;
+        uint32_t height = image.height;
+
+        while (true) {
+            result += uint64_t(width) * height * texel_size;
+
+            if (width == 1 && height == 1) {
+                break;
+            }
+
+            width = std::max(width >> 1, 1u);
+            height = std::max(height >> 1, 1u);
+        }
+
+        return result;
+    }
+} // namespace
+
+
+vk_model_builder& vk_model_builder::set_vertex_format(
+    const std::array<vk::Format, 8>& fmt)
+{
+    m_fixed_format = fmt;
+    return *this;
+}
+
+
+vk_model_builder& vk_model_builder::use_skin(bool use_skin)
+{
+    m_skinned = use_skin;
+    return *this;
+}
+
+
+vk_model_builder& vk_model_builder::set_cache_directory(const std::string& directory)
+{
+    m_cache_directory = directory;
+    return *this;
+}
+
+
+vk_model_builder& vk_model_builder::bake_mips(bool bake_mips)
+{
+    m_bake_mips = bake_mips;
+    return *this;
+}
+
+
+vk_model_builder& vk_model_builder::keep_quantized(bool keep_quantized)
+{
+    m_keep_quantized = keep_quantized;
+    return *this;
+}
+
+
+vk_model_builder& vk_model_builder::compact_vertices(bool compact_vertices)
+{
+    m_compact_vertices = compact_vertices;
+    return *this;
+}
+
+
+vk_model_builder& vk_model_builder::quantize_positions(bool quantize_positions)
+{
+    m_quantize_positions = quantize_positions;
+    return *this;
+}
+
+
+vk_model_builder& vk_model_builder::optimize_meshes(bool optimize_meshes)
+{
+    m_optimize_meshes = optimize_meshes;
+    return *this;
+}
+
+
+vk_model_builder& vk_model_builder::build_clusters(bool build_clusters)
+{
+    m_build_clusters = build_clusters;
+    return *this;
+}
+
+
+vk_model_builder& vk_model_builder::generate_lods(uint32_t lods_count)
+{
+    CHECK_MSG(lods_count < vk_model_cache::max_lods, "Too many lods.");
+    m_lods_count = lods_count;
+    return *this;
+}
+
+
+vk_model_builder& vk_model_builder::set_asset_registry(asset_registry* assets)
+{
+    m_assets = assets;
+    return *this;
+}
+
+
+vk_model_builder& vk_model_builder::set_file_system(hal::filesystem::vfs* file_system)
+{
+    m_file_system = file_system;
+    return *this;
+}
+
+
+vk_model_builder& vk_model_builder::release_after_upload(bool release_after_upload)
+{
+    m_release_after_upload = release_after_upload;
+    return *this;
+}
+
+
+vk_model vk_model_builder::load_from_file(
+    const std::string& path,
+    hal::render::avk::buffer_pool& buffer_pool,
+    hal::render::avk::image_pool& image_pool)
+{
+    return instantiate(load_cache(path), buffer_pool, image_pool);
+}
+
+
+std::shared_ptr<const vk_model_cache> vk_model_builder::load_cache(const std::string& path)
+{
+    const auto resolved_path = get_file_system().resolve(path);
+    const auto cache_path = get_cache_path(path);
+    const auto sources_directory = std::filesystem::path(resolved_path).parent_path().string();
+    const auto key = get_cache_key(resolved_path);
+
+    auto open_or_bake = [this, &resolved_path, &cache_path, &sources_directory, key]() {
+        if (auto cache = vk_model_cache::open(cache_path, key, sources_directory)) {
+            return std::move(*cache);
+        }
+
+        auto cache = bake_file(resolved_path);
+
+        // the cache only speeds up the next load, so the model is created even if it cannot be written.
+        try {
+            std::filesystem::create_directories(std::filesystem::path(cache_path).parent_path());
+            cache.save(cache_path);
+        } catch (const std::exception&) {
+        }
+
+        return cache;
+    };
+
+    if (m_assets == nullptr) {
+        return std::make_shared<const vk_model_cache>(open_or_bake());
+    }
+
+    // the key changes with the model file and builder settings. other sources are checked only when the cache is opened.
+    const auto asset_key = asset_registry::make_key("vk model", asset_registry::get_canonical_path(resolved_path), key);
+
+    // the cache which is still held by another model is reused, but a new one isn't kept by the registry after upload.
+    if (m_release_after_upload) {
+        auto cache = m_assets->find<vk_model_cache>(asset_key);
+        return cache ? std::move(cache) : std::make_shared<const vk_model_cache>(open_or_bake());
+    }
+
+    return m_assets->acquire<vk_model_cache>(asset_key, [&open_or_bake]() {
+        auto cache = open_or_bake();
+        const auto size = cache.get_blobs_size();
+        return std::pair{std::move(cache), size};
+    });
+}
+
+
+vk_model_cache vk_model_builder::bake_file(const std::string& path)
+{
+    const auto resolved_path = get_file_system().resolve(path);
+    const auto sources_directory = std::filesystem::path(resolved_path).parent_path();
+
+    const auto mdl = model::from_url(resolved_path, {.file_system = m_file_system, .assets = m_release_after_upload ? nullptr : m_assets});
+    auto cache = bake(mdl);
+    cache.set_key(get_cache_key(resolved_path));
+
+    auto add_source = [&cache, &sources_directory, &mdl](const std::string& uri) {
+        const auto relative_path = (std::filesystem::path(mdl.get_cwd()) / uri).lexically_relative(sources_directory);
+        cache.add_source(sources_directory.string(), relative_path.string());
+    };
+
+    cache.add_source(sources_directory.string(), std::filesystem::path(resolved_path).filename().string());
+
+    for (const auto& buffer : mdl.get_buffers()) {
+        if (!buffer.get_uri().empty() && !is_data_uri(buffer.get_uri())) {
+            add_source(buffer.get_uri());
+        }
+    }
+
+    for (const auto& image : mdl.get_images()) {
+        if (image.get_buffer_view() < 0 && !image.get_uri().empty() && !is_data_uri(image.get_uri())) {
+            add_source(image.get_uri());
+        }
+    }
+
+    return cache;
+}
+
+
+vk_model vk_model_builder::create(
+    const model& mdl,
+    avk::buffer_pool& buffer_pool,
+    hal::render::avk::image_pool& image_pool)
+{
+    return instantiate(std::make_shared<const vk_model_cache>(bake(mdl)), buffer_pool, image_pool);
+}
+
+
+vk_model_cache vk_model_builder::bake(const gltf::model& mdl)
+{
+    CHECK_MSG(m_fixed_format || m_compact_vertices, "Fixed vertex format didn't specified.");
+
+    vk_model_cache result;
+    bake_geometry(mdl, result);
+
+    if (m_skinned && !mdl.get_skins().empty()) {
+        bake_skins(mdl, result);
+    }
+
+    if (/* TODO: m_animated && */ !mdl.get_animations().empty()) {
+        bake_animations(mdl, result);
+    }
+
+    bake_textures(mdl, result);
+
+    bake_materials(mdl, result);
+
+    return result;
+}
+
+
+vk_model vk_model_builder::instantiate(
+    std::shared_ptr<const vk_model_cache> cache,
+    hal::render::avk::buffer_pool& buffer_pool,
+    hal::render::avk::image_pool& image_pool)
+{
+    return instantiate(std::move(cache), buffer_pool, image_pool, {});
+}
+
+
+vk_model vk_model_builder::instantiate(
+    std::shared_ptr<const vk_model_cache> cache,
+    hal::render::avk::buffer_pool& buffer_pool,
+    hal::render::avk::image_pool& image_pool,
+    const std::vector<bool>& meshes)
+{
+    vk_model result;
+
+    const bool partial = !meshes.empty();
+
+    auto is_used_mesh = [&meshes, partial](size_t mesh) {
+        return !partial || (mesh < meshes.size() && meshes[mesh]);
+    };
+
+    // partial models create only resources which are reachable from their meshes.
+    std::vector<bool> used_skins(cache->m_skins.size(), !partial);
+    std::vector<bool> used_materials(cache->m_materials.size(), !partial);
+    std::vector<bool> used_images(cache->m_images.size(), !partial);
+
+    if (partial) {
+        for (size_t i = 0; i < cache->m_meshes.size(); ++i) {
+            if (!is_used_mesh(i)) {
+                continue;
+            }
+
+            const auto& mesh = cache->m_meshes[i];
+
+            if (mesh.skin >= 0) {
+                used_skins[mesh.skin] = true;
+            }
+
+            for (uint32_t j = mesh.first_primitive; j < mesh.first_primitive + mesh.primitives_count; ++j) {
+                used_materials[cache->m_primitives[j].material] = true;
+            }
+        }
+
+        for (size_t i = 0; i < cache->m_materials.size(); ++i) {
+            if (!used_materials[i]) {
+                continue;
+            }
+
+            const auto& material = cache->m_materials[i];
+
+            for (const auto texture : {material.base_color, material.normal, material.metallic_roughness, material.occlusion, material.emissive}) {
+                used_images[cache->m_textures[texture].image] = true;
+            }
+        }
+    }
+
+    uint32_t vertex_size = 0;
+    std::array<vk::Format, 8> vertex_format{};
+    std::transform(cache->m_vertex_format.begin(), cache->m_vertex_format.end(), vertex_format.begin(), [](uint32_t format) {
+        return static_cast<vk::Format>(format);
+    });
+
+    get_vertex_attributes_data(vertex_format, result.m_attributes, result.m_bindings, vertex_size);
+
+    result.m_cache = cache;
+
+    // blobs are copied straight from the cache to the staging memory.
+    auto create_buffer = [&cache, &buffer_pool](const vk_model_cache::blob& blob, vk::BufferUsageFlags usage, memory_footprint::usage& footprint) {
+        footprint.cpu += blob.size;
+        footprint.gpu += blob.size;
+
+        // clang-format off
+        return buffer_pool.get_builder()
+            .set_size(blob.size)
+            .set_usage(usage | vk::BufferUsageFlagBits::eTransferDst)
+            .create([cache, blob](uint8_t* dst) {
+                std::memcpy(dst, cache->get_blob_data(blob), blob.size);
+            });
+        // clang-format on
+    };
+
+    std::vector<vk_skin> skins{};
+    skins.reserve(cache->m_skins.size());
+
+    for (size_t i = 0; i < cache->m_skins.size(); ++i) {
+        const auto& skin = cache->m_skins[i];
+        auto& new_skin = skins.emplace_back();
+
+        if (!used_skins[i]) {
+            continue;
+        }
+
+        new_skin.m_joints_buffer = create_buffer(skin.joints, vk::BufferUsageFlagBits::eUniformBuffer, result.m_footprint.animations);
+        new_skin.m_joints_count = skin.joints_count;
+        new_skin.m_hierarchy_size = skin.hierarchy_size;
+    }
+
+    result.m_meshes.reserve(cache->m_meshes.size());
+
+    for (size_t mesh_index = 0; mesh_index < cache->m_meshes.size(); ++mesh_index) {
+        const auto& mesh = cache->m_meshes[mesh_index];
+        auto& new_mesh = result.m_meshes.emplace_back();
 
-    template<size_t ElementCount, typename ElementType, glm::qualifier ElementQualifier>
-    struct attribute_converter<glm::vec<ElementCount, ElementType, ElementQualifier>>
-    {
-        using VecT = glm::vec<ElementCount, ElementType, glm::qualifier::mediump>;
+        if (!is_used_mesh(mesh_index)) {
+            continue;
+        }
 
-        vk::Format desired_vk_format{};
+        new_mesh.m_primitives.reserve(mesh.primitives_count);
+        new_mesh.m_bounds = from_bounding_volume(mesh.bounds);
 
-        VecT operator()(
-            const uint8_t* data,
-            accessor_type actual_accessor_type,
-            component_type actual_component_type,
-            accessor_type /* ignored */,
-            component_type /* ignored */) const
-        {
-            VecT result{};
+        for (uint32_t i = mesh.first_primitive; i < mesh.first_primitive + mesh.primitives_count; ++i) {
+            const auto& primitive = cache->m_primitives[i];
+            auto& new_primitive = new_mesh.m_primitives.emplace_back();
+
+            new_primitive.m_material = primitive.material;
+            new_primitive.m_bounds = from_bounding_volume(primitive.bounds);
+            new_primitive.m_position_offset = to_vec3(primitive.position_offset);
+            new_primitive.m_position_scale = to_vec3(primitive.position_scale);
+            new_primitive.m_vertex_buffer = create_buffer(primitive.vertices, vk::BufferUsageFlagBits::eVertexBuffer, result.m_footprint.geometry);
+            new_primitive.m_vertices_count = primitive.vertices_count;
 
-            const auto actual_el_count = accessor_components_count(actual_accessor_type);
-            if (actual_el_count > ElementCount) {
-                throw std::runtime_error("Types are not convertible.");
+            if (primitive.clusters_count > 0) {
+                new_primitive.m_clusters_buffer = create_buffer(primitive.clusters, vk::BufferUsageFlagBits::eStorageBuffer, result.m_footprint.geometry);
+                new_primitive.m_clusters_count = primitive.clusters_count;
             }
 
-            for (size_t i = 0; i < ElementCount; ++i) {
-                if (i < actual_el_count) {
-                    result[i] = convert_element(actual_component_type, i, data);
-                } else {
-                    // just fill with zeros
-                    result[i] = ElementType{0};
-                }
+            // the culling shader reads indices of clustered primitives as a storage buffer.
+            if (primitive.indices_count > 0) {
+                const auto index_usage = primitive.clusters_count > 0
+                                             ? vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eStorageBuffer
+                                             : vk::BufferUsageFlags{vk::BufferUsageFlagBits::eIndexBuffer};
+                new_primitive.m_index_buffer = create_buffer(primitive.indices, index_usage, result.m_footprint.geometry);
+                new_primitive.m_indices_count = primitive.indices_count;
+                new_primitive.m_index_type = static_cast<vk::IndexType>(primitive.index_type);
+                new_primitive.m_lods = get_lods(primitive);
             }
-            return result;
         }
 
-        ElementType convert_element(component_type actual_component_type, size_t element_index, const uint8_t* data) const
-        {
-            // TODO: add pack/unpack elements data relative actual vk_format
-            if constexpr (std::is_same_v<ElementType, float>) {
-                switch (actual_component_type) {
-                    case component_type::float32:
-                        return reinterpret_cast<const float*>(data)[element_index];
-                    default:
-                        throw std::runtime_error("Elements converting temporary unsupported.");
-                }
-            } else if constexpr (std::is_same_v<ElementType, uint32_t>) {
-                switch (actual_component_type) {
-                    case component_type::unsigned_int:
-                        return reinterpret_cast<const uint32_t*>(data)[element_index];
-                    case component_type::unsigned_short:
-                        return uint32_t(reinterpret_cast<const uint16_t*>(data)[element_index]);
-                    case component_type::signed_short:
-                        return uint32_t(reinterpret_cast<const int16_t*>(data)[element_index]);
-                    case component_type::signed_byte:
-                        return uint32_t(reinterpret_cast<const int8_t*>(data)[element_index]);
-                    case component_type::unsigned_byte:
-                        return uint32_t(data[element_index]);
-                    default:
-                        throw std::runtime_error("Unsupported convert type.");
-                }
-            } else if constexpr (std::is_same_v<ElementType, int16_t>) {
-                switch (actual_component_type) {
-                    case component_type::signed_short:
-                        return reinterpret_cast<const int16_t*>(data)[element_index];
-                    default:
-                        throw std::runtime_error("Elements converting temporary unsupported.");
-                }
-            } else if constexpr (std::is_same_v<ElementType, uint16_t>) {
-                switch (actual_component_type) {
-                    case component_type::unsigned_short:
-                        return reinterpret_cast<const uint16_t*>(data)[element_index];
-                    default:
-                        throw std::runtime_error("Elements converting temporary unsupported.");
-                }
-            } else if constexpr (std::is_same_v<ElementType, int8_t>) {
-                switch (actual_component_type) {
-                    case component_type::signed_byte:
-                        return reinterpret_cast<const int8_t*>(data)[element_index];
-                    default:
-                        throw std::runtime_error("Elements converting temporary unsupported.");
-                }
-            } else if constexpr (std::is_same_v<ElementType, uint8_t>) {
-                switch (actual_component_type) {
-                    case component_type::unsigned_byte:
-                        return data[element_index];
-                    default:
-                        throw std::runtime_error("Elements converting temporary unsupported.");
-                }
+        if (mesh.skin >= 0) {
+            new_mesh.m_skin = skins[mesh.skin];
+            new_mesh.m_skinned = true;
+        }
+    }
+
+    // animations move nodes of the whole model, so partial models don't have them.
+    if (!partial && !cache->m_animations.empty()) {
+        const auto nodes_buffer = create_buffer(cache->m_anim_nodes, vk::BufferUsageFlagBits::eStorageBuffer, result.m_footprint.animations);
+        const auto exec_order_buffer = create_buffer(cache->m_anim_exec_order, vk::BufferUsageFlagBits::eStorageBuffer, result.m_footprint.animations);
+
+        result.m_animations.reserve(cache->m_animations.size());
+
+        for (const auto& anim : cache->m_animations) {
+            auto& new_anim = result.m_animations.emplace_back();
+            new_anim.m_time_stamps_buffer = create_buffer(anim.time_stamps, vk::BufferUsageFlagBits::eStorageBuffer, result.m_footprint.animations);
+            new_anim.m_keys_buffer = create_buffer(anim.keys, vk::BufferUsageFlagBits::eStorageBuffer, result.m_footprint.animations);
+            new_anim.m_meta_buffer = create_buffer(anim.meta, vk::BufferUsageFlagBits::eStorageBuffer, result.m_footprint.animations);
+            new_anim.m_nodes_buffer = nodes_buffer;
+            new_anim.m_exec_order_buffer = exec_order_buffer;
+        }
+    }
+
+    std::vector<std::shared_ptr<const avk::image_instance>> images{};
+    images.reserve(cache->m_images.size());
+
+    if (m_assets == nullptr) {
+        result.m_own_images.resize(cache->m_images.size());
+    }
+
+    for (size_t i = 0; i < cache->m_images.size(); ++i) {
+        const auto& image = cache->m_images[i];
+
+        if (!used_images[i]) {
+            images.emplace_back();
+            continue;
+        }
+
+        result.m_footprint.textures.cpu += image.pixels.size;
+        result.m_footprint.textures.gpu += get_image_size(image);
+
+        auto create_image = [&cache, &image, &image_pool]() {
+            return image_pool.get_builder()
+                .set_width(image.width)
+                .set_height(image.height)
+                .set_format(static_cast<vk::Format>(image.format))
+                .set_mips_levels(image.mips_levels)
+                .gen_mips(image.gen_mips != 0)
+                .create([cache, pixels = image.pixels](uint8_t* dst) {
+                    std::memcpy(dst, cache->get_blob_data(pixels), pixels.size);
+                });
+        };
+
+        if (m_assets == nullptr) {
+            result.m_own_images[i] = std::make_shared<avk::image_instance>(create_image());
+            images.emplace_back(result.m_own_images[i]);
+            continue;
+        }
+
+        // images live in the pool, so the same pixels are shared only between models of one pool.
+        const std::array<uint64_t, 6> image_desc{
+            reinterpret_cast<uintptr_t>(&image_pool), image.hash, image.width, image.height, image.format, image.mips_levels | (uint64_t(image.gen_mips) << 32)};
+        const auto image_key = asset_registry::make_key("vk image", {}, utils::hash64(image_desc.data(), sizeof(image_desc)));
+
+        images.emplace_back(m_assets->acquire<avk::image_instance>(image_key, [&create_image, &image]() {
+            return std::pair{create_image(), image.pixels.size};
+        }));
+    }
+
+    result.m_textures.reserve(cache->m_textures.size());
+
+    for (const auto& texture : cache->m_textures) {
+        auto& new_texture = result.m_textures.emplace_back();
+
+        new_texture.m_image = images[texture.image];
+
+        if (new_texture.m_image != nullptr) {
+            new_texture.m_sampler = create_sampler(texture, *new_texture.m_image);
+        }
+    }
+
+    result.m_materials.reserve(cache->m_materials.size());
+
+    for (size_t i = 0; i < cache->m_materials.size(); ++i) {
+        const auto& material = cache->m_materials[i];
+        auto& new_material = result.m_materials.emplace_back();
+
+        if (used_materials[i]) {
+            new_material.m_material_info_buffer = create_buffer(material.info, vk::BufferUsageFlagBits::eUniformBuffer, result.m_footprint.other);
+        }
+
+        new_material.m_base_color = material.base_color;
+        new_material.m_normal = material.normal;
+        new_material.m_metallic_roughness = material.metallic_roughness;
+        new_material.m_occlusion = material.occlusion;
+        new_material.m_emissive = material.emissive;
+    }
+
+    return result;
+}
+
+
+vk_model_changes vk_model_builder::reload(vk_model& model, const vk_model_cache& old_cache, std::shared_ptr<const vk_model_cache> cache)
+{
+    vk_model_changes result{};
+
+    // nothing is changed until it is known that the model can be updated in place.
+    if (!is_reloadable(model, old_cache, *cache)) {
+        result.requires_rebuild = true;
+        return result;
+    }
+
+    auto is_same_blob = [&old_cache, &cache](const vk_model_cache::blob& old_blob, const vk_model_cache::blob& new_blob) {
+        return old_blob.size == new_blob.size && std::memcmp(old_cache.get_blob_data(old_blob), cache->get_blob_data(new_blob), new_blob.size) == 0;
+    };
+
+    // buffers keep their place in the pool, so only the staging memory is rewritten.
+    auto upload = [&cache, &result, &is_same_blob](avk::buffer_instance& buffer, const vk_model_cache::blob& old_blob, const vk_model_cache::blob& new_blob) {
+        if (buffer.get_size() == 0 || is_same_blob(old_blob, new_blob)) {
+            return;
+        }
+
+        buffer.upload([cache, new_blob](uint8_t* dst) {
+            std::memcpy(dst, cache->get_blob_data(new_blob), new_blob.size);
+        });
+
+        result.buffers_uploaded = true;
+    };
+
+    std::vector<bool> uploaded_skins(cache->m_skins.size(), false);
+
+    for (size_t mesh_index = 0; mesh_index < cache->m_meshes.size(); ++mesh_index) {
+        const auto& mesh = cache->m_meshes[mesh_index];
+        auto& curr_mesh = model.m_meshes[mesh_index];
+
+        // meshes which are not created by partial models have no primitives.
+        if (curr_mesh.m_primitives.empty()) {
+            continue;
+        }
+
+        bool rebound = false;
+        curr_mesh.m_bounds = from_bounding_volume(mesh.bounds);
+
+        for (uint32_t i = 0; i < mesh.primitives_count; ++i) {
+            const auto& old_primitive = old_cache.m_primitives[mesh.first_primitive + i];
+            const auto& primitive = cache->m_primitives[mesh.first_primitive + i];
+            auto& curr_primitive = curr_mesh.m_primitives[i];
+
+            curr_primitive.m_bounds = from_bounding_volume(primitive.bounds);
+            curr_primitive.m_position_offset = to_vec3(primitive.position_offset);
+            curr_primitive.m_position_scale = to_vec3(primitive.position_scale);
+
+            if (primitive.indices_count > 0) {
+                curr_primitive.m_lods = get_lods(primitive);
+            }
+
+            upload(curr_primitive.m_vertex_buffer, old_primitive.vertices, primitive.vertices);
+            upload(curr_primitive.m_index_buffer, old_primitive.indices, primitive.indices);
+            upload(curr_primitive.m_clusters_buffer, old_primitive.clusters, primitive.clusters);
+
+            if (curr_primitive.m_material != primitive.material) {
+                curr_primitive.m_material = primitive.material;
+                rebound = true;
+            }
+        }
+
+        if (rebound) {
+            result.rebound_meshes.emplace_back(mesh_index);
+        }
+
+        // meshes share the buffer of their skin, so it is uploaded once.
+        if (mesh.skin >= 0 && !uploaded_skins[mesh.skin]) {
+            upload(curr_mesh.m_skin.m_joints_buffer, old_cache.m_skins[mesh.skin].joints, cache->m_skins[mesh.skin].joints);
+            uploaded_skins[mesh.skin] = true;
+        }
+    }
+
+    if (!model.m_animations.empty()) {
+        upload(model.m_animations.front().m_nodes_buffer, old_cache.m_anim_nodes, cache->m_anim_nodes);
+        upload(model.m_animations.front().m_exec_order_buffer, old_cache.m_anim_exec_order, cache->m_anim_exec_order);
+
+        for (size_t i = 0; i < cache->m_animations.size(); ++i) {
+            const auto& old_anim = old_cache.m_animations[i];
+            const auto& anim = cache->m_animations[i];
+            auto& curr_anim = model.m_animations[i];
+
+            upload(curr_anim.m_meta_buffer, old_anim.meta, anim.meta);
+            upload(curr_anim.m_time_stamps_buffer, old_anim.time_stamps, anim.time_stamps);
+            upload(curr_anim.m_keys_buffer, old_anim.keys, anim.keys);
+        }
+    }
+
+    for (size_t i = 0; i < model.m_own_images.size(); ++i) {
+        if (model.m_own_images[i] == nullptr || is_same_blob(old_cache.m_images[i].pixels, cache->m_images[i].pixels)) {
+            continue;
+        }
+
+        // images of models with the asset registry are shared, so is_reloadable doesn't let them change.
+        model.m_own_images[i]->upload([cache, pixels = cache->m_images[i].pixels](uint8_t* dst) {
+            std::memcpy(dst, cache->get_blob_data(pixels), pixels.size);
+        });
+
+        result.images_uploaded = true;
+    }
+
+    // is_reloadable checked that every image which textures refer to now is created by the model.
+    auto find_image = [&model, &old_cache](uint32_t image) {
+        for (size_t i = 0; i < old_cache.m_textures.size(); ++i) {
+            if (old_cache.m_textures[i].image == image && model.m_textures[i].m_image != nullptr) {
+                return model.m_textures[i].m_image;
             }
         }
+
+        return std::shared_ptr<const avk::image_instance>{};
     };
 
+    std::vector<bool> rebound_textures(cache->m_textures.size(), false);
+    std::vector<std::shared_ptr<const avk::image_instance>> texture_images(cache->m_textures.size());
 
-    template<size_t ElementCount, typename ElementT>
-    void copy_attribute_data(
-        const primitive::vertex_attribute& attribute,
-        vk::Format desired_vk_format,
-        accessor_type desired_type,
-        component_type desired_component_type,
-        uint64_t vtx_size,
-        uint64_t offset,
-        uint8_t* dst)
-    {
-        using T = glm::vec<ElementCount, ElementT>;
-        attribute.for_each_element<T>(
-            [dst, vtx_size, offset](T v, uint32_t index) {
-                if constexpr (ElementCount == 1) {
-                    std::memcpy((void*) (dst + vtx_size * index + offset), &v.x, sizeof(v));
-                } else {
-                    auto ptr = dst + vtx_size * index + offset;
-                    auto last = ptr + sizeof(v);
-                    auto vptr = reinterpret_cast<const uint8_t*>(glm::value_ptr(v));
-                    std::memcpy((void*) (dst + vtx_size * index + offset), glm::value_ptr(v), sizeof(v));
-                }
-            },
-            desired_type,
-            desired_component_type,
-            attribute_converter<T>{desired_vk_format});
+    for (size_t i = 0; i < cache->m_textures.size(); ++i) {
+        const auto& old_texture = old_cache.m_textures[i];
+        const auto& texture = cache->m_textures[i];
+
+        if (model.m_textures[i].m_image == nullptr) {
+            continue;
+        }
+
+        if (std::memcmp(&old_texture, &texture, sizeof(texture)) != 0) {
+            texture_images[i] = old_texture.image == texture.image ? model.m_textures[i].m_image : find_image(texture.image);
+            rebound_textures[i] = true;
+        }
     }
-} // namespace
 
+    // images are looked up by textures of the old cache, so textures are changed after all of them are found.
+    for (size_t i = 0; i < cache->m_textures.size(); ++i) {
+        if (rebound_textures[i]) {
+            model.m_textures[i].m_image = std::move(texture_images[i]);
+            model.m_textures[i].m_sampler = create_sampler(cache->m_textures[i], *model.m_textures[i].m_image);
+        }
+    }
 
-vk_model sandbox::gltf::vk_model_builder::load_from_file(
-    const std::string& path,
-    hal::render::avk::buffer_pool& buffer_pool,
-    hal::render::avk::image_pool& image_pool)
+    for (size_t i = 0; i < cache->m_materials.size(); ++i) {
+        const auto& material = cache->m_materials[i];
+        auto& curr_material = model.m_materials[i];
+
+        if (curr_material.m_material_info_buffer.get_size() == 0) {
+            continue;
+        }
+
+        upload(curr_material.m_material_info_buffer, old_cache.m_materials[i].info, material.info);
+
+        const std::array textures{material.base_color, material.normal, material.metallic_roughness, material.occlusion, material.emissive};
+        const std::array curr_textures{curr_material.m_base_color, curr_material.m_normal, curr_material.m_metallic_roughness, curr_material.m_occlusion, curr_material.m_emissive};
+
+        const bool rebound = textures != curr_textures || std::any_of(textures.begin(), textures.end(), [&rebound_textures](uint32_t texture) {
+            return rebound_textures[texture];
+        });
+
+        if (!rebound) {
+            continue;
+        }
+
+        curr_material.m_base_color = material.base_color;
+        curr_material.m_normal = material.normal;
+        curr_material.m_metallic_roughness = material.metallic_roughness;
+        curr_material.m_occlusion = material.occlusion;
+        curr_material.m_emissive = material.emissive;
+
+        result.rebound_materials.emplace_back(i);
+    }
+
+    model.m_cache = cache;
+
+    return result;
+}
+
+
+uint64_t vk_model_builder::get_cache_key(const std::string& path) const
 {
-    return vk_model();
+    CHECK_MSG(m_fixed_format || m_compact_vertices, "Fixed vertex format didn't specified.");
+
+    uint64_t content_hash = 0;
+
+    // the registry hashes the file again only if it was changed since the last call.
+    if (m_assets != nullptr) {
+        content_hash = m_assets->get_content_hash(asset_registry::get_canonical_path(path));
+    } else {
+        hal::filesystem::mapped_file file{};
+        file.open(path);
+        const auto file_data = file.read_all();
+        content_hash = utils::hash64(file_data.get_data(), file_data.get_size());
+    }
+
+    uint64_t result = utils::hash64_value(vk_model_cache::version);
+    result = utils::hash64_value(content_hash, result);
+    // the compact format depends only on the model, so the fixed one doesn't change its caches.
+    if (!m_compact_vertices) {
+        result = utils::hash64(m_fixed_format->data(), m_fixed_format->size() * sizeof(vk::Format), result);
+    }
+
+    result = utils::hash64_value(m_compact_vertices, result);
+    result = utils::hash64_value(m_quantize_positions, result);
+    result = utils::hash64_value(m_skinned, result);
+    result = utils::hash64_value(m_bake_mips, result);
+    result = utils::hash64_value(m_keep_quantized, result);
+    result = utils::hash64_value(m_optimize_meshes, result);
+    result = utils::hash64_value(m_build_clusters, result);
+    result = utils::hash64_value(m_lods_count, result);
+
+    return result;
 }
 
-vk_model_builder& vk_model_builder::set_vertex_format(
-    const std::array<vk::Format, 8>& fmt)
+
+std::string vk_model_builder::get_cache_path(const std::string& url) const
 {
-    m_fixed_format = fmt;
-    return *this;
+    if (m_cache_directory.empty()) {
+        return get_file_system().resolve(url) + ".vkcache";
+    }
+
+    if (std::filesystem::path(url).is_relative()) {
+        return (std::filesystem::path(m_cache_directory) / (url + ".vkcache")).lexically_normal().string();
+    }
+
+    // files with the same name from different directories must not share the cache.
+    const auto path_hash = utils::hash64(url.data(), url.size());
+    char path_hash_str[17]{};
+    std::snprintf(path_hash_str, sizeof(path_hash_str), "%016llx", static_cast<unsigned long long>(path_hash));
+
+    const auto file_name = std::filesystem::path(url).filename().string() + "." + path_hash_str + ".vkcache";
+    return (std::filesystem::path(m_cache_directory) / file_name).string();
 }
 
 
-vk_model_builder& vk_model_builder::use_skin(bool use_skin)
+std::shared_ptr<const avk::sampler_instance> vk_model_builder::create_sampler(
+    const vk_model_cache::texture& texture, const avk::image_instance& image)
 {
-    m_skinned = use_skin;
-    return *this;
+    auto create = [&texture, &image]() {
+        return avk::sampler_builder()
+            .set_filtering(
+                static_cast<vk::Filter>(texture.filter),
+                static_cast<vk::Filter>(texture.filter),
+                static_cast<vk::SamplerMipmapMode>(texture.mip_filter))
+            .set_wrap(
+                static_cast<vk::SamplerAddressMode>(texture.wrap_u),
+                static_cast<vk::SamplerAddressMode>(texture.wrap_v),
+                static_cast<vk::SamplerAddressMode>(texture.wrap_w))
+            .create(image);
+    };
+
+    if (m_assets == nullptr) {
+        return std::make_shared<const avk::sampler_instance>(create());
+    }
+
+    // samplers depend only on their state and the count of image levels.
+    const std::array<uint32_t, 6> sampler_desc{
+        texture.filter, texture.mip_filter, texture.wrap_u, texture.wrap_v, texture.wrap_w, image.get_mips_levels()};
+    const auto sampler_key = asset_registry::make_key("vk sampler", {}, utils::hash64(sampler_desc.data(), sizeof(sampler_desc)));
+
+    return m_assets->acquire<avk::sampler_instance>(sampler_key, [&create]() {
+        return std::pair{create(), uint64_t{0}};
+    });
 }
 
 
-vk_model vk_model_builder::create(
-    const model& mdl,
-    avk::buffer_pool& buffer_pool,
-    hal::render::avk::image_pool& image_pool)
+bool vk_model_builder::is_reloadable(const vk_model& model, const vk_model_cache& old_cache, const vk_model_cache& cache) const
 {
-    vk_model result;
-    create_geometry(mdl, result, buffer_pool);
+    auto same_size = [](const vk_model_cache::blob& lhs, const vk_model_cache::blob& rhs) {
+        return lhs.size == rhs.size;
+    };
 
-    if (m_skinned && !mdl.get_skins().empty()) {
-        create_skins(mdl, result, buffer_pool);
+    if (old_cache.m_vertex_format != cache.m_vertex_format
+        || old_cache.m_primitives.size() != cache.m_primitives.size()
+        || old_cache.m_meshes.size() != cache.m_meshes.size()
+        || old_cache.m_skins.size() != cache.m_skins.size()
+        || old_cache.m_animations.size() != cache.m_animations.size()
+        || old_cache.m_images.size() != cache.m_images.size()
+        || old_cache.m_textures.size() != cache.m_textures.size()
+        || old_cache.m_materials.size() != cache.m_materials.size()
+        || model.m_meshes.size() != cache.m_meshes.size()
+        || !same_size(old_cache.m_anim_nodes, cache.m_anim_nodes)
+        || !same_size(old_cache.m_anim_exec_order, cache.m_anim_exec_order)) {
+        return false;
     }
 
-    if (/* TODO: m_animated && */ !mdl.get_animations().empty()) {
-        create_animations(mdl, result, buffer_pool);
+    for (size_t i = 0; i < cache.m_meshes.size(); ++i) {
+        const auto& old_mesh = old_cache.m_meshes[i];
+        const auto& mesh = cache.m_meshes[i];
+
+        if (old_mesh.first_primitive != mesh.first_primitive || old_mesh.primitives_count != mesh.primitives_count || old_mesh.skin != mesh.skin) {
+            return false;
+        }
+
+        // primitives of a partial model may switch only to materials which the model created.
+        if (model.m_meshes[i].m_primitives.empty()) {
+            continue;
+        }
+
+        for (uint32_t j = mesh.first_primitive; j < mesh.first_primitive + mesh.primitives_count; ++j) {
+            const auto& old_primitive = old_cache.m_primitives[j];
+            const auto& primitive = cache.m_primitives[j];
+
+            if (!same_size(old_primitive.vertices, primitive.vertices)
+                || !same_size(old_primitive.indices, primitive.indices)
+                || old_primitive.vertices_count != primitive.vertices_count
+                || old_primitive.indices_count != primitive.indices_count
+                || old_primitive.index_type != primitive.index_type
+                || !same_size(old_primitive.clusters, primitive.clusters)
+                || old_primitive.clusters_count != primitive.clusters_count
+                || old_primitive.lods_count != primitive.lods_count
+                || to_vec3(old_primitive.position_offset) != to_vec3(primitive.position_offset)
+                || to_vec3(old_primitive.position_scale) != to_vec3(primitive.position_scale)
+                || model.m_materials[primitive.material].m_material_info_buffer.get_size() == 0) {
+                return false;
+            }
+        }
     }
 
-    create_textures(mdl, image_pool, result);
+    // counts of joints are specialization constants of pipelines.
+    for (size_t i = 0; i < cache.m_skins.size(); ++i) {
+        const auto& old_skin = old_cache.m_skins[i];
+        const auto& skin = cache.m_skins[i];
 
-    create_materials(mdl, buffer_pool, image_pool, result);
+        if (!same_size(old_skin.joints, skin.joints) || old_skin.joints_count != skin.joints_count || old_skin.hierarchy_size != skin.hierarchy_size) {
+            return false;
+        }
+    }
 
-    return result;
+    for (size_t i = 0; i < cache.m_animations.size(); ++i) {
+        const auto& old_anim = old_cache.m_animations[i];
+        const auto& anim = cache.m_animations[i];
+
+        if (!same_size(old_anim.meta, anim.meta) || !same_size(old_anim.time_stamps, anim.time_stamps) || !same_size(old_anim.keys, anim.keys)) {
+            return false;
+        }
+    }
+
+    std::vector<bool> created_images(cache.m_images.size(), false);
+
+    for (size_t i = 0; i < old_cache.m_textures.size(); ++i) {
+        if (model.m_textures[i].m_image != nullptr) {
+            created_images[old_cache.m_textures[i].image] = true;
+        }
+    }
+
+    for (size_t i = 0; i < cache.m_images.size(); ++i) {
+        const auto& old_image = old_cache.m_images[i];
+        const auto& image = cache.m_images[i];
+
+        if (old_image.width != image.width
+            || old_image.height != image.height
+            || old_image.format != image.format
+            || old_image.gen_mips != image.gen_mips
+            || old_image.mips_levels != image.mips_levels
+            || !same_size(old_image.pixels, image.pixels)) {
+            return false;
+        }
+
+        // images shared through the asset registry may be used by other models.
+        const bool is_own_image = i < model.m_own_images.size() && model.m_own_images[i] != nullptr;
+
+        if (created_images[i] && !is_own_image && old_image.hash != image.hash) {
+            return false;
+        }
+    }
+
+    // textures of the model may switch only to images which the model created.
+    for (size_t i = 0; i < cache.m_textures.size(); ++i) {
+        if (model.m_textures[i].m_image != nullptr && !created_images[cache.m_textures[i].image]) {
+            return false;
+        }
+    }
+
+    // materials of the model may switch only to textures which the model created.
+    for (size_t i = 0; i < cache.m_materials.size(); ++i) {
+        const auto& material = cache.m_materials[i];
+
+        if (model.m_materials[i].m_material_info_buffer.get_size() == 0) {
+            continue;
+        }
+
+        for (const auto texture : {material.base_color, material.normal, material.metallic_roughness, material.occlusion, material.emissive}) {
+            if (model.m_textures[texture].m_image == nullptr) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+hal::filesystem::vfs& vk_model_builder::get_file_system() const
+{
+    return m_file_system != nullptr ? *m_file_system : hal::filesystem::vfs::global();
 }
 
 
-void vk_model_builder::create_geometry(const model& mdl, vk_model& result, hal::render::avk::buffer_pool& pool)
+void vk_model_builder::bake_geometry(const model& mdl, vk_model_cache& cache)
 {
     uint32_t vertex_size = 0;
 
-    get_vertex_attributes_data_from_fixed_format(result.m_attributes, result.m_bindings, vertex_size);
+    const auto vertex_format = get_model_vertex_format(mdl);
+    cache.m_vertex_format.assign(vertex_format.begin(), vertex_format.end());
 
-    result.m_meshes.reserve(mdl.get_meshes().size());
+    std::vector<vk::VertexInputAttributeDescription> attributes{};
+    std::vector<vk::VertexInputBindingDescription> bindings{};
+    get_vertex_attributes_data(vertex_format, attributes, bindings, vertex_size);
+
+    cache.m_meshes.reserve(mdl.get_meshes().size());
+
+    mesh_optimization_statistics statistics{};
 
     for (const auto& mesh : mdl.get_meshes()) {
-        auto& new_mesh = result.m_meshes.emplace_back();
-        new_mesh.m_primitives.reserve(mesh.get_primitives().size());
+        auto& new_mesh = cache.m_meshes.emplace_back();
+        new_mesh.first_primitive = cache.m_primitives.size();
+        new_mesh.primitives_count = mesh.get_primitives().size();
+
+        bounds mesh_bounds{};
 
         for (const auto& primitive : mesh.get_primitives()) {
-            auto& new_primitive = new_mesh.m_primitives.emplace_back();
-            new_primitive.m_material = std::min(size_t(primitive.get_material()), mdl.get_materials().size() - 1);
-            auto vertex_buffer_bulder = pool.get_builder();
-            vertex_buffer_bulder.set_size(primitive.get_vertices_count(mdl) * vertex_size);
-            vertex_buffer_bulder.set_usage(vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst);
-
-            new_primitive.m_vertex_buffer = vertex_buffer_bulder.create([this, &mdl, &primitive, vertex_size](uint8_t* dst) {
-                uint32_t attr_offset = 0;
-
-                for (uint32_t i = 0; i < m_fixed_format->size(); ++i) {
-                    auto curr_path = static_cast<attribute_path>(i);
-                    const auto attribute = primitive.attribute_at_path(mdl, static_cast<attribute_path>(i));
-                    copy_attribute_data(attribute, m_fixed_format->at(i), vertex_size, attr_offset, dst);
-                    attr_offset += avk::get_format_info(m_fixed_format->at(i)).size;
+            auto& new_primitive = cache.m_primitives.emplace_back();
+            new_primitive.material = std::min(size_t(primitive.get_material()), mdl.get_materials().size() - 1);
+
+            const auto primitive_bounds = get_primitive_bounds(mdl, primitive);
+            new_primitive.bounds = to_bounding_volume(primitive_bounds);
+            mesh_bounds.extend(primitive_bounds);
+
+            if (m_quantize_positions && !primitive_bounds.is_empty()) {
+                const auto scale = primitive_bounds.max - primitive_bounds.min;
+                std::copy_n(&primitive_bounds.min.x, 3, new_primitive.position_offset);
+                std::copy_n(&scale.x, 3, new_primitive.position_scale);
+            }
+
+            // reordered primitives get new indices and vertices are moved to the places which the remap gives them.
+            std::vector<uint32_t> indices{};
+            std::vector<uint32_t> remap{};
+            std::vector<glm::vec3> positions{};
+            const bool reordered = (m_optimize_meshes || m_build_clusters || m_lods_count > 0) && read_triangles(mdl, primitive, indices, positions);
+
+            if (reordered && m_optimize_meshes) {
+                statistics.before += analyze_vertex_cache(indices, positions.size());
+
+                optimize_vertex_cache(indices, positions.size());
+                optimize_overdraw(indices, reinterpret_cast<const uint8_t*>(positions.data()), sizeof(glm::vec3), positions.size());
+            }
+
+            // clusters take triangles in the cache optimized order, so they keep most of its locality.
+            if (reordered && m_build_clusters) {
+                const auto material = primitive.get_material();
+                const bool double_sided = material >= 0 && size_t(material) < mdl.get_materials().size() && mdl.get_materials()[material].is_double_sided();
+                const auto clusters = get_clusters(gltf::build_clusters(indices, positions.size()), indices, positions, double_sided);
+
+                new_primitive.clusters = cache.add_blob(clusters.size() * sizeof(vk_model_cache::cluster), [&clusters](uint8_t* dst) {
+                    std::memcpy(dst, clusters.data(), clusters.size() * sizeof(vk_model_cache::cluster));
+                });
+                new_primitive.clusters_count = clusters.size();
+            }
+
+            if (reordered && m_optimize_meshes) {
+                remap = optimize_vertex_fetch(indices, positions.size());
+                statistics.after += analyze_vertex_cache(indices, positions.size());
+            }
+
+            std::vector<simplification_result> lods{};
+
+            if (reordered && m_lods_count > 0) {
+                const float max_error = std::max(primitive_bounds.radius, 0.0f) * max_lod_error;
+                lods = generate_primitive_lods(mdl, primitive, indices, std::move(positions), remap, m_lods_count, max_error, m_optimize_meshes);
+            }
+
+            new_primitive.vertices = cache.add_blob(primitive.get_vertices_count(mdl) * vertex_size, [this, &mdl, &primitive, &new_primitive, &attributes, &vertex_format, &remap, vertex_size](uint8_t* dst) {
+                for (uint32_t i = 0; i < vertex_format.size(); ++i) {
+                    const auto path = static_cast<attribute_path>(i);
+                    const auto attribute = primitive.attribute_at_path(mdl, path);
+                    copy_attribute_data(attribute, path, vertex_format[i], new_primitive, vertex_size, attributes[i].offset, dst);
+                }
+
+                if (!remap.empty()) {
+                    const std::vector<uint8_t> source_vertices(dst, dst + remap.size() * vertex_size);
+
+                    for (size_t i = 0; i < remap.size(); ++i) {
+                        std::memcpy(dst + size_t(remap[i]) * vertex_size, source_vertices.data() + i * vertex_size, vertex_size);
+                    }
                 }
             });
 
-            new_primitive.m_vertices_count = primitive.get_vertices_count(mdl);
+            new_primitive.vertices_count = primitive.get_vertices_count(mdl);
 
             if (primitive.get_indices_count(mdl) > 0) {
-                auto index_buffer_bulder = pool.get_builder();
-                primitive.get_indices_data(mdl);
-
-                auto [index_data, indices_type] = primitive.get_indices_data(mdl);
+                const auto& indices_accessor = mdl.get_accessors()[primitive.get_indices()];
+                auto indices_type = indices_accessor.get_component_type();
                 auto elements_count = primitive.get_indices_count(mdl);
 
+                // the culling shader reads indices of clustered primitives as 32-bit words.
+                if (new_primitive.clusters_count > 0) {
+                    indices_type = component_type::unsigned_int;
+                }
+
                 auto element_size = avk::get_format_info(to_vk_format(accessor_type::scalar, indices_type)).size;
 
-                index_buffer_bulder.set_size(elements_count * element_size);
-                index_buffer_bulder.set_usage(vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+                new_primitive.lods_count = 1;
+                new_primitive.lods[0] = vk_model_cache::lod{.first_index = 0, .indices_count = elements_count};
+
+                uint64_t lods_indices_count = elements_count;
+
+                for (const auto& lod : lods) {
+                    new_primitive.lods[new_primitive.lods_count++] = vk_model_cache::lod{
+                        .first_index = lods_indices_count,
+                        .indices_count = lod.indices.size(),
+                        .error = lod.error};
+
+                    lods_indices_count += lod.indices.size();
+                }
+
+                // sparse indices are patched right in the baked memory. reordered indices keep their source type, lods
+                // follow the primitive indices.
+                new_primitive.indices = cache.add_blob(lods_indices_count * element_size, [&mdl, &indices_accessor, &indices, &lods, reordered, element_size](uint8_t* dst) {
+                    if (!reordered) {
+                        indices_accessor.copy_data(mdl, dst);
+                        return;
+                    }
+
+                    for (size_t i = 0; i < indices.size(); ++i) {
+                        std::memcpy(dst + i * element_size, &indices[i], element_size);
+                    }
+
+                    dst += indices.size() * element_size;
 
-                new_primitive.m_index_buffer = index_buffer_bulder.create([index_data, elements_count, element_size](uint8_t* dst) {
-                    std::memcpy(dst, index_data, elements_count * element_size);
+                    for (const auto& lod : lods) {
+                        for (size_t i = 0; i < lod.indices.size(); ++i) {
+                            std::memcpy(dst + i * element_size, &lod.indices[i], element_size);
+                        }
+
+                        dst += lod.indices.size() * element_size;
+                    }
                 });
 
-                new_primitive.m_indices_count = elements_count;
-                new_primitive.m_index_type = to_vk_index_type(accessor_type::scalar, indices_type);
+                new_primitive.indices_count = elements_count;
+                new_primitive.index_type = static_cast<uint32_t>(to_vk_index_type(accessor_type::scalar, indices_type));
             }
         }
-    }
-}
 
+        new_mesh.bounds = to_bounding_volume(mesh_bounds);
+    }
 
-void vk_model_builder::create_skins(const model& mdl, vk_model& model, hal::render::avk::buffer_pool& pool)
-{
-    std::vector<vk_skin> skins;
-    create_skins_resources(mdl, skins, model, pool);
-    assing_skins_to_meshes(skins, mdl, model);
+    if (m_optimize_meshes) {
+        cache.m_optimization_statistics = statistics;
+    }
 }
 
 
-void vk_model_builder::create_skins_resources(const model& mdl, std::vector<vk_skin>& result, vk_model& model, hal::render::avk::buffer_pool& pool)
+void vk_model_builder::bake_skins(const model& mdl, vk_model_cache& cache)
 {
     struct joint_data
     {
@@ -258,62 +1493,51 @@ void vk_model_builder::create_skins_resources(const model& mdl, std::vector<vk_s
 
     const auto& accessors = mdl.get_accessors();
 
-    std::vector<std::vector<joint_data>> joints_data{};
-    joints_data.reserve(mdl.get_skins().size() + 1);
-
-    result.clear();
-    result.reserve(mdl.get_skins().size());
+    cache.m_skins.reserve(mdl.get_skins().size());
 
     for (const auto& skin : mdl.get_skins()) {
-        auto& new_skin = result.emplace_back();
-        const auto& joints = skin.get_joints();
-
-        std::vector<joint_data> vk_joints{};
-        const auto ibp = accessors[skin.get_inv_bind_matrices()];
-        const glm::mat4* ibp_data = reinterpret_cast<const glm::mat4*>(ibp.get_data(mdl));
-
-        ASSERT(joints.size() == ibp.get_count());
+        auto& new_skin = cache.m_skins.emplace_back();
+        const auto joints = skin.get_joints();
 
-        vk_joints.reserve(joints.size());
+        const accessor_view<glm::mat4> inv_bind_poses{mdl, accessors[skin.get_inv_bind_matrices()]};
 
-        for (const auto joint : joints) {
-            vk_joints.emplace_back(joint_data{
-                .inv_bind_pose = *ibp_data++,
-                .joint = static_cast<uint32_t>(joint)});
-        }
+        ASSERT(joints.size() == inv_bind_poses.size());
 
-        auto joints_buffer_builder = pool.get_builder();
-        joints_buffer_builder.set_size(vk_joints.size() * sizeof(joint_data));
-        joints_buffer_builder.set_usage(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst);
+        new_skin.joints_count = joints.size();
+        new_skin.hierarchy_size = mdl.get_nodes().size();
 
-        new_skin.m_joints_count = vk_joints.size();
-        new_skin.m_hierarchy_size = mdl.get_nodes().size();
+        new_skin.joints = cache.add_blob(joints.size() * sizeof(joint_data), [&joints, &inv_bind_poses](uint8_t* dst) {
+            for (size_t i = 0; i < joints.size(); ++i) {
+                const joint_data data{
+                    .inv_bind_pose = inv_bind_poses[i],
+                    .joint = static_cast<uint32_t>(joints[i])};
 
-        new_skin.m_joints_buffer = joints_buffer_builder.create([joints = std::move(vk_joints)](uint8_t* dst) {
-            std::memcpy(dst, joints.data(), joints.size() * sizeof(joint_data));
+                std::memcpy(dst + i * sizeof(joint_data), &data, sizeof(joint_data));
+            }
         });
     }
+
+    assing_skins_to_meshes(mdl, cache);
 }
 
 
-void vk_model_builder::assing_skins_to_meshes(const std::vector<vk_skin>& skins, const model& mdl, vk_model& model)
+void vk_model_builder::assing_skins_to_meshes(const model& mdl, vk_model_cache& cache)
 {
-    auto& meshes = model.m_meshes;
+    auto& meshes = cache.m_meshes;
 
-    for_each_scene_node(mdl, [this, &meshes, &skins](const node& node, uint32_t node_index) {
+    for_each_scene_node(mdl, [&meshes](const node& node, uint32_t node_index) {
         if (node.get_skin() >= 0) {
-            meshes[node.get_mesh()].m_skin = skins[node.get_skin()];
-            meshes[node.get_mesh()].m_skinned = true;
+            meshes[node.get_mesh()].skin = node.get_skin();
         }
     });
 }
 
 
-void sandbox::gltf::vk_model_builder::create_animations(const gltf::model& mdl, vk_model& result, hal::render::avk::buffer_pool& pool)
+void sandbox::gltf::vk_model_builder::bake_animations(const gltf::model& mdl, vk_model_cache& cache)
 {
-    create_anim_keys_buffers(mdl, result, pool);
-    create_anim_nodes_buffer(mdl, result, pool);
-    create_anim_exec_order_buffer(mdl, result, pool);
+    bake_anim_keys(mdl, cache);
+    bake_anim_nodes(mdl, cache);
+    bake_anim_exec_order(mdl, cache);
 }
 
 
@@ -430,42 +1654,31 @@ vk_model_builder::gpu_animation vk_model_builder::create_gpu_animation(
 }
 
 
-void vk_model_builder::create_anim_keys_buffers(const model& mdl, vk_model& result, hal::render::avk::buffer_pool& pool)
+void vk_model_builder::bake_anim_keys(const model& mdl, vk_model_cache& cache)
 {
     auto default_keys = get_default_keys(mdl);
-    result.m_animations.reserve(mdl.get_animations().size());
+    cache.m_animations.reserve(mdl.get_animations().size());
 
     for (const auto& anim : mdl.get_animations()) {
-        auto& new_anim = result.m_animations.emplace_back();
-        auto gpu_anim = create_gpu_animation(mdl, anim, default_keys);
+        auto& new_anim = cache.m_animations.emplace_back();
+        const auto gpu_anim = create_gpu_animation(mdl, anim, default_keys);
 
-        // clang-format off
-        new_anim.m_time_stamps_buffer = pool.get_builder()
-            .set_size(gpu_anim.time_stamps.size() * sizeof(gpu_anim.time_stamps.front()))
-            .set_usage(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst)
-            .create([time_stamps = std::move(gpu_anim.time_stamps)](uint8_t* dst) {
-                std::memcpy(dst, time_stamps.data(), time_stamps.size() * sizeof(time_stamps.front()));
-            });
+        new_anim.time_stamps = cache.add_blob(gpu_anim.time_stamps.size() * sizeof(gpu_anim.time_stamps.front()), [&gpu_anim](uint8_t* dst) {
+            std::memcpy(dst, gpu_anim.time_stamps.data(), gpu_anim.time_stamps.size() * sizeof(gpu_anim.time_stamps.front()));
+        });
 
-        new_anim.m_keys_buffer = pool.get_builder()
-            .set_size(gpu_anim.keys.size() * sizeof(gpu_anim.keys.front()))
-            .set_usage(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst)
-            .create([keys = std::move(gpu_anim.keys)](uint8_t* dst) {
-                std::memcpy(dst, keys.data(), keys.size() * sizeof(keys.front()));
-            });
+        new_anim.keys = cache.add_blob(gpu_anim.keys.size() * sizeof(gpu_anim.keys.front()), [&gpu_anim](uint8_t* dst) {
+            std::memcpy(dst, gpu_anim.keys.data(), gpu_anim.keys.size() * sizeof(gpu_anim.keys.front()));
+        });
 
-        new_anim.m_meta_buffer = pool.get_builder()
-            .set_size(sizeof(gpu_anim.interpolation_avg_frame_duration))
-            .set_usage(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst)
-            .create([meta = gpu_anim.interpolation_avg_frame_duration](uint8_t* dst) {
-                std::memcpy(dst, &meta, sizeof(meta));
-            });
-        // clang-format on
+        new_anim.meta = cache.add_blob(sizeof(gpu_anim.interpolation_avg_frame_duration), [&gpu_anim](uint8_t* dst) {
+            std::memcpy(dst, &gpu_anim.interpolation_avg_frame_duration, sizeof(gpu_anim.interpolation_avg_frame_duration));
+        });
     }
 }
 
 
-void sandbox::gltf::vk_model_builder::create_anim_nodes_buffer(const gltf::model& mdl, vk_model& result, hal::render::avk::buffer_pool& pool)
+void sandbox::gltf::vk_model_builder::bake_anim_nodes(const gltf::model& mdl, vk_model_cache& cache)
 {
     std::vector<glm::ivec4> children_indices{};
     children_indices.emplace_back(-1, -1, -1, -1);
@@ -502,22 +1715,13 @@ void sandbox::gltf::vk_model_builder::create_anim_nodes_buffer(const gltf::model
     input_nodes_data.reserve(input_nodes_data.size() + children_indices.size());
     std::copy(children_indices.begin(), children_indices.end(), std::back_inserter(input_nodes_data));
 
-    // clang-format off
-    auto iput_nodes_buffer = pool.get_builder()
-        .set_size(input_nodes_data.size() * sizeof(glm::ivec4))
-        .set_usage(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst)
-        .create([ind = std::move(input_nodes_data)](uint8_t* dst) {
-            std::memcpy(dst, ind.data(), ind.size() * sizeof(ind.front()));
-        });
-    // clang-format on
-
-    for (auto& anim : result.m_animations) {
-        anim.m_nodes_buffer = iput_nodes_buffer;
-    }
+    cache.m_anim_nodes = cache.add_blob(input_nodes_data.size() * sizeof(glm::ivec4), [&input_nodes_data](uint8_t* dst) {
+        std::memcpy(dst, input_nodes_data.data(), input_nodes_data.size() * sizeof(input_nodes_data.front()));
+    });
 }
 
 
-void sandbox::gltf::vk_model_builder::create_anim_exec_order_buffer(const gltf::model& mdl, vk_model& result, hal::render::avk::buffer_pool& pool)
+void sandbox::gltf::vk_model_builder::bake_anim_exec_order(const gltf::model& mdl, vk_model_cache& cache)
 {
     std::vector<glm::ivec4> exec_order;
 
@@ -534,37 +1738,86 @@ void sandbox::gltf::vk_model_builder::create_anim_exec_order_buffer(const gltf::
         exec_order.back()[write_index++] = node_index;
     });
 
-    // clang-format off
-    auto exec_order_buffer = pool.get_builder()
-        .set_size(exec_order.size() * sizeof(glm::ivec4))
-        .set_usage(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst)
-        .create([eo = std::move(exec_order)](uint8_t* dst) {
-            std::memcpy(dst, eo.data(), eo.size() * sizeof(eo.front()));
-        });
-    // clang-format on
+    cache.m_anim_exec_order = cache.add_blob(exec_order.size() * sizeof(glm::ivec4), [&exec_order](uint8_t* dst) {
+        std::memcpy(dst, exec_order.data(), exec_order.size() * sizeof(exec_order.front()));
+    });
+}
+
+
+std::array<vk::Format, 8> vk_model_builder::get_model_vertex_format(const gltf::model& mdl) const
+{
+    CHECK_MSG(m_fixed_format || m_compact_vertices, "Fixed vertex format didn't specified.");
+
+    auto result = m_compact_vertices ? get_compact_vertex_format(mdl) : *m_fixed_format;
+
+    if (m_quantize_positions) {
+        result[static_cast<size_t>(attribute_path::position)] = vk::Format::eR16G16B16A16Unorm;
+    }
+
+    if (!m_keep_quantized) {
+        return result;
+    }
+
+    // the format shared by all primitives which have the attribute, nothing if any of them is float or they differ.
+    auto get_quantized_format = [&mdl](attribute_path path) -> std::optional<vertex_format> {
+        std::optional<vertex_format> result{};
+
+        for (const auto& mesh : mdl.get_meshes()) {
+            for (const auto& primitive : mesh.get_primitives()) {
+                const auto accessor_index = primitive.attribute_at_path(path);
+
+                if (accessor_index < 0) {
+                    continue;
+                }
+
+                const auto& accessor = mdl.get_accessors()[accessor_index];
+                const auto format = to_vertex_format(accessor.get_type(), accessor.get_component_type(), accessor.is_normalized());
+
+                if (format.component == vertex_component::float32 || format.component == vertex_component::uint32 || (result && *result != format)) {
+                    return std::nullopt;
+                }
+
+                result = format;
+            }
+        }
+
+        return result;
+    };
+
+    for (uint32_t i = 0; i < result.size(); ++i) {
+        const auto path = static_cast<attribute_path>(i);
+        const auto fixed_component = to_vertex_format(result[i]).component;
 
-    for (auto& anim : result.m_animations) {
-        anim.m_exec_order_buffer = exec_order_buffer;
+        // joints are integers in any case, only attributes which the fixed format reads as floats are replaced.
+        if (path == attribute_path::joints_0 || (fixed_component != vertex_component::float32 && fixed_component != vertex_component::float16)) {
+            continue;
+        }
+
+        if (const auto format = get_quantized_format(path)) {
+            result[i] = to_vk_quantized_vertex_format(*format);
+        }
     }
+
+    return result;
 }
 
-void vk_model_builder::get_vertex_attributes_data_from_fixed_format(
+
+void vk_model_builder::get_vertex_attributes_data(
+    const std::array<vk::Format, 8>& format,
     std::vector<vk::VertexInputAttributeDescription>& out_attributres,
     std::vector<vk::VertexInputBindingDescription>& out_bindings,
     uint32_t& out_vertex_size)
 {
-    CHECK_MSG(m_fixed_format, "Fixed vertex format didn't specified.");
-
     out_attributres.clear();
     out_bindings.clear();
 
-    out_attributres.reserve(m_fixed_format->size());
+    out_attributres.reserve(format.size());
     out_bindings.reserve(1);
 
     out_vertex_size = 0;
     uint32_t attribute_location = 0;
 
-    for (const vk::Format vk_fmt : *m_fixed_format) {
+    for (const vk::Format vk_fmt : format) {
         out_attributres.emplace_back(vk::VertexInputAttributeDescription{
             .location = attribute_location++,
             .binding = 0,
@@ -583,138 +1836,146 @@ void vk_model_builder::get_vertex_attributes_data_from_fixed_format(
 
 void vk_model_builder::copy_attribute_data(
     const primitive::vertex_attribute& attribute,
+    attribute_path path,
     vk::Format desired_vk_format,
+    const vk_model_cache::primitive& baked_primitive,
     uint64_t vtx_size,
     uint64_t offset,
     uint8_t* dst)
 {
-    auto [desired_type, desired_component_type] = from_vk_format(desired_vk_format);
-
-    switch (desired_type) {
-        case accessor_type::scalar:
-            switch (desired_component_type) {
-                case component_type::signed_byte:
-                    return ::copy_attribute_data<1, int8_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::unsigned_byte:
-                    return ::copy_attribute_data<1, uint8_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::signed_short:
-                    return ::copy_attribute_data<1, int16_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::unsigned_short:
-                    return ::copy_attribute_data<1, uint16_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::unsigned_int:
-                    return ::copy_attribute_data<1, uint32_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::float32:
-                    return ::copy_attribute_data<1, float>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                default:
-                    return;
-            }
-        case accessor_type::vec2:
-            switch (desired_component_type) {
-                case component_type::signed_byte:
-                    return ::copy_attribute_data<2, int8_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::unsigned_byte:
-                    return ::copy_attribute_data<2, uint8_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::signed_short:
-                    return ::copy_attribute_data<2, int16_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::unsigned_short:
-                    return ::copy_attribute_data<2, uint16_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::unsigned_int:
-                    return ::copy_attribute_data<2, uint32_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::float32:
-                    return ::copy_attribute_data<2, float>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                default:
-                    return;
-            }
-        case accessor_type::vec3:
-            switch (desired_component_type) {
-                case component_type::signed_byte:
-                    return ::copy_attribute_data<3, int8_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::unsigned_byte:
-                    return ::copy_attribute_data<3, uint8_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::signed_short:
-                    return ::copy_attribute_data<3, int16_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::unsigned_short:
-                    return ::copy_attribute_data<3, uint16_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::unsigned_int:
-                    return ::copy_attribute_data<3, uint32_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::float32:
-                    return ::copy_attribute_data<3, float>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                default:
-                    return;
-            }
-        case accessor_type::vec4:
-            switch (desired_component_type) {
-                case component_type::signed_byte:
-                    return ::copy_attribute_data<4, int8_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::unsigned_byte:
-                    return ::copy_attribute_data<4, uint8_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::signed_short:
-                    return ::copy_attribute_data<4, int16_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::unsigned_short:
-                    return ::copy_attribute_data<4, uint16_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::unsigned_int:
-                    return ::copy_attribute_data<4, uint32_t>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                case component_type::float32:
-                    return ::copy_attribute_data<4, float>(attribute, desired_vk_format, desired_type, desired_component_type, vtx_size, offset, dst);
-                default:
-                    return;
-            }
-        default:
-            return;
+    if (attribute.attribute_data == nullptr) {
+        return;
+    }
+
+    const auto src_format = to_vertex_format(attribute.accessor_type, attribute.component_type, attribute.normalized);
+    const auto dst_format = to_vertex_format(desired_vk_format);
+
+    if (path == attribute_path::position && m_quantize_positions) {
+        gltf::quantize_positions(
+            attribute.attribute_data,
+            attribute.byte_stride,
+            src_format,
+            dst + offset,
+            vtx_size,
+            dst_format,
+            to_vec3(baked_primitive.position_offset),
+            to_vec3(baked_primitive.position_scale),
+            attribute.elements_count);
+    } else if (path == attribute_path::normal && dst_format.components_count == 2) {
+        encode_octahedral(attribute.attribute_data, attribute.byte_stride, src_format, dst + offset, vtx_size, dst_format, attribute.elements_count);
+    } else if (path == attribute_path::weights_0) {
+        encode_weights(attribute.attribute_data, attribute.byte_stride, src_format, dst + offset, vtx_size, dst_format, attribute.elements_count);
+    } else {
+        convert_vertices(attribute.attribute_data, attribute.byte_stride, src_format, dst + offset, vtx_size, dst_format, attribute.elements_count);
     }
 }
 
 
-void vk_model_builder::create_textures(
-    const gltf::model& mdl,
-    hal::render::avk::image_pool& pool,
-    gltf::vk_model& result)
+void vk_model_builder::bake_textures(const gltf::model& mdl, vk_model_cache& cache)
 {
-    std::vector<avk::image_instance> images{};
-    images.reserve(mdl.get_images().size());
+    cache.m_images.reserve(mdl.get_images().size());
 
-    for (const auto& image : mdl.get_images()) {
-        auto image_pixels = get_stb_pixel_data(mdl, image);
+    // external images are read in the background with one batch, so reading the next files overlaps with decoding.
+    std::vector<hal::filesystem::async_reader::request> file_requests{};
+    std::vector<size_t> file_images{};
+
+    // images decoded for other models are taken from the registry and their files are not read at all.
+    std::vector<std::shared_ptr<const stb_pixel_data>> decoded_images(mdl.get_images().size());
+    std::vector<uint64_t> decoded_image_keys(mdl.get_images().size());
+
+    for (size_t i = 0; i < mdl.get_images().size(); ++i) {
+        const auto& image = mdl.get_images()[i];
+        if (image.get_buffer_view() < 0 && !image.get_uri().empty() && !is_data_uri(image.get_uri())) {
+            const auto abs_path = (std::filesystem::path(mdl.get_cwd()) / image.get_uri()).string();
+
+            if (m_assets != nullptr) {
+                const auto canonical_path = asset_registry::get_canonical_path(mdl.get_file_system().resolve(abs_path));
+                decoded_image_keys[i] = asset_registry::make_key("decoded image", canonical_path, m_assets->get_content_hash(canonical_path));
+                decoded_images[i] = m_assets->find<stb_pixel_data>(decoded_image_keys[i]);
 
-        images.emplace_back(pool.get_builder()
-                                .set_width(image_pixels.width)
-                                .set_height(image_pixels.height)
-                                .set_format(image_pixels.format)
-                                .gen_mips(true)
-                                .create([pixels = std::move(image_pixels.pixels)](uint8_t* dst) {
-                                    std::memcpy(dst, pixels.data(), pixels.size());
-                                }));
+                if (decoded_images[i] != nullptr) {
+                    continue;
+                }
+            }
+
+            file_requests.push_back({.file = mdl.get_file_system().open(abs_path)});
+            file_images.emplace_back(i);
+        }
     }
 
-    result.m_textures.reserve(mdl.get_textures().size());
+    auto files = hal::filesystem::async_reader::global().read_batch(std::move(file_requests));
+    std::vector<std::future<utils::data>> image_files(mdl.get_images().size());
 
-    for (const auto& texture : mdl.get_textures()) {
-        auto& new_texture = result.m_textures.emplace_back();
+    for (size_t i = 0; i < files.size(); ++i) {
+        image_files[file_images[i]] = std::move(files[i]);
+    }
 
-        new_texture.m_image = images[texture.get_image()];
+    for (size_t i = 0; i < mdl.get_images().size(); ++i) {
+        auto decode = [this, &mdl, &image_files, i]() {
+            return get_stb_pixel_data(mdl, mdl.get_images()[i], image_files[i]);
+        };
+
+        if (decoded_images[i] == nullptr && decoded_image_keys[i] != 0 && !m_release_after_upload) {
+            decoded_images[i] = m_assets->acquire<stb_pixel_data>(decoded_image_keys[i], [&decode]() {
+                auto pixels = decode();
+                const auto size = pixels.pixels.size();
+                return std::pair{std::move(pixels), uint64_t(size)};
+            });
+        } else if (decoded_images[i] == nullptr) {
+            decoded_images[i] = std::make_shared<const stb_pixel_data>(decode());
+        }
+
+        const auto& image_pixels = *decoded_images[i];
+
+        auto& new_image = cache.m_images.emplace_back();
+        new_image.width = image_pixels.width;
+        new_image.height = image_pixels.height;
+        new_image.format = static_cast<uint32_t>(image_pixels.format);
+
+        if (m_bake_mips) {
+            const auto mips = gen_srgb_mips(image_pixels.pixels, image_pixels.width, image_pixels.height);
+            new_image.mips_levels = mips.size();
+
+            size_t mips_size = 0;
+            for (const auto& level : mips) {
+                mips_size += level.size();
+            }
+
+            new_image.pixels = cache.add_blob(mips_size, [&mips](uint8_t* dst) {
+                for (const auto& level : mips) {
+                    std::memcpy(dst, level.data(), level.size());
+                    dst += level.size();
+                }
+            });
+        } else {
+            new_image.gen_mips = 1;
+            new_image.pixels = cache.add_blob(image_pixels.pixels.size(), [&image_pixels](uint8_t* dst) {
+                std::memcpy(dst, image_pixels.pixels.data(), image_pixels.pixels.size());
+            });
+        }
+
+        new_image.hash = utils::hash64(cache.get_blob_data(new_image.pixels), new_image.pixels.size);
+    }
+
+    cache.m_textures.reserve(mdl.get_textures().size());
+
+    for (const auto& texture : mdl.get_textures()) {
         const auto& sampler = mdl.get_samplers()[texture.get_sampler()];
 
-        new_texture.m_sampler = avk::sampler_builder()
-                                    .set_filtering(
-                                        to_vk_sampler_filter(sampler.get_mag_filter()).first,
-                                        to_vk_sampler_filter(sampler.get_mag_filter()).first,
-                                        vk::SamplerMipmapMode::eLinear)
-                                    .set_wrap(
-                                        to_vk_sampler_wrap(sampler.get_wrap_s()),
-                                        to_vk_sampler_wrap(sampler.get_wrap_t()),
-                                        to_vk_sampler_wrap(sampler.get_wrap_s()))
-                                    .create(new_texture.m_image);
+        cache.m_textures.emplace_back(vk_model_cache::texture{
+            .image = texture.get_image(),
+            .filter = static_cast<uint32_t>(to_vk_sampler_filter(sampler.get_mag_filter()).first),
+            .mip_filter = static_cast<uint32_t>(vk::SamplerMipmapMode::eLinear),
+            .wrap_u = static_cast<uint32_t>(to_vk_sampler_wrap(sampler.get_wrap_s())),
+            .wrap_v = static_cast<uint32_t>(to_vk_sampler_wrap(sampler.get_wrap_t())),
+            .wrap_w = static_cast<uint32_t>(to_vk_sampler_wrap(sampler.get_wrap_s()))});
     }
 }
 
 
-void vk_model_builder::create_materials(
-    const gltf::model& mdl,
-    hal::render::avk::buffer_pool& buffer_pool,
-    hal::render::avk::image_pool& image_pool,
-    gltf::vk_model& result)
+void vk_model_builder::bake_materials(const gltf::model& mdl, vk_model_cache& cache)
 {
-    result.m_materials.reserve(mdl.get_materials().size());
+    cache.m_materials.reserve(mdl.get_materials().size());
 
     constexpr int32_t max_scale = std::numeric_limits<int32_t>::max();
 
@@ -730,74 +1991,67 @@ void vk_model_builder::create_materials(
 
     for (const auto& material : mdl.get_materials()) {
         const auto& data = material.get_pbr_metallic_roughness();
-        auto& new_material = result.m_materials.emplace_back();
+        vk_model_cache::material new_material{};
 
         if (data.base_color_texture.index < 0) {
-            new_material.m_base_color = gen_texture_from_vec(
-                data.base_color, result.m_textures, image_pool);
+            new_material.base_color = gen_texture_from_vec(data.base_color, cache);
         } else {
-            new_material.m_base_color = data.base_color_texture.index;
+            new_material.base_color = data.base_color_texture.index;
         }
 
         if (data.metallic_roughness_texture.index < 0) {
-            new_material.m_metallic_roughness = gen_texture_from_vec(
-                {data.metallic_factor, data.roughness_factor, 0, 1}, result.m_textures, image_pool);
+            new_material.metallic_roughness = gen_texture_from_vec(
+                {data.metallic_factor, data.roughness_factor, 0, 1}, cache);
         } else {
-            new_material.m_metallic_roughness = data.metallic_roughness_texture.index;
+            new_material.metallic_roughness = data.metallic_roughness_texture.index;
         }
 
         bool use_normal = false;
 
         if (auto normal = material.get_normal_texture(); normal.index < 0) {
-            new_material.m_normal = gen_texture_from_vec(
-                {0.5, 0.5, 1, 1}, result.m_textures, image_pool);
+            new_material.normal = gen_texture_from_vec({0.5, 0.5, 1, 1}, cache);
         } else {
-            new_material.m_normal = normal.index;
+            new_material.normal = normal.index;
             use_normal = true;
         }
 
         bool use_occl = false;
 
         if (auto occl = material.get_occlusion_texture(); occl.index < 0) {
-            new_material.m_occlusion = gen_texture_from_vec(
-                {1, 1, 1, 1}, result.m_textures, image_pool);
+            new_material.occlusion = gen_texture_from_vec({1, 1, 1, 1}, cache);
         } else {
-            new_material.m_occlusion = occl.index;
+            new_material.occlusion = occl.index;
             use_occl = true;
         }
 
         bool use_emi = false;
 
         if (auto emi = material.get_emissive_texture(); emi.index < 0) {
-            new_material.m_emissive = gen_texture_from_vec(
-                {material.get_emissive_factor(), 1}, result.m_textures, image_pool);
+            new_material.emissive = gen_texture_from_vec({material.get_emissive_factor(), 1}, cache);
 
             use_emi = glm::length(material.get_emissive_factor()) > 0;
         } else {
-            new_material.m_emissive = emi.index;
+            new_material.emissive = emi.index;
             use_emi = true;
         }
 
-        material_data curr_material_data{
+        const material_data curr_material_data{
             .base_color_texture_data = {data.base_color_texture.coord_set, 1, max_scale, 0},
             .metalic_roughness_texture_data = {data.metallic_roughness_texture.coord_set, 1, max_scale, 0},
             .normal_texture_data{material.get_normal_texture().coord_set, use_normal, material.get_normal_scale() * max_scale, 1},
             .occlusion_texture_data = {material.get_occlusion_texture().coord_set, use_occl, max_scale, 0},
             .emissive_texture_data = {material.get_emissive_texture().coord_set, use_emi, max_scale, 0}};
 
-        // clang-format off
-        new_material.m_material_info_buffer = buffer_pool.get_builder()
-            .set_size(sizeof(material_data))
-            .set_usage(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst)
-            .create([curr_material_data](uint8_t* dst) {
-                  std::memcpy(dst, &curr_material_data, sizeof(curr_material_data));
-            });
-        // clang-format on
+        new_material.info = cache.add_blob(sizeof(material_data), [&curr_material_data](uint8_t* dst) {
+            std::memcpy(dst, &curr_material_data, sizeof(curr_material_data));
+        });
+
+        cache.m_materials.emplace_back(new_material);
     }
 }
 
 
-vk_model_builder::stb_pixel_data vk_model_builder::get_stb_pixel_data(const gltf::model& mdl, const gltf::image& image)
+vk_model_builder::stb_pixel_data vk_model_builder::get_stb_pixel_data(const gltf::model& mdl, const gltf::image& image, std::future<utils::data>& image_file)
 {
     stb_pixel_data result{};
 
@@ -813,9 +2067,14 @@ vk_model_builder::stb_pixel_data vk_model_builder::get_stb_pixel_data(const gltf
 
         handler.reset(stbi_load_from_memory(
             data_ptr, buffer_view.get_byte_length(), &w, &h, &c, 0));
-    } else if (!image.get_uri().empty()) {
-        const auto abs_path = (std::filesystem::path(mdl.get_cwd()) / image.get_uri()).string();
-        handler.reset(stbi_load(abs_path.c_str(), &w, &h, &c, 0));
+    } else if (is_data_uri(image.get_uri())) {
+        const auto image_data = decode_data_uri(image.get_uri());
+        handler.reset(stbi_load_from_memory(
+            image_data.get_data(), image_data.get_size(), &w, &h, &c, 0));
+    } else if (image_file.valid()) {
+        const auto file_data = image_file.get();
+        handler.reset(stbi_load_from_memory(
+            file_data.get_data(), file_data.get_size(), &w, &h, &c, 0));
     } else {
         throw std::runtime_error("Bad image.");
     }
@@ -857,30 +2116,27 @@ vk_model_builder::stb_pixel_data vk_model_builder::get_stb_pixel_data(const gltf
 }
 
 
-uint32_t vk_model_builder::gen_texture_from_vec(
-    glm::vec4 glm_data,
-    std::vector<vk_texture>& textures,
-    hal::render::avk::image_pool& pool)
+uint32_t vk_model_builder::gen_texture_from_vec(glm::vec4 glm_data, vk_model_cache& cache)
 {
-    vk_texture result;
-
-    // clang-format off
-            result.m_image = pool.get_builder()
-                .set_width(1)
-                .set_height(1)
-                .set_format(stb_channels_count_to_vk_format(glm_data.length()))
-                .create([glm_data](uint8_t* dst) {
-                    for (size_t i = 0; i < glm_data.length(); i++) {
-                        *dst++ = 255 * glm_data[i];
-                    }
-                });
-    // clang-format on
-
-    result.m_sampler = hal::render::avk::sampler_builder().create(result.m_image);
+    auto& new_image = cache.m_images.emplace_back();
+    new_image.format = static_cast<uint32_t>(stb_channels_count_to_vk_format(glm_data.length()));
+    new_image.pixels = cache.add_blob(glm_data.length(), [glm_data](uint8_t* dst) {
+        for (size_t i = 0; i < glm_data.length(); i++) {
+            *dst++ = 255 * glm_data[i];
+        }
+    });
+    new_image.hash = utils::hash64(cache.get_blob_data(new_image.pixels), new_image.pixels.size);
 
-    textures.emplace_back(std::move(result));
+    // default sampler
+    cache.m_textures.emplace_back(vk_model_cache::texture{
+        .image = static_cast<uint32_t>(cache.m_images.size() - 1),
+        .filter = static_cast<uint32_t>(vk::Filter::eLinear),
+        .mip_filter = static_cast<uint32_t>(vk::SamplerMipmapMode::eLinear),
+        .wrap_u = static_cast<uint32_t>(vk::SamplerAddressMode::eClampToEdge),
+        .wrap_v = static_cast<uint32_t>(vk::SamplerAddressMode::eClampToEdge),
+        .wrap_w = static_cast<uint32_t>(vk::SamplerAddressMode::eClampToEdge)});
 
-    return textures.size() - 1;
+    return cache.m_textures.size() - 1;
 }
 
 
@@ -988,6 +2244,21 @@ vk_model::vertex_format vk_model::get_vertex_format()
 }
 
 
+memory_footprint vk_model::get_memory_footprint() const
+{
+    auto result = m_footprint;
+
+    if (m_cache.expired()) {
+        result.geometry.cpu = 0;
+        result.textures.cpu = 0;
+        result.animations.cpu = 0;
+        result.other.cpu = 0;
+    }
+
+    return result;
+}
+
+
 const std::vector<vk_primitive>& vk_mesh::get_primitives() const
 {
     return m_primitives;
@@ -1005,13 +2276,20 @@ bool vk_mesh::is_skinned() const
     return m_skinned;
 }
 
+
+const bounds& vk_mesh::get_bounds() const
+{
+    return m_bounds;
+}
+
+
 const avk::buffer_instance& vk_primitive::get_vertex_buffer() const
 {
     return m_vertex_buffer;
 }
 
 
-uint32_t vk_primitive::get_vertices_count() const
+uint64_t vk_primitive::get_vertices_count() const
 {
     return m_vertices_count;
 }
@@ -1029,7 +2307,7 @@ vk::IndexType vk_primitive::get_indices_type() const
 }
 
 
-uint32_t vk_primitive::get_indices_count() const
+uint64_t vk_primitive::get_indices_count() const
 {
     return m_indices_count;
 }
@@ -1041,6 +2319,42 @@ const vk_material& sandbox::gltf::vk_primitive::get_material(const vk_model& mod
 }
 
 
+const bounds& vk_primitive::get_bounds() const
+{
+    return m_bounds;
+}
+
+
+const avk::buffer_instance& vk_primitive::get_clusters_buffer() const
+{
+    return m_clusters_buffer;
+}
+
+
+uint32_t vk_primitive::get_clusters_count() const
+{
+    return m_clusters_count;
+}
+
+
+const glm::vec3& vk_primitive::get_position_offset() const
+{
+    return m_position_offset;
+}
+
+
+const glm::vec3& vk_primitive::get_position_scale() const
+{
+    return m_position_scale;
+}
+
+
+const std::vector<vk_lod>& vk_primitive::get_lods() const
+{
+    return m_lods;
+}
+
+
 const hal::render::avk::buffer_instance& vk_skin::get_joints_buffer() const
 {
     return m_joints_buffer;
@@ -1135,8 +2449,8 @@ void sandbox::gltf::animation_controller::init_pipelines()
 {
     ASSERT(m_gltf_model != nullptr && m_vk_model != nullptr);
 
-    sandbox::hal::filesystem::common_file file{};
-    file.open(WORK_DIR "/gltf/resources/skinning.comp.spv");
+    sandbox::hal::filesystem::vfs_file file{};
+    file.open(get_shader_path());
     ASSERT(file.get_size());
 
     m_shader = avk::create_shader_module(avk::context::device()->createShaderModule(vk::ShaderModuleCreateInfo{
@@ -1231,6 +2545,256 @@ animation_instance* sandbox::gltf::animation_controller::instantiate_animation()
 }
 
 
+const std::string& sandbox::gltf::animation_controller::get_shader_path()
+{
+    static const std::string path{WORK_DIR "/gltf/resources/skinning.comp.spv"};
+    return path;
+}
+
+
+sandbox::gltf::cluster_culler::cluster_culler(const gltf::vk_model& vk_model)
+    : m_vk_model(&vk_model)
+    , m_mesh_transforms(vk_model.get_meshes().size(), glm::mat4{1})
+{
+}
+
+
+void sandbox::gltf::cluster_culler::init_resources(hal::render::avk::buffer_pool& pool)
+{
+    ASSERT(m_vk_model != nullptr);
+
+    const auto& meshes = m_vk_model->get_meshes();
+
+    m_primitives.clear();
+    m_primitives.resize(meshes.size());
+
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const auto& primitives = meshes[i].get_primitives();
+        m_primitives[i].resize(primitives.size());
+
+        // skinned vertices leave the bind pose which clusters are bounded by.
+        if (meshes[i].is_skinned()) {
+            continue;
+        }
+
+        for (size_t j = 0; j < primitives.size(); ++j) {
+            const auto& primitive = primitives[j];
+
+            // indirect draws count indices in 32 bits.
+            if (primitive.get_clusters_count() == 0 || primitive.get_indices_count() > std::numeric_limits<uint32_t>::max()) {
+                continue;
+            }
+
+            auto& culled = m_primitives[i][j];
+
+            // clang-format off
+            culled.culling_data = pool.get_builder()
+                .set_size(sizeof(gpu_culling_data))
+                .set_usage(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eUniformBuffer)
+                .create();
+
+            culled.visible_indices = pool.get_builder()
+                .set_size(primitive.get_indices_count() * sizeof(uint32_t))
+                .set_usage(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndexBuffer)
+                .create();
+
+            // the command is reset by the command buffer every frame, so it is never uploaded.
+            culled.draw_command = pool.get_builder()
+                .set_size(sizeof(vk::DrawIndexedIndirectCommand))
+                .set_usage(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer)
+                .create();
+            // clang-format on
+        }
+    }
+}
+
+
+void sandbox::gltf::cluster_culler::init_pipelines()
+{
+    ASSERT(m_vk_model != nullptr);
+
+    sandbox::hal::filesystem::vfs_file file{};
+    file.open(get_shader_path());
+    ASSERT(file.get_size());
+
+    m_shader = avk::create_shader_module(avk::context::device()->createShaderModule(vk::ShaderModuleCreateInfo{
+        .flags = {},
+        .codeSize = file.get_size(),
+        .pCode = reinterpret_cast<const uint32_t*>(file.read_all().get_data())}));
+
+    for (size_t i = 0; i < m_primitives.size(); ++i) {
+        for (size_t j = 0; j < m_primitives[i].size(); ++j) {
+            auto& culled = m_primitives[i][j];
+
+            if (culled.draw_command.get_size() == 0) {
+                continue;
+            }
+
+            const auto& primitive = m_vk_model->get_meshes()[i].get_primitives()[j];
+
+            // clang-format off
+            culled.pipeline = avk::pipeline_builder().set_shader_stages({{m_shader, vk::ShaderStageFlagBits::eCompute}})
+              .begin_descriptor_set()
+              .add_buffer(culled.culling_data, vk::DescriptorType::eUniformBuffer)
+              .add_buffer(primitive.get_clusters_buffer(), vk::DescriptorType::eStorageBuffer)
+              .add_buffer(primitive.get_index_buffer(), vk::DescriptorType::eStorageBuffer)
+              .add_buffer(culled.visible_indices, vk::DescriptorType::eStorageBuffer)
+              .add_buffer(culled.draw_command, vk::DescriptorType::eStorageBuffer)
+              .create_compute_pipeline();
+            // clang-format on
+        }
+    }
+}
+
+
+void sandbox::gltf::cluster_culler::set_mesh_transform(uint32_t mesh, const glm::mat4& transform)
+{
+    ASSERT(mesh < m_mesh_transforms.size());
+    m_mesh_transforms[mesh] = transform;
+}
+
+
+void sandbox::gltf::cluster_culler::update(const glm::mat4& view_proj, const glm::vec3& camera_position)
+{
+    const auto frustum_planes = get_frustum_planes(view_proj);
+
+    for (size_t i = 0; i < m_primitives.size(); ++i) {
+        const auto& transform = m_mesh_transforms[i];
+
+        const float scale = std::max({
+            glm::length(glm::vec3(transform[0])),
+            glm::length(glm::vec3(transform[1])),
+            glm::length(glm::vec3(transform[2]))});
+
+        // cones are tested in model space, so they stay exact for transforms which scale all axes the same.
+        const gpu_culling_data data{
+            .model = transform,
+            .frustum_planes = frustum_planes,
+            .camera = glm::vec4{glm::vec3(glm::inverse(transform) * glm::vec4{camera_position, 1}), scale}};
+
+        for (auto& culled : m_primitives[i]) {
+            if (culled.culling_data.get_size() == 0) {
+                continue;
+            }
+
+            culled.culling_data.upload([data](uint8_t* dst) {
+                std::memcpy(dst, &data, sizeof(data));
+            });
+        }
+    }
+}
+
+
+void sandbox::gltf::cluster_culler::update(vk::CommandBuffer& command_buffer)
+{
+    // the minimal limit of work groups along every dimension, bigger primitives are dispatched as rows of it.
+    constexpr uint32_t max_groups_count = 65535;
+
+    const vk::DrawIndexedIndirectCommand empty_draw{
+        .indexCount = 0,
+        .instanceCount = 1,
+        .firstIndex = 0,
+        .vertexOffset = 0,
+        .firstInstance = 0,
+    };
+
+    const bool has_culled = std::any_of(m_primitives.begin(), m_primitives.end(), [](const auto& mesh_primitives) {
+        return std::any_of(mesh_primitives.begin(), mesh_primitives.end(), [](const culled_primitive& culled) {
+            return culled.draw_command.get_size() > 0;
+        });
+    });
+
+    if (!has_culled) {
+        return;
+    }
+
+    // draws of the previous submit may still read the commands and indices which are rewritten below.
+    command_buffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput,
+        vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+        {},
+        {vk::MemoryBarrier{
+            .srcAccessMask = {},
+            .dstAccessMask = vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite,
+        }},
+        {},
+        {});
+
+    for (const auto& mesh_primitives : m_primitives) {
+        for (const auto& culled : mesh_primitives) {
+            if (culled.draw_command.get_size() > 0) {
+                command_buffer.updateBuffer(culled.draw_command, culled.draw_command.get_offset(), sizeof(empty_draw), &empty_draw);
+            }
+        }
+    }
+
+    command_buffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eComputeShader,
+        {},
+        {vk::MemoryBarrier{
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+        }},
+        {},
+        {});
+
+    for (size_t i = 0; i < m_primitives.size(); ++i) {
+        for (size_t j = 0; j < m_primitives[i].size(); ++j) {
+            auto& culled = m_primitives[i][j];
+
+            if (culled.draw_command.get_size() == 0) {
+                continue;
+            }
+
+            // every work group culls one cluster and copies its indices if it is visible.
+            const auto clusters_count = m_vk_model->get_meshes()[i].get_primitives()[j].get_clusters_count();
+
+            culled.pipeline.activate(command_buffer);
+            command_buffer.dispatch(std::min(clusters_count, max_groups_count), (clusters_count + max_groups_count - 1) / max_groups_count, 1);
+        }
+    }
+
+    command_buffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput,
+        {},
+        {vk::MemoryBarrier{
+            .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+            .dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eIndexRead,
+        }},
+        {},
+        {});
+}
+
+
+bool sandbox::gltf::cluster_culler::draw(uint32_t mesh, uint32_t primitive, vk::CommandBuffer& command_buffer) const
+{
+    ASSERT(mesh < m_primitives.size() && primitive < m_primitives[mesh].size());
+
+    const auto& culled = m_primitives[mesh][primitive];
+
+    if (culled.draw_command.get_size() == 0) {
+        return false;
+    }
+
+    const auto& vert_buffer = m_vk_model->get_meshes()[mesh].get_primitives()[primitive].get_vertex_buffer();
+
+    command_buffer.bindVertexBuffers(0, {vert_buffer}, {vert_buffer.get_offset()});
+    command_buffer.bindIndexBuffer(culled.visible_indices, culled.visible_indices.get_offset(), vk::IndexType::eUint32);
+    command_buffer.drawIndexedIndirect(culled.draw_command, culled.draw_command.get_offset(), 1, sizeof(vk::DrawIndexedIndirectCommand));
+
+    return true;
+}
+
+
+const std::string& sandbox::gltf::cluster_culler::get_shader_path()
+{
+    static const std::string path{WORK_DIR "/gltf/resources/cluster_culling.comp.spv"};
+    return path;
+}
+
+
 const vk_texture& sandbox::gltf::vk_material::get_base_color(const vk_model& model) const
 {
     return model.get_textures()[m_base_color];
@@ -1263,11 +2827,11 @@ const vk_texture& sandbox::gltf::vk_material::get_emissive(const vk_model& model
 
 const hal::render::avk::image_instance& sandbox::gltf::vk_texture::get_image() const
 {
-    return m_image;
+    return *m_image;
 }
 
 
 const hal::render::avk::sampler_instance& sandbox::gltf::vk_texture::get_sampler() const
 {
-    return m_sampler;
+    return *m_sampler;
 }
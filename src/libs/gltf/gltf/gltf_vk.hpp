@@ -1,8 +1,11 @@
 #pragma once
 
+#include <gltf/bounds.hpp>
 #include <gltf/gltf_base.hpp>
+#include <gltf/vk_model_cache.hpp>
 #include <render/vk/resources.hpp>
 
+#include <memory>
 #include <string>
 
 namespace sandbox::gltf
@@ -18,8 +21,9 @@ namespace sandbox::gltf
         const hal::render::avk::sampler_instance& get_sampler() const;
 
     private:
-        hal::render::avk::image_instance m_image{};
-        hal::render::avk::sampler_instance m_sampler{};
+        // shared with textures of other models if they are created through the asset registry.
+        std::shared_ptr<const hal::render::avk::image_instance> m_image{};
+        std::shared_ptr<const hal::render::avk::sampler_instance> m_sampler{};
     };
 
 
@@ -81,32 +85,65 @@ namespace sandbox::gltf
     };
 
 
+    // range of the primitive index buffer which one lod is drawn with.
+    struct vk_lod
+    {
+        uint64_t first_index{0};
+        uint64_t indices_count{0};
+        // the largest object space distance which the lod moves the surface by, 0 for the primitive itself.
+        float error{0};
+    };
+
+
     class vk_primitive
     {
         friend class vk_model_builder;
 
     public:
         const hal::render::avk::buffer_instance& get_vertex_buffer() const;
-        uint32_t get_vertices_count() const;
+        uint64_t get_vertices_count() const;
 
         const hal::render::avk::buffer_instance& get_index_buffer() const;
         vk::IndexType get_indices_type() const;
-        uint32_t get_indices_count() const;
+        uint64_t get_indices_count() const;
 
         const vk_material& get_material(const vk_model&) const;
 
+        // object space bounds of the vertices.
+        const bounds& get_bounds() const;
+
+        // positions of the vertex buffer are offset + position * scale in object space. it is the identity unless they
+        // were baked with vk_model_builder::quantize_positions(true).
+        const glm::vec3& get_position_offset() const;
+        const glm::vec3& get_position_scale() const;
+
+        // clusters of primitives which were baked with vk_model_builder::build_clusters(true), see cluster_culler.
+        const hal::render::avk::buffer_instance& get_clusters_buffer() const;
+        uint32_t get_clusters_count() const;
+
+        // lods of indexed primitives from the finest one, which is the primitive itself, to the coarsest one.
+        // all of them index the same vertices.
+        const std::vector<vk_lod>& get_lods() const;
+
     private:
         uint32_t m_material{};
 
         hal::render::avk::buffer_instance m_vertex_buffer{};
         hal::render::avk::buffer_instance m_index_buffer{};
+        hal::render::avk::buffer_instance m_clusters_buffer{};
+
+        uint64_t m_vertices_count{};
+        uint64_t m_indices_count{};
+        uint32_t m_clusters_count{};
 
-        uint32_t m_vertices_count{};
-        uint32_t m_indices_count{};
+        std::vector<vk_lod> m_lods{};
 
         vk::IndexType m_index_type{vk::IndexType::eNoneKHR};
 
-        std::pair<glm::vec3, glm::vec3> m_box_bound{};
+        bounds m_bounds{};
+
+        glm::vec3 m_position_offset{0};
+        glm::vec3 m_position_scale{1};
     };
 
 
@@ -119,12 +156,15 @@ namespace sandbox::gltf
         const vk_skin& get_skin() const;
         bool is_skinned() const;
 
+        // object space bounds of all primitives. skinned meshes are bounded by their bind pose.
+        const bounds& get_bounds() const;
+
     private:
         std::vector<vk_primitive> m_primitives{};
         vk_skin m_skin{};
         bool m_skinned = false;
 
-        std::pair<glm::vec3, glm::vec3> m_box_bound{};
+        bounds m_bounds{};
     };
 
 
@@ -144,6 +184,10 @@ namespace sandbox::gltf
 
         vertex_format get_vertex_format();
 
+        // gpu bytes of the model resources and cpu bytes of its baked data while anything keeps the data alive,
+        // e.g. until the pools upload it or while the asset registry caches it. shared images are counted by every model.
+        memory_footprint get_memory_footprint() const;
+
     private:
         std::vector<vk::VertexInputAttributeDescription> m_attributes{};
         std::vector<vk::VertexInputBindingDescription> m_bindings{};
@@ -152,26 +196,120 @@ namespace sandbox::gltf
         std::vector<vk_animation> m_animations{};
         std::vector<vk_texture> m_textures{};
         std::vector<vk_material> m_materials{};
+
+        // images which are not shared through the asset registry, so reload updates them in place. indexed as cache images.
+        std::vector<std::shared_ptr<hal::render::avk::image_instance>> m_own_images{};
+
+        // cpu part is the size of baked blobs, it is reported only while the cache is alive.
+        memory_footprint m_footprint{};
+        std::weak_ptr<const vk_model_cache> m_cache{};
+    };
+
+
+    // result of vk_model_builder::reload.
+    struct vk_model_changes
+    {
+        // layout of the new cache differs, e.g. counts, sizes or formats, so nothing was changed and the model has to be
+        // instantiated again.
+        bool requires_rebuild{false};
+        // changed data was passed to the pools, they have to be updated to copy it to gpu.
+        bool buffers_uploaded{false};
+        bool images_uploaded{false};
+        // meshes which primitives use other materials now.
+        std::vector<uint32_t> rebound_meshes{};
+        // materials which use other images or samplers now. pipelines and descriptor sets of these meshes and materials
+        // have to be recreated. uploaded buffers and images keep their handles, so descriptors of others stay valid.
+        std::vector<uint32_t> rebound_materials{};
     };
 
 
     class vk_model_builder
     {
     public:
-        static vk_model load_from_file(
-            const std::string&,
-            hal::render::avk::buffer_pool& buffer_pool,
-            hal::render::avk::image_pool& image_pool);
-
         vk_model_builder() = default;
         vk_model_builder& set_vertex_format(const std::array<vk::Format, 8>&);
         vk_model_builder& use_skin(bool use_skin);
+        // mip levels are filtered while baking instead of blitting them on gpu after upload.
+        vk_model_builder& bake_mips(bool bake_mips);
+        // float attributes of the vertex format are replaced with native formats of KHR_mesh_quantization attributes,
+        // e.g. eR16G16B16A16Snorm, if all primitives of the model use the same quantized format for them.
+        // the model vertex format has to be used for pipelines then.
+        vk_model_builder& keep_quantized(bool keep_quantized);
+        // picks compact formats instead of the fixed vertex format, so vertices take 40 bytes instead of 100 of the float
+        // formats: normals are octahedral eR16G16Snorm, tangents eR8G8B8A8Snorm, texcoords eR16G16Sfloat, colors and
+        // weights eR8G8B8A8Unorm, joints eR8G8B8A8Uint or eR16G16B16A16Uint for skins of more than 256 joints.
+        // normals of any vertex format are octahedral if their format has 2 components, see gltf::encode_octahedral.
+        // the model vertex format has to be used for pipelines then.
+        vk_model_builder& compact_vertices(bool compact_vertices);
+        // positions are baked as eR16G16B16A16Unorm in the bounds box of their primitive instead of the vertex format,
+        // shaders restore them with vk_primitive::get_position_offset and get_position_scale.
+        vk_model_builder& quantize_positions(bool quantize_positions);
+        // indexed triangle lists are reordered for the post-transform cache and overdraw, and their vertices are reordered
+        // for fetch locality while baking. statistics of the cache before and after it are kept by baked caches.
+        vk_model_builder& optimize_meshes(bool optimize_meshes);
+        // indexed triangle lists are split into clusters of up to 64 vertices and 124 triangles with bounding spheres and
+        // normal cones, so cluster_culler can cull them on gpu. indices of these primitives are baked as 32-bit.
+        vk_model_builder& build_clusters(bool build_clusters);
+        // indexed triangle lists get up to lods_count simplified lods, every one has about half of the triangles of the
+        // previous one. borders, attribute seams and vertices with different skin weights are kept, see gltf::simplify.
+        // lods which can't be simplified further without visible errors are dropped, so primitives may have fewer of them.
+        vk_model_builder& generate_lods(uint32_t lods_count);
+        // baked models are saved next to the source file if the directory is not set.
+        // relative urls keep their path inside the directory, so it can be filled by the asset cooker.
+        vk_model_builder& set_cache_directory(const std::string& directory);
+        // shares files, baked models, decoded images and gpu images between models built with the same registry.
+        // gpu resources are shared only between models which are created with the same pools.
+        vk_model_builder& set_asset_registry(asset_registry* assets);
+        // resolves model files and cache paths of load_from_file and load_cache, the global file system is used if it
+        // is not set. models passed to bake and create read their images through the file system they were loaded with.
+        vk_model_builder& set_file_system(hal::filesystem::vfs* file_system);
+        // baked data, decoded images and files of loaded models are not kept by the asset registry, so they are freed
+        // once the pools copy them to staging memory on submit. gpu resources are still shared through the registry.
+        // the gltf model passed to create can be released right after it, see model::release_payloads.
+        vk_model_builder& release_after_upload(bool release_after_upload);
+
+        // creates the model from the baked cache if it is up to date, otherwise loads gltf file and bakes the cache.
+        vk_model load_from_file(
+            const std::string& path,
+            hal::render::avk::buffer_pool& buffer_pool,
+            hal::render::avk::image_pool& image_pool);
 
         vk_model create(
             const gltf::model& mdl,
             hal::render::avk::buffer_pool& buffer_pool,
             hal::render::avk::image_pool& image_pool);
 
+        // converts everything which is uploaded to gpu, the result doesn't depend on gltf model.
+        vk_model_cache bake(const gltf::model& mdl);
+        // loads and bakes the file without checking caches. the result is keyed and can be saved as is.
+        vk_model_cache bake_file(const std::string& path);
+
+        // hash of the file content and of the builder settings which change baked data.
+        uint64_t get_cache_key(const std::string& path) const;
+        std::string get_cache_path(const std::string& url) const;
+
+        // opens the baked cache or bakes the file, as load_from_file does, so several models can be instantiated from it.
+        std::shared_ptr<const vk_model_cache> load_cache(const std::string& path);
+
+        // cache is kept alive until pools upload its data.
+        vk_model instantiate(
+            std::shared_ptr<const vk_model_cache> cache,
+            hal::render::avk::buffer_pool& buffer_pool,
+            hal::render::avk::image_pool& image_pool);
+
+        // creates only meshes which are set in the mask, with skins, materials and images which they use.
+        // other meshes have no primitives and the model has no animations. an empty mask creates the whole model.
+        vk_model instantiate(
+            std::shared_ptr<const vk_model_cache> cache,
+            hal::render::avk::buffer_pool& buffer_pool,
+            hal::render::avk::image_pool& image_pool,
+            const std::vector<bool>& meshes);
+
+        // diffs the cache which the model was instantiated from with the new one and re-uploads only changed blobs
+        // through the pools of the model. textures and materials get new images and samplers if they refer to others.
+        // the builder has to have the settings which the model was instantiated with. the model refers to the new cache then.
+        vk_model_changes reload(vk_model& model, const vk_model_cache& old_cache, std::shared_ptr<const vk_model_cache> cache);
+
     private:
         struct gpu_trs
         {
@@ -203,60 +341,64 @@ namespace sandbox::gltf
             std::vector<uint8_t> pixels;
         };
 
-        void create_geometry(
-            const gltf::model& mdl,
-            vk_model& model,
-            hal::render::avk::buffer_pool& buffer_pool);
+        void bake_geometry(const gltf::model& mdl, vk_model_cache& cache);
 
-        void create_skins(const gltf::model& mdl, vk_model& model, hal::render::avk::buffer_pool& pool);
-        void create_skins_resources(
-            const gltf::model& mdl,
-            std::vector<vk_skin>& result,
-            vk_model& model,
-            hal::render::avk::buffer_pool& pool);
-        void assing_skins_to_meshes(const std::vector<vk_skin>& skins, const gltf::model& mdl, vk_model& model);
+        void bake_skins(const gltf::model& mdl, vk_model_cache& cache);
+        void assing_skins_to_meshes(const gltf::model& mdl, vk_model_cache& cache);
 
-        void create_animations(const gltf::model& mdl, vk_model& model, hal::render::avk::buffer_pool& pool);
+        void bake_animations(const gltf::model& mdl, vk_model_cache& cache);
 
         std::vector<gpu_trs> get_default_keys(const gltf::model& mdl);
         gpu_animation create_gpu_animation(const model& mdl, const animation& curr_animation, const std::vector<gpu_trs>& default_keys);
-        void create_anim_keys_buffers(const gltf::model& mdl, vk_model& model, hal::render::avk::buffer_pool& pool);
+        void bake_anim_keys(const gltf::model& mdl, vk_model_cache& cache);
 
-        void create_anim_nodes_buffer(const gltf::model& mdl, vk_model& model, hal::render::avk::buffer_pool& pool);
-        void create_anim_exec_order_buffer(const gltf::model& mdl, vk_model& model, hal::render::avk::buffer_pool& pool);
+        void bake_anim_nodes(const gltf::model& mdl, vk_model_cache& cache);
+        void bake_anim_exec_order(const gltf::model& mdl, vk_model_cache& cache);
 
-        void get_vertex_attributes_data_from_fixed_format(
+        std::array<vk::Format, 8> get_model_vertex_format(const gltf::model& mdl) const;
+
+        static void get_vertex_attributes_data(
+            const std::array<vk::Format, 8>& format,
             std::vector<vk::VertexInputAttributeDescription>& out_attributres,
             std::vector<vk::VertexInputBindingDescription>& out_bindings,
             uint32_t& out_vertex_size);
 
         void copy_attribute_data(
             const gltf::primitive::vertex_attribute& attribute,
+            attribute_path path,
             vk::Format desired_vk_format,
+            const vk_model_cache::primitive& baked_primitive,
             uint64_t vtx_size,
             uint64_t offset,
             uint8_t* dst);
 
-        void create_textures(
-            const gltf::model& mdl,
-            hal::render::avk::image_pool& pool,
-            vk_model& result);
+        void bake_textures(const gltf::model& mdl, vk_model_cache& cache);
+        void bake_materials(const gltf::model& mdl, vk_model_cache& cache);
 
-        void create_materials(
-            const gltf::model& mdl,
-            hal::render::avk::buffer_pool& buffer_pool,
-            hal::render::avk::image_pool& image_pool,
-            vk_model& result);
+        stb_pixel_data get_stb_pixel_data(const gltf::model& mdl, const gltf::image& image, std::future<utils::data>& image_file);
+
+        uint32_t gen_texture_from_vec(glm::vec4 glm_data, vk_model_cache& cache);
 
-        stb_pixel_data get_stb_pixel_data(const gltf::model& mdl, const gltf::image& image);
+        std::shared_ptr<const hal::render::avk::sampler_instance> create_sampler(
+            const vk_model_cache::texture& texture, const hal::render::avk::image_instance& image);
 
-        uint32_t gen_texture_from_vec(
-            glm::vec4 glm_data,
-            std::vector<vk_texture>& textures,
-            hal::render::avk::image_pool& pool);
+        bool is_reloadable(const vk_model& model, const vk_model_cache& old_cache, const vk_model_cache& cache) const;
+
+        hal::filesystem::vfs& get_file_system() const;
 
         std::optional<std::array<vk::Format, 8>> m_fixed_format{};
         bool m_skinned = true;
+        bool m_bake_mips = false;
+        bool m_keep_quantized = false;
+        bool m_compact_vertices = false;
+        bool m_quantize_positions = false;
+        bool m_optimize_meshes = false;
+        bool m_build_clusters = false;
+        uint32_t m_lods_count = 0;
+        bool m_release_after_upload = false;
+        std::string m_cache_directory{};
+        asset_registry* m_assets{nullptr};
+        hal::filesystem::vfs* m_file_system{nullptr};
     };
 
 
@@ -308,6 +450,7 @@ namespace sandbox::gltf
             const gltf::vk_model& vk_model);
 
         void init_resources(hal::render::avk::buffer_pool& pool, size_t instances_count);
+        // can be called again to rebuild the pipeline, e.g. after the shader is changed.
         void init_pipelines();
 
         void update(uint64_t dt);
@@ -318,6 +461,8 @@ namespace sandbox::gltf
 
         animation_instance* instantiate_animation();
 
+        static const std::string& get_shader_path();
+
     private:
         const gltf::model* m_gltf_model{nullptr};
         const gltf::vk_model* m_vk_model{nullptr};
@@ -331,4 +476,49 @@ namespace sandbox::gltf
         std::vector<hal::render::avk::buffer_instance> m_progressions{};
         std::vector<animation_instance> m_animation_instances{};
     };
+
+
+    // culls clusters of static meshes against the frustum and their normal cones on gpu and compacts indices of visible
+    // clusters into a buffer per primitive, which is drawn by one indirect draw. skinned meshes, primitives without
+    // clusters and primitives with more than 2^32 indices are drawn as they are. clusters are built for the finest lod.
+    class cluster_culler
+    {
+    public:
+        cluster_culler() = default;
+
+        explicit cluster_culler(const gltf::vk_model& vk_model);
+
+        void init_resources(hal::render::avk::buffer_pool& pool);
+        // can be called again to rebuild pipelines, e.g. after the shader is changed.
+        void init_pipelines();
+
+        // meshes are culled in model space until they get a transform.
+        void set_mesh_transform(uint32_t mesh, const glm::mat4& transform);
+
+        void update(const glm::mat4& view_proj, const glm::vec3& camera_position);
+        // culling data is uploaded by the pool update, so it is recorded after the update and outside of render passes.
+        void update(vk::CommandBuffer& command_buffer);
+
+        // returns false if the primitive is not culled, it is drawn with draw_primitive then.
+        bool draw(uint32_t mesh, uint32_t primitive, vk::CommandBuffer& command_buffer) const;
+
+        static const std::string& get_shader_path();
+
+    private:
+        struct culled_primitive
+        {
+            hal::render::avk::buffer_instance culling_data{};
+            hal::render::avk::buffer_instance visible_indices{};
+            hal::render::avk::buffer_instance draw_command{};
+            hal::render::avk::pipeline_instance pipeline{};
+        };
+
+        const gltf::vk_model* m_vk_model{nullptr};
+
+        hal::render::avk::shader_module m_shader{};
+
+        std::vector<glm::mat4> m_mesh_transforms{};
+        // indexed as meshes and their primitives, primitives which are not culled have no buffers.
+        std::vector<std::vector<culled_primitive>> m_primitives{};
+    };
 } // namespace sandbox::gltf
@@ -0,0 +1,978 @@
+#include "mesh_optimizer.hpp"
+
+#include <utils/conditions_helpers.hpp>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+using namespace sandbox::gltf;
+
+namespace
+{
+    // vertex scores of the cache optimization, see "Linear-Speed Vertex Cache Optimisation" by Tom Forsyth.
+    constexpr uint32_t forsyth_cache_size = 32;
+    constexpr uint32_t forsyth_max_valence = 32;
+    constexpr float forsyth_cache_decay_power = 1.5f;
+    constexpr float forsyth_last_triangle_score = 0.75f;
+    constexpr float forsyth_valence_boost_scale = 2.0f;
+    constexpr float forsyth_valence_boost_power = 0.5f;
+
+
+    struct forsyth_scores
+    {
+        // indexed by cache position, the last entry is for vertices out of the cache.
+        std::array<float, forsyth_cache_size + 1> cache{};
+        // indexed by count of triangles which are not emitted yet.
+        std::array<float, forsyth_max_valence + 1> valence{};
+
+        forsyth_scores()
+        {
+            for (uint32_t i = 0; i < forsyth_cache_size; ++i) {
+                // vertices of the last triangle get a fixed score, so the next triangle doesn't reuse all of them
+                // and the strip doesn't turn back.
+                if (i < 3) {
+                    cache[i] = forsyth_last_triangle_score;
+                } else {
+                    const float scale = 1.0f / float(forsyth_cache_size - 3);
+                    cache[i] = std::pow(1.0f - float(i - 3) * scale, forsyth_cache_decay_power);
+                }
+            }
+
+            cache[forsyth_cache_size] = 0;
+
+            // vertices with few triangles left are finished first, so they don't stay alone.
+            valence[0] = 0;
+
+            for (uint32_t i = 1; i <= forsyth_max_valence; ++i) {
+                valence[i] = forsyth_valence_boost_scale * std::pow(float(i), -forsyth_valence_boost_power);
+            }
+        }
+
+        float get(uint32_t cache_position, uint32_t live_triangles) const
+        {
+            if (live_triangles == 0) {
+                return -1;
+            }
+
+            return cache[std::min(cache_position, forsyth_cache_size)] + valence[std::min(live_triangles, forsyth_max_valence)];
+        }
+    };
+
+
+    // triangles which use every vertex, offsets are indexed by vertices.
+    struct vertex_adjacency
+    {
+        std::vector<uint32_t> counts{};
+        std::vector<uint32_t> offsets{};
+        std::vector<uint32_t> triangles{};
+
+        vertex_adjacency(std::span<const uint32_t> indices, uint64_t vertices_count)
+            : counts(vertices_count, 0)
+            , offsets(vertices_count, 0)
+            , triangles(indices.size())
+        {
+            for (const auto index : indices) {
+                ++counts[index];
+            }
+
+            uint32_t offset = 0;
+
+            for (size_t i = 0; i < vertices_count; ++i) {
+                offsets[i] = offset;
+                offset += counts[i];
+            }
+
+            std::vector<uint32_t> filled(vertices_count, 0);
+
+            for (size_t i = 0; i < indices.size(); ++i) {
+                const auto vertex = indices[i];
+                triangles[offsets[vertex] + filled[vertex]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        std::span<const uint32_t> get(uint32_t vertex) const
+        {
+            return {triangles.data() + offsets[vertex], counts[vertex]};
+        }
+
+        // the emitted triangle is swapped with the last live one, so live triangles of the vertex stay in front.
+        void remove(uint32_t vertex, uint32_t triangle)
+        {
+            auto* begin = triangles.data() + offsets[vertex];
+            auto* end = begin + counts[vertex];
+            auto* it = std::find(begin, end, triangle);
+
+            ASSERT(it != end);
+
+            std::swap(*it, *(end - 1));
+            --counts[vertex];
+        }
+    };
+
+
+    // fifo cache over vertex timestamps, so the cache is reset by moving the time forward.
+    class fifo_cache
+    {
+    public:
+        fifo_cache(uint64_t vertices_count, uint32_t cache_size)
+            : m_timestamps(vertices_count, 0)
+            , m_cache_size(cache_size)
+            , m_time(cache_size + 1)
+        {
+        }
+
+        // returns count of vertices of the triangle which were transformed.
+        uint32_t add_triangle(const uint32_t* triangle)
+        {
+            uint32_t misses = 0;
+
+            for (uint32_t i = 0; i < 3; ++i) {
+                if (m_time - m_timestamps[triangle[i]] > m_cache_size) {
+                    m_timestamps[triangle[i]] = m_time++;
+                    ++misses;
+                }
+            }
+
+            return misses;
+        }
+
+        void reset()
+        {
+            m_time += m_cache_size + 1;
+        }
+
+    private:
+        std::vector<uint32_t> m_timestamps{};
+        uint32_t m_cache_size{0};
+        uint32_t m_time{0};
+    };
+
+
+    glm::vec3 load_position(const uint8_t* positions, size_t stride, uint32_t vertex)
+    {
+        glm::vec3 result;
+        std::memcpy(&result, positions + size_t(vertex) * stride, sizeof(result));
+        return result;
+    }
+
+
+    // weighted sum of squared distances to planes, see "Surface Simplification Using Quadric Error Metrics" by Garland
+    // and Heckbert. planes are weighted by areas of their triangles, so the error is an average squared distance.
+    struct quadric
+    {
+        double a00{0};
+        double a11{0};
+        double a22{0};
+        double a01{0};
+        double a02{0};
+        double a12{0};
+        double b0{0};
+        double b1{0};
+        double b2{0};
+        double c{0};
+        double weight{0};
+
+        static quadric from_plane(const glm::vec3& normal, float distance, float weight)
+        {
+            const double x = normal.x;
+            const double y = normal.y;
+            const double z = normal.z;
+            const double d = distance;
+
+            return {
+                .a00 = x * x * weight,
+                .a11 = y * y * weight,
+                .a22 = z * z * weight,
+                .a01 = x * y * weight,
+                .a02 = x * z * weight,
+                .a12 = y * z * weight,
+                .b0 = x * d * weight,
+                .b1 = y * d * weight,
+                .b2 = z * d * weight,
+                .c = d * d * weight,
+                .weight = weight};
+        }
+
+        quadric& operator+=(const quadric& other)
+        {
+            a00 += other.a00;
+            a11 += other.a11;
+            a22 += other.a22;
+            a01 += other.a01;
+            a02 += other.a02;
+            a12 += other.a12;
+            b0 += other.b0;
+            b1 += other.b1;
+            b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+
+            return *this;
+        }
+
+        double get_error(const glm::vec3& point) const
+        {
+            if (weight <= 0) {
+                return 0;
+            }
+
+            const double x = point.x;
+            const double y = point.y;
+            const double z = point.z;
+
+            const double error =
+                a00 * x * x + a11 * y * y + a22 * z * z
+                + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                + 2 * (b0 * x + b1 * y + b2 * z)
+                + c;
+
+            return std::max(error / weight, 0.0);
+        }
+    };
+
+
+    // vertices which simplify must keep: vertices of border and non-manifold edges and vertices which share position with
+    // others, since the shared position is a seam of attributes.
+    std::vector<bool> get_locked_vertices(std::span<const uint32_t> indices, const std::vector<glm::vec3>& positions)
+    {
+        std::vector<bool> result(positions.size(), false);
+
+        std::vector<uint32_t> vertices(positions.size());
+        std::iota(vertices.begin(), vertices.end(), 0);
+
+        auto position_key = [&positions](uint32_t vertex) {
+            const auto& p = positions[vertex];
+            return std::array<uint32_t, 3>{std::bit_cast<uint32_t>(p.x), std::bit_cast<uint32_t>(p.y), std::bit_cast<uint32_t>(p.z)};
+        };
+
+        std::sort(vertices.begin(), vertices.end(), [&position_key](uint32_t lhs, uint32_t rhs) {
+            return position_key(lhs) < position_key(rhs);
+        });
+
+        for (size_t i = 1; i < vertices.size(); ++i) {
+            if (position_key(vertices[i - 1]) == position_key(vertices[i])) {
+                result[vertices[i - 1]] = true;
+                result[vertices[i]] = true;
+            }
+        }
+
+        // every manifold edge is used once in each direction.
+        std::vector<uint64_t> edges{};
+        edges.reserve(indices.size());
+
+        auto make_edge = [](uint32_t from, uint32_t to) {
+            return (uint64_t(from) << 32) | to;
+        };
+
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (uint32_t j = 0; j < 3; ++j) {
+                edges.emplace_back(make_edge(indices[i + j], indices[i + (j + 1) % 3]));
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+
+        for (size_t i = 0; i < edges.size(); ++i) {
+            const auto from = uint32_t(edges[i] >> 32);
+            const auto to = uint32_t(edges[i]);
+
+            const bool repeated = (i > 0 && edges[i - 1] == edges[i]) || (i + 1 < edges.size() && edges[i + 1] == edges[i]);
+            const auto opposite = std::equal_range(edges.begin(), edges.end(), make_edge(to, from));
+
+            if (repeated || opposite.second - opposite.first != 1) {
+                result[from] = true;
+                result[to] = true;
+            }
+        }
+
+        return result;
+    }
+
+
+    // collapsing a vertex moves its triangles to the other vertex, they must not turn over or degenerate.
+    bool flips_triangles(
+        std::span<const uint32_t> indices,
+        std::span<const uint32_t> triangles,
+        const std::vector<glm::vec3>& positions,
+        uint32_t from,
+        uint32_t to)
+    {
+        for (const auto triangle : triangles) {
+            const uint32_t* vertices = indices.data() + size_t(triangle) * 3;
+
+            // triangles of the collapsed edge disappear.
+            if (vertices[0] == to || vertices[1] == to || vertices[2] == to) {
+                continue;
+            }
+
+            std::array<glm::vec3, 3> moved{};
+
+            for (uint32_t i = 0; i < 3; ++i) {
+                moved[i] = positions[vertices[i] == from ? to : vertices[i]];
+            }
+
+            const auto& p0 = positions[vertices[0]];
+            const auto& p1 = positions[vertices[1]];
+            const auto& p2 = positions[vertices[2]];
+
+            const auto normal = glm::cross(p1 - p0, p2 - p0);
+            const auto moved_normal = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+
+            if (glm::dot(normal, moved_normal) <= 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+} // namespace
+
+
+float vertex_cache_statistics::get_acmr() const
+{
+    return triangles > 0 ? float(transformed_vertices) / float(triangles) : 0.0f;
+}
+
+
+float vertex_cache_statistics::get_atvr() const
+{
+    return vertices > 0 ? float(transformed_vertices) / float(vertices) : 0.0f;
+}
+
+
+vertex_cache_statistics& vertex_cache_statistics::operator+=(const vertex_cache_statistics& other)
+{
+    triangles += other.triangles;
+    vertices += other.vertices;
+    transformed_vertices += other.transformed_vertices;
+
+    return *this;
+}
+
+
+vertex_cache_statistics sandbox::gltf::analyze_vertex_cache(std::span<const uint32_t> indices, uint64_t vertices_count, uint32_t cache_size)
+{
+    CHECK_MSG(indices.size() % 3 == 0, "Indices are not a triangle list.");
+
+    vertex_cache_statistics result{};
+    result.triangles = indices.size() / 3;
+
+    std::vector<bool> used(vertices_count, false);
+    fifo_cache cache{vertices_count, cache_size};
+
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        result.transformed_vertices += cache.add_triangle(indices.data() + i);
+    }
+
+    for (const auto index : indices) {
+        if (!used[index]) {
+            used[index] = true;
+            ++result.vertices;
+        }
+    }
+
+    return result;
+}
+
+
+void sandbox::gltf::optimize_vertex_cache(std::span<uint32_t> indices, uint64_t vertices_count)
+{
+    CHECK_MSG(indices.size() % 3 == 0, "Indices are not a triangle list.");
+
+    const size_t triangles_count = indices.size() / 3;
+
+    if (triangles_count == 0) {
+        return;
+    }
+
+    static const forsyth_scores scores{};
+
+    vertex_adjacency adjacency{indices, vertices_count};
+
+    std::vector<float> vertex_scores(vertices_count, 0);
+
+    for (uint32_t i = 0; i < vertices_count; ++i) {
+        vertex_scores[i] = scores.get(forsyth_cache_size, adjacency.counts[i]);
+    }
+
+    std::vector<float> triangle_scores(triangles_count, 0);
+    std::vector<bool> emitted(triangles_count, false);
+
+    for (size_t i = 0; i < triangles_count; ++i) {
+        triangle_scores[i] = vertex_scores[indices[i * 3]] + vertex_scores[indices[i * 3 + 1]] + vertex_scores[indices[i * 3 + 2]];
+    }
+
+    std::vector<uint32_t> result(indices.size());
+
+    // vertices of the emitted triangle are pushed in front, so the cache is 3 entries longer while it is rebuilt.
+    std::array<uint32_t, forsyth_cache_size + 3> cache{};
+    std::array<uint32_t, forsyth_cache_size + 3> new_cache{};
+    uint32_t cache_count = 0;
+
+    uint32_t current_triangle = static_cast<uint32_t>(std::max_element(triangle_scores.begin(), triangle_scores.end()) - triangle_scores.begin());
+    size_t input_cursor = 0;
+
+    for (size_t output_triangle = 0; output_triangle < triangles_count; ++output_triangle) {
+        const uint32_t* triangle = indices.data() + size_t(current_triangle) * 3;
+
+        std::copy_n(triangle, 3, result.data() + output_triangle * 3);
+        emitted[current_triangle] = true;
+
+        uint32_t new_cache_count = 0;
+
+        for (uint32_t i = 0; i < 3; ++i) {
+            adjacency.remove(triangle[i], current_triangle);
+            new_cache[new_cache_count++] = triangle[i];
+        }
+
+        for (uint32_t i = 0; i < cache_count; ++i) {
+            const auto vertex = cache[i];
+
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                new_cache[new_cache_count++] = vertex;
+            }
+        }
+
+        std::swap(cache, new_cache);
+        cache_count = std::min(new_cache_count, forsyth_cache_size);
+
+        // scores of vertices which are pushed out of the cache are updated too.
+        for (uint32_t i = 0; i < new_cache_count; ++i) {
+            const auto vertex = cache[i];
+            const auto position = std::min(i, forsyth_cache_size);
+            const float score = scores.get(position, adjacency.counts[vertex]);
+            const float delta = score - vertex_scores[vertex];
+            vertex_scores[vertex] = score;
+
+            for (const auto adjacent_triangle : adjacency.get(vertex)) {
+                triangle_scores[adjacent_triangle] += delta;
+            }
+        }
+
+        // the next triangle is the best one which uses cached vertices.
+        float best_score = 0;
+        uint32_t best_triangle = uint32_t(-1);
+
+        for (uint32_t i = 0; i < cache_count; ++i) {
+            for (const auto adjacent_triangle : adjacency.get(cache[i])) {
+                if (triangle_scores[adjacent_triangle] > best_score) {
+                    best_score = triangle_scores[adjacent_triangle];
+                    best_triangle = adjacent_triangle;
+                }
+            }
+        }
+
+        // dead end, the cache has no vertices with triangles left, so the next triangle of the input is taken.
+        if (best_triangle == uint32_t(-1)) {
+            while (input_cursor < triangles_count && emitted[input_cursor]) {
+                ++input_cursor;
+            }
+
+            best_triangle = static_cast<uint32_t>(input_cursor);
+        }
+
+        current_triangle = best_triangle;
+    }
+
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+
+void sandbox::gltf::optimize_overdraw(
+    std::span<uint32_t> indices,
+    const uint8_t* positions,
+    size_t positions_stride,
+    uint64_t vertices_count,
+    float threshold)
+{
+    CHECK_MSG(indices.size() % 3 == 0, "Indices are not a triangle list.");
+
+    constexpr uint32_t cache_size = 16;
+
+    const size_t triangles_count = indices.size() / 3;
+
+    if (triangles_count == 0) {
+        return;
+    }
+
+    // hard boundaries are triangles which transform all their vertices, the order of clusters doesn't change acmr there.
+    std::vector<size_t> hard_clusters{};
+
+    {
+        fifo_cache cache{vertices_count, cache_size};
+
+        for (size_t i = 0; i < triangles_count; ++i) {
+            if (cache.add_triangle(indices.data() + i * 3) == 3 || i == 0) {
+                hard_clusters.emplace_back(i);
+            }
+        }
+    }
+
+    // hard clusters are split further while acmr of the parts stays close to acmr of the whole cluster.
+    std::vector<size_t> clusters{};
+    fifo_cache cache{vertices_count, cache_size};
+
+    for (size_t i = 0; i < hard_clusters.size(); ++i) {
+        const size_t start = hard_clusters[i];
+        const size_t end = i + 1 < hard_clusters.size() ? hard_clusters[i + 1] : triangles_count;
+
+        cache.reset();
+        uint32_t cluster_misses = 0;
+
+        for (size_t j = start; j < end; ++j) {
+            cluster_misses += cache.add_triangle(indices.data() + j * 3);
+        }
+
+        const float cluster_threshold = threshold * float(cluster_misses) / float(end - start);
+
+        cache.reset();
+        clusters.emplace_back(start);
+
+        size_t soft_start = start;
+        uint32_t misses = 0;
+
+        for (size_t j = start; j < end; ++j) {
+            misses += cache.add_triangle(indices.data() + j * 3);
+
+            if (j + 1 < end && float(misses) <= cluster_threshold * float(j + 1 - soft_start)) {
+                clusters.emplace_back(j + 1);
+                cache.reset();
+                soft_start = j + 1;
+                misses = 0;
+            }
+        }
+    }
+
+    // mesh center is the average of vertices, clusters which face away from it are on the outside of the mesh.
+    glm::vec3 mesh_center{0};
+    uint64_t used_vertices = 0;
+
+    {
+        std::vector<bool> used(vertices_count, false);
+
+        for (const auto index : indices) {
+            if (!used[index]) {
+                used[index] = true;
+                mesh_center += load_position(positions, positions_stride, index);
+                ++used_vertices;
+            }
+        }
+
+        mesh_center = mesh_center / float(used_vertices);
+    }
+
+    std::vector<float> sort_keys(clusters.size(), 0);
+
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        const size_t start = clusters[i];
+        const size_t end = i + 1 < clusters.size() ? clusters[i + 1] : triangles_count;
+
+        glm::vec3 center{0};
+        glm::vec3 normal{0};
+        float area = 0;
+
+        for (size_t j = start; j < end; ++j) {
+            const auto p0 = load_position(positions, positions_stride, indices[j * 3]);
+            const auto p1 = load_position(positions, positions_stride, indices[j * 3 + 1]);
+            const auto p2 = load_position(positions, positions_stride, indices[j * 3 + 2]);
+
+            // the cross product length is twice the triangle area, so centers are weighted by areas.
+            const auto triangle_normal = glm::cross(p1 - p0, p2 - p0);
+            const float triangle_area = glm::length(triangle_normal);
+
+            center += (p0 + p1 + p2) * (triangle_area / 3.0f);
+            normal += triangle_normal;
+            area += triangle_area;
+        }
+
+        // degenerate clusters keep their place relative to each other and go last.
+        if (area <= 0 || glm::length(normal) <= 0) {
+            sort_keys[i] = -std::numeric_limits<float>::max();
+            continue;
+        }
+
+        center = center / area;
+        sort_keys[i] = glm::dot(center - mesh_center, glm::normalize(normal));
+    }
+
+    std::vector<uint32_t> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    std::stable_sort(order.begin(), order.end(), [&sort_keys](uint32_t lhs, uint32_t rhs) {
+        return sort_keys[lhs] > sort_keys[rhs];
+    });
+
+    std::vector<uint32_t> result{};
+    result.reserve(indices.size());
+
+    for (const auto cluster : order) {
+        const size_t start = clusters[cluster];
+        const size_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangles_count;
+
+        result.insert(result.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+    }
+
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+
+std::vector<uint32_t> sandbox::gltf::optimize_vertex_fetch(std::span<uint32_t> indices, uint64_t vertices_count)
+{
+    constexpr uint32_t unused = uint32_t(-1);
+
+    std::vector<uint32_t> result(vertices_count, unused);
+    uint32_t next_vertex = 0;
+
+    for (auto& index : indices) {
+        if (result[index] == unused) {
+            result[index] = next_vertex++;
+        }
+
+        index = result[index];
+    }
+
+    for (auto& vertex : result) {
+        if (vertex == unused) {
+            vertex = next_vertex++;
+        }
+    }
+
+    return result;
+}
+
+
+std::vector<index_cluster> sandbox::gltf::build_clusters(
+    std::span<uint32_t> indices,
+    uint64_t vertices_count,
+    uint32_t max_vertices,
+    uint32_t max_triangles)
+{
+    CHECK_MSG(indices.size() % 3 == 0, "Indices are not a triangle list.");
+    CHECK_MSG(max_vertices >= 3 && max_triangles > 0, "Cluster can't hold a triangle.");
+
+    constexpr uint32_t no_triangle = uint32_t(-1);
+
+    const size_t triangles_count = indices.size() / 3;
+
+    std::vector<index_cluster> result{};
+
+    if (triangles_count == 0) {
+        return result;
+    }
+
+    vertex_adjacency adjacency{indices, vertices_count};
+
+    std::vector<bool> emitted(triangles_count, false);
+    // the last cluster which every vertex was added to, so membership isn't cleared between clusters.
+    std::vector<uint32_t> vertex_clusters(vertices_count, uint32_t(-1));
+    std::vector<uint32_t> cluster_vertices{};
+    cluster_vertices.reserve(max_vertices);
+
+    std::vector<uint32_t> reordered{};
+    reordered.reserve(indices.size());
+
+    size_t input_cursor = 0;
+
+    while (reordered.size() < indices.size()) {
+        const auto cluster = static_cast<uint32_t>(result.size());
+        auto& new_cluster = result.emplace_back(index_cluster{.first_triangle = static_cast<uint32_t>(reordered.size() / 3)});
+        cluster_vertices.clear();
+
+        // every cluster starts from the next triangle of the input, so clusters follow the cache optimized order.
+        while (emitted[input_cursor]) {
+            ++input_cursor;
+        }
+
+        uint32_t current_triangle = static_cast<uint32_t>(input_cursor);
+
+        while (current_triangle != no_triangle) {
+            const uint32_t* triangle = indices.data() + size_t(current_triangle) * 3;
+
+            for (uint32_t i = 0; i < 3; ++i) {
+                adjacency.remove(triangle[i], current_triangle);
+                reordered.emplace_back(triangle[i]);
+
+                if (vertex_clusters[triangle[i]] != cluster) {
+                    vertex_clusters[triangle[i]] = cluster;
+                    cluster_vertices.emplace_back(triangle[i]);
+                }
+            }
+
+            emitted[current_triangle] = true;
+
+            if (++new_cluster.triangles_count == max_triangles) {
+                break;
+            }
+
+            // the next triangle shares vertices with the cluster and adds as few new ones as possible.
+            uint32_t best_new_vertices = 3;
+            current_triangle = no_triangle;
+
+            for (size_t i = 0; i < cluster_vertices.size() && best_new_vertices > 0; ++i) {
+                for (const auto adjacent_triangle : adjacency.get(cluster_vertices[i])) {
+                    const uint32_t* adjacent = indices.data() + size_t(adjacent_triangle) * 3;
+                    uint32_t new_vertices = 0;
+
+                    for (uint32_t j = 0; j < 3; ++j) {
+                        new_vertices += vertex_clusters[adjacent[j]] != cluster ? 1 : 0;
+                    }
+
+                    if (new_vertices < best_new_vertices && cluster_vertices.size() + new_vertices <= max_vertices) {
+                        best_new_vertices = new_vertices;
+                        current_triangle = adjacent_triangle;
+                    }
+                }
+            }
+        }
+    }
+
+    std::copy(reordered.begin(), reordered.end(), indices.begin());
+
+    return result;
+}
+
+
+cluster_bounds sandbox::gltf::get_cluster_bounds(std::span<const uint32_t> indices, const uint8_t* positions, size_t positions_stride)
+{
+    CHECK_MSG(indices.size() % 3 == 0, "Indices are not a triangle list.");
+
+    cluster_bounds result{};
+
+    if (indices.empty()) {
+        return result;
+    }
+
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+    for (const auto index : indices) {
+        const auto position = load_position(positions, positions_stride, index);
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+
+    result.center = (min + max) * 0.5f;
+
+    for (const auto index : indices) {
+        result.radius = std::max(result.radius, glm::length(load_position(positions, positions_stride, index) - result.center));
+    }
+
+    // the axis is the average of unit normals, degenerate triangles face nowhere and are skipped.
+    std::vector<glm::vec3> normals{};
+    normals.reserve(indices.size() / 3);
+
+    glm::vec3 axis{0};
+
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const auto p0 = load_position(positions, positions_stride, indices[i]);
+        const auto p1 = load_position(positions, positions_stride, indices[i + 1]);
+        const auto p2 = load_position(positions, positions_stride, indices[i + 2]);
+
+        const auto normal = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(normal);
+
+        if (length > 0) {
+            normals.emplace_back(normal / length);
+            axis += normals.back();
+        }
+    }
+
+    const float axis_length = glm::length(axis);
+
+    if (normals.empty() || axis_length <= std::numeric_limits<float>::epsilon()) {
+        return result;
+    }
+
+    axis = axis / axis_length;
+
+    float min_dot = 1;
+
+    for (const auto& normal : normals) {
+        min_dot = std::min(min_dot, glm::dot(normal, axis));
+    }
+
+    // the cone of normals is widened by 90 degrees to the cone of back facing view directions, cos(a + 90) = -sin(a).
+    // wide cones are almost never culled, so they aren't tested at all.
+    if (min_dot <= 0.1f) {
+        return result;
+    }
+
+    result.cone_axis = axis;
+    result.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+
+    return result;
+}
+
+
+simplification_result sandbox::gltf::simplify(
+    std::span<const uint32_t> indices,
+    const uint8_t* positions,
+    size_t positions_stride,
+    uint64_t vertices_count,
+    size_t target_indices_count,
+    float max_error,
+    const std::function<bool(uint32_t from, uint32_t to)>& can_collapse)
+{
+    CHECK_MSG(indices.size() % 3 == 0, "Indices are not a triangle list.");
+
+    constexpr uint32_t no_vertex = uint32_t(-1);
+
+    simplification_result result{.indices = std::vector<uint32_t>(indices.begin(), indices.end())};
+
+    const size_t target_triangles_count = target_indices_count / 3;
+
+    if (result.indices.size() / 3 <= target_triangles_count) {
+        return result;
+    }
+
+    std::vector<glm::vec3> float_positions(vertices_count);
+
+    for (uint32_t i = 0; i < vertices_count; ++i) {
+        float_positions[i] = load_position(positions, positions_stride, i);
+    }
+
+    const auto locked = get_locked_vertices(indices, float_positions);
+
+    std::vector<quadric> quadrics(vertices_count);
+
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const auto& p0 = float_positions[indices[i]];
+        const auto& p1 = float_positions[indices[i + 1]];
+        const auto& p2 = float_positions[indices[i + 2]];
+
+        const auto normal = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(normal);
+
+        if (length <= 0) {
+            continue;
+        }
+
+        const auto unit_normal = normal / length;
+        const auto plane = quadric::from_plane(unit_normal, -glm::dot(unit_normal, p0), length * 0.5f);
+
+        for (uint32_t j = 0; j < 3; ++j) {
+            quadrics[indices[i + j]] += plane;
+        }
+    }
+
+    const double max_error_squared = double(max_error) * max_error;
+    double result_error = 0;
+
+    std::vector<uint32_t> targets(vertices_count);
+    std::vector<double> costs(vertices_count);
+    std::vector<uint32_t> remap(vertices_count);
+    std::vector<bool> touched(vertices_count);
+    std::vector<uint32_t> candidates{};
+
+    // every pass collapses independent edges in order of their cost, then triangles are rebuilt and costs are updated.
+    while (result.indices.size() / 3 > target_triangles_count) {
+        const size_t triangles_count = result.indices.size() / 3;
+
+        vertex_adjacency adjacency{result.indices, vertices_count};
+
+        std::fill(targets.begin(), targets.end(), no_vertex);
+        std::fill(costs.begin(), costs.end(), std::numeric_limits<double>::max());
+
+        // the cheapest collapse of every vertex along its edges.
+        for (size_t i = 0; i < result.indices.size(); i += 3) {
+            for (uint32_t j = 0; j < 3; ++j) {
+                const auto a = result.indices[i + j];
+                const auto b = result.indices[i + (j + 1) % 3];
+
+                for (const auto& [from, to] : {std::pair{a, b}, std::pair{b, a}}) {
+                    if (locked[from] || from == to || (can_collapse && !can_collapse(from, to))) {
+                        continue;
+                    }
+
+                    const double cost = quadrics[from].get_error(float_positions[to]);
+
+                    if (cost < costs[from]) {
+                        costs[from] = cost;
+                        targets[from] = to;
+                    }
+                }
+            }
+        }
+
+        candidates.clear();
+
+        for (uint32_t i = 0; i < vertices_count; ++i) {
+            if (targets[i] != no_vertex && costs[i] <= max_error_squared) {
+                candidates.emplace_back(i);
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [&costs](uint32_t lhs, uint32_t rhs) {
+            return costs[lhs] < costs[rhs];
+        });
+
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+
+        size_t removed_triangles = 0;
+        size_t collapses_count = 0;
+
+        for (const auto from : candidates) {
+            const auto to = targets[from];
+
+            // collapses of a pass don't share triangles, so flips are tested against final positions.
+            if (touched[from] || touched[to] || flips_triangles(result.indices, adjacency.get(from), float_positions, from, to)) {
+                continue;
+            }
+
+            for (const auto triangle : adjacency.get(from)) {
+                const uint32_t* vertices = result.indices.data() + size_t(triangle) * 3;
+
+                for (uint32_t i = 0; i < 3; ++i) {
+                    touched[vertices[i]] = true;
+                }
+
+                if (vertices[0] == to || vertices[1] == to || vertices[2] == to) {
+                    ++removed_triangles;
+                }
+            }
+
+            remap[from] = to;
+            quadrics[to] += quadrics[from];
+            result_error = std::max(result_error, costs[from]);
+            ++collapses_count;
+
+            if (triangles_count - removed_triangles <= target_triangles_count) {
+                break;
+            }
+        }
+
+        if (collapses_count == 0) {
+            break;
+        }
+
+        size_t output = 0;
+
+        for (size_t i = 0; i < result.indices.size(); i += 3) {
+            const auto a = remap[result.indices[i]];
+            const auto b = remap[result.indices[i + 1]];
+            const auto c = remap[result.indices[i + 2]];
+
+            if (a != b && b != c && a != c) {
+                result.indices[output++] = a;
+                result.indices[output++] = b;
+                result.indices[output++] = c;
+            }
+        }
+
+        result.indices.resize(output);
+    }
+
+    result.error = static_cast<float>(std::sqrt(result_error));
+
+    return result;
+}
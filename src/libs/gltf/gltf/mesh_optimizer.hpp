@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace sandbox::gltf
+{
+    // post-transform cache efficiency of a triangle list. acmr is transformed vertices per triangle, 0.5 at best and 3 at
+    // worst. atvr is transformed vertices per referenced vertex, 1 at best.
+    struct vertex_cache_statistics
+    {
+        uint64_t triangles{0};
+        uint64_t vertices{0};
+        uint64_t transformed_vertices{0};
+
+        float get_acmr() const;
+        float get_atvr() const;
+
+        vertex_cache_statistics& operator+=(const vertex_cache_statistics&);
+    };
+
+    struct mesh_optimization_statistics
+    {
+        vertex_cache_statistics before{};
+        vertex_cache_statistics after{};
+    };
+
+    // simulates a fifo cache of the given size, it is close to caches of current gpus.
+    vertex_cache_statistics analyze_vertex_cache(std::span<const uint32_t> indices, uint64_t vertices_count, uint32_t cache_size = 16);
+
+    // reorders triangles so they reuse vertices of recently drawn ones. it is the linear speed algorithm of Tom Forsyth,
+    // the result doesn't depend on the exact cache size of the gpu.
+    void optimize_vertex_cache(std::span<uint32_t> indices, uint64_t vertices_count);
+
+    // reorders clusters of cache optimized triangles, so triangles which face outward of the mesh are drawn first and
+    // occlude the rest. clusters are split while their acmr grows by no more than threshold times.
+    // positions are float triples which are stride bytes apart.
+    void optimize_overdraw(
+        std::span<uint32_t> indices,
+        const uint8_t* positions,
+        size_t positions_stride,
+        uint64_t vertices_count,
+        float threshold = 1.05f);
+
+    // numbers vertices in the order the indices use them first and remaps the indices, so vertices are fetched
+    // sequentially. returns the new index of every old vertex, unused vertices go after used ones.
+    std::vector<uint32_t> optimize_vertex_fetch(std::span<uint32_t> indices, uint64_t vertices_count);
+
+    // triangles of a cluster are contiguous in indices, so visible clusters are drawn by copying their index ranges.
+    struct index_cluster
+    {
+        uint32_t first_triangle{0};
+        uint32_t triangles_count{0};
+    };
+
+    // sphere around vertices of a cluster and a cone around normals of its triangles. the cluster is backfacing for a
+    // camera if dot(center - camera, cone_axis) >= cone_cutoff * length(center - camera) + radius.
+    struct cluster_bounds
+    {
+        glm::vec3 center{0};
+        float radius{0};
+        glm::vec3 cone_axis{0};
+        // clusters which normals are spread over a hemisphere get 1, so they are never backfacing.
+        float cone_cutoff{1};
+    };
+
+    // groups triangles into clusters of at most max_vertices vertices and max_triangles triangles and reorders indices,
+    // so every cluster is a contiguous range. clusters grow by adjacent triangles which add the fewest vertices, so they
+    // stay compact for culling and keep cache locality of the input order.
+    std::vector<index_cluster> build_clusters(
+        std::span<uint32_t> indices,
+        uint64_t vertices_count,
+        uint32_t max_vertices = 64,
+        uint32_t max_triangles = 124);
+
+    // indices are the triangles of one cluster, positions are float triples which are stride bytes apart.
+    cluster_bounds get_cluster_bounds(std::span<const uint32_t> indices, const uint8_t* positions, size_t positions_stride);
+
+    struct simplification_result
+    {
+        std::vector<uint32_t> indices{};
+        // the largest distance which collapses moved the surface by, in units of positions.
+        float error{0};
+    };
+
+    // collapses edges by the quadric error metric of Garland and Heckbert until count of indices drops to the target or
+    // the next collapse would move the surface further than max_error. vertices are only removed and never moved, so
+    // attributes of the rest, e.g. skin weights, stay exact and the result indexes the same vertices. vertices on borders
+    // and on attribute seams, i.e. vertices which share their position with others, are kept. can_collapse may forbid
+    // removing a vertex in favor of another one, e.g. if their skin weights differ.
+    simplification_result simplify(
+        std::span<const uint32_t> indices,
+        const uint8_t* positions,
+        size_t positions_stride,
+        uint64_t vertices_count,
+        size_t target_indices_count,
+        float max_error,
+        const std::function<bool(uint32_t from, uint32_t to)>& can_collapse = {});
+} // namespace sandbox::gltf
@@ -0,0 +1,729 @@
+#include "meshopt_decoder.hpp"
+
+#include <utils/conditions_helpers.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SANDBOX_MESHOPT_SSE2 1
+    #include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define SANDBOX_MESHOPT_NEON 1
+    #include <arm_neon.h>
+#endif
+
+using namespace sandbox::gltf;
+
+namespace
+{
+    constexpr uint8_t vertex_header = 0xa0;
+    constexpr uint8_t triangles_header = 0xe0;
+    constexpr uint8_t indices_header = 0xd0;
+
+    constexpr size_t byte_group_size = 16;
+    // the longest encoded group is 16 bytes, the tail of at least 32 bytes keeps this much data after every group.
+    constexpr size_t byte_group_decode_limit = 24;
+    constexpr size_t vertex_block_size_bytes = 8192;
+    constexpr size_t vertex_block_max_size = 256;
+    constexpr size_t vertex_tail_max_size = 32;
+    constexpr size_t triangles_tail_size = 16;
+    constexpr size_t indices_tail_size = 4;
+
+
+    size_t get_vertex_block_size(size_t byte_stride)
+    {
+        const size_t result = (vertex_block_size_bytes / byte_stride) & ~(byte_group_size - 1);
+        return std::min(result, vertex_block_max_size);
+    }
+
+
+    // values of Bits bits are packed from the high bits of every byte, the max value means that the value follows as a whole byte.
+    template<uint32_t Bits>
+    const uint8_t* decode_bits_group(const uint8_t* src, uint8_t* dst)
+    {
+        constexpr uint32_t values_per_byte = 8 / Bits;
+        constexpr uint32_t escape = (1u << Bits) - 1;
+
+        const uint8_t* packed = src;
+        const uint8_t* extra = src + byte_group_size / values_per_byte;
+
+        for (size_t i = 0; i < byte_group_size; ++i) {
+            const uint32_t shift = 8 - Bits - uint32_t(i % values_per_byte) * Bits;
+            const uint8_t value = (packed[i / values_per_byte] >> shift) & escape;
+
+            if (value == escape) {
+                dst[i] = *extra++;
+            } else {
+                dst[i] = value;
+            }
+        }
+
+        return extra;
+    }
+
+
+    const uint8_t* decode_bytes_group(const uint8_t* src, uint8_t* dst, uint32_t bits_log2)
+    {
+        switch (bits_log2) {
+            case 0:
+                std::memset(dst, 0, byte_group_size);
+                return src;
+            case 1:
+                return decode_bits_group<2>(src, dst);
+            case 2:
+                return decode_bits_group<4>(src, dst);
+            default:
+                std::memcpy(dst, src, byte_group_size);
+                return src + byte_group_size;
+        }
+    }
+
+
+    // one byte of every vertex of the block, size is aligned to the group size.
+    const uint8_t* decode_bytes(const uint8_t* src, const uint8_t* src_end, uint8_t* dst, size_t size)
+    {
+        const size_t header_size = (size / byte_group_size + 3) / 4;
+        CHECK_MSG(size_t(src_end - src) >= header_size, "Bad meshopt vertex data.");
+
+        const uint8_t* header = src;
+        src += header_size;
+
+        for (size_t i = 0; i < size; i += byte_group_size) {
+            CHECK_MSG(size_t(src_end - src) >= byte_group_decode_limit, "Bad meshopt vertex data.");
+
+            const size_t group = i / byte_group_size;
+            const uint32_t bits_log2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+
+            src = decode_bytes_group(src, dst + i, bits_log2);
+        }
+
+        return src;
+    }
+
+
+    // turns zigzag encoded deltas into values in place, returns the last value.
+    uint8_t accumulate_deltas(uint8_t* values, size_t count, size_t aligned_count, uint8_t previous)
+    {
+#if defined(SANDBOX_MESHOPT_SSE2)
+        __m128i last = _mm_set1_epi8(char(previous));
+
+        for (size_t i = 0; i < aligned_count; i += byte_group_size) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+
+            const __m128i half = _mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(0x7f));
+            const __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi8(1)));
+            v = _mm_xor_si128(half, sign);
+
+            // prefix sum over 16 vertices in 4 steps.
+            v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+            v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+            v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+            v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+            v = _mm_add_epi8(v, last);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), v);
+
+            const __m128i high = _mm_shufflehi_epi16(_mm_unpackhi_epi8(v, v), 0xff);
+            last = _mm_shuffle_epi32(high, 0xff);
+        }
+#elif defined(SANDBOX_MESHOPT_NEON)
+        uint8x16_t last = vdupq_n_u8(previous);
+        const uint8x16_t zero = vdupq_n_u8(0);
+
+        for (size_t i = 0; i < aligned_count; i += byte_group_size) {
+            uint8x16_t v = vld1q_u8(values + i);
+
+            const uint8x16_t sign = vsubq_u8(zero, vandq_u8(v, vdupq_n_u8(1)));
+            v = veorq_u8(vshrq_n_u8(v, 1), sign);
+
+            v = vaddq_u8(v, vextq_u8(zero, v, 15));
+            v = vaddq_u8(v, vextq_u8(zero, v, 14));
+            v = vaddq_u8(v, vextq_u8(zero, v, 12));
+            v = vaddq_u8(v, vextq_u8(zero, v, 8));
+            v = vaddq_u8(v, last);
+
+            vst1q_u8(values + i, v);
+
+            last = vdupq_laneq_u8(v, 15);
+        }
+#else
+        for (size_t i = 0; i < count; ++i) {
+            const uint8_t delta = uint8_t(-(values[i] & 1)) ^ uint8_t(values[i] >> 1);
+            previous = uint8_t(previous + delta);
+            values[i] = previous;
+        }
+#endif
+
+        return values[count - 1];
+    }
+
+
+    const uint8_t* decode_vertex_block(
+        const uint8_t* src,
+        const uint8_t* src_end,
+        uint8_t* dst,
+        size_t count,
+        size_t byte_stride,
+        uint8_t* last_vertex)
+    {
+        std::array<uint8_t, vertex_block_max_size> values;
+        const size_t aligned_count = (count + byte_group_size - 1) & ~(byte_group_size - 1);
+
+        // every byte of the vertex is stored as a separate stream of deltas.
+        for (size_t k = 0; k < byte_stride; ++k) {
+            src = decode_bytes(src, src_end, values.data(), aligned_count);
+            last_vertex[k] = accumulate_deltas(values.data(), count, aligned_count, last_vertex[k]);
+
+            uint8_t* dst_byte = dst + k;
+
+            for (size_t i = 0; i < count; ++i, dst_byte += byte_stride) {
+                *dst_byte = values[i];
+            }
+        }
+
+        return src;
+    }
+
+
+    uint32_t decode_vbyte(const uint8_t*& src)
+    {
+        const uint8_t lead = *src++;
+
+        if (lead < 128) {
+            return lead;
+        }
+
+        uint32_t result = lead & 127;
+        uint32_t shift = 7;
+
+        for (size_t i = 0; i < 4; ++i) {
+            const uint8_t group = *src++;
+            result |= uint32_t(group & 127) << shift;
+            shift += 7;
+
+            if (group < 128) {
+                break;
+            }
+        }
+
+        return result;
+    }
+
+
+    uint32_t decode_index(const uint8_t*& src, uint32_t last)
+    {
+        const uint32_t v = decode_vbyte(src);
+        const uint32_t delta = (v >> 1) ^ uint32_t(-int32_t(v & 1));
+
+        return last + delta;
+    }
+
+
+    // fifo of recently seen edges and vertices. the decoder has to push exactly what the encoder has pushed.
+    struct triangles_fifo
+    {
+        std::array<std::array<uint32_t, 2>, 16> edges;
+        std::array<uint32_t, 16> vertices;
+        uint32_t edges_offset{0};
+        uint32_t vertices_offset{0};
+
+        triangles_fifo()
+        {
+            reset();
+        }
+
+        void reset()
+        {
+            std::memset(edges.data(), 0xff, sizeof(edges));
+            std::memset(vertices.data(), 0xff, sizeof(vertices));
+            edges_offset = 0;
+            vertices_offset = 0;
+        }
+
+        void push_edge(uint32_t a, uint32_t b)
+        {
+            edges[edges_offset] = {a, b};
+            edges_offset = (edges_offset + 1) & 15;
+        }
+
+        void push_vertex(uint32_t v, bool condition = true)
+        {
+            vertices[vertices_offset] = v;
+            vertices_offset = (vertices_offset + uint32_t(condition)) & 15;
+        }
+    };
+
+
+    template<typename T>
+    void decode_triangles(const uint8_t* src, size_t src_size, T* dst, size_t count)
+    {
+        CHECK_MSG(count % 3 == 0, "Bad meshopt triangles count.");
+        CHECK_MSG(src_size >= 1 + count / 3 + triangles_tail_size, "Bad meshopt triangles data.");
+        CHECK_MSG((src[0] & 0xf0) == triangles_header, "Bad meshopt triangles header.");
+
+        const uint32_t version = src[0] & 0x0f;
+        CHECK_MSG(version <= 1, "Unsupported meshopt triangles version.");
+
+        triangles_fifo fifo{};
+
+        uint32_t next = 0;
+        uint32_t last = 0;
+
+        // version 1 encodes +-1 deltas of free indices in the edge code.
+        const int32_t fec_max = version >= 1 ? 13 : 15;
+
+        const uint8_t* code = src + 1;
+        const uint8_t* data = code + count / 3;
+        const uint8_t* data_safe_end = src + src_size - triangles_tail_size;
+        const uint8_t* codeaux_table = data_safe_end;
+
+        for (size_t i = 0; i < count; i += 3) {
+            CHECK_MSG(data <= data_safe_end, "Bad meshopt triangles data.");
+
+            const uint8_t codetri = *code++;
+            uint32_t a;
+            uint32_t b;
+            uint32_t c;
+
+            if (codetri < 0xf0) {
+                // the triangle shares an edge with one of the recent triangles.
+                const auto& edge = fifo.edges[(fifo.edges_offset - 1 - (codetri >> 4)) & 15];
+                a = edge[0];
+                b = edge[1];
+
+                const int32_t fec = codetri & 15;
+
+                if (fec < fec_max) {
+                    c = fec == 0 ? next++ : fifo.vertices[(fifo.vertices_offset - 1 - fec) & 15];
+                    fifo.push_vertex(c, fec == 0);
+                } else {
+                    // fec - (fec ^ 3) turns 13 and 14 into -1 and 1.
+                    c = last = fec != 15 ? last + uint32_t(fec - (fec ^ 3)) : decode_index(data, last);
+                    fifo.push_vertex(c);
+                }
+
+                fifo.push_edge(c, b);
+                fifo.push_edge(a, c);
+            } else {
+                int32_t fea;
+                int32_t feb;
+                int32_t fec;
+
+                if (codetri < 0xfe) {
+                    // the common vertex combinations are looked up in the table at the end of the data.
+                    const uint8_t codeaux = codeaux_table[codetri & 15];
+                    fea = 0;
+                    feb = codeaux >> 4;
+                    fec = codeaux & 15;
+                } else {
+                    const uint8_t codeaux = *data++;
+                    fea = codetri == 0xfe ? 0 : 15;
+                    feb = codeaux >> 4;
+                    fec = codeaux & 15;
+
+                    // zero codeaux restarts index numbering.
+                    if (codeaux == 0) {
+                        next = 0;
+                    }
+                }
+
+                // the next indices are taken in order before free indices are read.
+                a = fea == 0 ? next++ : 0;
+                b = feb == 0 ? next++ : fifo.vertices[(fifo.vertices_offset - feb) & 15];
+                c = fec == 0 ? next++ : fifo.vertices[(fifo.vertices_offset - fec) & 15];
+
+                if (fea == 15) {
+                    a = last = decode_index(data, last);
+                }
+
+                if (feb == 15) {
+                    b = last = decode_index(data, last);
+                }
+
+                if (fec == 15) {
+                    c = last = decode_index(data, last);
+                }
+
+                fifo.push_vertex(a);
+                fifo.push_vertex(b, feb == 0 || feb == 15);
+                fifo.push_vertex(c, fec == 0 || fec == 15);
+
+                fifo.push_edge(b, a);
+                fifo.push_edge(c, b);
+                fifo.push_edge(a, c);
+            }
+
+            dst[i + 0] = T(a);
+            dst[i + 1] = T(b);
+            dst[i + 2] = T(c);
+        }
+
+        CHECK_MSG(data == data_safe_end, "Bad meshopt triangles data.");
+    }
+
+
+    template<typename T>
+    void decode_indices(const uint8_t* src, size_t src_size, T* dst, size_t count)
+    {
+        CHECK_MSG(src_size >= 1 + count + indices_tail_size, "Bad meshopt indices data.");
+        CHECK_MSG((src[0] & 0xf0) == indices_header, "Bad meshopt indices header.");
+        CHECK_MSG((src[0] & 0x0f) <= 1, "Unsupported meshopt indices version.");
+
+        const uint8_t* data = src + 1;
+        const uint8_t* data_safe_end = src + src_size - indices_tail_size;
+
+        // every index is a delta from one of two previous baselines, the lowest bit selects the baseline.
+        std::array<uint32_t, 2> last{};
+
+        for (size_t i = 0; i < count; ++i) {
+            CHECK_MSG(data < data_safe_end, "Bad meshopt indices data.");
+
+            uint32_t v = decode_vbyte(data);
+            const uint32_t baseline = v & 1;
+            v >>= 1;
+
+            const uint32_t delta = (v >> 1) ^ uint32_t(-int32_t(v & 1));
+            last[baseline] += delta;
+
+            dst[i] = T(last[baseline]);
+        }
+
+        CHECK_MSG(data == data_safe_end, "Bad meshopt indices data.");
+    }
+
+
+    int32_t round_to_int(float value)
+    {
+        return int32_t(value + (value >= 0.f ? 0.5f : -0.5f));
+    }
+
+
+    template<typename T>
+    void decode_octahedral(T* element, float max)
+    {
+        float x = float(element[0]);
+        float y = float(element[1]);
+        // z keeps 1 in the same precision, w is not filtered.
+        const float z = float(element[2]) - std::abs(x) - std::abs(y);
+
+        // unfold the lower hemisphere.
+        const float t = z >= 0.f ? 0.f : z;
+        x += x >= 0.f ? t : -t;
+        y += y >= 0.f ? t : -t;
+
+        const float s = max / std::sqrt(x * x + y * y + z * z);
+
+        element[0] = T(round_to_int(x * s));
+        element[1] = T(round_to_int(y * s));
+        element[2] = T(round_to_int(z * s));
+    }
+
+
+    void decode_quaternion(int16_t* element)
+    {
+        const float scale = 1.f / std::sqrt(2.f);
+
+        // the lowest bits of w keep the index of the dropped component, the rest keeps the scale.
+        const float ss = scale / float(element[3] | 3);
+
+        const float x = float(element[0]) * ss;
+        const float y = float(element[1]) * ss;
+        const float z = float(element[2]) * ss;
+        const float ww = 1.f - x * x - y * y - z * z;
+        const float w = std::sqrt(std::max(ww, 0.f));
+
+        const int32_t qc = element[3] & 3;
+
+        element[(qc + 1) & 3] = int16_t(round_to_int(x * 32767.f));
+        element[(qc + 2) & 3] = int16_t(round_to_int(y * 32767.f));
+        element[(qc + 3) & 3] = int16_t(round_to_int(z * 32767.f));
+        element[(qc + 0) & 3] = int16_t(round_to_int(w * 32767.f));
+    }
+
+
+    uint32_t decode_exponential(uint32_t v)
+    {
+        // 24 bit signed mantissa and 8 bit signed exponent, ldexp without a call.
+        const int32_t m = int32_t(v << 8) >> 8;
+        const int32_t e = int32_t(v) >> 24;
+
+        const float scale = std::bit_cast<float>(uint32_t(e + 127) << 23);
+        return std::bit_cast<uint32_t>(scale * float(m));
+    }
+
+
+#ifdef SANDBOX_MESHOPT_SSE2
+    __m128i round_to_int_sse2(__m128 value)
+    {
+        const __m128 half = _mm_or_ps(_mm_set1_ps(0.5f), _mm_and_ps(value, _mm_set1_ps(-0.f)));
+        return _mm_cvttps_epi32(_mm_add_ps(value, half));
+    }
+
+
+    template<typename T>
+    void decode_octahedral_sse2(uint8_t* data, size_t byte_stride, float max)
+    {
+        alignas(16) std::array<int32_t, 4> xs;
+        alignas(16) std::array<int32_t, 4> ys;
+        alignas(16) std::array<int32_t, 4> zs;
+
+        for (size_t j = 0; j < 4; ++j) {
+            const auto* element = reinterpret_cast<const T*>(data + j * byte_stride);
+            xs[j] = element[0];
+            ys[j] = element[1];
+            zs[j] = element[2];
+        }
+
+        const __m128 sign_mask = _mm_set1_ps(-0.f);
+
+        __m128 x = _mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(xs.data())));
+        __m128 y = _mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(ys.data())));
+        __m128 z = _mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(zs.data())));
+
+        z = _mm_sub_ps(_mm_sub_ps(z, _mm_andnot_ps(sign_mask, x)), _mm_andnot_ps(sign_mask, y));
+
+        const __m128 t = _mm_min_ps(z, _mm_setzero_ps());
+        x = _mm_add_ps(x, _mm_xor_ps(t, _mm_and_ps(x, sign_mask)));
+        y = _mm_add_ps(y, _mm_xor_ps(t, _mm_and_ps(y, sign_mask)));
+
+        const __m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        const __m128 s = _mm_div_ps(_mm_set1_ps(max), _mm_sqrt_ps(length_squared));
+
+        _mm_store_si128(reinterpret_cast<__m128i*>(xs.data()), round_to_int_sse2(_mm_mul_ps(x, s)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(ys.data()), round_to_int_sse2(_mm_mul_ps(y, s)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(zs.data()), round_to_int_sse2(_mm_mul_ps(z, s)));
+
+        for (size_t j = 0; j < 4; ++j) {
+            auto* element = reinterpret_cast<T*>(data + j * byte_stride);
+            element[0] = T(xs[j]);
+            element[1] = T(ys[j]);
+            element[2] = T(zs[j]);
+        }
+    }
+
+
+    void decode_quaternion_sse2(int16_t* elements)
+    {
+        alignas(16) std::array<int32_t, 4> xs;
+        alignas(16) std::array<int32_t, 4> ys;
+        alignas(16) std::array<int32_t, 4> zs;
+        alignas(16) std::array<int32_t, 4> ws;
+
+        for (size_t j = 0; j < 4; ++j) {
+            xs[j] = elements[j * 4 + 0];
+            ys[j] = elements[j * 4 + 1];
+            zs[j] = elements[j * 4 + 2];
+            ws[j] = elements[j * 4 + 3];
+        }
+
+        const __m128i w_bits = _mm_load_si128(reinterpret_cast<const __m128i*>(ws.data()));
+        const __m128 ss = _mm_div_ps(_mm_set1_ps(1.f / std::sqrt(2.f)), _mm_cvtepi32_ps(_mm_or_si128(w_bits, _mm_set1_epi32(3))));
+
+        const __m128 x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(xs.data()))), ss);
+        const __m128 y = _mm_mul_ps(_mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(ys.data()))), ss);
+        const __m128 z = _mm_mul_ps(_mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(zs.data()))), ss);
+
+        const __m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        const __m128 w = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(1.f), length_squared), _mm_setzero_ps()));
+
+        const __m128 max = _mm_set1_ps(32767.f);
+        alignas(16) std::array<int32_t, 4> qcs;
+        _mm_store_si128(reinterpret_cast<__m128i*>(qcs.data()), _mm_and_si128(w_bits, _mm_set1_epi32(3)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(xs.data()), round_to_int_sse2(_mm_mul_ps(x, max)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(ys.data()), round_to_int_sse2(_mm_mul_ps(y, max)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(zs.data()), round_to_int_sse2(_mm_mul_ps(z, max)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(ws.data()), round_to_int_sse2(_mm_mul_ps(w, max)));
+
+        for (size_t j = 0; j < 4; ++j) {
+            int16_t* element = elements + j * 4;
+            const int32_t qc = qcs[j];
+
+            element[(qc + 1) & 3] = int16_t(xs[j]);
+            element[(qc + 2) & 3] = int16_t(ys[j]);
+            element[(qc + 3) & 3] = int16_t(zs[j]);
+            element[(qc + 0) & 3] = int16_t(ws[j]);
+        }
+    }
+#endif
+
+
+    template<typename T>
+    void apply_octahedral_filter(uint8_t* data, size_t count, size_t byte_stride)
+    {
+        const float max = float((1 << (sizeof(T) * 8 - 1)) - 1);
+
+        size_t i = 0;
+
+#ifdef SANDBOX_MESHOPT_SSE2
+        for (; i + 4 <= count; i += 4) {
+            decode_octahedral_sse2<T>(data + i * byte_stride, byte_stride, max);
+        }
+#endif
+
+        for (; i < count; ++i) {
+            decode_octahedral(reinterpret_cast<T*>(data + i * byte_stride), max);
+        }
+    }
+
+
+    void apply_quaternion_filter(uint8_t* data, size_t count)
+    {
+        auto* elements = reinterpret_cast<int16_t*>(data);
+
+        size_t i = 0;
+
+#ifdef SANDBOX_MESHOPT_SSE2
+        for (; i + 4 <= count; i += 4) {
+            decode_quaternion_sse2(elements + i * 4);
+        }
+#endif
+
+        for (; i < count; ++i) {
+            decode_quaternion(elements + i * 4);
+        }
+    }
+
+
+    void apply_exponential_filter(uint8_t* data, size_t count)
+    {
+        auto* values = reinterpret_cast<uint32_t*>(data);
+
+        size_t i = 0;
+
+#if defined(SANDBOX_MESHOPT_SSE2)
+        for (; i + 4 <= count; i += 4) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+            const __m128i m = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+            const __m128i e = _mm_srai_epi32(v, 24);
+            const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(e, _mm_set1_epi32(127)), 23));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_castps_si128(_mm_mul_ps(scale, _mm_cvtepi32_ps(m))));
+        }
+#elif defined(SANDBOX_MESHOPT_NEON)
+        for (; i + 4 <= count; i += 4) {
+            const int32x4_t v = vreinterpretq_s32_u32(vld1q_u32(values + i));
+            const int32x4_t m = vshrq_n_s32(vshlq_n_s32(v, 8), 8);
+            const int32x4_t e = vshrq_n_s32(v, 24);
+            const float32x4_t scale = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(e, vdupq_n_s32(127)), 23));
+
+            vst1q_u32(values + i, vreinterpretq_u32_f32(vmulq_f32(scale, vcvtq_f32_s32(m))));
+        }
+#endif
+
+        for (; i < count; ++i) {
+            values[i] = decode_exponential(values[i]);
+        }
+    }
+} // namespace
+
+
+void sandbox::gltf::decode_meshopt_attributes(const uint8_t* src, size_t src_size, uint8_t* dst, size_t count, size_t byte_stride)
+{
+    CHECK_MSG(byte_stride > 0 && byte_stride <= 256 && byte_stride % 4 == 0, "Bad meshopt vertex stride.");
+
+    const size_t tail_size = std::max(byte_stride, vertex_tail_max_size);
+    CHECK_MSG(src_size >= 1 + tail_size, "Bad meshopt vertex data.");
+    CHECK_MSG((src[0] & 0xf0) == vertex_header, "Bad meshopt vertex header.");
+    CHECK_MSG((src[0] & 0x0f) == 0, "Unsupported meshopt vertex version.");
+
+    const uint8_t* data = src + 1;
+    const uint8_t* data_end = src + src_size;
+
+    // deltas of the first block are taken from the vertex stored at the end of the data.
+    std::array<uint8_t, 256> last_vertex;
+    std::memcpy(last_vertex.data(), data_end - byte_stride, byte_stride);
+
+    const size_t block_size = get_vertex_block_size(byte_stride);
+
+    for (size_t offset = 0; offset < count; offset += block_size) {
+        const size_t block_count = std::min(block_size, count - offset);
+        data = decode_vertex_block(data, data_end, dst + offset * byte_stride, block_count, byte_stride, last_vertex.data());
+    }
+
+    CHECK_MSG(size_t(data_end - data) == tail_size, "Bad meshopt vertex data.");
+}
+
+
+void sandbox::gltf::decode_meshopt_triangles(const uint8_t* src, size_t src_size, uint8_t* dst, size_t count, size_t byte_stride)
+{
+    if (byte_stride == sizeof(uint16_t)) {
+        decode_triangles(src, src_size, reinterpret_cast<uint16_t*>(dst), count);
+    } else if (byte_stride == sizeof(uint32_t)) {
+        decode_triangles(src, src_size, reinterpret_cast<uint32_t*>(dst), count);
+    } else {
+        throw std::runtime_error("Bad meshopt index stride.");
+    }
+}
+
+
+void sandbox::gltf::decode_meshopt_indices(const uint8_t* src, size_t src_size, uint8_t* dst, size_t count, size_t byte_stride)
+{
+    if (byte_stride == sizeof(uint16_t)) {
+        decode_indices(src, src_size, reinterpret_cast<uint16_t*>(dst), count);
+    } else if (byte_stride == sizeof(uint32_t)) {
+        decode_indices(src, src_size, reinterpret_cast<uint32_t*>(dst), count);
+    } else {
+        throw std::runtime_error("Bad meshopt index stride.");
+    }
+}
+
+
+void sandbox::gltf::apply_meshopt_filter(meshopt_compression_filter filter, uint8_t* data, size_t count, size_t byte_stride)
+{
+    switch (filter) {
+        case meshopt_compression_filter::none:
+            break;
+
+        case meshopt_compression_filter::octahedral:
+            if (byte_stride == 4) {
+                apply_octahedral_filter<int8_t>(data, count, byte_stride);
+            } else if (byte_stride == 8) {
+                apply_octahedral_filter<int16_t>(data, count, byte_stride);
+            } else {
+                throw std::runtime_error("Bad meshopt octahedral filter stride.");
+            }
+            break;
+
+        case meshopt_compression_filter::quaternion:
+            CHECK_MSG(byte_stride == 8, "Bad meshopt quaternion filter stride.");
+            apply_quaternion_filter(data, count);
+            break;
+
+        case meshopt_compression_filter::exponential:
+            CHECK_MSG(byte_stride % 4 == 0, "Bad meshopt exponential filter stride.");
+            apply_exponential_filter(data, count * byte_stride / 4);
+            break;
+    }
+}
+
+
+void sandbox::gltf::decode_meshopt_buffer_view(
+    meshopt_compression_mode mode,
+    meshopt_compression_filter filter,
+    const uint8_t* src,
+    size_t src_size,
+    uint8_t* dst,
+    size_t count,
+    size_t byte_stride)
+{
+    switch (mode) {
+        case meshopt_compression_mode::attributes:
+            decode_meshopt_attributes(src, src_size, dst, count, byte_stride);
+            apply_meshopt_filter(filter, dst, count, byte_stride);
+            break;
+
+        case meshopt_compression_mode::triangles:
+            CHECK_MSG(filter == meshopt_compression_filter::none, "Meshopt filters are allowed only for attributes.");
+            decode_meshopt_triangles(src, src_size, dst, count, byte_stride);
+            break;
+
+        case meshopt_compression_mode::indices:
+            CHECK_MSG(filter == meshopt_compression_filter::none, "Meshopt filters are allowed only for attributes.");
+            decode_meshopt_indices(src, src_size, dst, count, byte_stride);
+            break;
+    }
+}
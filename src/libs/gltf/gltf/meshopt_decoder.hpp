@@ -0,0 +1,30 @@
+#pragma once
+
+#include <gltf/utils.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sandbox::gltf
+{
+    // decoders of EXT_meshopt_compression buffer views. they write count elements of byte_stride bytes straight into dst,
+    // throw on malformed data and don't read past src_size, so a view from a broken file can't corrupt other data.
+    void decode_meshopt_buffer_view(
+        meshopt_compression_mode mode,
+        meshopt_compression_filter filter,
+        const uint8_t* src,
+        size_t src_size,
+        uint8_t* dst,
+        size_t count,
+        size_t byte_stride);
+
+    // vertex codec, byte_stride is a multiple of 4 up to 256.
+    void decode_meshopt_attributes(const uint8_t* src, size_t src_size, uint8_t* dst, size_t count, size_t byte_stride);
+    // triangle list codec, count is a multiple of 3 and byte_stride is 2 or 4.
+    void decode_meshopt_triangles(const uint8_t* src, size_t src_size, uint8_t* dst, size_t count, size_t byte_stride);
+    // index sequence codec, byte_stride is 2 or 4.
+    void decode_meshopt_indices(const uint8_t* src, size_t src_size, uint8_t* dst, size_t count, size_t byte_stride);
+
+    // filters are applied in place to vertices decoded by the vertex codec.
+    void apply_meshopt_filter(meshopt_compression_filter filter, uint8_t* data, size_t count, size_t byte_stride);
+} // namespace sandbox::gltf
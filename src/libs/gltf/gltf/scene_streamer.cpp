@@ -0,0 +1,303 @@
+#include "scene_streamer.hpp"
+
+#include <utils/conditions_helpers.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+using namespace sandbox;
+using namespace sandbox::gltf;
+using namespace sandbox::hal::render;
+
+
+scene_streamer::scene_streamer(
+    const gltf::model& mdl,
+    const vk_model_builder& builder,
+    std::shared_ptr<const vk_model_cache> cache,
+    const options& opts)
+    : m_model(mdl)
+    , m_builder(builder)
+    , m_cache(std::move(cache))
+    , m_options(opts)
+{
+    CHECK_MSG(m_options.low_water_mark >= 0 && m_options.low_water_mark <= 1, "Low water mark is not a part of the budget.");
+
+    // the registry keys gpu images by their pool, and pools of subtrees are destroyed on eviction.
+    m_builder.set_asset_registry(nullptr);
+}
+
+
+void scene_streamer::request_subtree(uint32_t node)
+{
+    CHECK_MSG(node < m_model.get_nodes().size(), "Bad node index.");
+
+    auto& tree = m_subtrees[node];
+
+    if (tree == nullptr) {
+        tree = std::make_unique<subtree>();
+    }
+
+    if (tree->requests++ > 0) {
+        return;
+    }
+
+    switch (tree->state) {
+        case subtree_state::pending:
+            m_pending.push_back(node);
+            break;
+        case subtree_state::resident:
+            m_lru.erase(tree->lru_position);
+            break;
+        case subtree_state::uploading:
+        case subtree_state::rejected:
+            break;
+    }
+}
+
+
+void scene_streamer::release_subtree(uint32_t node)
+{
+    const auto it = m_subtrees.find(node);
+    CHECK_MSG(it != m_subtrees.end() && it->second->requests > 0, "Subtree was not requested.");
+
+    auto& tree = *it->second;
+
+    if (--tree.requests > 0) {
+        return;
+    }
+
+    switch (tree.state) {
+        case subtree_state::pending:
+            m_pending.remove(node);
+            m_subtrees.erase(it);
+            break;
+        case subtree_state::rejected:
+            m_subtrees.erase(it);
+            break;
+        case subtree_state::resident:
+            m_lru.push_front(node);
+            tree.lru_position = m_lru.begin();
+            break;
+        case subtree_state::uploading:
+            // it goes to m_lru once the upload is finished.
+            break;
+    }
+}
+
+
+void scene_streamer::request_scene(uint32_t scene)
+{
+    CHECK_MSG(scene < m_model.get_scenes().size(), "Bad scene index.");
+
+    for (const auto node : m_model.get_scenes()[scene].get_nodes()) {
+        request_subtree(node);
+    }
+}
+
+
+void scene_streamer::release_scene(uint32_t scene)
+{
+    CHECK_MSG(scene < m_model.get_scenes().size(), "Bad scene index.");
+
+    for (const auto node : m_model.get_scenes()[scene].get_nodes()) {
+        release_subtree(node);
+    }
+}
+
+
+void scene_streamer::update()
+{
+    ++m_update;
+
+    for (auto& [node, tree] : m_subtrees) {
+        if (tree->state != subtree_state::uploading) {
+            continue;
+        }
+
+        const bool completed = std::all_of(tree->uploads.begin(), tree->uploads.end(), [](const avk::submit_handler& upload) {
+            return upload.is_completed();
+        });
+
+        if (!completed) {
+            continue;
+        }
+
+        tree->uploads.clear();
+        tree->state = subtree_state::resident;
+
+        if (tree->requests == 0) {
+            m_lru.push_front(node);
+            tree->lru_position = m_lru.begin();
+        }
+    }
+
+    // subtrees are uploaded in the order of requests, so a big one isn't starved by smaller ones requested after it.
+    while (!m_pending.empty()) {
+        const auto node = m_pending.front();
+        auto& tree = *m_subtrees.at(node);
+
+        if (!upload(node, tree)) {
+            // others wait until evictions or releases make room, a subtree which never fits would block them forever.
+            if (tree.gpu_size <= m_options.gpu_memory_budget) {
+                break;
+            }
+
+            reject(node, tree);
+        }
+
+        m_pending.pop_front();
+    }
+
+    evict_released(static_cast<uint64_t>(static_cast<double>(m_options.gpu_memory_budget) * m_options.low_water_mark));
+
+    std::erase_if(m_evicted, [this](const evicted_subtree& evicted) {
+        return m_update - evicted.update >= m_options.frames_in_flight;
+    });
+}
+
+
+const vk_model* scene_streamer::get_subtree(uint32_t node) const
+{
+    const auto it = m_subtrees.find(node);
+
+    if (it == m_subtrees.end() || it->second->state != subtree_state::resident) {
+        return nullptr;
+    }
+
+    return &it->second->model;
+}
+
+
+std::vector<std::pair<uint32_t, const vk_model*>> scene_streamer::get_resident_subtrees() const
+{
+    std::vector<std::pair<uint32_t, const vk_model*>> result{};
+
+    for (const auto& [node, tree] : m_subtrees) {
+        if (tree->requests > 0 && tree->state == subtree_state::resident) {
+            result.emplace_back(node, &tree->model);
+        }
+    }
+
+    return result;
+}
+
+
+scene_streamer::statistics scene_streamer::get_statistics() const
+{
+    const auto resident_subtrees = std::count_if(m_subtrees.begin(), m_subtrees.end(), [](const auto& tree) {
+        return tree.second->state == subtree_state::resident;
+    });
+
+    const auto rejected_subtrees = std::count_if(m_subtrees.begin(), m_subtrees.end(), [](const auto& tree) {
+        return tree.second->state == subtree_state::rejected;
+    });
+
+    return {
+        .gpu_memory_usage = m_gpu_memory_usage,
+        .gpu_memory_budget = m_options.gpu_memory_budget,
+        .resident_subtrees = static_cast<size_t>(resident_subtrees),
+        .pending_subtrees = m_pending.size(),
+        .rejected_subtrees = static_cast<size_t>(rejected_subtrees),
+        .evictions = m_evictions};
+}
+
+
+std::vector<bool> scene_streamer::get_subtree_meshes(uint32_t node) const
+{
+    std::vector<bool> result(m_model.get_meshes().size(), false);
+
+    for_each_subtree_node(m_model, node, [&result](const gltf::node& curr_node, int32_t) {
+        if (curr_node.get_mesh() >= 0) {
+            result[curr_node.get_mesh()] = true;
+        }
+    });
+
+    return result;
+}
+
+
+bool scene_streamer::upload(uint32_t node, subtree& tree)
+{
+    // the model is instantiated once, pools allocate memory only on submit, so a subtree which doesn't fit costs nothing.
+    if (tree.buffer_pool == nullptr) {
+        const auto meshes = get_subtree_meshes(node);
+
+        if (std::find(meshes.begin(), meshes.end(), true) == meshes.end()) {
+            tree.state = subtree_state::resident;
+            return true;
+        }
+
+        tree.buffer_pool = std::make_unique<avk::buffer_pool>();
+        tree.image_pool = std::make_unique<avk::image_pool>();
+        tree.model = m_builder.instantiate(m_cache, *tree.buffer_pool, *tree.image_pool, meshes);
+        tree.gpu_size = tree.model.get_memory_footprint().get_gpu_size();
+    }
+
+    uint64_t evictable_size = 0;
+
+    for (const auto released_node : m_lru) {
+        evictable_size += m_subtrees.at(released_node)->gpu_size;
+    }
+
+    // released subtrees are kept if evicting them doesn't make enough room anyway.
+    if (m_gpu_memory_usage - evictable_size + tree.gpu_size > m_options.gpu_memory_budget) {
+        return false;
+    }
+
+    evict_released(m_options.gpu_memory_budget - tree.gpu_size);
+
+    const auto footprint = tree.model.get_memory_footprint();
+
+    if (footprint.get_gpu_size() > footprint.textures.gpu) {
+        tree.uploads.emplace_back(tree.buffer_pool->submit(m_options.queue));
+    }
+
+    if (footprint.textures.gpu > 0) {
+        tree.uploads.emplace_back(tree.image_pool->submit(m_options.queue));
+    }
+
+    tree.state = subtree_state::uploading;
+    m_gpu_memory_usage += tree.gpu_size;
+
+    return true;
+}
+
+
+void scene_streamer::reject(uint32_t node, subtree& tree)
+{
+    spdlog::error(
+        "subtree of node {} needs {} bytes of gpu memory, it doesn't fit into the budget of {} bytes.",
+        node,
+        tree.gpu_size,
+        m_options.gpu_memory_budget);
+
+    // pools of the rejected subtree were never submitted, so nothing uses them.
+    tree.model = {};
+    tree.image_pool.reset();
+    tree.buffer_pool.reset();
+    tree.state = subtree_state::rejected;
+}
+
+
+void scene_streamer::evict(uint32_t node)
+{
+    const auto it = m_subtrees.find(node);
+    auto& tree = it->second;
+
+    m_lru.erase(tree->lru_position);
+    m_gpu_memory_usage -= tree->gpu_size;
+    ++m_evictions;
+
+    // frames which are in flight may still draw the subtree.
+    m_evicted.push_back({.update = m_update, .resources = std::move(tree)});
+    m_subtrees.erase(it);
+}
+
+
+void scene_streamer::evict_released(uint64_t max_usage)
+{
+    while (m_gpu_memory_usage > max_usage && !m_lru.empty()) {
+        evict(m_lru.back());
+    }
+}
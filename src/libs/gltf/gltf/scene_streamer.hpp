@@ -0,0 +1,124 @@
+#pragma once
+
+#include <gltf/gltf_vk.hpp>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace sandbox::gltf
+{
+    // uploads meshes and textures of requested node subtrees within a gpu memory budget. every subtree is a partial
+    // vk_model with its own pools, so evicting it frees its memory. subtrees which are not requested anymore stay
+    // resident until their memory is needed or the usage is above the low water mark, and are evicted in least recently
+    // used order then. subtrees which don't fit into the whole budget are rejected, so they don't block later requests.
+    // mesh and image indices of subtree models are the ones of the gltf model. subtrees shouldn't overlap,
+    // meshes and textures used by several resident subtrees are uploaded by each of them.
+    class scene_streamer
+    {
+    public:
+        struct options
+        {
+            uint64_t gpu_memory_budget{uint64_t(256) << 20};
+            // part of the budget which released subtrees are evicted down to on every update, so requests usually
+            // find room without evicting anything.
+            float low_water_mark{0.75f};
+            // evicted subtrees are destroyed after this count of updates, once frames which drew them are finished.
+            uint32_t frames_in_flight{2};
+            vk::QueueFlagBits queue{vk::QueueFlagBits::eGraphics};
+        };
+
+        struct statistics
+        {
+            uint64_t gpu_memory_usage{0};
+            uint64_t gpu_memory_budget{0};
+            size_t resident_subtrees{0};
+            size_t pending_subtrees{0};
+            size_t rejected_subtrees{0};
+            size_t evictions{0};
+        };
+
+        // the gltf model is used for its nodes and scenes only, so its payloads may be released.
+        scene_streamer(
+            const gltf::model& mdl,
+            const vk_model_builder& builder,
+            std::shared_ptr<const vk_model_cache> cache,
+            const options& opts);
+
+        // requests are counted, the subtree stays requested until it is released as many times as it was requested.
+        void request_subtree(uint32_t node);
+        void release_subtree(uint32_t node);
+        // requests root nodes of the scene.
+        void request_scene(uint32_t scene);
+        void release_scene(uint32_t scene);
+
+        // call it once a frame. uploads requested subtrees which fit into the budget in the order of requests, evicting
+        // released ones, evicts released subtrees down to the low water mark and destroys subtrees which were evicted
+        // frames_in_flight updates ago.
+        void update();
+
+        // nullptr until the subtree is uploaded.
+        const vk_model* get_subtree(uint32_t node) const;
+        // uploaded subtrees which are requested now with their root nodes.
+        std::vector<std::pair<uint32_t, const vk_model*>> get_resident_subtrees() const;
+
+        statistics get_statistics() const;
+
+    private:
+        enum class subtree_state
+        {
+            pending,
+            uploading,
+            resident,
+            // bigger than the whole budget, it stays so until it is released.
+            rejected
+        };
+
+        struct subtree
+        {
+            uint32_t requests{0};
+            subtree_state state{subtree_state::pending};
+            uint64_t gpu_size{0};
+
+            std::unique_ptr<hal::render::avk::buffer_pool> buffer_pool{};
+            std::unique_ptr<hal::render::avk::image_pool> image_pool{};
+            vk_model model{};
+            std::vector<hal::render::avk::submit_handler> uploads{};
+
+            // position in m_lru while the subtree is resident and not requested.
+            std::list<uint32_t>::iterator lru_position{};
+        };
+
+        struct evicted_subtree
+        {
+            uint64_t update{0};
+            std::unique_ptr<subtree> resources{};
+        };
+
+        std::vector<bool> get_subtree_meshes(uint32_t node) const;
+
+        bool upload(uint32_t node, subtree& tree);
+        void reject(uint32_t node, subtree& tree);
+        void evict(uint32_t node);
+        // evicts released subtrees in least recently used order until the usage is not above max_usage.
+        void evict_released(uint64_t max_usage);
+
+        const gltf::model& m_model;
+        vk_model_builder m_builder;
+        std::shared_ptr<const vk_model_cache> m_cache{};
+        options m_options{};
+
+        std::unordered_map<uint32_t, std::unique_ptr<subtree>> m_subtrees{};
+        // requested subtrees which are not uploaded yet, in the order of requests.
+        std::list<uint32_t> m_pending{};
+        // front is the most recently released subtree.
+        std::list<uint32_t> m_lru{};
+        std::vector<evicted_subtree> m_evicted{};
+
+        uint64_t m_update{0};
+        uint64_t m_gpu_memory_usage{0};
+        size_t m_evictions{0};
+    };
+} // namespace sandbox::gltf
@@ -1,8 +1,13 @@
 
 #include "utils.hpp"
 
+#include <utils/base64.hpp>
+#include <utils/conditions_helpers.hpp>
+#include <utils/static_string_map.hpp>
+
 #include <string>
 #include <stdexcept>
+#include <cctype>
 #include <cstring>
 
 
@@ -18,33 +23,101 @@ namespace
         *ptr += sizeof(T);
         return res;
     }
+
+    using namespace sandbox::gltf;
+
+    constexpr auto accessor_types = sandbox::utils::make_static_string_map<accessor_type>({
+        {accessor_type_value::ACCESSOR_TYPE_SCALAR, accessor_type::scalar},
+        {accessor_type_value::ACCESSOR_TYPE_VEC2, accessor_type::vec2},
+        {accessor_type_value::ACCESSOR_TYPE_VEC3, accessor_type::vec3},
+        {accessor_type_value::ACCESSOR_TYPE_VEC4, accessor_type::vec4},
+        {accessor_type_value::ACCESSOR_TYPE_MAT2, accessor_type::mat2},
+        {accessor_type_value::ACCESSOR_TYPE_MAT3, accessor_type::mat3},
+        {accessor_type_value::ACCESSOR_TYPE_MAT4, accessor_type::mat4},
+    });
+
+    constexpr auto attribute_paths = sandbox::utils::make_static_string_map<attribute_path>({
+        {attribute_path_value::ATTRIBUTE_PATH_POSITION, attribute_path::position},
+        {attribute_path_value::ATTRIBUTE_PATH_NORMAL, attribute_path::normal},
+        {attribute_path_value::ATTRIBUTE_PATH_TANGENT, attribute_path::tangent},
+        {attribute_path_value::ATTRIBUTE_PATH_TEXCOORD_0, attribute_path::texcoord_0},
+        {attribute_path_value::ATTRIBUTE_PATH_TEXCOORD_1, attribute_path::texcoord_1},
+        {attribute_path_value::ATTRIBUTE_PATH_COLOR_0, attribute_path::color_0},
+        {attribute_path_value::ATTRIBUTE_PATH_JOINTS_0, attribute_path::joints_0},
+        {attribute_path_value::ATTRIBUTE_PATH_WEIGHTS_0, attribute_path::weights_0},
+    });
+
+    constexpr auto animation_paths = sandbox::utils::make_static_string_map<animation_path>({
+        {animation_path_value::ANIMATION_PATH_ROTATION, animation_path::rotation},
+        {animation_path_value::ANIMATION_PATH_TRANSLATION, animation_path::translation},
+        {animation_path_value::ANIMATION_PATH_SCALE, animation_path::scale},
+        {animation_path_value::ANIMATION_PATH_WEIGHTS, animation_path::weights},
+    });
+
+    constexpr auto animation_interpolations = sandbox::utils::make_static_string_map<animation_interpolation>({
+        {animation_interpolation_value::ANIMATION_INTERPOLATION_LINEAR, animation_interpolation::linear},
+        {animation_interpolation_value::ANIMATION_INTERPOLATION_STEP, animation_interpolation::step},
+        {animation_interpolation_value::ANIMATION_INTERPOLATION_CUBIC_SPLINE, animation_interpolation::cubic_spline},
+    });
+
+    constexpr auto meshopt_compression_modes = sandbox::utils::make_static_string_map<meshopt_compression_mode>({
+        {meshopt_compression_mode_value::MESHOPT_COMPRESSION_MODE_ATTRIBUTES, meshopt_compression_mode::attributes},
+        {meshopt_compression_mode_value::MESHOPT_COMPRESSION_MODE_TRIANGLES, meshopt_compression_mode::triangles},
+        {meshopt_compression_mode_value::MESHOPT_COMPRESSION_MODE_INDICES, meshopt_compression_mode::indices},
+    });
+
+    constexpr auto meshopt_compression_filters = sandbox::utils::make_static_string_map<meshopt_compression_filter>({
+        {meshopt_compression_filter_value::MESHOPT_COMPRESSION_FILTER_NONE, meshopt_compression_filter::none},
+        {meshopt_compression_filter_value::MESHOPT_COMPRESSION_FILTER_OCTAHEDRAL, meshopt_compression_filter::octahedral},
+        {meshopt_compression_filter_value::MESHOPT_COMPRESSION_FILTER_QUATERNION, meshopt_compression_filter::quaternion},
+        {meshopt_compression_filter_value::MESHOPT_COMPRESSION_FILTER_EXPONENTIAL, meshopt_compression_filter::exponential},
+    });
+
+    constexpr auto alpha_modes = sandbox::utils::make_static_string_map<alpha_mode>({
+        {alpha_mode_value::ALPHA_MODE_OPAQUE, alpha_mode::opaque},
+        {alpha_mode_value::ALPHA_MODE_MASK, alpha_mode::mask},
+        {alpha_mode_value::ALPHA_MODE_BLEND, alpha_mode::blend},
+    });
+
+    constexpr auto camera_types = sandbox::utils::make_static_string_map<camera_type>({
+        {camera_type_value::CAMERA_TYPE_PERSPECTIVE, camera_type::perspective},
+        {camera_type_value::CAMERA_TYPE_ORTHOGRAPHIC, camera_type::orthographic},
+    });
+
+    constexpr auto image_mime_types = sandbox::utils::make_static_string_map<image_mime_type>({
+        {image_mime_type_value::IMAGE_MIME_TYPE_JPEG, image_mime_type::jpeg},
+        {image_mime_type_value::IMAGE_MIME_TYPE_PNG, image_mime_type::png},
+        {"", image_mime_type::undefined},
+    });
+
+    template<typename MapT>
+    auto find_value(const MapT& map, std::string_view value, const char* err_msg)
+    {
+        const auto result = map.find(value);
+
+        if (!result) {
+            throw std::runtime_error(err_msg + std::string(value));
+        }
+
+        return *result;
+    }
 } // namespace
 
 
 sandbox::gltf::accessor_type_value::accessor_type_value(const char* value)
+    : accessor_type_value(std::string_view{value})
 {
-    if (strcmp(ACCESSOR_TYPE_SCALAR, value) == 0) {
-        type = accessor_type::scalar;
-    } else if (strcmp(ACCESSOR_TYPE_VEC2, value) == 0) {
-        type = accessor_type::vec2;
-    } else if (strcmp(ACCESSOR_TYPE_VEC3, value) == 0) {
-        type = accessor_type::vec3;
-    } else if (strcmp(ACCESSOR_TYPE_VEC4, value) == 0) {
-        type = accessor_type::vec4;
-    } else if (strcmp(ACCESSOR_TYPE_MAT2, value) == 0) {
-        type = accessor_type::mat2;
-    } else if (strcmp(ACCESSOR_TYPE_MAT3, value) == 0) {
-        type = accessor_type::mat3;
-    } else if (strcmp(ACCESSOR_TYPE_MAT4, value) == 0) {
-        type = accessor_type::mat4;
-    } else {
-        throw std::runtime_error("Bad accessor type value " + std::string(value));
-    }
 }
 
 
 sandbox::gltf::accessor_type_value::accessor_type_value(const std::string& value)
-    : accessor_type_value(value.c_str())
+    : accessor_type_value(std::string_view{value})
+{
+}
+
+
+sandbox::gltf::accessor_type_value::accessor_type_value(std::string_view value)
+    : type(find_value(accessor_types, value, "Bad accessor type value "))
 {
 }
 
@@ -56,31 +129,19 @@ sandbox::gltf::accessor_type_value::operator sandbox::gltf::accessor_type() cons
 
 
 sandbox::gltf::attribute_path_value::attribute_path_value(const char* value)
+    : attribute_path_value(std::string_view{value})
 {
-    if (strcmp(ATTRIBUTE_PATH_POSITION, value) == 0) {
-        type = attribute_path::position;
-    } else if (strcmp(ATTRIBUTE_PATH_NORMAL, value) == 0) {
-        type = attribute_path::normal;
-    } else if (strcmp(ATTRIBUTE_PATH_TANGENT, value) == 0) {
-        type = attribute_path::tangent;
-    } else if (strcmp(ATTRIBUTE_PATH_TEXCOORD_0, value) == 0) {
-        type = attribute_path::texcoord_0;
-    } else if (strcmp(ATTRIBUTE_PATH_TEXCOORD_1, value) == 0) {
-        type = attribute_path::texcoord_1;
-    } else if (strcmp(ATTRIBUTE_PATH_COLOR_0, value) == 0) {
-        type = attribute_path::color_0;
-    } else if (strcmp(ATTRIBUTE_PATH_JOINTS_0, value) == 0) {
-        type = attribute_path::joints_0;
-    } else if (strcmp(ATTRIBUTE_PATH_WEIGHTS_0, value) == 0) {
-        type = attribute_path::weights_0;
-    } else {
-        throw std::runtime_error("Bad accessor type value " + std::string(value));
-    }
 }
 
 
 sandbox::gltf::attribute_path_value::attribute_path_value(const std::string& value)
-    : attribute_path_value(value.c_str())
+    : attribute_path_value(std::string_view{value})
+{
+}
+
+
+sandbox::gltf::attribute_path_value::attribute_path_value(std::string_view value)
+    : type(find_value(attribute_paths, value, "Bad attribute path "))
 {
 }
 
@@ -128,24 +189,101 @@ sandbox::gltf::glb_file sandbox::gltf::parse_glb_file(const uint8_t* data_ptr, s
 }
 
 
-sandbox::gltf::animation_path_value::animation_path_value(const char* value)
+std::vector<sandbox::gltf::json_member> sandbox::gltf::find_json_members(const uint8_t* json_data, size_t json_size)
 {
-    if (strcmp(ANIMATION_PATH_ROTATION, value) == 0) {
-        path = animation_path::rotation;
-    } else if (strcmp(ANIMATION_PATH_SCALE, value) == 0) {
-        path = animation_path::scale;
-    } else if (strcmp(ANIMATION_PATH_TRANSLATION, value) == 0) {
-        path = animation_path::translation;
-    } else if (strcmp(ANIMATION_PATH_WEIGHTS, value) == 0) {
-        path = animation_path::weights;
-    } else {
-        throw std::runtime_error("Bad accessor type value " + std::string(value));
+    const std::string_view json{reinterpret_cast<const char*>(json_data), json_size};
+    std::vector<json_member> result{};
+
+    // returns position after the closing quote.
+    auto skip_string = [&json](size_t pos) {
+        for (++pos; pos < json.size(); ++pos) {
+            if (json[pos] == '\\') {
+                ++pos;
+            } else if (json[pos] == '"') {
+                return pos + 1;
+            }
+        }
+        throw std::runtime_error("Bad json. Unterminated string.");
+    };
+
+    auto skip_spaces = [&json](size_t pos) {
+        while (pos < json.size() && std::isspace(static_cast<unsigned char>(json[pos]))) {
+            ++pos;
+        }
+        return pos;
+    };
+
+    size_t pos = skip_spaces(0);
+
+    if (pos >= json.size() || json[pos] != '{') {
+        throw std::runtime_error("Bad json. Top level value is not an object.");
+    }
+
+    pos = skip_spaces(pos + 1);
+
+    while (pos < json.size() && json[pos] != '}') {
+        if (json[pos] != '"') {
+            throw std::runtime_error("Bad json. Expected member name.");
+        }
+
+        const auto key_end = skip_string(pos);
+        const auto key = json.substr(pos + 1, key_end - pos - 2);
+
+        pos = skip_spaces(key_end);
+        if (pos >= json.size() || json[pos] != ':') {
+            throw std::runtime_error("Bad json. Expected ':'.");
+        }
+
+        const auto value_begin = skip_spaces(pos + 1);
+        size_t depth = 0;
+
+        for (pos = value_begin; pos < json.size(); ++pos) {
+            const char c = json[pos];
+
+            if (c == '"') {
+                pos = skip_string(pos) - 1;
+            } else if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (depth == 0) {
+                    break;
+                }
+                --depth;
+            } else if (c == ',' && depth == 0) {
+                break;
+            }
+        }
+
+        auto value_end = pos;
+        while (value_end > value_begin && std::isspace(static_cast<unsigned char>(json[value_end - 1]))) {
+            --value_end;
+        }
+
+        result.push_back({.key = key, .value = json.substr(value_begin, value_end - value_begin)});
+
+        if (pos < json.size() && json[pos] == ',') {
+            pos = skip_spaces(pos + 1);
+        }
     }
+
+    return result;
+}
+
+
+sandbox::gltf::animation_path_value::animation_path_value(const char* value)
+    : animation_path_value(std::string_view{value})
+{
 }
 
 
 sandbox::gltf::animation_path_value::animation_path_value(const std::string& value)
-    : animation_path_value(value.c_str())
+    : animation_path_value(std::string_view{value})
+{
+}
+
+
+sandbox::gltf::animation_path_value::animation_path_value(std::string_view value)
+    : path(find_value(animation_paths, value, "Bad animation path "))
 {
 }
 
@@ -157,21 +295,19 @@ sandbox::gltf::animation_path_value::operator sandbox::gltf::animation_path() co
 
 
 sandbox::gltf::animation_interpolation_value::animation_interpolation_value(const char* value)
+    : animation_interpolation_value(std::string_view{value})
 {
-    if (strcmp(ANIMATION_INTERPOLATION_LINEAR, value) == 0) {
-        interpolation = animation_interpolation::linear;
-    } else if (strcmp(ANIMATION_INTERPOLATION_STEP, value) == 0) {
-        interpolation = animation_interpolation::step;
-    } else if (strcmp(ANIMATION_INTERPOLATION_CUBIC_SPLINE, value) == 0) {
-        interpolation = animation_interpolation::cubic_spline;
-    } else {
-        throw std::runtime_error("Bad accessor type value " + std::string(value));
-    }
 }
 
 
 sandbox::gltf::animation_interpolation_value::animation_interpolation_value(const std::string& value)
-    : animation_interpolation_value(value.c_str())
+    : animation_interpolation_value(std::string_view{value})
+{
+}
+
+
+sandbox::gltf::animation_interpolation_value::animation_interpolation_value(std::string_view value)
+    : interpolation(find_value(animation_interpolations, value, "Bad animation interpolation "))
 {
 }
 
@@ -182,22 +318,68 @@ sandbox::gltf::animation_interpolation_value::operator sandbox::gltf::animation_
 }
 
 
+sandbox::gltf::meshopt_compression_mode_value::meshopt_compression_mode_value(const char* value)
+    : meshopt_compression_mode_value(std::string_view{value})
+{
+}
+
+
+sandbox::gltf::meshopt_compression_mode_value::meshopt_compression_mode_value(const std::string& value)
+    : meshopt_compression_mode_value(std::string_view{value})
+{
+}
+
+
+sandbox::gltf::meshopt_compression_mode_value::meshopt_compression_mode_value(std::string_view value)
+    : mode(find_value(meshopt_compression_modes, value, "Bad meshopt compression mode "))
+{
+}
+
+
+sandbox::gltf::meshopt_compression_mode_value::operator sandbox::gltf::meshopt_compression_mode() const
+{
+    return mode;
+}
+
+
+sandbox::gltf::meshopt_compression_filter_value::meshopt_compression_filter_value(const char* value)
+    : meshopt_compression_filter_value(std::string_view{value})
+{
+}
+
+
+sandbox::gltf::meshopt_compression_filter_value::meshopt_compression_filter_value(const std::string& value)
+    : meshopt_compression_filter_value(std::string_view{value})
+{
+}
+
+
+sandbox::gltf::meshopt_compression_filter_value::meshopt_compression_filter_value(std::string_view value)
+    : filter(find_value(meshopt_compression_filters, value, "Bad meshopt compression filter "))
+{
+}
+
+
+sandbox::gltf::meshopt_compression_filter_value::operator sandbox::gltf::meshopt_compression_filter() const
+{
+    return filter;
+}
+
+
 sandbox::gltf::alpha_mode_value::alpha_mode_value(const char* value)
+    : alpha_mode_value(std::string_view{value})
 {
-    if (strcmp(ALPHA_MODE_OPAQUE, value) == 0) {
-        mode = alpha_mode::opaque;
-    } else if (strcmp(ALPHA_MODE_MASK, value) == 0) {
-        mode = alpha_mode::mask;
-    } else if (strcmp(ALPHA_MODE_BLEND, value) == 0) {
-        mode = alpha_mode::blend;
-    } else {
-        throw std::runtime_error("Bad alpha mode " + std::string(value));
-    }
 }
 
 
 sandbox::gltf::alpha_mode_value::alpha_mode_value(const std::string& value)
-    : alpha_mode_value(value.c_str())
+    : alpha_mode_value(std::string_view{value})
+{
+}
+
+
+sandbox::gltf::alpha_mode_value::alpha_mode_value(std::string_view value)
+    : mode(find_value(alpha_modes, value, "Bad alpha mode "))
 {
 }
 
@@ -209,19 +391,19 @@ sandbox::gltf::alpha_mode_value::operator sandbox::gltf::alpha_mode() const
 
 
 sandbox::gltf::camera_type_value::camera_type_value(const char* value)
+    : camera_type_value(std::string_view{value})
 {
-    if (strcmp(CAMERA_TYPE_PERSPECTIVE, value) == 0) {
-        type = camera_type::perspective;
-    } else if (strcmp(CAMERA_TYPE_ORTHOGRAPHIC, value) == 0) {
-        type = camera_type::orthographic;
-    } else {
-        throw std::runtime_error("Bad camera type " + std::string(value));
-    }
 }
 
 
 sandbox::gltf::camera_type_value::camera_type_value(const std::string& value)
-    : camera_type_value(value.c_str())
+    : camera_type_value(std::string_view{value})
+{
+}
+
+
+sandbox::gltf::camera_type_value::camera_type_value(std::string_view value)
+    : type(find_value(camera_types, value, "Bad camera type "))
 {
 }
 
@@ -233,19 +415,19 @@ sandbox::gltf::camera_type_value::operator sandbox::gltf::camera_type() const
 
 
 sandbox::gltf::image_mime_type_value::image_mime_type_value(const char* value)
+    : image_mime_type_value(std::string_view{value})
 {
-    if (strcmp(IMAGE_MIME_TYPE_JPEG, value) == 0) {
-        type = image_mime_type::jpeg;
-    } else if (strcmp(IMAGE_MIME_TYPE_PNG, value) == 0) {
-        type = image_mime_type::png;
-    } else if (strcmp("", value) != 0) {
-        throw std::runtime_error("Bad image mime type " + std::string(value));
-    }
 }
 
 
 sandbox::gltf::image_mime_type_value::image_mime_type_value(const std::string& value)
-    : image_mime_type_value(value.c_str())
+    : image_mime_type_value(std::string_view{value})
+{
+}
+
+
+sandbox::gltf::image_mime_type_value::image_mime_type_value(std::string_view value)
+    : type(find_value(image_mime_types, value, "Bad image mime type "))
 {
 }
 
@@ -315,6 +497,69 @@ std::string sandbox::gltf::to_string(sandbox::gltf::alpha_mode alpha_mode)
 }
 
 
+std::string sandbox::gltf::to_string(sandbox::gltf::attribute_path attribute_path)
+{
+    switch (attribute_path) {
+        case attribute_path::position:
+            return attribute_path_value::ATTRIBUTE_PATH_POSITION;
+        case attribute_path::normal:
+            return attribute_path_value::ATTRIBUTE_PATH_NORMAL;
+        case attribute_path::tangent:
+            return attribute_path_value::ATTRIBUTE_PATH_TANGENT;
+        case attribute_path::texcoord_0:
+            return attribute_path_value::ATTRIBUTE_PATH_TEXCOORD_0;
+        case attribute_path::texcoord_1:
+            return attribute_path_value::ATTRIBUTE_PATH_TEXCOORD_1;
+        case attribute_path::color_0:
+            return attribute_path_value::ATTRIBUTE_PATH_COLOR_0;
+        case attribute_path::joints_0:
+            return attribute_path_value::ATTRIBUTE_PATH_JOINTS_0;
+        case attribute_path::weights_0:
+            return attribute_path_value::ATTRIBUTE_PATH_WEIGHTS_0;
+    }
+
+    return std::to_string(static_cast<int>(attribute_path));
+}
+
+
+std::string sandbox::gltf::to_string(sandbox::gltf::animation_path animation_path)
+{
+    switch (animation_path) {
+        case animation_path::translation:
+            return animation_path_value::ANIMATION_PATH_TRANSLATION;
+        case animation_path::rotation:
+            return animation_path_value::ANIMATION_PATH_ROTATION;
+        case animation_path::scale:
+            return animation_path_value::ANIMATION_PATH_SCALE;
+        case animation_path::weights:
+            return animation_path_value::ANIMATION_PATH_WEIGHTS;
+    }
+
+    return std::to_string(static_cast<int>(animation_path));
+}
+
+
+std::string sandbox::gltf::to_string(sandbox::gltf::animation_interpolation animation_interpolation)
+{
+    switch (animation_interpolation) {
+        case animation_interpolation::linear:
+            return animation_interpolation_value::ANIMATION_INTERPOLATION_LINEAR;
+        case animation_interpolation::step:
+            return animation_interpolation_value::ANIMATION_INTERPOLATION_STEP;
+        case animation_interpolation::cubic_spline:
+            return animation_interpolation_value::ANIMATION_INTERPOLATION_CUBIC_SPLINE;
+    }
+
+    return std::to_string(static_cast<int>(animation_interpolation));
+}
+
+
+std::optional<sandbox::gltf::attribute_path> sandbox::gltf::find_attribute_path(std::string_view name)
+{
+    return attribute_paths.find(name);
+}
+
+
 size_t sandbox::gltf::accessor_components_count(sandbox::gltf::accessor_type accessor_type)
 {
     switch (accessor_type) {
@@ -342,7 +587,17 @@ size_t sandbox::gltf::get_buffer_element_size(
     sandbox::gltf::accessor_type accessor_type,
     sandbox::gltf::component_type component_type)
 {
-    return accessor_components_count(accessor_type) * get_component_type_size(component_type);
+    const auto component_size = get_component_type_size(component_type);
+
+    // every matrix column starts at 4 byte boundary.
+    switch (accessor_type) {
+        case accessor_type::mat2:
+            return 2 * ((2 * component_size + 3) & ~size_t{3});
+        case accessor_type::mat3:
+            return 3 * ((3 * component_size + 3) & ~size_t{3});
+        default:
+            return accessor_components_count(accessor_type) * component_size;
+    }
 }
 
 
@@ -376,3 +631,38 @@ void sandbox::gltf::do_if_found(
         callback(where[what]);
     }
 }
+
+
+bool sandbox::gltf::is_data_uri(std::string_view uri)
+{
+    return uri.starts_with("data:");
+}
+
+
+sandbox::utils::data sandbox::gltf::decode_data_uri(std::string_view uri)
+{
+    CHECK_MSG(is_data_uri(uri), "Uri is not a data uri.");
+
+    const auto payload_start = uri.find(',');
+    CHECK_MSG(payload_start != std::string_view::npos, "Bad data uri.");
+
+    const auto header = uri.substr(0, payload_start);
+    CHECK_MSG(header.ends_with(";base64"), "Only base64 data uris are supported.");
+
+    const auto payload = uri.substr(payload_start + 1);
+    const auto size = utils::base64_decoded_size(payload);
+
+    if (size == 0) {
+        return {};
+    }
+
+    auto* decoded = new uint8_t[size];
+
+    if (!utils::base64_decode(payload, decoded)) {
+        delete[] decoded;
+        throw std::runtime_error("Bad base64 data in data uri.");
+    }
+
+    return utils::data::create_owning(
+        decoded, [](uint8_t* data) { delete[] data; }, size);
+}
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <utils/data.hpp>
+
 #include <nlohmann/json.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 
 namespace sandbox::gltf
@@ -49,6 +54,18 @@ namespace sandbox::gltf
     };
 
 
+    enum class primitive_mode
+    {
+        points = 0,
+        lines = 1,
+        line_loop = 2,
+        line_strip = 3,
+        triangles = 4,
+        triangle_strip = 5,
+        triangle_fan = 6
+    };
+
+
     enum class sampler_filter_type
     {
         nearest = 9728,
@@ -116,6 +133,21 @@ namespace sandbox::gltf
         cubic_spline
     };
 
+    enum class meshopt_compression_mode
+    {
+        attributes,
+        triangles,
+        indices
+    };
+
+    enum class meshopt_compression_filter
+    {
+        none,
+        octahedral,
+        quaternion,
+        exponential
+    };
+
     enum glb_chunk_type : uint32_t
     {
         JSON = 0x4E4F534A, // "JSON"
@@ -156,6 +188,7 @@ namespace sandbox::gltf
         accessor_type_value() = default;
         accessor_type_value(const char* value);
         accessor_type_value(const std::string& value);
+        accessor_type_value(std::string_view value);
         operator sandbox::gltf::accessor_type() const;
 
         accessor_type type{};
@@ -176,6 +209,7 @@ namespace sandbox::gltf
         attribute_path_value() = default;
         attribute_path_value(const char* value);
         attribute_path_value(const std::string& value);
+        attribute_path_value(std::string_view value);
         operator sandbox::gltf::attribute_path() const;
 
         attribute_path type{};
@@ -191,6 +225,7 @@ namespace sandbox::gltf
         alpha_mode_value() = default;
         alpha_mode_value(const char* value);
         alpha_mode_value(const std::string& value);
+        alpha_mode_value(std::string_view value);
 
         operator sandbox::gltf::alpha_mode() const;
 
@@ -206,6 +241,7 @@ namespace sandbox::gltf
         camera_type_value() = default;
         camera_type_value(const char* value);
         camera_type_value(const std::string& value);
+        camera_type_value(std::string_view value);
 
         operator sandbox::gltf::camera_type() const;
 
@@ -221,6 +257,7 @@ namespace sandbox::gltf
         image_mime_type_value() = default;
         image_mime_type_value(const char* value);
         image_mime_type_value(const std::string& value);
+        image_mime_type_value(std::string_view value);
 
         operator sandbox::gltf::image_mime_type() const;
 
@@ -237,6 +274,7 @@ namespace sandbox::gltf
         animation_path_value() = default;
         animation_path_value(const char* value);
         animation_path_value(const std::string& value);
+        animation_path_value(std::string_view value);
 
         operator sandbox::gltf::animation_path() const;
 
@@ -252,12 +290,48 @@ namespace sandbox::gltf
         animation_interpolation_value() = default;
         animation_interpolation_value(const char* value);
         animation_interpolation_value(const std::string& value);
+        animation_interpolation_value(std::string_view value);
 
         operator sandbox::gltf::animation_interpolation() const;
 
         animation_interpolation interpolation{animation_interpolation::linear};
     };
 
+    struct meshopt_compression_mode_value
+    {
+        constexpr static auto MESHOPT_COMPRESSION_MODE_ATTRIBUTES = "ATTRIBUTES";
+        constexpr static auto MESHOPT_COMPRESSION_MODE_TRIANGLES = "TRIANGLES";
+        constexpr static auto MESHOPT_COMPRESSION_MODE_INDICES = "INDICES";
+
+        meshopt_compression_mode_value() = default;
+        meshopt_compression_mode_value(const char* value);
+        meshopt_compression_mode_value(const std::string& value);
+        meshopt_compression_mode_value(std::string_view value);
+
+        operator sandbox::gltf::meshopt_compression_mode() const;
+
+        meshopt_compression_mode mode{meshopt_compression_mode::attributes};
+    };
+
+    struct meshopt_compression_filter_value
+    {
+        constexpr static auto MESHOPT_COMPRESSION_FILTER_NONE = "NONE";
+        constexpr static auto MESHOPT_COMPRESSION_FILTER_OCTAHEDRAL = "OCTAHEDRAL";
+        constexpr static auto MESHOPT_COMPRESSION_FILTER_QUATERNION = "QUATERNION";
+        constexpr static auto MESHOPT_COMPRESSION_FILTER_EXPONENTIAL = "EXPONENTIAL";
+
+        meshopt_compression_filter_value() = default;
+        meshopt_compression_filter_value(const char* value);
+        meshopt_compression_filter_value(const std::string& value);
+        meshopt_compression_filter_value(std::string_view value);
+
+        operator sandbox::gltf::meshopt_compression_filter() const;
+
+        meshopt_compression_filter filter{meshopt_compression_filter::none};
+    };
+
+
+    std::optional<attribute_path> find_attribute_path(std::string_view name);
 
     size_t get_component_type_size(component_type component_type);
     size_t accessor_components_count(sandbox::gltf::accessor_type accessor_type);
@@ -266,6 +340,9 @@ namespace sandbox::gltf
     std::string to_string(accessor_type);
     std::string to_string(component_type);
     std::string to_string(alpha_mode);
+    std::string to_string(attribute_path);
+    std::string to_string(animation_path);
+    std::string to_string(animation_interpolation);
 
     void do_if_found(
         const nlohmann::json& where,
@@ -322,4 +399,17 @@ namespace sandbox::gltf
     }
 
     glb_file parse_glb_file(const uint8_t* data_ptr, size_t data_size);
+
+    struct json_member
+    {
+        std::string_view key{};
+        std::string_view value{};
+    };
+
+    // finds members of the top level json object by brackets and quotes only, values are not parsed.
+    std::vector<json_member> find_json_members(const uint8_t* json_data, size_t json_size);
+
+    // "data:[<media type>];base64,<payload>" uris embed buffers and images into json.
+    bool is_data_uri(std::string_view uri);
+    utils::data decode_data_uri(std::string_view uri);
 } // namespace sandbox::gltf
@@ -0,0 +1,641 @@
+#include "vertex_conversion.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SANDBOX_CONVERSION_SSE2 1
+    #include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define SANDBOX_CONVERSION_NEON 1
+    #include <arm_neon.h>
+#endif
+
+using namespace sandbox::gltf;
+
+namespace
+{
+    constexpr size_t components_types_count = static_cast<size_t>(vertex_component::uint32) + 1;
+    constexpr size_t max_components_count = 4;
+
+    template<vertex_component Component>
+    struct component_traits;
+
+    template<typename T, bool IsFloat, bool IsNormalized>
+    struct component_traits_base
+    {
+        using type = T;
+        constexpr static bool is_float = IsFloat;
+        constexpr static bool is_normalized = IsNormalized;
+        constexpr static bool is_integer = !IsFloat && !IsNormalized;
+    };
+
+    // clang-format off
+    template<> struct component_traits<vertex_component::float32> : component_traits_base<float, true, false> {};
+    template<> struct component_traits<vertex_component::float16> : component_traits_base<uint16_t, true, false> {};
+    template<> struct component_traits<vertex_component::unorm8> : component_traits_base<uint8_t, false, true> {};
+    template<> struct component_traits<vertex_component::snorm8> : component_traits_base<int8_t, false, true> {};
+    template<> struct component_traits<vertex_component::uint8> : component_traits_base<uint8_t, false, false> {};
+    template<> struct component_traits<vertex_component::sint8> : component_traits_base<int8_t, false, false> {};
+    template<> struct component_traits<vertex_component::unorm16> : component_traits_base<uint16_t, false, true> {};
+    template<> struct component_traits<vertex_component::snorm16> : component_traits_base<int16_t, false, true> {};
+    template<> struct component_traits<vertex_component::uint16> : component_traits_base<uint16_t, false, false> {};
+    template<> struct component_traits<vertex_component::sint16> : component_traits_base<int16_t, false, false> {};
+    template<> struct component_traits<vertex_component::uint32> : component_traits_base<uint32_t, false, false> {};
+    // clang-format on
+
+    template<vertex_component Component>
+    using component_t = typename component_traits<Component>::type;
+
+
+    // round to nearest even, overflow goes to infinity.
+    uint16_t float_to_half(float value)
+    {
+        constexpr uint32_t f32_infinity = 255u << 23;
+        constexpr uint32_t f16_max = (127u + 16u) << 23;
+        constexpr uint32_t denorm_magic_bits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        const uint32_t sign = bits & 0x80000000u;
+        bits ^= sign;
+
+        uint16_t result;
+
+        if (bits >= f16_max) {
+            result = bits > f32_infinity ? 0x7E00 : 0x7C00;
+        } else if (bits < (113u << 23)) {
+            // magic addition aligns mantissa bits at the bottom of the float with hardware rounding.
+            float denorm_magic;
+            std::memcpy(&denorm_magic, &denorm_magic_bits, sizeof(denorm_magic));
+
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            f += denorm_magic;
+
+            std::memcpy(&bits, &f, sizeof(bits));
+            result = static_cast<uint16_t>(bits - denorm_magic_bits);
+        } else {
+            const uint32_t mantissa_odd = (bits >> 13) & 1u;
+            bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFFu + mantissa_odd;
+            result = static_cast<uint16_t>(bits >> 13);
+        }
+
+        return result | static_cast<uint16_t>(sign >> 16);
+    }
+
+
+    template<vertex_component Component>
+    constexpr float normalization_scale()
+    {
+        return 1.0f / static_cast<float>(std::numeric_limits<component_t<Component>>::max());
+    }
+
+
+    template<vertex_component Src>
+    float to_float(component_t<Src> value)
+    {
+        using traits = component_traits<Src>;
+        static_assert(Src != vertex_component::float16, "Half floats are not a source format.");
+
+        if constexpr (Src == vertex_component::float32) {
+            return value;
+        } else if constexpr (traits::is_normalized && std::is_signed_v<component_t<Src>>) {
+            return std::max(static_cast<float>(value) * normalization_scale<Src>(), -1.0f);
+        } else if constexpr (traits::is_normalized) {
+            return static_cast<float>(value) * normalization_scale<Src>();
+        } else {
+            return static_cast<float>(value);
+        }
+    }
+
+
+    template<vertex_component Dst>
+    component_t<Dst> from_float(float value)
+    {
+        using traits = component_traits<Dst>;
+        using T = component_t<Dst>;
+
+        if constexpr (Dst == vertex_component::float32) {
+            return value;
+        } else if constexpr (Dst == vertex_component::float16) {
+            return float_to_half(value);
+        } else if constexpr (traits::is_normalized && std::is_signed_v<T>) {
+            const float scaled = std::clamp(value, -1.0f, 1.0f) * static_cast<float>(std::numeric_limits<T>::max());
+            return static_cast<T>(scaled + (scaled >= 0 ? 0.5f : -0.5f));
+        } else if constexpr (traits::is_normalized) {
+            return static_cast<T>(std::clamp(value, 0.0f, 1.0f) * static_cast<float>(std::numeric_limits<T>::max()) + 0.5f);
+        } else {
+            constexpr auto min_value = static_cast<float>(std::numeric_limits<T>::lowest());
+            constexpr auto max_value = static_cast<float>(std::numeric_limits<T>::max());
+            return static_cast<T>(std::clamp(value, min_value, max_value));
+        }
+    }
+
+
+    template<vertex_component Src, vertex_component Dst>
+    component_t<Dst> convert_component(component_t<Src> value)
+    {
+        if constexpr (Src == Dst) {
+            return value;
+        } else if constexpr (component_traits<Src>::is_integer && component_traits<Dst>::is_integer) {
+            return static_cast<component_t<Dst>>(value);
+        } else {
+            return from_float<Dst>(to_float<Src>(value));
+        }
+    }
+
+
+    template<vertex_component Src, uint32_t SrcCount, vertex_component Dst, uint32_t DstCount>
+    void convert_scalar(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i, src += src_stride, dst += dst_stride) {
+            component_t<Src> in[SrcCount];
+            std::memcpy(in, src, sizeof(in));
+
+            component_t<Dst> out[DstCount]{};
+            for (uint32_t c = 0; c < SrcCount; ++c) {
+                out[c] = convert_component<Src, Dst>(in[c]);
+            }
+
+            std::memcpy(dst, out, sizeof(out));
+        }
+    }
+
+
+    template<vertex_component Src, vertex_component Dst>
+    constexpr bool has_vector_kernel()
+    {
+#if defined(SANDBOX_CONVERSION_SSE2) || defined(SANDBOX_CONVERSION_NEON)
+        constexpr bool is_float_dst = Dst == vertex_component::float32 || Dst == vertex_component::float16;
+        constexpr bool is_small_src = sizeof(component_t<Src>) <= 2 || Src == vertex_component::float32;
+        return is_float_dst && is_small_src && Src != Dst;
+#else
+        return false;
+#endif
+    }
+
+
+#ifdef SANDBOX_CONVERSION_SSE2
+    __m128i float_to_half_sse2(__m128 value)
+    {
+        const __m128i sign = _mm_and_si128(_mm_castps_si128(value), _mm_set1_epi32(int32_t(0x80000000u)));
+        const __m128i bits = _mm_xor_si128(_mm_castps_si128(value), sign);
+
+        const __m128i is_inf_or_nan = _mm_cmpgt_epi32(bits, _mm_set1_epi32(((127 + 16) << 23) - 1));
+        const __m128i is_nan = _mm_cmpgt_epi32(bits, _mm_set1_epi32(255 << 23));
+        const __m128i inf_or_nan = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(is_nan, _mm_set1_epi32(0x200)));
+
+        const __m128i is_denorm = _mm_cmpgt_epi32(_mm_set1_epi32(113 << 23), bits);
+        const __m128i denorm_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+        const __m128i denorm = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(denorm_magic))), denorm_magic);
+
+        const __m128i mantissa_odd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+        __m128i normal = _mm_add_epi32(bits, _mm_set1_epi32(((15 - 127) << 23) + 0xFFF));
+        normal = _mm_srli_epi32(_mm_add_epi32(normal, mantissa_odd), 13);
+
+        __m128i result = _mm_or_si128(_mm_and_si128(is_denorm, denorm), _mm_andnot_si128(is_denorm, normal));
+        result = _mm_or_si128(_mm_and_si128(is_inf_or_nan, inf_or_nan), _mm_andnot_si128(is_inf_or_nan, result));
+        result = _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+
+        // sign extension keeps the bits through signed saturating pack.
+        result = _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+        return _mm_packs_epi32(result, result);
+    }
+
+
+    template<vertex_component Src, uint32_t SrcCount>
+    __m128 load_as_float4(const uint8_t* src)
+    {
+        using T = component_t<Src>;
+
+        if constexpr (Src == vertex_component::float32) {
+            float in[4]{};
+            std::memcpy(in, src, SrcCount * sizeof(float));
+            return _mm_loadu_ps(in);
+        } else {
+            __m128i ints;
+
+            if constexpr (sizeof(T) == 1) {
+                uint32_t packed = 0;
+                std::memcpy(&packed, src, SrcCount);
+                const __m128i bytes = _mm_cvtsi32_si128(int32_t(packed));
+
+                if constexpr (std::is_signed_v<T>) {
+                    const __m128i shorts = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+                    ints = _mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 16);
+                } else {
+                    ints = _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, _mm_setzero_si128()), _mm_setzero_si128());
+                }
+            } else {
+                uint64_t packed = 0;
+                std::memcpy(&packed, src, SrcCount * sizeof(T));
+                const __m128i shorts = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&packed));
+
+                if constexpr (std::is_signed_v<T>) {
+                    ints = _mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 16);
+                } else {
+                    ints = _mm_unpacklo_epi16(shorts, _mm_setzero_si128());
+                }
+            }
+
+            __m128 result = _mm_cvtepi32_ps(ints);
+
+            if constexpr (component_traits<Src>::is_normalized) {
+                result = _mm_mul_ps(result, _mm_set1_ps(normalization_scale<Src>()));
+                if constexpr (std::is_signed_v<T>) {
+                    result = _mm_max_ps(result, _mm_set1_ps(-1.0f));
+                }
+            }
+
+            return result;
+        }
+    }
+
+
+    template<vertex_component Src, uint32_t SrcCount, vertex_component Dst, uint32_t DstCount>
+    void convert_vector(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i, src += src_stride, dst += dst_stride) {
+            const __m128 value = load_as_float4<Src, SrcCount>(src);
+
+            if constexpr (Dst == vertex_component::float32) {
+                if constexpr (DstCount == 4) {
+                    _mm_storeu_ps(reinterpret_cast<float*>(dst), value);
+                } else {
+                    float out[4];
+                    _mm_storeu_ps(out, value);
+                    std::memcpy(dst, out, DstCount * sizeof(float));
+                }
+            } else {
+                uint64_t out;
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(&out), float_to_half_sse2(value));
+                std::memcpy(dst, &out, DstCount * sizeof(uint16_t));
+            }
+        }
+    }
+#endif
+
+#ifdef SANDBOX_CONVERSION_NEON
+    template<vertex_component Src, uint32_t SrcCount>
+    float32x4_t load_as_float4(const uint8_t* src)
+    {
+        using T = component_t<Src>;
+
+        if constexpr (Src == vertex_component::float32) {
+            float in[4]{};
+            std::memcpy(in, src, SrcCount * sizeof(float));
+            return vld1q_f32(in);
+        } else {
+            float32x4_t result;
+
+            if constexpr (sizeof(T) == 1) {
+                T in[8]{};
+                std::memcpy(in, src, SrcCount);
+
+                if constexpr (std::is_signed_v<T>) {
+                    result = vcvtq_f32_s32(vmovl_s16(vget_low_s16(vmovl_s8(vld1_s8(in)))));
+                } else {
+                    result = vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(vld1_u8(in)))));
+                }
+            } else {
+                T in[4]{};
+                std::memcpy(in, src, SrcCount * sizeof(T));
+
+                if constexpr (std::is_signed_v<T>) {
+                    result = vcvtq_f32_s32(vmovl_s16(vld1_s16(in)));
+                } else {
+                    result = vcvtq_f32_u32(vmovl_u16(vld1_u16(in)));
+                }
+            }
+
+            if constexpr (component_traits<Src>::is_normalized) {
+                result = vmulq_n_f32(result, normalization_scale<Src>());
+                if constexpr (std::is_signed_v<T>) {
+                    result = vmaxq_f32(result, vdupq_n_f32(-1.0f));
+                }
+            }
+
+            return result;
+        }
+    }
+
+
+    template<vertex_component Src, uint32_t SrcCount, vertex_component Dst, uint32_t DstCount>
+    void convert_vector(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i, src += src_stride, dst += dst_stride) {
+            const float32x4_t value = load_as_float4<Src, SrcCount>(src);
+
+            if constexpr (Dst == vertex_component::float32) {
+                float out[4];
+                vst1q_f32(out, value);
+                std::memcpy(dst, out, DstCount * sizeof(float));
+            } else {
+                uint16_t out[4];
+                vst1_u16(out, vreinterpret_u16_f16(vcvt_f16_f32(value)));
+                std::memcpy(dst, out, DstCount * sizeof(uint16_t));
+            }
+        }
+    }
+#endif
+
+
+    template<vertex_component Src, uint32_t SrcCount, vertex_component Dst, uint32_t DstCount>
+    void convert_kernel(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride, size_t count)
+    {
+        if constexpr (Src == Dst && SrcCount == DstCount) {
+            constexpr size_t element_size = sizeof(component_t<Src>) * SrcCount;
+
+            if (src_stride == element_size && dst_stride == element_size) {
+                std::memcpy(dst, src, element_size * count);
+                return;
+            }
+
+            for (size_t i = 0; i < count; ++i, src += src_stride, dst += dst_stride) {
+                std::memcpy(dst, src, element_size);
+            }
+        } else if constexpr (has_vector_kernel<Src, Dst>()) {
+            convert_vector<Src, SrcCount, Dst, DstCount>(src, src_stride, dst, dst_stride, count);
+        } else {
+            convert_scalar<Src, SrcCount, Dst, DstCount>(src, src_stride, dst, dst_stride, count);
+        }
+    }
+
+
+    using conversion_kernel = void (*)(const uint8_t*, size_t, uint8_t*, size_t, size_t);
+
+    constexpr size_t kernel_index(vertex_format src, vertex_format dst)
+    {
+        return ((static_cast<size_t>(src.component) * max_components_count + (src.components_count - 1)) * components_types_count + static_cast<size_t>(dst.component)) * max_components_count + (dst.components_count - 1);
+    }
+
+
+    template<size_t Index>
+    constexpr conversion_kernel make_kernel()
+    {
+        constexpr auto dst_count = uint32_t(Index % max_components_count + 1);
+        constexpr auto dst = vertex_component(Index / max_components_count % components_types_count);
+        constexpr auto src_count = uint32_t(Index / (max_components_count * components_types_count) % max_components_count + 1);
+        constexpr auto src = vertex_component(Index / (max_components_count * components_types_count * max_components_count));
+
+        // gltf has no half float attributes, and components are never dropped.
+        if constexpr (src == vertex_component::float16 || dst_count < src_count) {
+            return nullptr;
+        } else {
+            return &convert_kernel<src, src_count, dst, dst_count>;
+        }
+    }
+
+
+    template<size_t... Indices>
+    constexpr auto make_kernels(std::index_sequence<Indices...>)
+    {
+        return std::array<conversion_kernel, sizeof...(Indices)>{make_kernel<Indices>()...};
+    }
+
+
+    constexpr auto kernels = make_kernels(std::make_index_sequence<components_types_count * max_components_count * components_types_count * max_components_count>{});
+
+    constexpr size_t encoding_chunk_size = 256;
+
+    using float4 = std::array<float, max_components_count>;
+
+
+    // converts src to floats by chunks, encodes them in place and converts results to dst_format.
+    template<typename Encoder>
+    void encode_vertices(
+        const uint8_t* src,
+        size_t src_stride,
+        vertex_format src_format,
+        uint8_t* dst,
+        size_t dst_stride,
+        vertex_format dst_format,
+        size_t count,
+        const Encoder& encode)
+    {
+        constexpr vertex_format float_format{.component = vertex_component::float32, .components_count = max_components_count};
+        const vertex_format encoded_format{.component = vertex_component::float32, .components_count = dst_format.components_count};
+
+        std::array<float4, encoding_chunk_size> chunk{};
+
+        for (size_t first = 0; first < count; first += chunk.size()) {
+            const auto chunk_count = std::min(chunk.size(), count - first);
+
+            convert_vertices(
+                src + first * src_stride,
+                src_stride,
+                src_format,
+                reinterpret_cast<uint8_t*>(chunk.data()),
+                sizeof(float4),
+                float_format,
+                chunk_count);
+
+            for (size_t i = 0; i < chunk_count; ++i) {
+                encode(chunk[i]);
+            }
+
+            convert_vertices(
+                reinterpret_cast<const uint8_t*>(chunk.data()),
+                sizeof(float4),
+                encoded_format,
+                dst + first * dst_stride,
+                dst_stride,
+                dst_format,
+                chunk_count);
+        }
+    }
+
+
+    float sign_not_zero(float value)
+    {
+        return value >= 0 ? 1.0f : -1.0f;
+    }
+
+
+    float get_unorm_max(vertex_component component)
+    {
+        switch (component) {
+            case vertex_component::unorm8:
+                return static_cast<float>(std::numeric_limits<uint8_t>::max());
+            case vertex_component::unorm16:
+                return static_cast<float>(std::numeric_limits<uint16_t>::max());
+            default:
+                return 0;
+        }
+    }
+} // namespace
+
+
+vertex_format sandbox::gltf::to_vertex_format(accessor_type accessor_type, component_type component_type, bool normalized)
+{
+    const auto count = static_cast<uint32_t>(accessor_components_count(accessor_type));
+
+    switch (component_type) {
+        case component_type::signed_byte:
+            return {normalized ? vertex_component::snorm8 : vertex_component::sint8, count};
+        case component_type::unsigned_byte:
+            return {normalized ? vertex_component::unorm8 : vertex_component::uint8, count};
+        case component_type::signed_short:
+            return {normalized ? vertex_component::snorm16 : vertex_component::sint16, count};
+        case component_type::unsigned_short:
+            return {normalized ? vertex_component::unorm16 : vertex_component::uint16, count};
+        case component_type::unsigned_int:
+            return {vertex_component::uint32, count};
+        case component_type::float32:
+            return {vertex_component::float32, count};
+        default:
+            throw std::runtime_error("Bad component type " + to_string(component_type));
+    }
+}
+
+
+size_t sandbox::gltf::get_vertex_format_size(vertex_format format)
+{
+    switch (format.component) {
+        case vertex_component::unorm8:
+        case vertex_component::snorm8:
+        case vertex_component::uint8:
+        case vertex_component::sint8:
+            return format.components_count;
+        case vertex_component::float16:
+        case vertex_component::unorm16:
+        case vertex_component::snorm16:
+        case vertex_component::uint16:
+        case vertex_component::sint16:
+            return format.components_count * 2;
+        case vertex_component::float32:
+        case vertex_component::uint32:
+            return format.components_count * 4;
+    }
+
+    return 0;
+}
+
+
+void sandbox::gltf::convert_vertices(
+    const uint8_t* src,
+    size_t src_stride,
+    vertex_format src_format,
+    uint8_t* dst,
+    size_t dst_stride,
+    vertex_format dst_format,
+    size_t count)
+{
+    const auto is_valid_count = [](uint32_t count) { return count > 0 && count <= max_components_count; };
+
+    if (!is_valid_count(src_format.components_count) || !is_valid_count(dst_format.components_count)) {
+        throw std::runtime_error("Types are not convertible.");
+    }
+
+    const auto kernel = kernels[kernel_index(src_format, dst_format)];
+
+    if (kernel == nullptr) {
+        throw std::runtime_error("Types are not convertible.");
+    }
+
+    kernel(src, src_stride, dst, dst_stride, count);
+}
+
+
+void sandbox::gltf::encode_octahedral(
+    const uint8_t* src,
+    size_t src_stride,
+    vertex_format src_format,
+    uint8_t* dst,
+    size_t dst_stride,
+    vertex_format dst_format,
+    size_t count)
+{
+    if (dst_format.components_count != 2) {
+        throw std::runtime_error("Octahedral vectors have 2 components.");
+    }
+
+    encode_vertices(src, src_stride, src_format, dst, dst_stride, dst_format, count, [](float4& value) {
+        const float length = std::abs(value[0]) + std::abs(value[1]) + std::abs(value[2]);
+
+        // degenerate vectors are written as the pole.
+        if (length == 0) {
+            value = {0, 0, 0, 0};
+            return;
+        }
+
+        const float x = value[0] / length;
+        const float y = value[1] / length;
+
+        if (value[2] >= 0) {
+            value = {x, y, 0, 0};
+        } else {
+            value = {(1.0f - std::abs(y)) * sign_not_zero(x), (1.0f - std::abs(x)) * sign_not_zero(y), 0, 0};
+        }
+    });
+}
+
+
+void sandbox::gltf::quantize_positions(
+    const uint8_t* src,
+    size_t src_stride,
+    vertex_format src_format,
+    uint8_t* dst,
+    size_t dst_stride,
+    vertex_format dst_format,
+    const glm::vec3& offset,
+    const glm::vec3& scale,
+    size_t count)
+{
+    encode_vertices(src, src_stride, src_format, dst, dst_stride, dst_format, count, [&offset, &scale](float4& value) {
+        for (glm::length_t i = 0; i < 3; ++i) {
+            value[i] = scale[i] > 0 ? std::clamp((value[i] - offset[i]) / scale[i], 0.0f, 1.0f) : 0.0f;
+        }
+
+        value[3] = 0;
+    });
+}
+
+
+void sandbox::gltf::encode_weights(
+    const uint8_t* src,
+    size_t src_stride,
+    vertex_format src_format,
+    uint8_t* dst,
+    size_t dst_stride,
+    vertex_format dst_format,
+    size_t count)
+{
+    const float max_value = get_unorm_max(dst_format.component);
+
+    if (max_value == 0) {
+        convert_vertices(src, src_stride, src_format, dst, dst_stride, dst_format, count);
+        return;
+    }
+
+    const size_t components_count = std::min<size_t>(dst_format.components_count, max_components_count);
+
+    encode_vertices(src, src_stride, src_format, dst, dst_stride, dst_format, count, [max_value, components_count](float4& value) {
+        float sum = 0;
+        float rounded_sum = 0;
+        size_t largest = 0;
+
+        for (size_t i = 0; i < components_count; ++i) {
+            sum += value[i];
+            value[i] = std::round(std::clamp(value[i], 0.0f, 1.0f) * max_value);
+            rounded_sum += value[i];
+            largest = value[i] > value[largest] ? i : largest;
+        }
+
+        // the target sum is the rounded source sum, weights of glTF sum to 1.
+        const float target_sum = std::round(std::clamp(sum, 0.0f, 1.0f) * max_value);
+        value[largest] = std::max(value[largest] + target_sum - rounded_sum, 0.0f);
+
+        for (auto& component : value) {
+            component /= max_value;
+        }
+    });
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <gltf/utils.hpp>
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sandbox::gltf
+{
+    // component encodings of gltf accessors and of gpu vertex formats.
+    enum class vertex_component : uint8_t
+    {
+        float32,
+        float16,
+        unorm8,
+        snorm8,
+        uint8,
+        sint8,
+        unorm16,
+        snorm16,
+        uint16,
+        sint16,
+        uint32,
+    };
+
+    struct vertex_format
+    {
+        vertex_component component{vertex_component::float32};
+        uint32_t components_count{0};
+
+        bool operator==(const vertex_format&) const = default;
+    };
+
+    vertex_format to_vertex_format(accessor_type accessor_type, component_type component_type, bool normalized);
+    size_t get_vertex_format_size(vertex_format format);
+
+    // converts count elements from strided src into strided dst. every (src, dst) formats pair has own kernel
+    // specialized at compile time, so there is no per element dispatch. missing components are filled with zeros.
+    // throws if the formats pair is not convertible.
+    void convert_vertices(
+        const uint8_t* src,
+        size_t src_stride,
+        vertex_format src_format,
+        uint8_t* dst,
+        size_t dst_stride,
+        vertex_format dst_format,
+        size_t count);
+
+    // compact encodings below convert elements to floats, encode them and convert to dst_format as convert_vertices
+    // does, so dst_format is usually normalized, e.g. snorm16. shaders decode them by the formulas below.
+
+    // unit vectors are folded onto the octahedron and written as its 2 coordinates in [-1, 1]:
+    // n = vec3(e, 1 - |e.x| - |e.y|), n.xy += t * -sign(n.xy) with t = max(-n.z, 0), normalize(n).
+    void encode_octahedral(
+        const uint8_t* src,
+        size_t src_stride,
+        vertex_format src_format,
+        uint8_t* dst,
+        size_t dst_stride,
+        vertex_format dst_format,
+        size_t count);
+
+    // positions are mapped into [0, 1] of the box, so offset + value * scale gives them back. axes with zero scale get 0.
+    void quantize_positions(
+        const uint8_t* src,
+        size_t src_stride,
+        vertex_format src_format,
+        uint8_t* dst,
+        size_t dst_stride,
+        vertex_format dst_format,
+        const glm::vec3& offset,
+        const glm::vec3& scale,
+        size_t count);
+
+    // weights which are written to unorm formats are rounded so they keep their sum, the rounding error goes to the
+    // largest weight. other formats are converted as they are.
+    void encode_weights(
+        const uint8_t* src,
+        size_t src_stride,
+        vertex_format src_format,
+        uint8_t* dst,
+        size_t dst_stride,
+        vertex_format dst_format,
+        size_t count);
+} // namespace sandbox::gltf
@@ -0,0 +1,393 @@
+#include "vk_model_cache.hpp"
+
+#include <filesystem/mapped_file.hpp>
+#include <utils/conditions_helpers.hpp>
+#include <utils/hash.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+using namespace sandbox;
+using namespace sandbox::gltf;
+
+namespace
+{
+    struct table
+    {
+        uint64_t offset{0};
+        uint64_t count{0};
+    };
+
+    // records are written as is, so the cache is valid only on little endian platforms with the same layout of these structs.
+    struct file_header
+    {
+        uint32_t magic{vk_model_cache::magic};
+        uint32_t version{vk_model_cache::version};
+        uint64_t key{0};
+
+        table vertex_format{};
+        table sources{};
+        table primitives{};
+        table meshes{};
+        table skins{};
+        table animations{};
+        table images{};
+        table textures{};
+        table materials{};
+
+        vk_model_cache::blob anim_nodes{};
+        vk_model_cache::blob anim_exec_order{};
+
+        uint64_t blobs_offset{0};
+        uint64_t blobs_size{0};
+    };
+
+    static_assert(std::is_trivially_copyable_v<file_header>);
+
+
+    uint64_t align(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+
+    int64_t get_write_time(const std::filesystem::path& path, std::error_code& error)
+    {
+        return std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    }
+
+
+    uint64_t get_content_hash(const std::filesystem::path& path)
+    {
+        hal::filesystem::mapped_file file{};
+        file.open(path.string());
+        const auto file_data = file.read_all();
+
+        return utils::hash64(file_data.get_data(), file_data.get_size());
+    }
+
+
+    template<typename T>
+    bool read_table(const utils::data& file, const table& src, std::vector<T>& dst)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        if (src.count > file.get_size() / sizeof(T) || src.offset > file.get_size() - src.count * sizeof(T)) {
+            return false;
+        }
+
+        dst.resize(src.count);
+
+        // empty tables have no data to copy from.
+        if (src.count > 0) {
+            std::memcpy(dst.data(), file.get_data() + src.offset, src.count * sizeof(T));
+        }
+
+        return true;
+    }
+
+
+    template<typename T>
+    table write_table(std::vector<uint8_t>& file, const std::vector<T>& src)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        table result{.offset = align(file.size(), vk_model_cache::blob_alignment), .count = src.size()};
+        file.resize(result.offset + src.size() * sizeof(T));
+
+        if (!src.empty()) {
+            std::memcpy(file.data() + result.offset, src.data(), src.size() * sizeof(T));
+        }
+
+        return result;
+    }
+} // namespace
+
+
+std::optional<vk_model_cache> vk_model_cache::open(const std::string& path, uint64_t key, const std::string& sources_directory)
+{
+    std::error_code error{};
+
+    if (!std::filesystem::is_regular_file(path, error)) {
+        return std::nullopt;
+    }
+
+    hal::filesystem::mapped_file file{};
+
+    try {
+        file.open(path);
+    } catch (const hal::filesystem::cannot_open_file_error&) {
+        return std::nullopt;
+    }
+
+    auto file_data = file.read_all_and_move();
+
+    file_header header{};
+
+    if (file_data.get_size() < sizeof(header)) {
+        return std::nullopt;
+    }
+
+    std::memcpy(&header, file_data.get_data(), sizeof(header));
+
+    if (header.magic != magic || header.version != version || header.key != key) {
+        return std::nullopt;
+    }
+
+    if (header.blobs_offset > file_data.get_size() || header.blobs_size > file_data.get_size() - header.blobs_offset) {
+        return std::nullopt;
+    }
+
+    vk_model_cache result{};
+    result.m_key = key;
+
+    // clang-format off
+    const bool tables_valid =
+        read_table(file_data, header.vertex_format, result.m_vertex_format) &&
+        read_table(file_data, header.sources, result.m_sources) &&
+        read_table(file_data, header.primitives, result.m_primitives) &&
+        read_table(file_data, header.meshes, result.m_meshes) &&
+        read_table(file_data, header.skins, result.m_skins) &&
+        read_table(file_data, header.animations, result.m_animations) &&
+        read_table(file_data, header.images, result.m_images) &&
+        read_table(file_data, header.textures, result.m_textures) &&
+        read_table(file_data, header.materials, result.m_materials);
+    // clang-format on
+
+    if (!tables_valid || result.m_vertex_format.size() != 8) {
+        return std::nullopt;
+    }
+
+    result.m_anim_nodes = header.anim_nodes;
+    result.m_anim_exec_order = header.anim_exec_order;
+    result.m_mapped_blobs_offset = header.blobs_offset;
+    result.m_mapped_blobs_size = header.blobs_size;
+    result.m_mapping = std::move(file_data);
+
+    auto blob_in_bounds = [&result](const blob& b) {
+        return b.offset <= result.m_mapped_blobs_size && b.size <= result.m_mapped_blobs_size - b.offset;
+    };
+
+    for (const auto& primitive : result.m_primitives) {
+        if (!blob_in_bounds(primitive.vertices) || !blob_in_bounds(primitive.indices) || !blob_in_bounds(primitive.clusters) || primitive.lods_count > max_lods) {
+            return std::nullopt;
+        }
+    }
+
+    for (const auto& image : result.m_images) {
+        if (!blob_in_bounds(image.pixels)) {
+            return std::nullopt;
+        }
+    }
+
+    if (!blob_in_bounds(result.m_anim_nodes) || !blob_in_bounds(result.m_anim_exec_order)) {
+        return std::nullopt;
+    }
+
+    for (const auto& skin : result.m_skins) {
+        if (!blob_in_bounds(skin.joints)) {
+            return std::nullopt;
+        }
+    }
+
+    for (const auto& animation : result.m_animations) {
+        if (!blob_in_bounds(animation.meta) || !blob_in_bounds(animation.time_stamps) || !blob_in_bounds(animation.keys)) {
+            return std::nullopt;
+        }
+    }
+
+    for (const auto& material : result.m_materials) {
+        if (!blob_in_bounds(material.info)) {
+            return std::nullopt;
+        }
+    }
+
+    // records refer to records of other tables, instantiate uses these indices as is.
+    for (const auto& mesh : result.m_meshes) {
+        if (mesh.first_primitive > result.m_primitives.size() || mesh.primitives_count > result.m_primitives.size() - mesh.first_primitive) {
+            return std::nullopt;
+        }
+
+        if (mesh.skin >= 0 && static_cast<uint64_t>(mesh.skin) >= result.m_skins.size()) {
+            return std::nullopt;
+        }
+    }
+
+    for (const auto& primitive : result.m_primitives) {
+        if (primitive.material >= result.m_materials.size()) {
+            return std::nullopt;
+        }
+    }
+
+    for (const auto& material : result.m_materials) {
+        for (const auto texture : {material.base_color, material.normal, material.metallic_roughness, material.occlusion, material.emissive}) {
+            if (texture >= result.m_textures.size()) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    for (const auto& texture : result.m_textures) {
+        if (texture.image >= result.m_images.size()) {
+            return std::nullopt;
+        }
+    }
+
+    // write time is the fast path. copied or checked out files get a new write time, for them the content decides.
+    for (const auto& source : result.m_sources) {
+        if (!blob_in_bounds(source.path)) {
+            return std::nullopt;
+        }
+
+        const auto source_path = std::filesystem::path(sources_directory) / std::string{
+            reinterpret_cast<const char*>(result.get_blob_data(source.path)), source.path.size};
+
+        const auto size = std::filesystem::file_size(source_path, error);
+        if (error || size != source.size) {
+            return std::nullopt;
+        }
+
+        const auto write_time = get_write_time(source_path, error);
+        if (error) {
+            return std::nullopt;
+        }
+
+        if (write_time != source.write_time) {
+            try {
+                if (get_content_hash(source_path) != source.hash) {
+                    return std::nullopt;
+                }
+            } catch (const hal::filesystem::cannot_open_file_error&) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    return result;
+}
+
+
+void vk_model_cache::save(const std::string& path) const
+{
+    std::vector<uint8_t> file(sizeof(file_header));
+
+    file_header header{};
+    header.key = m_key;
+    header.vertex_format = write_table(file, m_vertex_format);
+    header.sources = write_table(file, m_sources);
+    header.primitives = write_table(file, m_primitives);
+    header.meshes = write_table(file, m_meshes);
+    header.skins = write_table(file, m_skins);
+    header.animations = write_table(file, m_animations);
+    header.images = write_table(file, m_images);
+    header.textures = write_table(file, m_textures);
+    header.materials = write_table(file, m_materials);
+    header.anim_nodes = m_anim_nodes;
+    header.anim_exec_order = m_anim_exec_order;
+    header.blobs_offset = align(file.size(), blob_alignment);
+    header.blobs_size = get_blobs_size();
+
+    file.resize(header.blobs_offset);
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    const auto tmp_path = path + ".tmp";
+
+    {
+        std::ofstream stream{tmp_path, std::ios::binary | std::ios::trunc};
+        CHECK_MSG(stream.is_open(), "Cannot write model cache " + tmp_path + ".");
+
+        stream.write(reinterpret_cast<const char*>(file.data()), std::streamsize(file.size()));
+        stream.write(reinterpret_cast<const char*>(get_blob_data({})), std::streamsize(header.blobs_size));
+
+        CHECK_MSG(stream.good(), "Cannot write model cache " + tmp_path + ".");
+    }
+
+    std::filesystem::rename(tmp_path, path);
+}
+
+
+vk_model_cache::blob vk_model_cache::add_blob(uint64_t size, const std::function<void(uint8_t*)>& fill)
+{
+    CHECK_MSG(!m_mapping.get_data(), "Cannot add blob to the opened cache.");
+
+    blob result{.offset = align(m_blobs.size(), blob_alignment), .size = size};
+    m_blobs.resize(result.offset + size);
+
+    if (fill && size > 0) {
+        fill(m_blobs.data() + result.offset);
+    }
+
+    return result;
+}
+
+
+void vk_model_cache::add_source(const std::string& sources_directory, const std::string& relative_path)
+{
+    const auto source_path = std::filesystem::path(sources_directory) / relative_path;
+    const auto stored_path = std::filesystem::path(relative_path).generic_string();
+
+    source new_source{
+        .size = std::filesystem::file_size(source_path),
+        .write_time = std::filesystem::last_write_time(source_path).time_since_epoch().count(),
+        .hash = get_content_hash(source_path)};
+
+    new_source.path = add_blob(stored_path.size(), [&stored_path](uint8_t* dst) {
+        std::memcpy(dst, stored_path.data(), stored_path.size());
+    });
+
+    m_sources.emplace_back(new_source);
+}
+
+
+void vk_model_cache::set_key(uint64_t key)
+{
+    m_key = key;
+}
+
+
+void vk_model_cache::set_vertex_format(std::span<const uint32_t> vertex_format)
+{
+    m_vertex_format.assign(vertex_format.begin(), vertex_format.end());
+}
+
+
+const uint8_t* vk_model_cache::get_blob_data(const blob& b) const
+{
+    if (m_mapping.get_data() != nullptr) {
+        return m_mapping.get_data() + m_mapped_blobs_offset + b.offset;
+    }
+
+    return m_blobs.data() + b.offset;
+}
+
+
+uint64_t vk_model_cache::get_blobs_size() const
+{
+    return m_mapping.get_data() != nullptr ? m_mapped_blobs_size : m_blobs.size();
+}
+
+
+uint64_t vk_model_cache::get_sources_size() const
+{
+    uint64_t result = 0;
+
+    for (const auto& source : m_sources) {
+        result += source.size;
+    }
+
+    return result;
+}
+
+
+uint64_t vk_model_cache::get_key() const
+{
+    return m_key;
+}
+
+
+const std::optional<mesh_optimization_statistics>& vk_model_cache::get_optimization_statistics() const
+{
+    return m_optimization_statistics;
+}
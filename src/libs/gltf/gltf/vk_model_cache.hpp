@@ -0,0 +1,203 @@
+#pragma once
+
+#include <gltf/mesh_optimizer.hpp>
+#include <utils/data.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace sandbox::gltf
+{
+    // baked output of vk_model_builder: ready to upload buffers and images plus records which rebuild vk_model from them.
+    // file is a header, record tables and blobs area. blobs are aligned, so the mapped file is uploaded in place.
+    class vk_model_cache
+    {
+        friend class vk_model_builder;
+
+    public:
+        constexpr static uint32_t magic = 0x43564B53; // "SKVC"
+        constexpr static uint32_t version = 9;
+        constexpr static uint64_t blob_alignment = 16;
+        // the primitive itself and up to 5 simplified lods.
+        constexpr static uint32_t max_lods = 6;
+
+        struct blob
+        {
+            uint64_t offset{0};
+            uint64_t size{0};
+        };
+
+        // file which the cache was baked from. path is relative to the model directory, so cooked caches can be moved with models.
+        struct source
+        {
+            blob path{};
+            uint64_t size{0};
+            int64_t write_time{0};
+            uint64_t hash{0};
+        };
+
+        // object space box and sphere of gltf::bounds.
+        struct bounding_volume
+        {
+            float min[3]{};
+            float max[3]{};
+            float center[3]{};
+            float radius{-1};
+        };
+
+        // gltf::cluster_bounds and the index range of a cluster, laid out as cluster_culling.comp reads them.
+        struct cluster
+        {
+            float center[3]{};
+            float radius{0};
+            float cone_axis[3]{};
+            float cone_cutoff{1};
+            uint32_t first_index{0};
+            uint32_t indices_count{0};
+            uint32_t padding[2]{};
+        };
+
+        // range of the primitive indices. error is the largest object space distance which the lod moves the surface by.
+        struct lod
+        {
+            uint64_t first_index{0};
+            uint64_t indices_count{0};
+            float error{0};
+            uint32_t padding{0};
+        };
+
+        struct primitive
+        {
+            blob vertices{};
+            blob indices{};
+            uint64_t vertices_count{0};
+            uint64_t indices_count{0};
+            uint32_t index_type{0};
+            uint32_t material{0};
+            bounding_volume bounds{};
+            // quantized positions are offset + position * scale, see vk_model_builder::quantize_positions.
+            float position_offset[3]{};
+            float position_scale[3]{1, 1, 1};
+            // only primitives which were baked with clusters have them, their indices are 32-bit.
+            blob clusters{};
+            uint32_t clusters_count{0};
+            // indexed primitives have at least the first lod, which indices_count refers to. lods of the primitive share
+            // its vertices and follow each other in its indices.
+            uint32_t lods_count{0};
+            lod lods[max_lods]{};
+        };
+
+        struct mesh
+        {
+            uint32_t first_primitive{0};
+            uint32_t primitives_count{0};
+            int32_t skin{-1};
+            uint32_t padding{0};
+            // bounds of all primitives.
+            bounding_volume bounds{};
+        };
+
+        struct skin
+        {
+            blob joints{};
+            uint32_t joints_count{0};
+            uint32_t hierarchy_size{0};
+        };
+
+        struct animation
+        {
+            blob meta{};
+            blob time_stamps{};
+            blob keys{};
+        };
+
+        struct image
+        {
+            blob pixels{};
+            uint32_t width{1};
+            uint32_t height{1};
+            uint32_t format{0};
+            uint32_t gen_mips{0};
+            // levels are packed one after another in pixels if there is more than one.
+            uint32_t mips_levels{1};
+            uint32_t padding{0};
+            // hash of pixels, images with the same hash are uploaded once through the asset registry.
+            uint64_t hash{0};
+        };
+
+        struct texture
+        {
+            uint32_t image{0};
+            uint32_t filter{0};
+            uint32_t mip_filter{0};
+            uint32_t wrap_u{0};
+            uint32_t wrap_v{0};
+            uint32_t wrap_w{0};
+        };
+
+        struct material
+        {
+            blob info{};
+            uint32_t base_color{0};
+            uint32_t normal{0};
+            uint32_t metallic_roughness{0};
+            uint32_t occlusion{0};
+            uint32_t emissive{0};
+            uint32_t padding{0};
+        };
+
+        // returns nothing if there is no cache, it is broken, was baked with another key or any of its sources was changed.
+        static std::optional<vk_model_cache> open(const std::string& path, uint64_t key, const std::string& sources_directory);
+
+        vk_model_cache() = default;
+
+        // writes the cache to a temporary file and renames it, so readers never see a partially written cache.
+        void save(const std::string& path) const;
+
+        blob add_blob(uint64_t size, const std::function<void(uint8_t*)>& fill);
+        void add_source(const std::string& sources_directory, const std::string& relative_path);
+
+        // key of the builder settings and sources, open rejects caches which were baked with another key.
+        void set_key(uint64_t key);
+        // vk::Format of every attribute path.
+        void set_vertex_format(std::span<const uint32_t> vertex_format);
+
+        const uint8_t* get_blob_data(const blob& b) const;
+        uint64_t get_blobs_size() const;
+        uint64_t get_sources_size() const;
+        uint64_t get_key() const;
+
+        // set only for caches which were just baked with optimized meshes, it isn't saved.
+        const std::optional<mesh_optimization_statistics>& get_optimization_statistics() const;
+
+    private:
+        uint64_t m_key{0};
+
+        // vk::Format of every attribute path. it differs from the builder format if quantized attributes are kept.
+        std::vector<uint32_t> m_vertex_format{};
+        std::vector<source> m_sources{};
+        std::vector<primitive> m_primitives{};
+        std::vector<mesh> m_meshes{};
+        std::vector<skin> m_skins{};
+        std::vector<animation> m_animations{};
+        std::vector<image> m_images{};
+        std::vector<texture> m_textures{};
+        std::vector<material> m_materials{};
+
+        std::optional<mesh_optimization_statistics> m_optimization_statistics{};
+
+        // shared by all animations.
+        blob m_anim_nodes{};
+        blob m_anim_exec_order{};
+
+        // blobs are kept in memory while baking and in the mapped file after open.
+        std::vector<uint8_t> m_blobs{};
+        utils::data m_mapping{};
+        uint64_t m_mapped_blobs_offset{0};
+        uint64_t m_mapped_blobs_size{0};
+    };
+} // namespace sandbox::gltf
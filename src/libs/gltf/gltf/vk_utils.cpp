@@ -3,9 +3,31 @@
 #include <render/vk/utils.hpp>
 #include <utils/conditions_helpers.hpp>
 
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <limits>
+
 using namespace sandbox;
 using namespace sandbox::hal::render;
 
+namespace
+{
+    uint64_t get_index_size(vk::IndexType index_type)
+    {
+        switch (index_type) {
+            case vk::IndexType::eUint8EXT:
+                return 1;
+            case vk::IndexType::eUint16:
+                return 2;
+            case vk::IndexType::eUint32:
+                return 4;
+            default:
+                throw std::runtime_error("Bad index type.");
+        }
+    }
+} // namespace
+
 
 vk::IndexType sandbox::gltf::to_vk_index_type(
     sandbox::gltf::accessor_type accessor_type,
@@ -108,21 +130,79 @@ vk::Format sandbox::gltf::to_vk_format(
 }
 
 
-void sandbox::gltf::draw_primitive(const gltf::vk_primitive& primitive, vk::CommandBuffer& command_buffer)
+void sandbox::gltf::draw_primitive(const gltf::vk_primitive& primitive, vk::CommandBuffer& command_buffer, uint32_t lod)
 {
     const auto& vert_buffer = primitive.get_vertex_buffer();
 
-    command_buffer.bindVertexBuffers(0, {vert_buffer}, {vert_buffer.get_offset()});
+    if (primitive.get_vertices_count() == 0) {
+        return;
+    }
+
+    // counts and first elements of draws are 32-bit, so bigger primitives are drawn in parts with rebound buffers.
+    // the part size is a multiple of 3, so triangles aren't split between draws.
+    constexpr uint64_t max_part_size = std::numeric_limits<uint32_t>::max();
 
     if (primitive.get_indices_count() > 0) {
-        command_buffer.bindIndexBuffer(primitive.get_index_buffer(), primitive.get_index_buffer().get_offset(), primitive.get_indices_type());
-        command_buffer.drawIndexed(primitive.get_indices_count(), 1, 0, 0, 0);
+        const auto& index_buffer = primitive.get_index_buffer();
+        const auto& lods = primitive.get_lods();
+        const auto& curr_lod = lods[std::min<size_t>(lod, lods.size() - 1)];
+        const uint64_t index_size = get_index_size(primitive.get_indices_type());
+
+        command_buffer.bindVertexBuffers(0, {vert_buffer}, {vert_buffer.get_offset()});
+
+        for (uint64_t first = 0; first < curr_lod.indices_count; first += max_part_size) {
+            command_buffer.bindIndexBuffer(index_buffer, index_buffer.get_offset() + (curr_lod.first_index + first) * index_size, primitive.get_indices_type());
+            command_buffer.drawIndexed(static_cast<uint32_t>(std::min(max_part_size, curr_lod.indices_count - first)), 1, 0, 0, 0);
+        }
     } else {
-        command_buffer.draw(primitive.get_indices_count(), 1, 0, 0);
+        const uint64_t vertices_count = primitive.get_vertices_count();
+        const uint64_t vertex_size = vert_buffer.get_size() / vertices_count;
+
+        for (uint64_t first = 0; first < vertices_count; first += max_part_size) {
+            command_buffer.bindVertexBuffers(0, {vert_buffer}, {vert_buffer.get_offset() + first * vertex_size});
+            command_buffer.draw(static_cast<uint32_t>(std::min(max_part_size, vertices_count - first)), 1, 0, 0);
+        }
     }
 }
 
 
+uint32_t sandbox::gltf::select_lod(
+    const gltf::vk_primitive& primitive,
+    const glm::mat4& model_view,
+    float projection_scale,
+    float max_screen_error)
+{
+    const auto& lods = primitive.get_lods();
+    const auto& bounds = primitive.get_bounds();
+
+    if (lods.size() <= 1 || bounds.is_empty()) {
+        return 0;
+    }
+
+    const float scale = std::max({
+        glm::length(glm::vec3(model_view[0])),
+        glm::length(glm::vec3(model_view[1])),
+        glm::length(glm::vec3(model_view[2]))});
+
+    // errors are projected at the nearest point of the bounding sphere, the camera inside of it sees the finest lod.
+    const float distance = glm::length(glm::vec3(model_view * glm::vec4(bounds.center, 1.0f))) - bounds.radius * scale;
+
+    if (distance <= 0) {
+        return 0;
+    }
+
+    const float pixels_per_unit = scale * projection_scale / distance;
+
+    uint32_t result = 0;
+
+    while (result + 1 < lods.size() && lods[result + 1].error * pixels_per_unit <= max_screen_error) {
+        ++result;
+    }
+
+    return result;
+}
+
+
 vk::SamplerAddressMode sandbox::gltf::to_vk_sampler_wrap(sandbox::gltf::sampler_wrap_type wrap)
 {
     switch (wrap) {
@@ -257,6 +337,156 @@ std::pair<gltf::accessor_type, gltf::component_type> gltf::from_vk_format(vk::Fo
 }
 
 
+gltf::vertex_format gltf::to_vertex_format(vk::Format format)
+{
+    switch (format) {
+        case vk::Format::eR8Unorm:
+            return {vertex_component::unorm8, 1};
+        case vk::Format::eR8G8Unorm:
+            return {vertex_component::unorm8, 2};
+        case vk::Format::eR8G8B8Unorm:
+            return {vertex_component::unorm8, 3};
+        case vk::Format::eR8G8B8A8Unorm:
+            return {vertex_component::unorm8, 4};
+
+        case vk::Format::eR8Snorm:
+            return {vertex_component::snorm8, 1};
+        case vk::Format::eR8G8Snorm:
+            return {vertex_component::snorm8, 2};
+        case vk::Format::eR8G8B8Snorm:
+            return {vertex_component::snorm8, 3};
+        case vk::Format::eR8G8B8A8Snorm:
+            return {vertex_component::snorm8, 4};
+
+        case vk::Format::eR8Uint:
+            return {vertex_component::uint8, 1};
+        case vk::Format::eR8G8Uint:
+            return {vertex_component::uint8, 2};
+        case vk::Format::eR8G8B8Uint:
+            return {vertex_component::uint8, 3};
+        case vk::Format::eR8G8B8A8Uint:
+            return {vertex_component::uint8, 4};
+
+        case vk::Format::eR8Sint:
+            return {vertex_component::sint8, 1};
+        case vk::Format::eR8G8Sint:
+            return {vertex_component::sint8, 2};
+        case vk::Format::eR8G8B8Sint:
+            return {vertex_component::sint8, 3};
+        case vk::Format::eR8G8B8A8Sint:
+            return {vertex_component::sint8, 4};
+
+        // scaled formats keep integers in memory, shaders read them as floats.
+        case vk::Format::eR8G8B8A8Uscaled:
+            return {vertex_component::uint8, 4};
+        case vk::Format::eR8G8B8A8Sscaled:
+            return {vertex_component::sint8, 4};
+        case vk::Format::eR16G16Uscaled:
+            return {vertex_component::uint16, 2};
+        case vk::Format::eR16G16B16A16Uscaled:
+            return {vertex_component::uint16, 4};
+        case vk::Format::eR16G16Sscaled:
+            return {vertex_component::sint16, 2};
+        case vk::Format::eR16G16B16A16Sscaled:
+            return {vertex_component::sint16, 4};
+
+        case vk::Format::eR16Unorm:
+            return {vertex_component::unorm16, 1};
+        case vk::Format::eR16G16Unorm:
+            return {vertex_component::unorm16, 2};
+        case vk::Format::eR16G16B16Unorm:
+            return {vertex_component::unorm16, 3};
+        case vk::Format::eR16G16B16A16Unorm:
+            return {vertex_component::unorm16, 4};
+
+        case vk::Format::eR16Snorm:
+            return {vertex_component::snorm16, 1};
+        case vk::Format::eR16G16Snorm:
+            return {vertex_component::snorm16, 2};
+        case vk::Format::eR16G16B16Snorm:
+            return {vertex_component::snorm16, 3};
+        case vk::Format::eR16G16B16A16Snorm:
+            return {vertex_component::snorm16, 4};
+
+        case vk::Format::eR16Uint:
+            return {vertex_component::uint16, 1};
+        case vk::Format::eR16G16Uint:
+            return {vertex_component::uint16, 2};
+        case vk::Format::eR16G16B16Uint:
+            return {vertex_component::uint16, 3};
+        case vk::Format::eR16G16B16A16Uint:
+            return {vertex_component::uint16, 4};
+
+        case vk::Format::eR16Sint:
+            return {vertex_component::sint16, 1};
+        case vk::Format::eR16G16Sint:
+            return {vertex_component::sint16, 2};
+        case vk::Format::eR16G16B16Sint:
+            return {vertex_component::sint16, 3};
+        case vk::Format::eR16G16B16A16Sint:
+            return {vertex_component::sint16, 4};
+
+        case vk::Format::eR16Sfloat:
+            return {vertex_component::float16, 1};
+        case vk::Format::eR16G16Sfloat:
+            return {vertex_component::float16, 2};
+        case vk::Format::eR16G16B16Sfloat:
+            return {vertex_component::float16, 3};
+        case vk::Format::eR16G16B16A16Sfloat:
+            return {vertex_component::float16, 4};
+
+        case vk::Format::eR32Uint:
+            return {vertex_component::uint32, 1};
+        case vk::Format::eR32G32Uint:
+            return {vertex_component::uint32, 2};
+        case vk::Format::eR32G32B32Uint:
+            return {vertex_component::uint32, 3};
+        case vk::Format::eR32G32B32A32Uint:
+            return {vertex_component::uint32, 4};
+
+        case vk::Format::eR32Sfloat:
+            return {vertex_component::float32, 1};
+        case vk::Format::eR32G32Sfloat:
+            return {vertex_component::float32, 2};
+        case vk::Format::eR32G32B32Sfloat:
+            return {vertex_component::float32, 3};
+        case vk::Format::eR32G32B32A32Sfloat:
+            return {vertex_component::float32, 4};
+        default:
+            throw std::runtime_error("Unsupported vertex format.");
+    }
+}
+
+
+vk::Format gltf::to_vk_quantized_vertex_format(vertex_format format)
+{
+    // three component formats are optional for vertex buffers, so they are padded. 8 bit attributes are padded
+    // to 4 components, so every attribute offset stays aligned to 4 bytes.
+    const bool two_components = format.components_count <= 2;
+
+    switch (format.component) {
+        case vertex_component::unorm8:
+            return vk::Format::eR8G8B8A8Unorm;
+        case vertex_component::snorm8:
+            return vk::Format::eR8G8B8A8Snorm;
+        case vertex_component::uint8:
+            return vk::Format::eR8G8B8A8Uscaled;
+        case vertex_component::sint8:
+            return vk::Format::eR8G8B8A8Sscaled;
+        case vertex_component::unorm16:
+            return two_components ? vk::Format::eR16G16Unorm : vk::Format::eR16G16B16A16Unorm;
+        case vertex_component::snorm16:
+            return two_components ? vk::Format::eR16G16Snorm : vk::Format::eR16G16B16A16Snorm;
+        case vertex_component::uint16:
+            return two_components ? vk::Format::eR16G16Uscaled : vk::Format::eR16G16B16A16Uscaled;
+        case vertex_component::sint16:
+            return two_components ? vk::Format::eR16G16Sscaled : vk::Format::eR16G16B16A16Sscaled;
+        default:
+            throw std::runtime_error("Vertex format is not quantized.");
+    }
+}
+
+
 sandbox::gltf::vk_material_info sandbox::gltf::vk_material_info::from_gltf_material(const sandbox::gltf::material& material)
 {
     auto get_texture_cords_set = [](const gltf::material::texture_data& tex_data) {
@@ -318,8 +548,6 @@ void gltf::cpu_animation_controller::pause()
 void gltf::cpu_animation_controller::calculate_frame(const gltf::model& model)
 {
     const auto& accessors = model.get_accessors();
-    const auto& buffers = model.get_buffers();
-    const auto& buffer_views = model.get_buffer_views();
 
     const auto& channels = m_animation.get_channels();
     const auto& samplers = m_animation.get_samplers();
@@ -332,15 +560,16 @@ void gltf::cpu_animation_controller::calculate_frame(const gltf::model& model)
     for (const auto& channel : channels) {
         const auto& sampler = samplers[channel.get_sampler()];
 
-        auto input_accessor = accessors[sampler.get_input()];
-        auto output_accessor = accessors[sampler.get_output()];
+        const auto& input_accessor = accessors[sampler.get_input()];
+        const auto& output_accessor = accessors[sampler.get_output()];
 
         if (m_curr_key >= input_accessor.get_count()) {
             continue;
         }
 
-        const auto* keys = (const float*) input_accessor.get_data(buffers.data(), buffers.size(), buffer_views.data(), buffer_views.size());
-        const auto* vals = output_accessor.get_data(buffers.data(), buffers.size(), buffer_views.data(), buffer_views.size());
+        // sparse keys and values are materialized by the model.
+        const auto* keys = (const float*) model.get_accessor_data(sampler.get_input());
+        const auto* vals = model.get_accessor_data(sampler.get_output());
 
         assert(input_accessor.get_component_type() == component_type::float32);
         assert(input_accessor.get_type() == accessor_type::scalar);
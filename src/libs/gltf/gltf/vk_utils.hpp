@@ -1,6 +1,7 @@
 #pragma once
 
 #include <gltf/gltf_vk.hpp>
+#include <gltf/vertex_conversion.hpp>
 #include <render/vk/raii.hpp>
 
 namespace sandbox::gltf
@@ -53,6 +54,9 @@ namespace sandbox::gltf
 
     vk::Format to_vk_format(accessor_type accessor_type, component_type component_type);
     std::pair<accessor_type, component_type> from_vk_format(vk::Format);
+    vertex_format to_vertex_format(vk::Format);
+    // format which gpu reads quantized attributes with as is. integers are read as floats without normalization.
+    vk::Format to_vk_quantized_vertex_format(vertex_format);
 
     vk::IndexType to_vk_index_type(accessor_type accessor_type, component_type component_type);
     std::pair<vk::Filter, vk::SamplerMipmapMode> to_vk_sampler_filter(sampler_filter_type filter);
@@ -62,7 +66,16 @@ namespace sandbox::gltf
 
     void draw_primitive(
         const gltf::vk_primitive& primitive,
-        vk::CommandBuffer& command_buffer);
+        vk::CommandBuffer& command_buffer,
+        uint32_t lod = 0);
+
+    // the coarsest lod of the primitive which error is projected to at most max_screen_error pixels. model_view places
+    // the primitive in view space, projection_scale is proj[1][1] multiplied by half of the viewport height in pixels.
+    uint32_t select_lod(
+        const gltf::vk_primitive& primitive,
+        const glm::mat4& model_view,
+        float projection_scale,
+        float max_screen_error = 1.0f);
 
     vk::Format stb_channels_count_to_vk_format(int32_t);
 
@@ -0,0 +1,474 @@
+#include "async_reader.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #define SANDBOX_HAS_IO_URING 1
+    #include <atomic>
+    #include <cerrno>
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    // single sqe can't read more than 4gb, so big reads are split.
+    constexpr size_t max_read_size = size_t{1} << 30;
+} // namespace
+
+
+#ifdef SANDBOX_HAS_IO_URING
+
+class sandbox::hal::filesystem::async_reader::io_uring_queue
+{
+public:
+    static std::unique_ptr<io_uring_queue> create(uint32_t queue_depth)
+    {
+        std::unique_ptr<io_uring_queue> queue{new io_uring_queue()};
+
+        if (!queue->init(queue_depth)) {
+            return nullptr;
+        }
+
+        queue->m_thread = std::thread([queue = queue.get()]() { queue->completion_loop(); });
+
+        return queue;
+    }
+
+    io_uring_queue(const io_uring_queue&) = delete;
+    io_uring_queue& operator=(const io_uring_queue&) = delete;
+    io_uring_queue(io_uring_queue&&) noexcept = delete;
+    io_uring_queue& operator=(io_uring_queue&&) noexcept = delete;
+
+    ~io_uring_queue()
+    {
+        if (m_thread.joinable()) {
+            {
+                std::lock_guard lock{m_mutex};
+                m_stop = true;
+
+                // completion thread is blocked in the kernel, wake it up with an empty request.
+                if (m_in_flight == 0) {
+                    auto* sqe = next_sqe();
+                    sqe->opcode = IORING_OP_NOP;
+                    sqe->user_data = 0;
+                    m_in_flight++;
+                    enter(1, 0, 0);
+                }
+            }
+
+            m_thread.join();
+        }
+
+        if (m_sqes != nullptr) {
+            munmap(m_sqes, m_sqes_size);
+        }
+
+        if (m_cq_ring != nullptr && m_cq_ring != m_sq_ring) {
+            munmap(m_cq_ring, m_cq_ring_size);
+        }
+
+        if (m_sq_ring != nullptr) {
+            munmap(m_sq_ring, m_sq_ring_size);
+        }
+
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    void submit(std::vector<std::unique_ptr<operation>> ops)
+    {
+        std::lock_guard lock{m_mutex};
+
+        for (auto& op : ops) {
+            m_pending.emplace_back(std::move(op));
+        }
+
+        flush_pending();
+    }
+
+private:
+    io_uring_queue() = default;
+
+    bool init(uint32_t queue_depth)
+    {
+        io_uring_params params{};
+        m_fd = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &params));
+
+        if (m_fd < 0) {
+            return false;
+        }
+
+        // plain read opcode appeared together with this feature.
+        if ((params.features & IORING_FEAT_RW_CUR_POS) == 0) {
+            return false;
+        }
+
+        m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+        }
+
+        m_sq_ring = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (m_sq_ring == MAP_FAILED) {
+            m_sq_ring = nullptr;
+            return false;
+        }
+
+        if (single_mmap) {
+            m_cq_ring = m_sq_ring;
+        } else {
+            m_cq_ring = mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+            if (m_cq_ring == MAP_FAILED) {
+                m_cq_ring = nullptr;
+                return false;
+            }
+        }
+
+        m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        auto* sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+        m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq_ptr = static_cast<uint8_t*>(m_sq_ring);
+        m_sq_tail = reinterpret_cast<uint32_t*>(sq_ptr + params.sq_off.tail);
+        m_sq_mask = *reinterpret_cast<uint32_t*>(sq_ptr + params.sq_off.ring_mask);
+        m_sq_array = reinterpret_cast<uint32_t*>(sq_ptr + params.sq_off.array);
+
+        auto* cq_ptr = static_cast<uint8_t*>(m_cq_ring);
+        m_cq_head = reinterpret_cast<uint32_t*>(cq_ptr + params.cq_off.head);
+        m_cq_tail = reinterpret_cast<uint32_t*>(cq_ptr + params.cq_off.tail);
+        m_cq_mask = *reinterpret_cast<uint32_t*>(cq_ptr + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cq_ptr + params.cq_off.cqes);
+
+        // completion queue is at least as big as submission queue, so it never overflows.
+        m_capacity = params.sq_entries;
+
+        return true;
+    }
+
+    int enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags)
+    {
+        int result;
+
+        do {
+            result = static_cast<int>(syscall(__NR_io_uring_enter, m_fd, to_submit, min_complete, flags, nullptr, 0));
+        } while (result < 0 && errno == EINTR);
+
+        return result;
+    }
+
+    io_uring_sqe* next_sqe()
+    {
+        const uint32_t tail = *m_sq_tail;
+        const uint32_t index = tail & m_sq_mask;
+
+        auto* sqe = &m_sqes[index];
+        *sqe = {};
+        m_sq_array[index] = index;
+
+        std::atomic_ref<uint32_t>(*m_sq_tail).store(tail + 1, std::memory_order_release);
+
+        return sqe;
+    }
+
+    void flush_pending()
+    {
+        uint32_t to_submit = m_unsubmitted;
+
+        while (!m_pending.empty() && m_in_flight < m_capacity) {
+            auto* op = m_pending.front().release();
+            m_pending.pop_front();
+
+            auto* sqe = next_sqe();
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = op->file->get_native_handle();
+            sqe->off = op->offset + op->done;
+            sqe->addr = reinterpret_cast<uint64_t>(op->buffer.get() + op->done);
+            sqe->len = static_cast<uint32_t>(std::min(op->size - op->done, max_read_size));
+            sqe->user_data = reinterpret_cast<uint64_t>(op);
+
+            m_in_flight++;
+            to_submit++;
+        }
+
+        if (to_submit == 0) {
+            return;
+        }
+
+        // entries which kernel did not consume stay in the ring and are submitted by the next call.
+        const int submitted = enter(to_submit, 0, 0);
+        m_unsubmitted = submitted < 0 ? to_submit : to_submit - static_cast<uint32_t>(submitted);
+    }
+
+    void completion_loop()
+    {
+        std::vector<std::pair<std::unique_ptr<operation>, std::exception_ptr>> completed{};
+        std::vector<std::unique_ptr<operation>> resubmitted{};
+
+        while (true) {
+            enter(0, 1, IORING_ENTER_GETEVENTS);
+
+            bool stop;
+
+            // operations are handed over through the kernel, the lock makes this handover visible to thread checkers too.
+            std::unique_lock lock{m_mutex};
+
+            uint32_t head = *m_cq_head;
+            const uint32_t tail = std::atomic_ref<uint32_t>(*m_cq_tail).load(std::memory_order_acquire);
+            uint32_t reaped = 0;
+
+            for (; head != tail; ++head, ++reaped) {
+                const auto& cqe = m_cqes[head & m_cq_mask];
+
+                if (cqe.user_data == 0) {
+                    continue;
+                }
+
+                std::unique_ptr<operation> op{reinterpret_cast<operation*>(cqe.user_data)};
+
+                if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                    resubmitted.emplace_back(std::move(op));
+                } else if (cqe.res < 0) {
+                    auto error = std::make_exception_ptr(std::runtime_error("cannot read file " + op->file->get_path() + "."));
+                    completed.emplace_back(std::move(op), error);
+                } else {
+                    op->done += static_cast<size_t>(cqe.res);
+
+                    // zero bytes means the end of file, shorter result is returned in this case.
+                    if (cqe.res == 0 || op->done == op->size) {
+                        completed.emplace_back(std::move(op), nullptr);
+                    } else {
+                        resubmitted.emplace_back(std::move(op));
+                    }
+                }
+            }
+
+            std::atomic_ref<uint32_t>(*m_cq_head).store(head, std::memory_order_release);
+
+            m_in_flight -= reaped;
+
+            for (auto it = resubmitted.rbegin(); it != resubmitted.rend(); ++it) {
+                m_pending.emplace_front(std::move(*it));
+            }
+            resubmitted.clear();
+
+            flush_pending();
+
+            stop = m_stop && m_in_flight == 0 && m_pending.empty();
+
+            lock.unlock();
+
+            for (auto& [op, error] : completed) {
+                async_reader::complete(std::move(op), error);
+            }
+            completed.clear();
+
+            if (stop) {
+                break;
+            }
+        }
+    }
+
+    int m_fd{-1};
+
+    void* m_sq_ring{nullptr};
+    size_t m_sq_ring_size{0};
+    void* m_cq_ring{nullptr};
+    size_t m_cq_ring_size{0};
+    io_uring_sqe* m_sqes{nullptr};
+    size_t m_sqes_size{0};
+
+    uint32_t* m_sq_tail{nullptr};
+    uint32_t m_sq_mask{0};
+    uint32_t* m_sq_array{nullptr};
+
+    uint32_t* m_cq_head{nullptr};
+    uint32_t* m_cq_tail{nullptr};
+    uint32_t m_cq_mask{0};
+    io_uring_cqe* m_cqes{nullptr};
+
+    uint32_t m_capacity{0};
+    uint32_t m_in_flight{0};
+    uint32_t m_unsubmitted{0};
+
+    std::mutex m_mutex{};
+    std::deque<std::unique_ptr<operation>> m_pending{};
+    bool m_stop{false};
+    std::thread m_thread{};
+};
+
+#else
+
+class sandbox::hal::filesystem::async_reader::io_uring_queue
+{
+public:
+    static std::unique_ptr<io_uring_queue> create(uint32_t)
+    {
+        return nullptr;
+    }
+
+    void submit(std::vector<std::unique_ptr<operation>>)
+    {
+    }
+};
+
+#endif
+
+
+sandbox::hal::filesystem::async_reader::async_reader(utils::thread_pool* fallback_pool, uint32_t queue_depth)
+    : m_ring(io_uring_queue::create(queue_depth))
+    , m_pool(fallback_pool)
+{
+    if (m_ring == nullptr && m_pool == nullptr) {
+        // workers spend most of the time blocked in the kernel, so a few of them are enough.
+        m_own_pool = std::make_unique<utils::thread_pool>(std::clamp(std::thread::hardware_concurrency(), 2u, 8u));
+        m_pool = m_own_pool.get();
+    }
+}
+
+
+sandbox::hal::filesystem::async_reader::~async_reader() = default;
+
+
+std::future<sandbox::utils::data> sandbox::hal::filesystem::async_reader::read(request req)
+{
+    auto result = read_batch({std::move(req)});
+    return std::move(result.front());
+}
+
+
+void sandbox::hal::filesystem::async_reader::read(request req, completion_callback callback)
+{
+    std::vector<std::unique_ptr<operation>> ops{};
+    ops.emplace_back(create_operation(std::move(req), std::move(callback)));
+    submit(std::move(ops));
+}
+
+
+std::vector<std::future<sandbox::utils::data>> sandbox::hal::filesystem::async_reader::read_batch(std::vector<request> requests)
+{
+    std::vector<std::future<utils::data>> result{};
+    result.reserve(requests.size());
+
+    std::vector<std::unique_ptr<operation>> ops{};
+    ops.reserve(requests.size());
+
+    for (auto& req : requests) {
+        auto promise = std::make_shared<std::promise<utils::data>>();
+        result.emplace_back(promise->get_future());
+
+        ops.emplace_back(create_operation(std::move(req), [promise](utils::data data, std::exception_ptr error) {
+            if (error) {
+                promise->set_exception(error);
+            } else {
+                promise->set_value(std::move(data));
+            }
+        }));
+    }
+
+    submit(std::move(ops));
+
+    return result;
+}
+
+
+bool sandbox::hal::filesystem::async_reader::is_io_uring_enabled() const
+{
+    return m_ring != nullptr;
+}
+
+
+sandbox::hal::filesystem::async_reader& sandbox::hal::filesystem::async_reader::global()
+{
+    static async_reader instance{};
+    return instance;
+}
+
+
+std::unique_ptr<sandbox::hal::filesystem::async_reader::operation> sandbox::hal::filesystem::async_reader::create_operation(
+    request&& req, completion_callback&& callback)
+{
+    if (req.file == nullptr) {
+        throw std::invalid_argument("async read request without a file.");
+    }
+
+    auto op = std::make_unique<operation>();
+
+    const auto file_size = req.file->get_size();
+    const auto offset = std::min<uint64_t>(req.offset, file_size);
+
+    op->size = req.size ? *req.size : static_cast<size_t>(file_size - offset);
+    op->offset = offset;
+    op->file = std::move(req.file);
+    op->callback = std::move(callback);
+
+    if (op->size > 0) {
+        op->buffer.reset(new uint8_t[op->size]);
+    }
+
+    return op;
+}
+
+
+void sandbox::hal::filesystem::async_reader::complete(std::unique_ptr<operation> op, std::exception_ptr error)
+{
+    utils::data result{};
+
+    if (!error && op->done > 0) {
+        result = utils::data::create_owning(
+            op->buffer.release(), [](uint8_t* data) { delete[] data; }, op->done);
+    }
+
+    op->callback(std::move(result), error);
+}
+
+
+void sandbox::hal::filesystem::async_reader::submit(std::vector<std::unique_ptr<operation>> ops)
+{
+    std::vector<std::unique_ptr<operation>> ring_ops{};
+
+    for (auto& op : ops) {
+        // nothing to read, so there is no reason to go to the kernel.
+        if (op->size == 0) {
+            complete(std::move(op), nullptr);
+        } else if (m_ring != nullptr) {
+            ring_ops.emplace_back(std::move(op));
+        } else {
+            submit_to_pool(std::move(op));
+        }
+    }
+
+    if (!ring_ops.empty()) {
+        m_ring->submit(std::move(ring_ops));
+    }
+}
+
+
+void sandbox::hal::filesystem::async_reader::submit_to_pool(std::unique_ptr<operation> op)
+{
+    m_pool->submit([op = std::move(op)]() mutable {
+        std::exception_ptr error{};
+
+        try {
+            op->done = op->file->read(op->buffer.get(), op->size, op->offset);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        complete(std::move(op), error);
+    });
+}
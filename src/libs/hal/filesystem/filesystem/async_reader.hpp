@@ -0,0 +1,73 @@
+#pragma once
+
+#include <filesystem/vfs.hpp>
+
+#include <utils/thread_pool.hpp>
+
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace sandbox::hal::filesystem
+{
+    // asynchronous positional reads. on linux requests are batched through io_uring when the kernel allows it,
+    // otherwise every request is a blocking read on a worker thread.
+    class async_reader
+    {
+    public:
+        struct request
+        {
+            std::shared_ptr<const shared_file> file{};
+            uint64_t offset{0};
+            // whole file from the offset if not set.
+            std::optional<size_t> size{};
+        };
+
+        // called on a reader thread, so it must be short. error is set if the read failed.
+        using completion_callback = std::function<void(utils::data, std::exception_ptr)>;
+
+        // fallback pool is used only if io_uring is not available. reader creates its own pool if it is not set.
+        explicit async_reader(utils::thread_pool* fallback_pool = nullptr, uint32_t queue_depth = 64);
+        async_reader(const async_reader&) = delete;
+        async_reader& operator=(const async_reader&) = delete;
+        async_reader(async_reader&&) noexcept = delete;
+        async_reader& operator=(async_reader&&) noexcept = delete;
+        ~async_reader();
+
+        std::future<utils::data> read(request req);
+        void read(request req, completion_callback callback);
+
+        // submits all requests at once, so io_uring gets them in a single system call.
+        std::vector<std::future<utils::data>> read_batch(std::vector<request> requests);
+
+        bool is_io_uring_enabled() const;
+
+        static async_reader& global();
+
+    private:
+        struct operation
+        {
+            std::shared_ptr<const shared_file> file{};
+            uint64_t offset{0};
+            size_t size{0};
+            size_t done{0};
+            std::unique_ptr<uint8_t[]> buffer{};
+            completion_callback callback{};
+        };
+
+        class io_uring_queue;
+
+        static std::unique_ptr<operation> create_operation(request&& req, completion_callback&& callback);
+        static void complete(std::unique_ptr<operation> op, std::exception_ptr error);
+
+        void submit(std::vector<std::unique_ptr<operation>> ops);
+        void submit_to_pool(std::unique_ptr<operation> op);
+
+        std::unique_ptr<io_uring_queue> m_ring{};
+        std::unique_ptr<utils::thread_pool> m_own_pool{};
+        utils::thread_pool* m_pool{nullptr};
+    };
+} // namespace sandbox::hal::filesystem
@@ -9,7 +9,7 @@ cannot_open_file_error::cannot_open_file_error(const std::string& err_msg)
 }
 
 
-const char* cannot_open_file_error::what() const
+const char* cannot_open_file_error::what() const noexcept
 {
     return m_err_msg.c_str();
 }
\ No newline at end of file
@@ -24,7 +24,7 @@ namespace sandbox::hal::filesystem
     public:
         cannot_open_file_error(const std::string&);
         ~cannot_open_file_error() noexcept override = default;
-        const char* what() const override;
+        const char* what() const noexcept override;
 
     private:
         std::string m_err_msg{};
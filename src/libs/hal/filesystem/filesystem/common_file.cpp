@@ -6,18 +6,6 @@
 sandbox::hal::filesystem::common_file::common_file(const std::string& mount_dir)
     : m_cwd(mount_dir)
 {
-    if (!m_cwd.empty()) {
-        m_prev_cwd = std::filesystem::current_path().string();
-        std::filesystem::current_path(m_cwd);
-    }
-}
-
-
-sandbox::hal::filesystem::common_file::~common_file()
-{
-    if (!m_prev_cwd.empty()) {
-        std::filesystem::current_path(m_prev_cwd);
-    }
 }
 
 
@@ -50,11 +38,12 @@ void sandbox::hal::filesystem::common_file::close()
 sandbox::utils::data sandbox::hal::filesystem::common_file::read_all()
 {
     if (!m_data_buffer.empty()) {
-        sandbox::utils::data::create_non_owning(m_data_buffer.data(), m_data_buffer.size());
+        return sandbox::utils::data::create_non_owning(m_data_buffer.data(), m_data_buffer.size());
     }
 
     if (const auto sz = get_size(); sz > 0) {
         m_data_buffer.resize(sz);
+        std::rewind(m_file_handler.get());
         std::fread(m_data_buffer.data(), 1, sz, m_file_handler.get());
         return sandbox::utils::data::create_non_owning(m_data_buffer.data(), sz);
     }
@@ -83,23 +72,22 @@ size_t sandbox::hal::filesystem::common_file::get_size()
 
 sandbox::utils::data sandbox::hal::filesystem::common_file::read_all_and_move()
 {
-    auto move_data = [this]() {
-        const auto sz = m_data_buffer.size();
-        auto data_buffer = new uint8_t[sz];
-        std::memcpy(data_buffer, m_data_buffer.data(), m_data_buffer.size());
-        return sandbox::utils::data::create_owning(
-            data_buffer, [](uint8_t* data) { delete[] data; }, sz);
-    };
-
-    if (!m_data_buffer.empty()) {
-        return move_data();
+    if (m_data_buffer.empty()) {
+        if (const auto sz = get_size(); sz > 0) {
+            m_data_buffer.resize(sz);
+            std::rewind(m_file_handler.get());
+            std::fread(m_data_buffer.data(), 1, sz, m_file_handler.get());
+        }
     }
 
-    if (const auto sz = get_size(); sz > 0) {
-        m_data_buffer.resize(sz);
-        std::fread(m_data_buffer.data(), 1, sz, m_file_handler.get());
-        return move_data();
+    if (m_data_buffer.empty()) {
+        return {};
     }
 
-    return {};
+    // hand the read buffer over instead of copying it.
+    auto moved_buffer = new std::vector<uint8_t>(std::move(m_data_buffer));
+    m_data_buffer.clear();
+
+    return sandbox::utils::data::create_owning(
+        moved_buffer->data(), [moved_buffer](uint8_t*) { delete moved_buffer; }, moved_buffer->size());
 }
@@ -16,7 +16,7 @@ namespace sandbox::hal::filesystem
         common_file& operator=(const common_file&) = delete;
         common_file(common_file&&) noexcept = default;
         common_file& operator=(common_file&&) noexcept = default;
-        ~common_file() override;
+        ~common_file() override = default;
 
         void open(const std::string& url) override;
         void close() override;
@@ -30,6 +30,5 @@ namespace sandbox::hal::filesystem
         size_t m_size{0};
         std::vector<uint8_t> m_data_buffer{};
         std::string m_cwd{};
-        std::string m_prev_cwd{};
     };
 } // namespace sandbox::hal::filesystem
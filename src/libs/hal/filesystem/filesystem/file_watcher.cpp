@@ -0,0 +1,283 @@
+#include "file_watcher.hpp"
+
+#include <filesystem>
+#include <unordered_set>
+
+#ifdef __linux__
+    #define SANDBOX_HAS_INOTIFY 1
+    #include <cerrno>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    std::string get_watched_path(const std::string& resolved_path)
+    {
+        return std::filesystem::absolute(resolved_path).lexically_normal().string();
+    }
+} // namespace
+
+
+#ifdef SANDBOX_HAS_INOTIFY
+
+class sandbox::hal::filesystem::file_watcher::inotify_queue
+{
+public:
+    static std::unique_ptr<inotify_queue> create()
+    {
+        const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+        if (fd < 0) {
+            return nullptr;
+        }
+
+        return std::unique_ptr<inotify_queue>{new inotify_queue(fd)};
+    }
+
+    inotify_queue(const inotify_queue&) = delete;
+    inotify_queue& operator=(const inotify_queue&) = delete;
+    inotify_queue(inotify_queue&&) noexcept = delete;
+    inotify_queue& operator=(inotify_queue&&) noexcept = delete;
+
+    ~inotify_queue()
+    {
+        ::close(m_fd);
+    }
+
+    // returns false if the directory of the file can't be watched.
+    bool add(const std::string& path)
+    {
+        const auto directory = std::filesystem::path(path).parent_path().string();
+        const auto it = m_directories.find(directory);
+
+        if (it != m_directories.end()) {
+            ++it->second.files;
+            return true;
+        }
+
+        // files are replaced by rename more often than they are rewritten, so the directory is watched instead of the file.
+        const int wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR);
+
+        if (wd < 0) {
+            return false;
+        }
+
+        m_directories.emplace(directory, watched_directory{.wd = wd, .files = 1});
+        m_paths.emplace(wd, directory);
+
+        return true;
+    }
+
+    void remove(const std::string& path)
+    {
+        const auto it = m_directories.find(std::filesystem::path(path).parent_path().string());
+
+        if (it == m_directories.end() || --it->second.files > 0) {
+            return;
+        }
+
+        inotify_rm_watch(m_fd, it->second.wd);
+        m_paths.erase(it->second.wd);
+        m_directories.erase(it);
+    }
+
+    // returns paths of files which were written in watched directories. overflow is set if the kernel dropped events.
+    std::vector<std::string> read_events(bool& overflow)
+    {
+        std::vector<std::string> result{};
+        alignas(inotify_event) char buffer[4096];
+
+        while (true) {
+            const auto size = ::read(m_fd, buffer, sizeof(buffer));
+
+            if (size <= 0) {
+                // EAGAIN when there are no more events.
+                break;
+            }
+
+            for (ssize_t offset = 0; offset < size;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                if ((event->mask & IN_Q_OVERFLOW) != 0) {
+                    overflow = true;
+                    continue;
+                }
+
+                const auto it = m_paths.find(event->wd);
+
+                if (it == m_paths.end() || event->len == 0) {
+                    continue;
+                }
+
+                result.emplace_back((std::filesystem::path(it->second) / event->name).string());
+            }
+        }
+
+        return result;
+    }
+
+private:
+    struct watched_directory
+    {
+        int wd{-1};
+        uint32_t files{0};
+    };
+
+    explicit inotify_queue(int fd)
+        : m_fd(fd)
+    {
+    }
+
+    int m_fd{-1};
+    std::unordered_map<std::string, watched_directory> m_directories{};
+    std::unordered_map<int, std::string> m_paths{};
+};
+
+#else
+
+class sandbox::hal::filesystem::file_watcher::inotify_queue
+{
+public:
+    static std::unique_ptr<inotify_queue> create()
+    {
+        return nullptr;
+    }
+
+    bool add(const std::string&)
+    {
+        return false;
+    }
+
+    void remove(const std::string&)
+    {
+    }
+
+    std::vector<std::string> read_events(bool&)
+    {
+        return {};
+    }
+};
+
+#endif
+
+
+sandbox::hal::filesystem::file_watcher::file_watcher(vfs& file_system)
+    : m_vfs(&file_system)
+    , m_inotify(inotify_queue::create())
+{
+}
+
+
+sandbox::hal::filesystem::file_watcher::~file_watcher() = default;
+
+
+void sandbox::hal::filesystem::file_watcher::watch(const std::string& url)
+{
+    const auto path = get_watched_path(m_vfs->resolve(url));
+
+    if (m_files.contains(path)) {
+        return;
+    }
+
+    watched_file file{.url = url};
+    get_file_state(path, file.write_time, file.size);
+    file.polled = m_inotify == nullptr || !m_inotify->add(path);
+
+    m_files.emplace(path, std::move(file));
+}
+
+
+void sandbox::hal::filesystem::file_watcher::unwatch(const std::string& url)
+{
+    const auto it = m_files.find(get_watched_path(m_vfs->resolve(url)));
+
+    if (it == m_files.end()) {
+        return;
+    }
+
+    if (!it->second.polled) {
+        m_inotify->remove(it->first);
+    }
+
+    m_files.erase(it);
+}
+
+
+std::vector<std::string> sandbox::hal::filesystem::file_watcher::poll()
+{
+    std::unordered_set<const watched_file*> changed{};
+    bool overflow = false;
+
+    if (m_inotify != nullptr) {
+        for (const auto& path : m_inotify->read_events(overflow)) {
+            const auto it = m_files.find(path);
+
+            if (it != m_files.end()) {
+                // the state is updated anyway, so the change isn't reported again after an overflow.
+                update_file_state(path, it->second);
+                changed.emplace(&it->second);
+            }
+        }
+    }
+
+    for (auto& [path, file] : m_files) {
+        if ((file.polled || overflow) && update_file_state(path, file)) {
+            changed.emplace(&file);
+        }
+    }
+
+    std::vector<std::string> result{};
+    result.reserve(changed.size());
+
+    for (const auto* file : changed) {
+        result.emplace_back(file->url);
+    }
+
+    return result;
+}
+
+
+bool sandbox::hal::filesystem::file_watcher::is_inotify_enabled() const
+{
+    return m_inotify != nullptr;
+}
+
+
+void sandbox::hal::filesystem::file_watcher::get_file_state(const std::string& path, int64_t& write_time, uint64_t& size)
+{
+    std::error_code error{};
+    const auto time = std::filesystem::last_write_time(path, error);
+
+    // missing files get the state which differs from any existing file, so their creation is reported.
+    if (error) {
+        write_time = -1;
+        size = 0;
+        return;
+    }
+
+    write_time = static_cast<int64_t>(time.time_since_epoch().count());
+    size = std::filesystem::file_size(path, error);
+
+    if (error) {
+        size = 0;
+    }
+}
+
+
+bool sandbox::hal::filesystem::file_watcher::update_file_state(const std::string& path, watched_file& file)
+{
+    int64_t write_time{0};
+    uint64_t size{0};
+    get_file_state(path, write_time, size);
+
+    if (write_time == file.write_time && size == file.size) {
+        return false;
+    }
+
+    file.write_time = write_time;
+    file.size = size;
+
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <filesystem/vfs.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sandbox::hal::filesystem
+{
+    // reports files which were written since the last poll. on linux directories of watched files are watched through
+    // inotify, so files which are replaced by rename, as editors and compilers save them, are reported too.
+    // files of directories which can't be watched and all files on other platforms are checked by their write times.
+    class file_watcher
+    {
+    public:
+        explicit file_watcher(vfs& file_system = vfs::global());
+        file_watcher(const file_watcher&) = delete;
+        file_watcher& operator=(const file_watcher&) = delete;
+        file_watcher(file_watcher&&) noexcept = delete;
+        file_watcher& operator=(file_watcher&&) noexcept = delete;
+        ~file_watcher();
+
+        // url is resolved through the vfs when it is added. the file doesn't have to exist yet.
+        void watch(const std::string& url);
+        void unwatch(const std::string& url);
+
+        // never blocks, so it can be called every frame. returns urls as they were passed to watch,
+        // several writes of a file between polls are reported once.
+        std::vector<std::string> poll();
+
+        bool is_inotify_enabled() const;
+
+    private:
+        struct watched_file
+        {
+            std::string url{};
+            int64_t write_time{0};
+            uint64_t size{0};
+            // the directory isn't watched by inotify, write time is checked on every poll.
+            bool polled{true};
+        };
+
+        class inotify_queue;
+
+        static void get_file_state(const std::string& path, int64_t& write_time, uint64_t& size);
+        static bool update_file_state(const std::string& path, watched_file& file);
+
+        vfs* m_vfs{nullptr};
+        std::unique_ptr<inotify_queue> m_inotify{};
+
+        // keyed by resolved paths.
+        std::unordered_map<std::string, watched_file> m_files{};
+    };
+} // namespace sandbox::hal::filesystem
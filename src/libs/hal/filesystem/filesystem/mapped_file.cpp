@@ -0,0 +1,163 @@
+#include "mapped_file.hpp"
+
+#include <filesystem>
+
+#ifdef WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+struct sandbox::hal::filesystem::mapped_file::mapping
+{
+    mapping(const std::string& path)
+    {
+#ifdef WIN32
+        m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            throw filesystem::cannot_open_file_error("cannot open file " + path + ".");
+        }
+
+        LARGE_INTEGER file_size{};
+        GetFileSizeEx(m_file, &file_size);
+        size = static_cast<size_t>(file_size.QuadPart);
+
+        if (size == 0) {
+            return;
+        }
+
+        m_file_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_file_mapping == nullptr) {
+            CloseHandle(m_file);
+            throw filesystem::cannot_open_file_error("cannot map file " + path + ".");
+        }
+
+        data = static_cast<uint8_t*>(MapViewOfFile(m_file_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data == nullptr) {
+            CloseHandle(m_file_mapping);
+            CloseHandle(m_file);
+            throw filesystem::cannot_open_file_error("cannot map file " + path + ".");
+        }
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw filesystem::cannot_open_file_error("cannot open file " + path + ".");
+        }
+
+        struct stat file_stat
+        {
+        };
+
+        if (fstat(fd, &file_stat) != 0) {
+            ::close(fd);
+            throw filesystem::cannot_open_file_error("cannot stat file " + path + ".");
+        }
+
+        size = static_cast<size_t>(file_stat.st_size);
+
+        if (size > 0) {
+            // read only shared mapping, so every process which opens the same asset reuses the same page cache pages.
+            void* mapped_data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapped_data == MAP_FAILED) {
+                ::close(fd);
+                throw filesystem::cannot_open_file_error("cannot map file " + path + ".");
+            }
+            data = static_cast<uint8_t*>(mapped_data);
+        }
+
+        // mapping stays valid after the descriptor is closed.
+        ::close(fd);
+#endif
+    }
+
+    mapping(const mapping&) = delete;
+    mapping& operator=(const mapping&) = delete;
+    mapping(mapping&&) = delete;
+    mapping& operator=(mapping&&) = delete;
+
+    ~mapping()
+    {
+#ifdef WIN32
+        if (data != nullptr) {
+            UnmapViewOfFile(data);
+        }
+        if (m_file_mapping != nullptr) {
+            CloseHandle(m_file_mapping);
+        }
+        if (m_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_file);
+        }
+#else
+        if (data != nullptr) {
+            munmap(data, size);
+        }
+#endif
+    }
+
+    uint8_t* data{nullptr};
+    size_t size{0};
+
+#ifdef WIN32
+private:
+    HANDLE m_file{INVALID_HANDLE_VALUE};
+    HANDLE m_file_mapping{nullptr};
+#endif
+};
+
+
+sandbox::hal::filesystem::mapped_file::mapped_file(const std::string& cwd)
+    : m_cwd(cwd)
+{
+}
+
+
+void sandbox::hal::filesystem::mapped_file::open(const std::string& url)
+{
+    std::string full_path = url;
+    if (!m_cwd.empty()) {
+        full_path = (std::filesystem::path(m_cwd) / std::filesystem::path(url)).string();
+    }
+
+    m_mapping = std::make_shared<mapping>(full_path);
+}
+
+
+void sandbox::hal::filesystem::mapped_file::close()
+{
+    m_mapping.reset();
+}
+
+
+sandbox::utils::data sandbox::hal::filesystem::mapped_file::read_all()
+{
+    if (m_mapping == nullptr || m_mapping->size == 0) {
+        return {};
+    }
+
+    return sandbox::utils::data::create_non_owning(m_mapping->data, m_mapping->size);
+}
+
+
+sandbox::utils::data sandbox::hal::filesystem::mapped_file::read_all_and_move()
+{
+    if (m_mapping == nullptr || m_mapping->size == 0) {
+        return {};
+    }
+
+    return sandbox::utils::data::create_owning(
+        m_mapping->data, [mapping = m_mapping](uint8_t*) {}, m_mapping->size);
+}
+
+
+size_t sandbox::hal::filesystem::mapped_file::get_size()
+{
+    if (m_mapping == nullptr) {
+        return 0;
+    }
+
+    return m_mapping->size;
+}
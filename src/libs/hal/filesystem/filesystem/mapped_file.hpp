@@ -0,0 +1,34 @@
+#pragma once
+
+#include <filesystem/base_file.hpp>
+
+#include <memory>
+
+namespace sandbox::hal::filesystem
+{
+    class mapped_file : public base_file
+    {
+    public:
+        explicit mapped_file(const std::string& cwd = "");
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        mapped_file(mapped_file&&) noexcept = default;
+        mapped_file& operator=(mapped_file&&) noexcept = default;
+        ~mapped_file() override = default;
+
+        void open(const std::string& url) override;
+        void close() override;
+
+        // returns a view into the mapping which is valid until the file is closed.
+        utils::data read_all() override;
+        // returns data which shares the mapping and keeps it alive after the file is closed. no copies are made.
+        utils::data read_all_and_move() override;
+        size_t get_size() override;
+
+    private:
+        struct mapping;
+
+        std::shared_ptr<mapping> m_mapping{};
+        std::string m_cwd{};
+    };
+} // namespace sandbox::hal::filesystem
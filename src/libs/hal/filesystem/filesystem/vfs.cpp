@@ -0,0 +1,296 @@
+#include "vfs.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+#ifdef WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    std::string normalize(const std::filesystem::path& path)
+    {
+        return path.lexically_normal().generic_string();
+    }
+} // namespace
+
+
+sandbox::hal::filesystem::shared_file::shared_file(const std::string& path)
+    : m_path(path)
+{
+#ifdef WIN32
+    m_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_handle == INVALID_HANDLE_VALUE) {
+        throw filesystem::cannot_open_file_error("cannot open file " + path + ".");
+    }
+
+    LARGE_INTEGER file_size{};
+    GetFileSizeEx(m_handle, &file_size);
+    m_size = static_cast<size_t>(file_size.QuadPart);
+#else
+    m_handle = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_handle < 0) {
+        throw filesystem::cannot_open_file_error("cannot open file " + path + ".");
+    }
+
+    struct stat file_stat
+    {
+    };
+
+    if (fstat(m_handle, &file_stat) != 0) {
+        ::close(m_handle);
+        throw filesystem::cannot_open_file_error("cannot stat file " + path + ".");
+    }
+
+    m_size = static_cast<size_t>(file_stat.st_size);
+#endif
+}
+
+
+sandbox::hal::filesystem::shared_file::~shared_file()
+{
+#ifdef WIN32
+    CloseHandle(m_handle);
+#else
+    ::close(m_handle);
+#endif
+}
+
+
+const std::string& sandbox::hal::filesystem::shared_file::get_path() const
+{
+    return m_path;
+}
+
+
+size_t sandbox::hal::filesystem::shared_file::get_size() const
+{
+    return m_size;
+}
+
+
+sandbox::hal::filesystem::shared_file::native_handle_type sandbox::hal::filesystem::shared_file::get_native_handle() const
+{
+    return m_handle;
+}
+
+
+size_t sandbox::hal::filesystem::shared_file::read(uint8_t* dst, size_t size, uint64_t offset) const
+{
+    size_t total_read = 0;
+
+    while (total_read < size) {
+#ifdef WIN32
+        OVERLAPPED overlapped{};
+        const uint64_t curr_offset = offset + total_read;
+        overlapped.Offset = static_cast<DWORD>(curr_offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = static_cast<DWORD>(curr_offset >> 32);
+
+        DWORD bytes_read = 0;
+        const auto to_read = static_cast<DWORD>(std::min<size_t>(size - total_read, 1u << 30));
+        if (!ReadFile(m_handle, dst + total_read, to_read, &bytes_read, &overlapped)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) {
+                break;
+            }
+            throw std::runtime_error("cannot read file " + m_path + ".");
+        }
+#else
+        const auto bytes_read = pread(m_handle, dst + total_read, size - total_read, static_cast<off_t>(offset + total_read));
+        if (bytes_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("cannot read file " + m_path + ".");
+        }
+#endif
+
+        if (bytes_read == 0) {
+            break;
+        }
+
+        total_read += static_cast<size_t>(bytes_read);
+    }
+
+    return total_read;
+}
+
+
+sandbox::utils::data sandbox::hal::filesystem::shared_file::read_all() const
+{
+    if (m_size == 0) {
+        return {};
+    }
+
+    auto* buffer = new uint8_t[m_size];
+
+    try {
+        read(buffer, m_size, 0);
+    } catch (...) {
+        delete[] buffer;
+        throw;
+    }
+
+    return sandbox::utils::data::create_owning(
+        buffer, [](uint8_t* data) { delete[] data; }, m_size);
+}
+
+
+sandbox::hal::filesystem::vfs& sandbox::hal::filesystem::vfs::global()
+{
+    static vfs instance{};
+    return instance;
+}
+
+
+sandbox::hal::filesystem::vfs::vfs(const std::string& root_directory)
+    : m_root_directory(normalize(std::filesystem::absolute(root_directory.empty() ? std::filesystem::current_path() : std::filesystem::path(root_directory))))
+{
+}
+
+
+void sandbox::hal::filesystem::vfs::mount(const std::string& mount_point, const std::string& directory)
+{
+    auto point = normalize(mount_point);
+    while (!point.empty() && point.back() == '/') {
+        point.pop_back();
+    }
+
+    auto dir = normalize(std::filesystem::path(directory).is_absolute() ? std::filesystem::path(directory) : std::filesystem::path(m_root_directory) / directory);
+
+    std::unique_lock lock{m_mounts_mutex};
+
+    auto it = std::find_if(m_mounts.begin(), m_mounts.end(), [&point](const auto& mount) { return mount.first == point; });
+    if (it != m_mounts.end()) {
+        it->second = std::move(dir);
+        return;
+    }
+
+    m_mounts.emplace_back(std::move(point), std::move(dir));
+
+    // longest mount points go first, so the first match is the most specific one.
+    std::stable_sort(m_mounts.begin(), m_mounts.end(), [](const auto& l, const auto& r) {
+        return l.first.size() > r.first.size();
+    });
+}
+
+
+void sandbox::hal::filesystem::vfs::unmount(const std::string& mount_point)
+{
+    auto point = normalize(mount_point);
+    while (!point.empty() && point.back() == '/') {
+        point.pop_back();
+    }
+
+    std::unique_lock lock{m_mounts_mutex};
+    std::erase_if(m_mounts, [&point](const auto& mount) { return mount.first == point; });
+}
+
+
+std::string sandbox::hal::filesystem::vfs::resolve(const std::string& url) const
+{
+    const std::filesystem::path path{url};
+
+    if (path.is_absolute()) {
+        return normalize(path);
+    }
+
+    const auto generic_url = normalize(path);
+
+    {
+        std::shared_lock lock{m_mounts_mutex};
+
+        for (const auto& [point, directory] : m_mounts) {
+            if (generic_url.size() > point.size() && generic_url.compare(0, point.size(), point) == 0 && generic_url[point.size()] == '/') {
+                return normalize(std::filesystem::path(directory) / generic_url.substr(point.size() + 1));
+            }
+        }
+    }
+
+    return normalize(std::filesystem::path(m_root_directory) / generic_url);
+}
+
+
+std::shared_ptr<const sandbox::hal::filesystem::shared_file> sandbox::hal::filesystem::vfs::open(const std::string& url)
+{
+    auto path = resolve(url);
+
+    std::lock_guard lock{m_files_mutex};
+
+    if (auto it = m_files.find(path); it != m_files.end()) {
+        if (auto file = it->second.lock(); file != nullptr) {
+            return file;
+        }
+    }
+
+    if (m_files.size() > 256) {
+        std::erase_if(m_files, [](const auto& file) { return file.second.expired(); });
+    }
+
+    auto file = std::make_shared<const shared_file>(path);
+    m_files[path] = file;
+
+    return file;
+}
+
+
+sandbox::hal::filesystem::vfs_file::vfs_file(vfs& file_system)
+    : m_vfs(&file_system)
+{
+}
+
+
+void sandbox::hal::filesystem::vfs_file::open(const std::string& url)
+{
+    m_file = m_vfs->open(url);
+    m_data_buffer.clear();
+}
+
+
+void sandbox::hal::filesystem::vfs_file::close()
+{
+    m_file.reset();
+    m_data_buffer.clear();
+}
+
+
+sandbox::utils::data sandbox::hal::filesystem::vfs_file::read_all()
+{
+    if (m_data_buffer.empty() && get_size() > 0) {
+        m_data_buffer.resize(get_size());
+        m_data_buffer.resize(m_file->read(m_data_buffer.data(), m_data_buffer.size(), 0));
+    }
+
+    if (m_data_buffer.empty()) {
+        return {};
+    }
+
+    return sandbox::utils::data::create_non_owning(m_data_buffer.data(), m_data_buffer.size());
+}
+
+
+sandbox::utils::data sandbox::hal::filesystem::vfs_file::read_all_and_move()
+{
+    if (m_file == nullptr) {
+        return {};
+    }
+
+    return m_file->read_all();
+}
+
+
+size_t sandbox::hal::filesystem::vfs_file::get_size()
+{
+    if (m_file == nullptr) {
+        return 0;
+    }
+
+    return m_file->get_size();
+}
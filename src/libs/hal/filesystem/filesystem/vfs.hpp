@@ -0,0 +1,97 @@
+#pragma once
+
+#include <filesystem/base_file.hpp>
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sandbox::hal::filesystem
+{
+    // read only file handle which can be shared between threads. reads are positional and never move a file cursor.
+    class shared_file
+    {
+    public:
+#ifdef WIN32
+        using native_handle_type = void*;
+#else
+        using native_handle_type = int;
+#endif
+
+        explicit shared_file(const std::string& path);
+        shared_file(const shared_file&) = delete;
+        shared_file& operator=(const shared_file&) = delete;
+        shared_file(shared_file&&) noexcept = delete;
+        shared_file& operator=(shared_file&&) noexcept = delete;
+        ~shared_file();
+
+        const std::string& get_path() const;
+        size_t get_size() const;
+        native_handle_type get_native_handle() const;
+
+        // returns count of bytes read. it is less than size only at the end of file.
+        size_t read(uint8_t* dst, size_t size, uint64_t offset) const;
+        utils::data read_all() const;
+
+    private:
+        std::string m_path{};
+        size_t m_size{0};
+        native_handle_type m_handle{};
+    };
+
+
+    // resolves urls through mount points without touching process working directory.
+    // "mount_point/some/file" is resolved to "directory/some/file", absolute paths are used as is,
+    // other relative paths are resolved against the root directory.
+    class vfs
+    {
+    public:
+        static vfs& global();
+
+        explicit vfs(const std::string& root_directory = "");
+
+        void mount(const std::string& mount_point, const std::string& directory);
+        void unmount(const std::string& mount_point);
+
+        std::string resolve(const std::string& url) const;
+
+        // opened files are shared, so every loader which reads the same file uses the same handle.
+        std::shared_ptr<const shared_file> open(const std::string& url);
+
+    private:
+        std::string m_root_directory{};
+
+        mutable std::shared_mutex m_mounts_mutex{};
+        std::vector<std::pair<std::string, std::string>> m_mounts{};
+
+        std::mutex m_files_mutex{};
+        std::unordered_map<std::string, std::weak_ptr<const shared_file>> m_files{};
+    };
+
+
+    class vfs_file : public base_file
+    {
+    public:
+        explicit vfs_file(vfs& file_system = vfs::global());
+        vfs_file(const vfs_file&) = delete;
+        vfs_file& operator=(const vfs_file&) = delete;
+        vfs_file(vfs_file&&) noexcept = default;
+        vfs_file& operator=(vfs_file&&) noexcept = default;
+        ~vfs_file() override = default;
+
+        void open(const std::string& url) override;
+        void close() override;
+
+        utils::data read_all() override;
+        utils::data read_all_and_move() override;
+        size_t get_size() override;
+
+    private:
+        vfs* m_vfs{nullptr};
+        std::shared_ptr<const shared_file> m_file{};
+        std::vector<uint8_t> m_data_buffer{};
+    };
+} // namespace sandbox::hal::filesystem
@@ -6,6 +6,8 @@
 #include <utils/conditions_helpers.hpp>
 #include <utils/scope_helpers.hpp>
 
+#include <algorithm>
+
 using namespace sandbox::hal::render;
 
 
@@ -37,9 +39,15 @@ size_t avk::buffer_instance::get_offset() const
 }
 
 
+uint32_t avk::buffer_instance::get_block() const
+{
+    return m_block;
+}
+
+
 avk::buffer_instance::operator vk::Buffer() const
 {
-    return m_pool->get_buffer();
+    return m_pool->get_buffer(m_block);
 }
 
 
@@ -88,21 +96,45 @@ avk::buffer_instance avk::buffer_builder::create(std::function<void(uint8_t*)> c
     return result;
 }
 
+
+avk::buffer_pool::buffer_pool(size_t block_size)
+    : m_block_size(block_size)
+{
+}
+
+
 void avk::buffer_pool::add_buffer_instance(buffer_instance* instance)
 {
-    if (instance->is_updatable()) {
-        instance->m_staging_buffer_offset = m_staging_size;
-        m_staging_size += instance->m_size;
+    const auto block_usage = m_blocks.empty() ? instance->m_usage : m_blocks.back().usage | instance->m_usage;
+    const auto max_block_size = get_max_block_size(block_usage);
+    CHECK_MSG(instance->m_size <= m_max_allocation_size, "Buffer is bigger than the largest allocation of the device.");
+
+    size_t offset = 0;
+
+    if (!m_blocks.empty()) {
+        const auto alignment = avk::get_buffer_offset_alignment(instance->m_usage);
+        offset = alignment != 0 ? get_aligned_size(m_blocks.back().size, alignment) : m_blocks.back().size;
     }
 
-    auto alignment = avk::get_buffer_offset_alignment(instance->m_usage);
+    // empty blocks take instances of any size, so a big instance gets a block of its own.
+    if (m_blocks.empty() || (m_blocks.back().size > 0 && offset + instance->m_size > max_block_size)) {
+        m_blocks.emplace_back();
+        offset = 0;
+    }
+
+    auto& block = m_blocks.back();
 
-    if (alignment != 0) {
-        m_size = get_aligned_size(m_size, alignment);
+    instance->m_block = static_cast<uint32_t>(m_blocks.size() - 1);
+    instance->m_buffer_offset = offset;
+
+    // staging offsets are relative to the staging buffer of the block.
+    if (instance->is_updatable()) {
+        instance->m_staging_buffer_offset = block.staging_size;
+        block.staging_size += instance->m_size;
     }
 
-    instance->m_buffer_offset = m_size;
-    m_size += instance->m_size;
+    block.size = offset + instance->m_size;
+    block.usage |= instance->m_usage;
 
     instance->m_subresource_index = m_subresources.size();
 
@@ -110,39 +142,42 @@ void avk::buffer_pool::add_buffer_instance(buffer_instance* instance)
         .size = instance->m_size,
         .offset = instance->m_buffer_offset,
         .staging_offset = instance->m_staging_buffer_offset,
-        .usage = instance->m_usage});
-
-    m_usage |= instance->m_usage;
+        .usage = instance->m_usage,
+        .block = instance->m_block});
 }
 
 
 void sandbox::hal::render::avk::buffer_pool::update_subresource(uint32_t subresource, std::function<void(uint8_t*)> cb)
 {
-    m_upload_callbacks.emplace_back(std::move(cb));
+    m_upload_callbacks.emplace_back(m_subresources[subresource].block, std::move(cb));
     m_subresources_to_update.emplace(subresource);
 }
 
 
 avk::submit_handler avk::buffer_pool::submit(vk::QueueFlagBits queue)
 {
-
     const auto queue_family = avk::context::queue_family(queue);
-    if (m_staging_size > 0) {
-        m_staging_buffer = avk::gen_staging_buffer(queue_family, m_staging_size, [this](uint8_t* dst) {
-            upload_staging_data(dst);
-        });
-    }
 
-    m_resource = avk::create_vma_buffer(
-        vk::BufferCreateInfo{
-            .flags = {},
-            .size = m_size,
-            .usage = m_usage,
-            .sharingMode = vk::SharingMode::eExclusive,
-            .queueFamilyIndexCount = 1,
-            .pQueueFamilyIndices = &queue_family},
-        VmaAllocationCreateInfo{
-            .usage = VMA_MEMORY_USAGE_GPU_ONLY});
+    for (uint32_t i = 0; i < m_blocks.size(); ++i) {
+        auto& block = m_blocks[i];
+
+        if (block.staging_size > 0) {
+            block.staging_buffer = avk::gen_staging_buffer(queue_family, block.staging_size, [this, i](uint8_t* dst) {
+                upload_staging_data(i, dst);
+            });
+        }
+
+        block.resource = avk::create_vma_buffer(
+            vk::BufferCreateInfo{
+                .flags = {},
+                .size = block.size,
+                .usage = block.usage,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = 1,
+                .pQueueFamilyIndices = &queue_family},
+            VmaAllocationCreateInfo{
+                .usage = VMA_MEMORY_USAGE_GPU_ONLY});
+    }
 
     auto result = update_internal(queue, UPDATE_RESOURCE_BUFFER_BIT);
     m_queue_type = queue;
@@ -157,9 +192,44 @@ avk::submit_handler avk::buffer_pool::update()
 }
 
 
-vk::Buffer avk::buffer_pool::get_buffer() const
+vk::Buffer avk::buffer_pool::get_buffer(uint32_t block) const
+{
+    return m_blocks[block].resource.as<vk::Buffer>();
+}
+
+
+uint32_t avk::buffer_pool::get_blocks_count() const
+{
+    return static_cast<uint32_t>(m_blocks.size());
+}
+
+
+size_t avk::buffer_pool::get_size() const
 {
-    return m_resource.as<vk::Buffer>();
+    size_t result = 0;
+
+    for (const auto& block : m_blocks) {
+        result += block.size;
+    }
+
+    return result;
+}
+
+
+size_t avk::buffer_pool::get_max_block_size(vk::BufferUsageFlags usage)
+{
+    if (m_max_allocation_size == 0) {
+        m_max_allocation_size = avk::get_max_allocation_size();
+        m_max_storage_buffer_range = avk::context::gpu()->getProperties().limits.maxStorageBufferRange;
+    }
+
+    const auto max_block_size = std::min(m_block_size, m_max_allocation_size);
+
+    if (usage & vk::BufferUsageFlagBits::eStorageBuffer) {
+        return std::min(max_block_size, m_max_storage_buffer_range);
+    }
+
+    return max_block_size;
 }
 
 
@@ -206,32 +276,45 @@ avk::buffer_pool::get_pipeline_stages_acceses_by_usage(vk::BufferUsageFlags usag
 
 avk::submit_handler avk::buffer_pool::update_internal(vk::QueueFlagBits queue, uint32_t update_state)
 {
-    if (update_state & UPDATE_STAGING_BUFFER_BIT) {
-        if (!m_upload_callbacks.empty()) {
+    if ((update_state & UPDATE_STAGING_BUFFER_BIT) && !m_upload_callbacks.empty()) {
+        std::vector<bool> updated_blocks(m_blocks.size(), false);
+
+        for (const auto& [block, cb] : m_upload_callbacks) {
+            updated_blocks[block] = true;
+        }
+
+        for (uint32_t i = 0; i < m_blocks.size(); ++i) {
+            if (!updated_blocks[i]) {
+                continue;
+            }
+
+            auto& staging_buffer = m_blocks[i].staging_buffer;
+
             void* dst_ptr{nullptr};
-            auto res = vmaMapMemory(avk::context::allocator(), m_staging_buffer.as<VmaAllocation>(), &dst_ptr);
+            auto res = vmaMapMemory(avk::context::allocator(), staging_buffer.as<VmaAllocation>(), &dst_ptr);
 
-            utils::on_scope_exit scope_guard{[this, res]() {
+            utils::on_scope_exit scope_guard{[&staging_buffer, res]() {
                 if (res == VK_SUCCESS) {
-                    vmaUnmapMemory(avk::context::allocator(), m_staging_buffer.as<VmaAllocation>());
+                    vmaUnmapMemory(avk::context::allocator(), staging_buffer.as<VmaAllocation>());
                     VkDeviceSize offset = 0;
-                    VkDeviceSize size = m_staging_buffer->get_alloc_info().size;
-                    VmaAllocation allocation = m_staging_buffer.as<VmaAllocation>();
+                    VkDeviceSize size = staging_buffer->get_alloc_info().size;
+                    VmaAllocation allocation = staging_buffer.as<VmaAllocation>();
                     vmaFlushAllocations(avk::context::allocator(), 1, &allocation, &offset, &size);
                 }
             }};
 
             ASSERT(res == VK_SUCCESS);
 
-            upload_staging_data(static_cast<uint8_t*>(dst_ptr));
+            upload_staging_data(i, static_cast<uint8_t*>(dst_ptr));
         }
+
+        m_upload_callbacks.clear();
     }
 
     if (update_state & UPDATE_RESOURCE_BUFFER_BIT) {
-        std::vector<vk::BufferCopy> buffer_copies{};
+        std::vector<std::vector<vk::BufferCopy>> buffer_copies(m_blocks.size());
         std::vector<vk::BufferMemoryBarrier> buffer_barriers{};
 
-        buffer_copies.reserve(m_subresources_to_update.size());
         buffer_barriers.reserve(m_subresources_to_update.size());
 
         vk::PipelineStageFlags dst_stages{};
@@ -243,7 +326,7 @@ avk::submit_handler avk::buffer_pool::update_internal(vk::QueueFlagBits queue, u
 
             dst_stages |= curr_dst_stage;
 
-            buffer_copies.emplace_back(vk::BufferCopy{
+            buffer_copies[subres.block].emplace_back(vk::BufferCopy{
                 .srcOffset = static_cast<VkDeviceSize>(subres.staging_offset),
                 .dstOffset = static_cast<VkDeviceSize>(subres.offset),
                 .size = static_cast<VkDeviceSize>(subres.size),
@@ -254,34 +337,42 @@ avk::submit_handler avk::buffer_pool::update_internal(vk::QueueFlagBits queue, u
                 .dstAccessMask = dst_access,
                 .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
                 .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                .buffer = m_resource.as<vk::Buffer>(),
+                .buffer = m_blocks[subres.block].resource.as<vk::Buffer>(),
                 .offset = static_cast<VkDeviceSize>(subres.offset),
                 .size = static_cast<VkDeviceSize>(subres.size)});
         }
 
-        if (!buffer_copies.empty()) {
+        // copied subresources are cleared before the submit, so they aren't copied again by the next update.
+        m_subresources_to_update.clear();
+
+        if (!buffer_barriers.empty()) {
             return avk::one_time_submit(queue, [&](vk::CommandBuffer& command_buffer) {
-                command_buffer.copyBuffer(m_staging_buffer.as<vk::Buffer>(), m_resource.as<vk::Buffer>(), buffer_copies);
+                for (size_t i = 0; i < m_blocks.size(); ++i) {
+                    if (!buffer_copies[i].empty()) {
+                        command_buffer.copyBuffer(m_blocks[i].staging_buffer.as<vk::Buffer>(), m_blocks[i].resource.as<vk::Buffer>(), buffer_copies[i]);
+                    }
+                }
+
                 command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, dst_stages, {}, {}, buffer_barriers, {});
             });
         }
-
-        m_subresources_to_update.clear();
-
-        return {};
     }
+
+    return {};
 }
 
-void sandbox::hal::render::avk::buffer_pool::upload_staging_data(uint8_t* dst)
+
+void sandbox::hal::render::avk::buffer_pool::upload_staging_data(uint32_t block, uint8_t* dst)
 {
-    for (const auto& cp : m_upload_callbacks) {
-        cp(static_cast<uint8_t*>(dst));
+    for (const auto& [cb_block, cb] : m_upload_callbacks) {
+        if (cb_block == block) {
+            cb(dst);
+        }
     }
-
-    m_upload_callbacks.clear();
 }
 
+
 avk::buffer_builder sandbox::hal::render::avk::buffer_pool::get_builder()
 {
     return buffer_builder(*this);
-}
\ No newline at end of file
+}
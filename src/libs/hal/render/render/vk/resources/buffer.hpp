@@ -18,7 +18,10 @@ namespace sandbox::hal::render::avk
 
         void upload(std::function<void(uint8_t*)>);
         size_t get_size() const;
+        // offset in the pool block which the instance lives in.
         size_t get_offset() const;
+        uint32_t get_block() const;
+        // buffer of the pool block.
         operator vk::Buffer() const;
 
         bool is_updatable() const;
@@ -28,6 +31,7 @@ namespace sandbox::hal::render::avk
 
         vk::BufferUsageFlags m_usage{};
         uint32_t m_subresource_index{};
+        uint32_t m_block{};
 
         buffer_pool* m_pool{nullptr};
 
@@ -54,9 +58,17 @@ namespace sandbox::hal::render::avk
     };
 
 
+    // instances are packed into blocks, every block is a separate VkBuffer with its own allocation, so the pool isn't
+    // limited by the largest allocation which the device allows. an instance which doesn't fit into a block gets its own.
     class buffer_pool
     {
     public:
+        constexpr static size_t default_block_size = size_t{256} << 20;
+
+        buffer_pool() = default;
+        // block size is clamped to maxMemoryAllocationSize of the device.
+        explicit buffer_pool(size_t block_size);
+
         void add_buffer_instance(buffer_instance* instance);
         void update_subresource(uint32_t subresource, std::function<void(uint8_t*)> cb);
 
@@ -64,7 +76,10 @@ namespace sandbox::hal::render::avk
         avk::submit_handler update();
 
         buffer_builder get_builder();
-        vk::Buffer get_buffer() const;
+        vk::Buffer get_buffer(uint32_t block) const;
+        uint32_t get_blocks_count() const;
+        // sum of block sizes.
+        size_t get_size() const;
 
     private:
         enum update_state_flags
@@ -80,25 +95,39 @@ namespace sandbox::hal::render::avk
             size_t offset{0};
             size_t staging_offset{0};
             vk::BufferUsageFlags usage{};
+            uint32_t block{0};
+        };
+
+        struct buffer_block
+        {
+            size_t size{0};
+            size_t staging_size{0};
+            vk::BufferUsageFlags usage{};
+
+            avk::vma_buffer resource{};
+            avk::vma_buffer staging_buffer{};
         };
 
         static std::pair<vk::PipelineStageFlags, vk::AccessFlags> get_pipeline_stages_acceses_by_usage(vk::BufferUsageFlags usage);
 
+        // storage buffers may be bound as a whole block, so blocks with them fit into the storage buffer range.
+        size_t get_max_block_size(vk::BufferUsageFlags usage);
         avk::submit_handler update_internal(vk::QueueFlagBits queue, uint32_t update_state);
-        void upload_staging_data(uint8_t* dst);
+        void upload_staging_data(uint32_t block, uint8_t* dst);
 
         uint32_t m_queue_family{};
 
-        size_t m_size{};
-        size_t m_staging_size{};
-        std::vector<std::function<void(uint8_t*)>> m_upload_callbacks{};
+        size_t m_block_size{default_block_size};
+        // queried from the device on the first added instance.
+        size_t m_max_allocation_size{0};
+        size_t m_max_storage_buffer_range{0};
+        std::vector<buffer_block> m_blocks{};
+
+        // callbacks are grouped by blocks, since every block has its own staging buffer.
+        std::vector<std::pair<uint32_t, std::function<void(uint8_t*)>>> m_upload_callbacks{};
         std::vector<buffer_subresource> m_subresources{};
         std::unordered_set<uint32_t> m_subresources_to_update{};
 
-        vk::BufferUsageFlags m_usage{};
-        avk::vma_buffer m_resource{};
-        avk::vma_buffer m_staging_buffer{};
-
         vk::QueueFlagBits m_queue_type{};
     };
 } // namespace sandbox::hal::render::avk
\ No newline at end of file
@@ -262,20 +262,22 @@ avk::submit_handler avk::image_pool::update()
     }
 
 
-    if (!m_subresources_to_update.empty()) 
-    {
-        auto result = avk::one_time_submit(m_queue, [&](vk::CommandBuffer& command_buffer) {
-            for (auto& subres : m_subresources_to_update) {
-                if (m_subresources[subres].reserve_staging_space) {
-                    copy_subres_data(command_buffer, m_subresources[subres]);
-                }
+    if (m_subresources_to_update.empty()) {
+        return {};
+    }
+
+    // the handler is returned, so the caller decides when to wait for the copy.
+    auto result = avk::one_time_submit(m_queue, [&](vk::CommandBuffer& command_buffer) {
+        for (auto& subres : m_subresources_to_update) {
+            if (m_subresources[subres].reserve_staging_space) {
+                copy_subres_data(command_buffer, m_subresources[subres]);
             }
-        });
+        }
+    });
 
-         m_subresources_to_update.clear();
-    }
+    m_subresources_to_update.clear();
 
-    return {};
+    return result;
 }
 
 
@@ -322,12 +324,12 @@ void avk::image_pool::copy_subres_data(
             vk::ImageLayout::eUndefined,
             vk::ImageLayout::eTransferDstOptimal);
 
-        uint32_t level_offset{0};
+        VkDeviceSize level_offset{0};
         copy_subres_level(subres, 0, command_buffer, level_offset);
         gen_subres_mips(command_buffer, subres, 1);
 
     } else {
-        uint32_t level_offset{0};
+        VkDeviceSize level_offset{0};
 
         for (size_t i = 0; i < subres.levels; i++) {
             image_pipeline_barrier(
@@ -362,7 +364,7 @@ void avk::image_pool::copy_subres_level(
     const image_subresource& subres,
     uint32_t level,
     vk::CommandBuffer& command_buffer,
-    uint32_t& level_offset)
+    VkDeviceSize& level_offset)
 {
     auto level_width = std::max(subres.width >> level, 1u);
     auto level_height = std::max(subres.height >> level, 1u);
@@ -503,7 +505,7 @@ VkDeviceSize avk::image_pool::get_subresource_level_size(const image_subresource
 
     auto info = get_format_info(subres.format);
 
-    return level_width * level_height * subres.depth * subres.layers * subres.faces * info.size;
+    return VkDeviceSize{level_width} * level_height * subres.depth * subres.layers * subres.faces * info.size;
 }
 
 void avk::image_pool::image_pipeline_barrier(
@@ -554,6 +556,8 @@ avk::submit_handler avk::image_pool::submit(vk::QueueFlagBits queue)
         });
     }
 
+    // callbacks keep the uploaded data alive, it is in the staging buffer already.
+    m_upload_callbacks.clear();
     m_queue = queue;
 
     return avk::one_time_submit(queue, [&](vk::CommandBuffer& command_buffer) {
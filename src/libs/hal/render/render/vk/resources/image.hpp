@@ -122,7 +122,7 @@ namespace sandbox::hal::render::avk
 
         void gen_subresource_images(image_subresource& subres, uint32_t queue_family);
         void copy_subres_data(vk::CommandBuffer& command_buffer, const image_subresource& subres);
-        void copy_subres_level(const image_subresource& subres, uint32_t level, vk::CommandBuffer& command_buffer, uint32_t& level_offset);
+        void copy_subres_level(const image_subresource& subres, uint32_t level, vk::CommandBuffer& command_buffer, VkDeviceSize& level_offset);
         void gen_subres_mips(vk::CommandBuffer& command_buffer, const image_subresource& subres, uint32_t level);
         VkDeviceSize get_subresource_level_size(const image_subresource& subres, uint32_t queue_family);
 
@@ -818,7 +818,7 @@ avk::sampler avk::gen_sampler(
 std::pair<avk::vma_buffer, avk::vma_buffer> avk::gen_buffer(
     vk::CommandBuffer& command_buffer,
     uint32_t queue_family,
-    uint32_t buffer_size,
+    VkDeviceSize buffer_size,
     vk::BufferUsageFlagBits buffer_usage,
     vk::PipelineStageFlagBits wait_stage,
     vk::AccessFlagBits access_flags,
@@ -984,6 +984,13 @@ VkDeviceSize avk::get_aligned_size(VkDeviceSize size, VkDeviceSize alignment)
 }
 
 
+VkDeviceSize avk::get_max_allocation_size()
+{
+    const auto props = avk::context::gpu()->getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceMaintenance3Properties>();
+    return props.get<vk::PhysicalDeviceMaintenance3Properties>().maxMemoryAllocationSize;
+}
+
+
 avk::submit_handler::~submit_handler()
 {
     wait();
@@ -999,6 +1006,16 @@ void avk::submit_handler::wait() const
 }
 
 
+bool avk::submit_handler::is_completed() const
+{
+    if (m_fence && avk::context::device()->getFenceStatus(m_fence) == vk::Result::eSuccess) {
+        m_fence = {};
+    }
+
+    return !m_fence;
+}
+
+
 avk::submit_handler avk::one_time_submit(vk::QueueFlagBits queue, const std::function<void(vk::CommandBuffer& command_buffer)>& callback)
 {
     submit_handler handler{};
@@ -142,7 +142,7 @@ namespace sandbox::hal::render::avk
     std::pair<avk::vma_buffer, avk::vma_buffer> gen_buffer(
         vk::CommandBuffer& command_buffer,
         uint32_t queue_family,
-        uint32_t buffer_size,
+        VkDeviceSize buffer_size,
         vk::BufferUsageFlagBits buffer_usage,
         vk::PipelineStageFlagBits wait_stage = {},
         vk::AccessFlagBits access_flags = {},
@@ -171,6 +171,9 @@ namespace sandbox::hal::render::avk
     VkDeviceSize get_buffer_offset_alignment(vk::BufferUsageFlags usage);
 
     VkDeviceSize get_aligned_size(VkDeviceSize size, VkDeviceSize alignment);
+
+    // maxMemoryAllocationSize of the device.
+    VkDeviceSize get_max_allocation_size();
     
     class submit_handler
     {
@@ -184,6 +187,8 @@ namespace sandbox::hal::render::avk
         ~submit_handler();
 
         void wait() const;
+        // doesn't block, true once the submitted commands are finished.
+        bool is_completed() const;
     private:
         avk::command_pool m_pool{};
         avk::command_buffer_list m_command_buffer{};
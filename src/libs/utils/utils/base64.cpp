@@ -0,0 +1,286 @@
+#include "base64.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SANDBOX_BASE64_X86 1
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define SANDBOX_BASE64_NEON 1
+    #include <arm_neon.h>
+#endif
+
+#if defined(SANDBOX_BASE64_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define SANDBOX_TARGET(arch) __attribute__((target(arch)))
+#else
+    #define SANDBOX_TARGET(arch)
+#endif
+
+namespace
+{
+    constexpr uint8_t invalid_char = 0xFF;
+
+    constexpr std::array<uint8_t, 256> decode_table = []() {
+        std::array<uint8_t, 256> table{};
+        table.fill(invalid_char);
+
+        constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (size_t i = 0; i < alphabet.size(); ++i) {
+            table[static_cast<uint8_t>(alphabet[i])] = static_cast<uint8_t>(i);
+        }
+
+        return table;
+    }();
+
+
+    std::string_view strip_padding(std::string_view src)
+    {
+        for (size_t i = 0; i < 2 && !src.empty() && src.back() == '='; ++i) {
+            src.remove_suffix(1);
+        }
+
+        return src;
+    }
+
+
+    bool decode_scalar(const char* src, const char* src_end, uint8_t* dst)
+    {
+        uint32_t accumulator = 0;
+        uint32_t bits = 0;
+
+        for (; src != src_end; ++src) {
+            const auto value = decode_table[static_cast<uint8_t>(*src)];
+            if (value == invalid_char) {
+                return false;
+            }
+
+            accumulator = (accumulator << 6) | value;
+            bits += 6;
+
+            if (bits >= 8) {
+                bits -= 8;
+                *dst++ = static_cast<uint8_t>(accumulator >> bits);
+            }
+        }
+
+        return true;
+    }
+
+
+    // vector decoders translate ascii to 6 bit values with nibble lookups and pack every 4 values into 3 bytes.
+    // on invalid input they stop, and the rest of the string is decoded by the scalar decoder which reports the error.
+    // they return count of consumed chars, output is advanced by 3/4 of it.
+#ifdef SANDBOX_BASE64_X86
+    SANDBOX_TARGET("ssse3")
+    size_t decode_ssse3(const char* src, size_t size, uint8_t* dst)
+    {
+        const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+        const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+        const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m128i mask_2f = _mm_set1_epi8(0x2F);
+        const __m128i pack_shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+        size_t consumed = 0;
+
+        // every step stores 16 bytes but only 12 of them are output, so the tail is left for the scalar decoder.
+        for (; consumed + 24 <= size; consumed += 16, dst += 12) {
+            __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + consumed));
+
+            const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+            const __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+            const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+            const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+
+            if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0) {
+                break;
+            }
+
+            const __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+            const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+            str = _mm_add_epi8(str, roll);
+
+            const __m128i merged_pairs = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+            const __m128i merged = _mm_madd_epi16(merged_pairs, _mm_set1_epi32(0x00011000));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi8(merged, pack_shuffle));
+        }
+
+        return consumed;
+    }
+
+
+    SANDBOX_TARGET("avx2")
+    size_t decode_avx2(const char* src, size_t size, uint8_t* dst)
+    {
+        const __m256i lut_lo = _mm256_setr_epi8(
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+        const __m256i lut_hi = _mm256_setr_epi8(
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+        const __m256i lut_roll = _mm256_setr_epi8(
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i mask_2f = _mm256_set1_epi8(0x2F);
+        const __m256i pack_shuffle = _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+        const __m256i pack_lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+        size_t consumed = 0;
+
+        // every step stores 32 bytes but only 24 of them are output.
+        for (; consumed + 48 <= size; consumed += 32, dst += 24) {
+            __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + consumed));
+
+            const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+            const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+            const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+            const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+
+            if (!_mm256_testz_si256(lo, hi)) {
+                break;
+            }
+
+            const __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+            const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+            str = _mm256_add_epi8(str, roll);
+
+            const __m256i merged_pairs = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+            __m256i merged = _mm256_madd_epi16(merged_pairs, _mm256_set1_epi32(0x00011000));
+            merged = _mm256_shuffle_epi8(merged, pack_shuffle);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_permutevar8x32_epi32(merged, pack_lanes));
+        }
+
+        return consumed;
+    }
+
+
+    bool has_ssse3()
+    {
+    #ifdef _MSC_VER
+        int info[4]{};
+        __cpuid(info, 1);
+        return (info[2] & (1 << 9)) != 0;
+    #else
+        return __builtin_cpu_supports("ssse3");
+    #endif
+    }
+
+
+    bool has_avx2()
+    {
+    #ifdef _MSC_VER
+        #ifdef __AVX2__
+        return true;
+        #else
+        return false;
+        #endif
+    #else
+        return __builtin_cpu_supports("avx2");
+    #endif
+    }
+#endif
+
+#ifdef SANDBOX_BASE64_NEON
+    uint8x16_t translate_neon(uint8x16_t str, uint8x16_t& error)
+    {
+        static constexpr uint8_t lut_lo_values[16] = {0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A};
+        static constexpr uint8_t lut_hi_values[16] = {0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10};
+        static constexpr uint8_t lut_roll_values[16] = {0, 16, 19, 4, 191, 191, 185, 185, 0, 0, 0, 0, 0, 0, 0, 0};
+
+        const uint8x16_t hi_nibbles = vshrq_n_u8(str, 4);
+        const uint8x16_t lo_nibbles = vandq_u8(str, vdupq_n_u8(0x0F));
+        const uint8x16_t hi = vqtbl1q_u8(vld1q_u8(lut_hi_values), hi_nibbles);
+        const uint8x16_t lo = vqtbl1q_u8(vld1q_u8(lut_lo_values), lo_nibbles);
+
+        error = vorrq_u8(error, vandq_u8(lo, hi));
+
+        const uint8x16_t eq_2f = vceqq_u8(str, vdupq_n_u8(0x2F));
+        const uint8x16_t roll = vqtbl1q_u8(vld1q_u8(lut_roll_values), vaddq_u8(eq_2f, hi_nibbles));
+
+        return vaddq_u8(str, roll);
+    }
+
+
+    size_t decode_neon(const char* src, size_t size, uint8_t* dst)
+    {
+        size_t consumed = 0;
+
+        for (; consumed + 64 <= size; consumed += 64, dst += 48) {
+            // deinterleaving load puts the first, the second, the third and the fourth char of every quad into own register.
+            const uint8x16x4_t str = vld4q_u8(reinterpret_cast<const uint8_t*>(src + consumed));
+
+            uint8x16_t error = vdupq_n_u8(0);
+            const uint8x16_t a = translate_neon(str.val[0], error);
+            const uint8x16_t b = translate_neon(str.val[1], error);
+            const uint8x16_t c = translate_neon(str.val[2], error);
+            const uint8x16_t d = translate_neon(str.val[3], error);
+
+            if (vmaxvq_u8(error) != 0) {
+                break;
+            }
+
+            uint8x16x3_t out{};
+            out.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+            out.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+            out.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+
+            vst3q_u8(dst, out);
+        }
+
+        return consumed;
+    }
+#endif
+
+    using decoder = size_t (*)(const char*, size_t, uint8_t*);
+
+    decoder select_decoder()
+    {
+#if defined(SANDBOX_BASE64_X86)
+        if (has_avx2()) {
+            return decode_avx2;
+        }
+
+        if (has_ssse3()) {
+            return decode_ssse3;
+        }
+#elif defined(SANDBOX_BASE64_NEON)
+        return decode_neon;
+#endif
+
+        return nullptr;
+    }
+} // namespace
+
+
+size_t sandbox::utils::base64_decoded_size(std::string_view src)
+{
+    return strip_padding(src).size() * 3 / 4;
+}
+
+
+bool sandbox::utils::base64_decode(std::string_view src, uint8_t* dst)
+{
+    static const decoder vector_decoder = select_decoder();
+
+    src = strip_padding(src);
+
+    // single char can't encode a byte.
+    if (src.size() % 4 == 1) {
+        return false;
+    }
+
+    size_t consumed = 0;
+
+    if (vector_decoder != nullptr) {
+        consumed = vector_decoder(src.data(), src.size(), dst);
+    }
+
+    return decode_scalar(src.data() + consumed, src.data() + src.size(), dst + consumed / 4 * 3);
+}
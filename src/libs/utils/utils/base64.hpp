@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace sandbox::utils
+{
+    // count of bytes encoded in base64 string, padding is taken into account.
+    size_t base64_decoded_size(std::string_view src);
+
+    // decodes src into dst, dst must have base64_decoded_size(src) bytes.
+    // uses the widest simd decoder supported by cpu. returns false if src is not valid base64.
+    bool base64_decode(std::string_view src, uint8_t* dst);
+} // namespace sandbox::utils
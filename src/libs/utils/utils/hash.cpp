@@ -0,0 +1,108 @@
+#include "hash.hpp"
+
+#include <cstring>
+
+namespace
+{
+    constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t prime3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+
+    uint64_t rotl(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+
+    // hash is defined for little endian reads.
+    uint64_t read64(const uint8_t* ptr)
+    {
+        uint64_t result;
+        std::memcpy(&result, ptr, sizeof(result));
+        return result;
+    }
+
+
+    uint32_t read32(const uint8_t* ptr)
+    {
+        uint32_t result;
+        std::memcpy(&result, ptr, sizeof(result));
+        return result;
+    }
+
+
+    uint64_t round(uint64_t acc, uint64_t input)
+    {
+        acc += input * prime2;
+        acc = rotl(acc, 31);
+        return acc * prime1;
+    }
+
+
+    uint64_t merge_round(uint64_t acc, uint64_t value)
+    {
+        acc ^= round(0, value);
+        return acc * prime1 + prime4;
+    }
+} // namespace
+
+
+uint64_t sandbox::utils::hash64(const void* data, size_t size, uint64_t seed)
+{
+    const auto* ptr = static_cast<const uint8_t*>(data);
+    const auto* end = ptr + size;
+
+    uint64_t result;
+
+    if (size >= 32) {
+        uint64_t v1 = seed + prime1 + prime2;
+        uint64_t v2 = seed + prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - prime1;
+
+        // four independent lanes, so the loop is bound by loads, not by multiplication latency.
+        for (const auto* limit = end - 32; ptr <= limit; ptr += 32) {
+            v1 = round(v1, read64(ptr));
+            v2 = round(v2, read64(ptr + 8));
+            v3 = round(v3, read64(ptr + 16));
+            v4 = round(v4, read64(ptr + 24));
+        }
+
+        result = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        result = merge_round(result, v1);
+        result = merge_round(result, v2);
+        result = merge_round(result, v3);
+        result = merge_round(result, v4);
+    } else {
+        result = seed + prime5;
+    }
+
+    result += size;
+
+    for (; ptr + 8 <= end; ptr += 8) {
+        result ^= round(0, read64(ptr));
+        result = rotl(result, 27) * prime1 + prime4;
+    }
+
+    if (ptr + 4 <= end) {
+        result ^= uint64_t(read32(ptr)) * prime1;
+        result = rotl(result, 23) * prime2 + prime3;
+        ptr += 4;
+    }
+
+    for (; ptr < end; ++ptr) {
+        result ^= (*ptr) * prime5;
+        result = rotl(result, 11) * prime1;
+    }
+
+    result ^= result >> 33;
+    result *= prime2;
+    result ^= result >> 29;
+    result *= prime3;
+    result ^= result >> 32;
+
+    return result;
+}
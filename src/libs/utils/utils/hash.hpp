@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sandbox::utils
+{
+    // xxh64 of the bytes. fast enough to hash whole asset files, the result doesn't depend on platform.
+    uint64_t hash64(const void* data, size_t size, uint64_t seed = 0);
+
+    // combines the hash of value bytes with the seed, for keys which are built from several values.
+    template<typename T>
+    uint64_t hash64_value(const T& value, uint64_t seed = 0)
+    {
+        return hash64(&value, sizeof(value), seed);
+    }
+} // namespace sandbox::utils
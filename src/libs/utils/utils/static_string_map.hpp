@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+namespace sandbox::utils
+{
+    namespace detail
+    {
+        constexpr uint32_t seeded_hash(std::string_view str, uint32_t seed)
+        {
+            uint32_t hash = 2166136261u ^ seed;
+            for (const char c : str) {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 16777619u;
+            }
+
+            // final avalanche, so low bits depend on the seed and on every character.
+            hash ^= hash >> 16;
+            hash *= 0x85ebca6bu;
+            hash ^= hash >> 13;
+            hash *= 0xc2b2ae35u;
+            hash ^= hash >> 16;
+
+            return hash;
+        }
+
+        constexpr size_t next_pow2(size_t value)
+        {
+            size_t result = 1;
+            while (result < value) {
+                result <<= 1;
+            }
+            return result;
+        }
+    } // namespace detail
+
+    // string -> value map with a perfect hash found at compile time.
+    // lookup is one hash of the key and one string comparison.
+    template<typename ValueT, size_t Size>
+    class static_string_map
+    {
+    public:
+        using entry = std::pair<std::string_view, ValueT>;
+
+        constexpr explicit static_string_map(const entry (&entries)[Size])
+        {
+            for (uint32_t seed = 0;; ++seed) {
+                std::array<bool, table_size> used{};
+                bool collision = false;
+
+                for (size_t i = 0; i < Size && !collision; ++i) {
+                    const auto slot = detail::seeded_hash(entries[i].first, seed) & (table_size - 1);
+                    collision = used[slot];
+                    used[slot] = true;
+                }
+
+                if (!collision) {
+                    m_seed = seed;
+                    break;
+                }
+            }
+
+            for (size_t i = 0; i < Size; ++i) {
+                const auto slot = detail::seeded_hash(entries[i].first, m_seed) & (table_size - 1);
+                m_slots[slot] = {entries[i].first, entries[i].second};
+                m_used[slot] = true;
+            }
+        }
+
+        constexpr std::optional<ValueT> find(std::string_view key) const
+        {
+            const auto slot = detail::seeded_hash(key, m_seed) & (table_size - 1);
+
+            if (!m_used[slot] || m_slots[slot].first != key) {
+                return std::nullopt;
+            }
+
+            return m_slots[slot].second;
+        }
+
+    private:
+        constexpr static size_t table_size = detail::next_pow2(Size * 4);
+
+        uint32_t m_seed{0};
+        std::array<entry, table_size> m_slots{};
+        std::array<bool, table_size> m_used{};
+    };
+
+
+    template<typename ValueT, size_t Size>
+    constexpr auto make_static_string_map(const std::pair<std::string_view, ValueT> (&entries)[Size])
+    {
+        return static_string_map<ValueT, Size>{entries};
+    }
+} // namespace sandbox::utils
@@ -0,0 +1,97 @@
+#include "thread_pool.hpp"
+
+
+sandbox::utils::thread_pool::thread_pool(size_t threads_count)
+{
+    m_threads.reserve(threads_count);
+
+    for (size_t i = 0; i < threads_count; ++i) {
+        m_threads.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+
+sandbox::utils::thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard lock{m_mutex};
+        m_stop = true;
+    }
+
+    m_tasks_cv.notify_all();
+
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+
+size_t sandbox::utils::thread_pool::get_threads_count() const
+{
+    return m_threads.size();
+}
+
+
+void sandbox::utils::thread_pool::push_task(std::function<void()> task)
+{
+    if (m_threads.empty()) {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard lock{m_mutex};
+        m_tasks.emplace_back(std::move(task));
+    }
+
+    m_tasks_cv.notify_one();
+}
+
+
+void sandbox::utils::thread_pool::worker_loop()
+{
+    while (true) {
+        std::function<void()> task{};
+
+        {
+            std::unique_lock lock{m_mutex};
+            m_tasks_cv.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+
+            if (m_tasks.empty()) {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+
+void sandbox::utils::thread_pool::parallel_job::run()
+{
+    for (size_t chunk = next_chunk++; chunk < chunks_count; chunk = next_chunk++) {
+        try {
+            run_chunk(chunk);
+        } catch (...) {
+            std::lock_guard lock{mutex};
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+
+        if (++done_chunks == chunks_count) {
+            std::lock_guard lock{mutex};
+            done_cv.notify_all();
+        }
+    }
+}
+
+
+void sandbox::utils::thread_pool::parallel_job::wait()
+{
+    std::unique_lock lock{mutex};
+    done_cv.wait(lock, [this]() { return done_chunks == chunks_count; });
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace sandbox::utils
+{
+    class thread_pool
+    {
+    public:
+        explicit thread_pool(size_t threads_count = std::thread::hardware_concurrency());
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+        thread_pool(thread_pool&&) noexcept = delete;
+        thread_pool& operator=(thread_pool&&) noexcept = delete;
+        ~thread_pool();
+
+        size_t get_threads_count() const;
+
+        // blocking on the returned future from a pool thread can deadlock, use parallel_for inside tasks instead.
+        template<typename Callable>
+        auto submit(Callable&& callback) -> std::future<std::invoke_result_t<std::decay_t<Callable>>>
+        {
+            using result_type = std::invoke_result_t<std::decay_t<Callable>>;
+
+            auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<Callable>(callback));
+            auto result = task->get_future();
+            push_task([task]() { (*task)(); });
+
+            return result;
+        }
+
+        // calls callback(i) for every i in [begin, end). calling thread takes part in the work, so it is safe to call from pool threads.
+        // the first exception thrown by the callback is rethrown after all started chunks are finished.
+        template<typename Callable>
+        void parallel_for(size_t begin, size_t end, Callable&& callback, size_t grain_size = 1)
+        {
+            if (begin >= end) {
+                return;
+            }
+
+            const size_t count = end - begin;
+            grain_size = std::max<size_t>(grain_size, 1);
+            const size_t chunks_count = std::min((count + grain_size - 1) / grain_size, std::max<size_t>(m_threads.size(), 1) * 4);
+            const size_t chunk_size = (count + chunks_count - 1) / chunks_count;
+
+            // workers may pick the job up after all chunks are done, so the job state outlives this call.
+            auto job = std::make_shared<parallel_job>();
+            job->chunks_count = chunks_count;
+            job->run_chunk = [begin, end, chunk_size, &callback](size_t chunk) {
+                const size_t chunk_begin = begin + chunk * chunk_size;
+                const size_t chunk_end = std::min(chunk_begin + chunk_size, end);
+                for (size_t i = chunk_begin; i < chunk_end; ++i) {
+                    callback(i);
+                }
+            };
+
+            const size_t helpers_count = std::min(chunks_count - 1, m_threads.size());
+            for (size_t i = 0; i < helpers_count; ++i) {
+                push_task([job]() { job->run(); });
+            }
+
+            job->run();
+            job->wait();
+
+            if (job->error) {
+                std::rethrow_exception(job->error);
+            }
+        }
+
+    private:
+        struct parallel_job
+        {
+            void run();
+            void wait();
+
+            std::function<void(size_t)> run_chunk{};
+            size_t chunks_count{0};
+            std::atomic_size_t next_chunk{0};
+            std::atomic_size_t done_chunks{0};
+            std::mutex mutex{};
+            std::condition_variable done_cv{};
+            std::exception_ptr error{};
+        };
+
+        void push_task(std::function<void()> task);
+        void worker_loop();
+
+        std::vector<std::thread> m_threads{};
+        std::deque<std::function<void()>> m_tasks{};
+        std::mutex m_mutex{};
+        std::condition_variable m_tasks_cv{};
+        bool m_stop{false};
+    };
+} // namespace sandbox::utils
@@ -1,7 +1,8 @@
 
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
-#include <filesystem/common_file.hpp>
+#include <filesystem/file_watcher.hpp>
+#include <filesystem/vfs.hpp>
 #include <sample_app.hpp>
 #include <render/vk/errors_handling.hpp>
 #include <render/vk/utils.hpp>
@@ -10,6 +11,14 @@
 
 #include <renderdoc/renderdoc.hpp>
 
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <filesystem>
+#include <future>
+
 using namespace sandbox;
 using namespace sandbox::hal;
 using namespace sandbox::hal::render;
@@ -19,7 +28,8 @@ class test_sample_app : public sandbox::sample_app
 {
 public:
     explicit test_sample_app(const std::string& gltf_file)
-        : m_model(gltf::model::from_url(gltf_file))
+        : m_gltf_file(gltf_file)
+        , m_model(load_model(gltf_file))
     {
     }
 
@@ -27,6 +37,9 @@ public:
 protected:
     void update(uint64_t dt) override
     {
+        // sample_app waits for the previous frame at the end of update, so resources aren't used by gpu here.
+        process_file_changes();
+
         write_command_buffers(dt);
           
         vk::Queue queue = avk::context::queue(vk::QueueFlagBits::eGraphics, 0);
@@ -91,17 +104,33 @@ protected:
             .commandBufferCount = 1,
         });
 
-        m_geometry = gltf::vk_model_builder()
-                         .set_vertex_format(
-                             {vk::Format::eR32G32B32Sfloat,
-                              vk::Format::eR32G32B32Sfloat,
-                              vk::Format::eR32G32B32A32Sfloat,
-                              vk::Format::eR32G32Sfloat,
-                              vk::Format::eR32G32Sfloat,
-                              vk::Format::eR32G32B32Sfloat,
-                              vk::Format::eR32G32B32A32Uint,
-                              vk::Format::eR32G32B32A32Sfloat})
-                         .create(m_model, m_buffer_pool, m_image_pool);
+        // test.vert decodes octahedral normals and positions in primitive boxes, see init_mesh_pipelines.
+        m_builder.compact_vertices(true).quantize_positions(true);
+
+        // skinning makes vertices expensive, so triangles are reordered to transform every vertex as few times as possible.
+        m_builder.optimize_meshes(true);
+        // distant characters are drawn with simplified lods, see write_command_buffers.
+        m_builder.generate_lods(3);
+        // clusters of static meshes which are out of view or face away are culled on gpu.
+        m_builder.build_clusters(true);
+
+        m_cache = std::make_shared<const gltf::vk_model_cache>(m_builder.bake(m_model));
+
+        if (const auto& statistics = m_cache->get_optimization_statistics()) {
+            spdlog::info(
+                "vertex cache acmr {:.3f} -> {:.3f}, atvr {:.3f} -> {:.3f}.",
+                statistics->before.get_acmr(),
+                statistics->after.get_acmr(),
+                statistics->before.get_atvr(),
+                statistics->after.get_atvr());
+        }
+        m_geometry = m_builder.instantiate(m_cache, m_buffer_pool, m_image_pool);
+        m_mesh_transforms = get_mesh_transforms(m_model);
+
+        watch_files();
+
+        // the model data is baked already, the animation controller reads only nodes and animations of the model.
+        m_model.release_payloads();
 
         m_uniform_buffer =
             m_buffer_pool.get_builder()
@@ -112,6 +141,9 @@ protected:
         m_animation_controller = gltf::animation_controller(m_model, m_geometry);
 
         m_animation_controller.init_resources(m_buffer_pool, 1);
+
+        m_cluster_culler = gltf::cluster_culler(m_geometry);
+        m_cluster_culler.init_resources(m_buffer_pool);
         m_anim_instance = m_animation_controller.instantiate_animation();
         m_anim_instance->play();
 
@@ -137,13 +169,58 @@ protected:
     }
 
 private:
+    static gltf::model load_model(const std::string& gltf_file)
+    {
+        utils::thread_pool loader_pool{};
+        return gltf::model::from_url(gltf_file, {.map_files = true, .thread_pool = &loader_pool});
+    }
+
+    // rest pose world matrices of meshes, every mesh is placed by the first node which instances it. skinned meshes are
+    // placed by their joints, which keep them in the model space at rest, so they get the identity.
+    static std::vector<glm::mat4> get_mesh_transforms(const gltf::model& mdl)
+    {
+        const auto& nodes = mdl.get_nodes();
+
+        std::vector<glm::mat4> result(mdl.get_meshes().size(), glm::mat4{1});
+        std::vector<bool> placed(result.size(), false);
+        std::vector<bool> has_parent(nodes.size(), false);
+
+        for (const auto& node : nodes) {
+            for (const auto child : node.get_children()) {
+                has_parent[child] = true;
+            }
+        }
+
+        auto place = [&](auto& self, int32_t node_index, const glm::mat4& parent_matrix) -> void {
+            const auto& node = nodes[node_index];
+            const auto matrix = parent_matrix * node.get_matrix();
+
+            if (node.get_mesh() >= 0 && !placed[node.get_mesh()]) {
+                placed[node.get_mesh()] = true;
+                result[node.get_mesh()] = node.get_skin() >= 0 ? glm::mat4{1} : matrix;
+            }
+
+            for (const auto child : node.get_children()) {
+                self(self, child, matrix);
+            }
+        };
+
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (!has_parent[i]) {
+                place(place, static_cast<int32_t>(i), glm::mat4{1});
+            }
+        }
+
+        return result;
+    }
+
     void create_shader(avk::shader_module& module, const std::string& path)
     {
         if (module) {
             return;
         }
 
-        sandbox::hal::filesystem::common_file file{};
+        sandbox::hal::filesystem::vfs_file file{};
         file.open(path);
         assert(file.get_size());
 
@@ -156,47 +233,187 @@ private:
     void init_pipelines()
     {
         if (!m_vertex_shader) {
-            create_shader(m_vertex_shader, WORK_DIR "/resources/test.vert.spv");
+            create_shader(m_vertex_shader, vertex_shader_path);
         }
 
         if (!m_fragment_shader) {
-            create_shader(m_fragment_shader, WORK_DIR "/resources/test.frag.spv");
+            create_shader(m_fragment_shader, fragment_shader_path);
         }
 
         m_animation_controller.init_pipelines();
+        m_cluster_culler.init_pipelines();
+
+        for (size_t mesh_id = 0; mesh_id < m_geometry.get_meshes().size(); ++mesh_id) {
+            init_mesh_pipelines(mesh_id);
+        }
+    }
+
+    void init_mesh_pipelines(size_t mesh_id)
+    {
+        const auto& mesh = m_geometry.get_meshes()[mesh_id];
+        auto& pipelines = m_models_primitives_pipelines[mesh_id];
+
+        pipelines.clear();
+
+        for (const auto& primitive : mesh.get_primitives()) {
+            avk::pipeline_builder builder{};
+
+            const auto& mat = primitive.get_material(m_geometry);
+
+            builder.set_vertex_format(m_geometry.get_vertex_format())
+                .set_shader_stages({{m_vertex_shader, vk::ShaderStageFlagBits::eVertex}, {m_fragment_shader, vk::ShaderStageFlagBits::eFragment}})
+                .add_blend_state()
+                .add_push_constant(vk::ShaderStageFlagBits::eVertex, uint32_t(0))
+                .add_specialization_constant(uint32_t(1))                                    // use hierarchy
+                .add_specialization_constant(uint32_t(mesh.is_skinned()))                    // use skin
+                .add_specialization_constant(uint32_t(mesh.get_skin().get_hierarchy_size())) // hierarchy size
+                .add_specialization_constant(uint32_t(mesh.get_skin().get_joints_count()))   // skin size
+                .add_specialization_constant(primitive.get_position_offset().x)              // position offset
+                .add_specialization_constant(primitive.get_position_offset().y)
+                .add_specialization_constant(primitive.get_position_offset().z)
+                .add_specialization_constant(primitive.get_position_scale().x)               // position scale
+                .add_specialization_constant(primitive.get_position_scale().y)
+                .add_specialization_constant(primitive.get_position_scale().z)
+                .begin_descriptor_set()
+                .add_buffer(m_uniform_buffer, vk::DescriptorType::eUniformBuffer)
+                .add_buffer(m_animation_controller.get_hierarchies().front(), vk::DescriptorType::eStorageBuffer)
+                .add_buffer(mesh.get_skin().get_joints_buffer(), vk::DescriptorType::eUniformBuffer)
+                .finish_descriptor_set()
+                .begin_descriptor_set()
+                .add_texture(mat.get_base_color(m_geometry).get_image(), mat.get_base_color(m_geometry).get_sampler())
+                .add_texture(mat.get_normal(m_geometry).get_image(), mat.get_normal(m_geometry).get_sampler())
+                .add_texture(mat.get_metallic_roughness(m_geometry).get_image(), mat.get_metallic_roughness(m_geometry).get_sampler())
+                .add_texture(mat.get_occlusion(m_geometry).get_image(), mat.get_occlusion(m_geometry).get_sampler())
+                .add_texture(mat.get_emissive(m_geometry).get_image(), mat.get_emissive(m_geometry).get_sampler())
+                .finish_descriptor_set();
+            pipelines.emplace_back(builder.create_graphics_pipeline(m_pass, 0));
+        }
+    }
+
+    void watch_files()
+    {
+        m_watcher.watch(vertex_shader_path);
+        m_watcher.watch(fragment_shader_path);
+        m_watcher.watch(gltf::animation_controller::get_shader_path());
+        m_watcher.watch(gltf::cluster_culler::get_shader_path());
+        m_watcher.watch(m_gltf_file);
+
+        // uris of embedded data are cleared by release_payloads, so the sources are collected before it.
+        auto watch_uri = [this](const std::string& uri) {
+            if (!uri.empty() && !gltf::is_data_uri(uri)) {
+                m_watcher.watch((std::filesystem::path(m_model.get_cwd()) / uri).string());
+            }
+        };
+
+        for (const auto& buffer : m_model.get_buffers()) {
+            watch_uri(buffer.get_uri());
+        }
+
+        for (const auto& image : m_model.get_images()) {
+            if (image.get_buffer_view() < 0) {
+                watch_uri(image.get_uri());
+            }
+        }
+    }
 
-        for (const auto& mesh : m_geometry.get_meshes()) {
-            const auto& primitives = mesh.get_primitives();
-            auto curr_primitive = primitives.begin();
-
-            int mesh_id = 0;
-            for (const auto& primitive : mesh.get_primitives()) {
-                avk::pipeline_builder builder{};
-
-                const auto& mat = curr_primitive->get_material(m_geometry);
-
-                builder.set_vertex_format(m_geometry.get_vertex_format())
-                    .set_shader_stages({{m_vertex_shader, vk::ShaderStageFlagBits::eVertex}, {m_fragment_shader, vk::ShaderStageFlagBits::eFragment}})
-                    .add_blend_state()
-                    .add_push_constant(vk::ShaderStageFlagBits::eVertex, uint32_t(0))
-                    .add_specialization_constant(uint32_t(1))                                    // use hierarchy
-                    .add_specialization_constant(uint32_t(mesh.is_skinned()))                    // use skin
-                    .add_specialization_constant(uint32_t(mesh.get_skin().get_hierarchy_size())) // hierarchy size
-                    .add_specialization_constant(uint32_t(mesh.get_skin().get_joints_count()))   // skin size
-                    .begin_descriptor_set()
-                    .add_buffer(m_uniform_buffer, vk::DescriptorType::eUniformBuffer)
-                    .add_buffer(m_animation_controller.get_hierarchies().front(), vk::DescriptorType::eStorageBuffer)
-                    .add_buffer(mesh.get_skin().get_joints_buffer(), vk::DescriptorType::eUniformBuffer)
-                    .finish_descriptor_set()
-                    .begin_descriptor_set()
-                    .add_texture(mat.get_base_color(m_geometry).get_image(), mat.get_base_color(m_geometry).get_sampler())
-                    .add_texture(mat.get_normal(m_geometry).get_image(), mat.get_normal(m_geometry).get_sampler())
-                    .add_texture(mat.get_metallic_roughness(m_geometry).get_image(), mat.get_metallic_roughness(m_geometry).get_sampler())
-                    .add_texture(mat.get_occlusion(m_geometry).get_image(), mat.get_occlusion(m_geometry).get_sampler())
-                    .add_texture(mat.get_emissive(m_geometry).get_image(), mat.get_emissive(m_geometry).get_sampler())
-                    .finish_descriptor_set();
-                m_models_primitives_pipelines[mesh_id].emplace_back(builder.create_graphics_pipeline(m_pass, 0));
-                curr_primitive++;
+    void process_file_changes()
+    {
+        bool shaders_changed = false;
+
+        for (const auto& url : m_watcher.poll()) {
+            if (url == vertex_shader_path) {
+                m_vertex_shader = {};
+                shaders_changed = true;
+            } else if (url == fragment_shader_path) {
+                m_fragment_shader = {};
+                shaders_changed = true;
+            } else if (url == gltf::animation_controller::get_shader_path()) {
+                m_animation_controller.init_pipelines();
+            } else if (url == gltf::cluster_culler::get_shader_path()) {
+                m_cluster_culler.init_pipelines();
+            } else {
+                m_model_changed = true;
+            }
+        }
+
+        // the model is loaded and baked on another thread, the frame loop only diffs and uploads it.
+        if (m_model_changed && !m_reload.valid()) {
+            m_model_changed = false;
+            m_reload = std::async(std::launch::async, [builder = m_builder, path = m_gltf_file]() mutable {
+                auto mdl = load_model(path);
+                auto cache = std::make_shared<const gltf::vk_model_cache>(builder.bake(mdl));
+                return std::pair{std::move(mdl), std::move(cache)};
+            });
+        }
+
+        std::vector<bool> rebuilt_meshes(m_geometry.get_meshes().size(), shaders_changed);
+
+        if (m_reload.valid() && m_reload.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            apply_reload(rebuilt_meshes);
+        }
+
+        if (shaders_changed) {
+            create_shader(m_vertex_shader, vertex_shader_path);
+            create_shader(m_fragment_shader, fragment_shader_path);
+        }
+
+        for (size_t mesh_id = 0; mesh_id < rebuilt_meshes.size(); ++mesh_id) {
+            if (rebuilt_meshes[mesh_id]) {
+                init_mesh_pipelines(mesh_id);
+            }
+        }
+
+        if (m_image_update.is_completed()) {
+            m_image_update = {};
+        }
+    }
+
+    void apply_reload(std::vector<bool>& rebuilt_meshes)
+    {
+        std::pair<gltf::model, std::shared_ptr<const gltf::vk_model_cache>> reloaded{};
+
+        // the file may be saved partially or broken, the previous model is kept then.
+        try {
+            reloaded = m_reload.get();
+        } catch (const std::exception& e) {
+            spdlog::error("cannot reload {}: {}", m_gltf_file, e.what());
+            return;
+        }
+
+        auto& [mdl, cache] = reloaded;
+        const auto changes = m_builder.reload(m_geometry, *m_cache, cache);
+
+        // pools can't grow after submit, so the layout of the model is fixed until restart.
+        if (changes.requires_rebuild) {
+            spdlog::warn("layout of {} was changed, restart the sample to see it.", m_gltf_file);
+            return;
+        }
+
+        // nodes and animations of the model have the same layout, so the animation controller keeps pointers to it.
+        m_model = std::move(mdl);
+        m_model.release_payloads();
+        m_mesh_transforms = get_mesh_transforms(m_model);
+        m_cache = std::move(cache);
+
+        // the buffer pool is updated every frame by write_command_buffers.
+        // the staging memory of images is shared, so the previous copy has to be finished before it is rewritten.
+        if (changes.images_uploaded) {
+            m_image_update.wait();
+            m_image_update = m_image_pool.update();
+        }
+
+        for (const auto mesh_id : changes.rebound_meshes) {
+            rebuilt_meshes[mesh_id] = true;
+        }
+
+        for (size_t mesh_id = 0; mesh_id < m_geometry.get_meshes().size(); ++mesh_id) {
+            for (const auto& primitive : m_geometry.get_meshes()[mesh_id].get_primitives()) {
+                const auto& materials = changes.rebound_materials;
+                const auto& material = primitive.get_material(m_geometry);
+
+                if (std::any_of(materials.begin(), materials.end(), [this, &material](uint32_t i) { return &m_geometry.get_materials()[i] == &material; })) {
+                    rebuilt_meshes[mesh_id] = true;
+                }
             }
         }
     }
@@ -224,17 +441,38 @@ private:
 
         m_animation_controller.update(dt);
 
+        for (uint32_t mesh_id = 0; mesh_id < m_mesh_transforms.size(); ++mesh_id) {
+            m_cluster_culler.set_mesh_transform(mesh_id, m_mesh_transforms[mesh_id]);
+        }
+
+        const auto camera_position = glm::vec3(glm::inverse(istance_transform.view)[3]);
+        m_cluster_culler.update(istance_transform.mvp, camera_position);
+
         m_buffer_pool.update();
         m_animation_controller.update(command_buffer);
+        m_cluster_culler.update(command_buffer);
 
         m_pass.begin(command_buffer);
 
-        int node_id = 0;
-        for (const auto& mesh : m_geometry.get_meshes()) {
-            auto curr_pipeline = m_models_primitives_pipelines[node_id].begin();
-            for (const auto& primitive : m_geometry.get_meshes()[node_id++].get_primitives()) {
+        // errors of lods are kept below a pixel of the framebuffer.
+        const float projection_scale = std::abs(istance_transform.proj[1][1]) * float(m_pass.get_framebuffer().get_height()) * 0.5f;
+
+        const auto& meshes = m_geometry.get_meshes();
+
+        for (uint32_t mesh_id = 0; mesh_id < meshes.size(); ++mesh_id) {
+            const auto& primitives = meshes[mesh_id].get_primitives();
+            // lod errors are object space distances, so they are projected with the matrix which places the mesh.
+            const auto model_view = istance_transform.view * m_mesh_transforms[mesh_id];
+            auto curr_pipeline = m_models_primitives_pipelines[mesh_id].begin();
+
+            for (uint32_t primitive_id = 0; primitive_id < primitives.size(); ++primitive_id) {
                 curr_pipeline++->activate(command_buffer);
-                gltf::draw_primitive(primitive, command_buffer);
+
+                // culled primitives are drawn indirectly with visible clusters of the finest lod.
+                if (!m_cluster_culler.draw(mesh_id, primitive_id, command_buffer)) {
+                    const auto& primitive = primitives[primitive_id];
+                    gltf::draw_primitive(primitive, command_buffer, gltf::select_lod(primitive, model_view, projection_scale));
+                }
             }
         }
 
@@ -242,10 +480,20 @@ private:
         command_buffer.end();
     }
 
+    static constexpr auto vertex_shader_path = WORK_DIR "/resources/test.vert.spv";
+    static constexpr auto fragment_shader_path = WORK_DIR "/resources/test.frag.spv";
+
+    std::string m_gltf_file{};
     gltf::model m_model{};
+    gltf::vk_model_builder m_builder{};
+    // kept to diff it with the reloaded one.
+    std::shared_ptr<const gltf::vk_model_cache> m_cache{};
     gltf::vk_model m_geometry{};
+    // see get_mesh_transforms.
+    std::vector<glm::mat4> m_mesh_transforms{};
     gltf::animation_controller m_animation_controller{};
     gltf::animation_instance* m_anim_instance{};
+    gltf::cluster_culler m_cluster_culler{};
 
     avk::render_pass_instance m_pass{};
 
@@ -267,6 +515,11 @@ private:
 
     avk::buffer_instance m_uniform_buffer{};
 
+    hal::filesystem::file_watcher m_watcher{};
+    std::future<std::pair<gltf::model, std::shared_ptr<const gltf::vk_model_cache>>> m_reload{};
+    avk::submit_handler m_image_update{};
+    bool m_model_changed{false};
+
     bool m_reset_command_buffer = false;
 };
 
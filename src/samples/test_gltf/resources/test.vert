@@ -4,7 +4,8 @@
 
 
 layout(location = 0) in vec3 a_position;
-layout(location = 1) in vec3 a_normal;
+// octahedral, see decode_octahedral.
+layout(location = 1) in vec2 a_normal;
 layout(location = 2) in vec3 a_tangent;
 layout(location = 3) in vec2 a_texCoords0;
 layout(location = 4) in vec2 a_texCoords1;
@@ -16,6 +17,13 @@ layout(constant_id = 0) const uint USE_HIERARCHY = 0;
 layout(constant_id = 1) const uint USE_SKIN = 0;
 layout(constant_id = 2) const uint HIERARCHY_SIZE = 1;
 layout(constant_id = 3) const uint SKIN_SIZE = 1;
+// positions are quantized in the box of the primitive, see gltf::vk_primitive::get_position_offset.
+layout(constant_id = 4) const float POSITION_OFFSET_X = 0;
+layout(constant_id = 5) const float POSITION_OFFSET_Y = 0;
+layout(constant_id = 6) const float POSITION_OFFSET_Z = 0;
+layout(constant_id = 7) const float POSITION_SCALE_X = 1;
+layout(constant_id = 8) const float POSITION_SCALE_Y = 1;
+layout(constant_id = 9) const float POSITION_SCALE_Z = 1;
 
 
 layout(push_constant) uniform node_id
@@ -61,6 +69,24 @@ layout(location = 1) out vec3 v_tangent;
 layout(location = 2) out vec2 v_tex_coords;
 layout(location = 3) out vec3 v_vert_color;
 
+
+// inverse of gltf::encode_octahedral.
+vec3 decode_octahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+
+vec3 decode_position(vec3 p)
+{
+    return vec3(POSITION_OFFSET_X, POSITION_OFFSET_Y, POSITION_OFFSET_Z) + p * vec3(POSITION_SCALE_X, POSITION_SCALE_Y, POSITION_SCALE_Z);
+}
+
+
 void main()
 {
     mat4 skin_transform = mat4(1);
@@ -75,11 +101,11 @@ void main()
     }
 
     gl_Position =
-        u_instance_data.mvp * skin_transform * vec4(a_position, 1.0);
+        u_instance_data.mvp * skin_transform * vec4(decode_position(a_position), 1.0);
 
     gl_Position.y = 1. - gl_Position.y;
 
-    v_normal = normalize(transpose(inverse(mat3(skin_transform))) * a_normal);
+    v_normal = normalize(transpose(inverse(mat3(skin_transform))) * decode_octahedral(a_normal));
     v_tangent = normalize(transpose(inverse(mat3(skin_transform))) * a_tangent);
 
     v_tex_coords = a_texCoords0;
@@ -0,0 +1,98 @@
+#include "tests.hpp"
+
+#include <gltf/vk_utils.hpp>
+
+#include <cmath>
+#include <cstring>
+
+using namespace sandbox;
+using namespace sandbox::gltf;
+
+namespace
+{
+    // one node translated by a linear animation with keys at 0 and 1 s. translations have no buffer view,
+    // the second one is set by the sparse data, so the output accessor is materialized by the model.
+    const char* sparse_animation_json = R"({
+        "asset": {"version": "2.0"},
+        "scenes": [{"nodes": [0]}],
+        "nodes": [{}],
+        "buffers": [{"byteLength": 24}],
+        "bufferViews": [
+            {"buffer": 0, "byteOffset": 0, "byteLength": 8},
+            {"buffer": 0, "byteOffset": 8, "byteLength": 4},
+            {"buffer": 0, "byteOffset": 12, "byteLength": 12}
+        ],
+        "accessors": [
+            {"bufferView": 0, "componentType": 5126, "count": 2, "type": "SCALAR", "min": [0], "max": [1]},
+            {
+                "componentType": 5126,
+                "count": 2,
+                "type": "VEC3",
+                "sparse": {
+                    "count": 1,
+                    "indices": {"bufferView": 1, "componentType": 5125},
+                    "values": {"bufferView": 2}
+                }
+            }
+        ],
+        "animations": [{
+            "channels": [{"sampler": 0, "target": {"node": 0, "path": "translation"}}],
+            "samplers": [{"input": 0, "output": 1, "interpolation": "LINEAR"}]
+        }]
+    })";
+
+
+    std::vector<uint8_t> get_sparse_animation_bin()
+    {
+        const float keys[]{0.0f, 1.0f};
+        const uint32_t sparse_index = 1;
+        const float sparse_value[]{0.0f, 2.0f, 0.0f};
+
+        std::vector<uint8_t> result(sizeof(keys) + sizeof(sparse_index) + sizeof(sparse_value));
+        std::memcpy(result.data(), keys, sizeof(keys));
+        std::memcpy(result.data() + sizeof(keys), &sparse_index, sizeof(sparse_index));
+        std::memcpy(result.data() + sizeof(keys) + sizeof(sparse_index), sparse_value, sizeof(sparse_value));
+
+        return result;
+    }
+} // namespace
+
+
+TEST_CASE(animation, sparse_accessor_data)
+{
+    auto bin = get_sparse_animation_bin();
+    const model mdl{nlohmann::json::parse(sparse_animation_json), "", utils::data::create_non_owning(bin.data(), bin.size())};
+
+    const auto& output_accessor = mdl.get_accessors()[1];
+    CHECK(!output_accessor.is_dense());
+
+    const auto* values = reinterpret_cast<const float*>(mdl.get_accessor_data(1));
+    CHECK(values[0] == 0.0f && values[1] == 0.0f && values[2] == 0.0f);
+    CHECK(values[3] == 0.0f && values[4] == 2.0f && values[5] == 0.0f);
+
+    // data is materialized once.
+    CHECK(output_accessor.get_data(mdl) == mdl.get_accessor_data(1));
+
+    // a copy doesn't belong to the model, so the model doesn't know which data to materialize for it.
+    const auto accessor_copy = output_accessor;
+    CHECK(tests::throws([&]() { accessor_copy.get_data(mdl); }));
+    CHECK(tests::throws([&]() { mdl.get_accessor_data(mdl.get_accessors().size()); }));
+}
+
+
+TEST_CASE(animation, cpu_controller_reads_sparse_values)
+{
+    auto bin = get_sparse_animation_bin();
+    const model mdl{nlohmann::json::parse(sparse_animation_json), "", utils::data::create_non_owning(bin.data(), bin.size())};
+
+    cpu_animation_controller controller{mdl.get_animations().front()};
+    controller.play();
+
+    // a frame is calculated for the time before the update, so the second one is at 0.5 s.
+    controller.update(mdl, 500'000);
+    controller.update(mdl, 500'000);
+
+    const auto translation = controller.get_transformations().front()[3];
+    CHECK(translation.x == 0.0f && translation.z == 0.0f);
+    CHECK(std::abs(translation.y - 1.0f) < 1e-5f);
+}
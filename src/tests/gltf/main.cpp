@@ -0,0 +1,61 @@
+#include "tests.hpp"
+
+#include <cstdio>
+#include <exception>
+
+using namespace sandbox;
+
+
+std::vector<tests::test_case>& tests::get_test_cases()
+{
+    static std::vector<test_case> test_cases{};
+    return test_cases;
+}
+
+
+tests::test_registrar::test_registrar(const char* suite, const char* name, std::function<void()> run)
+{
+    get_test_cases().push_back({.suite = suite, .name = name, .run = std::move(run)});
+}
+
+
+bool tests::throws(const std::function<void()>& callable)
+{
+    try {
+        callable();
+    } catch (const std::exception&) {
+        return true;
+    }
+
+    return false;
+}
+
+
+// runs test cases of the suite which is passed as the first argument, or all of them.
+int main(int argc, char** argv)
+{
+    const std::string suite = argc > 1 ? argv[1] : "";
+
+    size_t run_count = 0;
+    size_t failed_count = 0;
+
+    for (const auto& test : tests::get_test_cases()) {
+        if (!suite.empty() && test.suite != suite) {
+            continue;
+        }
+
+        ++run_count;
+
+        try {
+            test.run();
+            std::printf("passed %s.%s\n", test.suite.c_str(), test.name.c_str());
+        } catch (const std::exception& e) {
+            ++failed_count;
+            std::printf("FAILED %s.%s: %s\n", test.suite.c_str(), test.name.c_str(), e.what());
+        }
+    }
+
+    std::printf("%zu of %zu tests passed\n", run_count - failed_count, run_count);
+
+    return run_count > 0 && failed_count == 0 ? 0 : 1;
+}
@@ -0,0 +1,291 @@
+#include "tests.hpp"
+
+#include <gltf/mesh_optimizer.hpp>
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <span>
+
+using namespace sandbox;
+using namespace sandbox::gltf;
+
+namespace
+{
+    struct test_mesh
+    {
+        std::vector<glm::vec3> positions{};
+        std::vector<uint32_t> indices{};
+    };
+
+
+    // flat grid of size x size quads in the xy plane, two triangles per quad.
+    test_mesh make_grid(uint32_t size)
+    {
+        test_mesh result{};
+
+        for (uint32_t y = 0; y <= size; ++y) {
+            for (uint32_t x = 0; x <= size; ++x) {
+                result.positions.emplace_back(float(x), float(y), 0.0f);
+            }
+        }
+
+        for (uint32_t y = 0; y < size; ++y) {
+            for (uint32_t x = 0; x < size; ++x) {
+                const uint32_t v0 = y * (size + 1) + x;
+                const uint32_t v1 = v0 + 1;
+                const uint32_t v2 = v0 + size + 1;
+                const uint32_t v3 = v2 + 1;
+
+                result.indices.insert(result.indices.end(), {v0, v1, v3, v0, v3, v2});
+            }
+        }
+
+        return result;
+    }
+
+
+    void shuffle_triangles(std::vector<uint32_t>& indices, uint32_t seed)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+        std::memcpy(triangles.data(), indices.data(), indices.size() * sizeof(uint32_t));
+
+        std::shuffle(triangles.begin(), triangles.end(), std::mt19937{seed});
+        std::memcpy(indices.data(), triangles.data(), indices.size() * sizeof(uint32_t));
+    }
+
+
+    // triangles are rotated to start with their smallest index, so the winding is kept, and sorted.
+    std::vector<std::array<uint32_t, 3>> get_sorted_triangles(std::span<const uint32_t> indices)
+    {
+        std::vector<std::array<uint32_t, 3>> result{};
+
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            std::array<uint32_t, 3> triangle{indices[i], indices[i + 1], indices[i + 2]};
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            result.push_back(triangle);
+        }
+
+        std::sort(result.begin(), result.end());
+
+        return result;
+    }
+
+
+    const uint8_t* get_positions_data(const test_mesh& mesh)
+    {
+        return reinterpret_cast<const uint8_t*>(mesh.positions.data());
+    }
+} // namespace
+
+
+TEST_CASE(mesh_optimizer, vertex_cache_statistics)
+{
+    const std::vector<uint32_t> indices{0, 1, 2, 2, 1, 3};
+    const auto statistics = analyze_vertex_cache(indices, 4);
+
+    CHECK(statistics.triangles == 2);
+    CHECK(statistics.vertices == 4);
+    CHECK(statistics.transformed_vertices == 4);
+    CHECK(statistics.get_acmr() == 2.0f);
+    CHECK(statistics.get_atvr() == 1.0f);
+}
+
+
+TEST_CASE(mesh_optimizer, vertex_cache_keeps_triangles)
+{
+    auto mesh = make_grid(32);
+    shuffle_triangles(mesh.indices, 1);
+
+    const auto source_triangles = get_sorted_triangles(mesh.indices);
+    const auto before = analyze_vertex_cache(mesh.indices, mesh.positions.size());
+
+    optimize_vertex_cache(mesh.indices, mesh.positions.size());
+
+    CHECK(get_sorted_triangles(mesh.indices) == source_triangles);
+    CHECK(analyze_vertex_cache(mesh.indices, mesh.positions.size()).get_acmr() < before.get_acmr());
+}
+
+
+TEST_CASE(mesh_optimizer, overdraw_keeps_triangles)
+{
+    auto mesh = make_grid(32);
+    optimize_vertex_cache(mesh.indices, mesh.positions.size());
+
+    const auto source_triangles = get_sorted_triangles(mesh.indices);
+
+    optimize_overdraw(mesh.indices, get_positions_data(mesh), sizeof(glm::vec3), mesh.positions.size());
+
+    CHECK(get_sorted_triangles(mesh.indices) == source_triangles);
+}
+
+
+TEST_CASE(mesh_optimizer, vertex_fetch_remap_is_bijective)
+{
+    auto mesh = make_grid(16);
+    shuffle_triangles(mesh.indices, 2);
+
+    // the last vertex is not used by any triangle.
+    const uint64_t vertices_count = mesh.positions.size() + 1;
+    const auto source_indices = mesh.indices;
+
+    const auto remap = optimize_vertex_fetch(mesh.indices, vertices_count);
+
+    CHECK(remap.size() == vertices_count);
+
+    std::vector<uint32_t> sorted_remap = remap;
+    std::sort(sorted_remap.begin(), sorted_remap.end());
+
+    std::vector<uint32_t> identity(vertices_count);
+    std::iota(identity.begin(), identity.end(), 0);
+
+    CHECK(sorted_remap == identity);
+    CHECK(remap.back() == vertices_count - 1);
+
+    for (size_t i = 0; i < mesh.indices.size(); ++i) {
+        CHECK(mesh.indices[i] == remap[source_indices[i]]);
+    }
+
+    // vertices are numbered in the order of their first use.
+    uint32_t next_vertex = 0;
+
+    for (const auto index : mesh.indices) {
+        CHECK(index <= next_vertex);
+        next_vertex = std::max(next_vertex, index + 1);
+    }
+}
+
+
+TEST_CASE(mesh_optimizer, clusters_fit_limits)
+{
+    auto mesh = make_grid(48);
+    optimize_vertex_cache(mesh.indices, mesh.positions.size());
+
+    const auto source_triangles = get_sorted_triangles(mesh.indices);
+    const auto clusters = build_clusters(mesh.indices, mesh.positions.size());
+
+    CHECK(get_sorted_triangles(mesh.indices) == source_triangles);
+
+    uint32_t next_triangle = 0;
+
+    for (const auto& cluster : clusters) {
+        CHECK(cluster.first_triangle == next_triangle);
+        CHECK(cluster.triangles_count > 0 && cluster.triangles_count <= 124);
+
+        const std::span<const uint32_t> cluster_indices{mesh.indices.data() + cluster.first_triangle * 3, cluster.triangles_count * 3};
+        std::vector<uint32_t> vertices(cluster_indices.begin(), cluster_indices.end());
+        std::sort(vertices.begin(), vertices.end());
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+        CHECK(vertices.size() <= 64);
+
+        next_triangle += cluster.triangles_count;
+    }
+
+    CHECK(next_triangle == mesh.indices.size() / 3);
+}
+
+
+TEST_CASE(mesh_optimizer, cluster_bounds_contain_vertices)
+{
+    auto mesh = make_grid(8);
+
+    // the grid is bent along x, so the normal cone isn't degenerate.
+    for (auto& position : mesh.positions) {
+        position.z = position.x * position.x * 0.1f;
+    }
+
+    const auto clusters = build_clusters(mesh.indices, mesh.positions.size());
+
+    for (const auto& cluster : clusters) {
+        const std::span<const uint32_t> cluster_indices{mesh.indices.data() + cluster.first_triangle * 3, cluster.triangles_count * 3};
+        const auto bounds = get_cluster_bounds(cluster_indices, get_positions_data(mesh), sizeof(glm::vec3));
+
+        for (const auto index : cluster_indices) {
+            CHECK(glm::length(mesh.positions[index] - bounds.center) <= bounds.radius * 1.001f);
+        }
+
+        CHECK(bounds.cone_cutoff <= 1.0f);
+    }
+}
+
+
+TEST_CASE(mesh_optimizer, flat_cluster_is_backfacing_from_behind)
+{
+    const auto mesh = make_grid(4);
+    const auto bounds = get_cluster_bounds(mesh.indices, get_positions_data(mesh), sizeof(glm::vec3));
+
+    auto is_backfacing = [&bounds](const glm::vec3& camera) {
+        const auto offset = bounds.center - camera;
+        return glm::dot(offset, bounds.cone_axis) >= bounds.cone_cutoff * glm::length(offset) + bounds.radius;
+    };
+
+    // triangles of the grid face +z.
+    CHECK(is_backfacing(glm::vec3{2, 2, -100}));
+    CHECK(!is_backfacing(glm::vec3{2, 2, 100}));
+}
+
+
+TEST_CASE(mesh_optimizer, simplify_reaches_target)
+{
+    const auto mesh = make_grid(32);
+    const size_t target_indices_count = mesh.indices.size() / 4;
+
+    const auto result = simplify(mesh.indices, get_positions_data(mesh), sizeof(glm::vec3), mesh.positions.size(), target_indices_count, 1.0f);
+
+    CHECK(result.indices.size() % 3 == 0);
+    CHECK(!result.indices.empty() && result.indices.size() <= target_indices_count);
+    // the grid is flat, so collapses don't move its surface.
+    CHECK(result.error < 1e-3f);
+
+    for (const auto index : result.indices) {
+        CHECK(index < mesh.positions.size());
+    }
+
+    // border vertices are kept.
+    for (uint32_t i = 0; i <= 32; ++i) {
+        for (const auto vertex : {i, 32 * 33 + i, i * 33, i * 33 + 32}) {
+            CHECK(std::find(result.indices.begin(), result.indices.end(), vertex) != result.indices.end());
+        }
+    }
+}
+
+
+TEST_CASE(mesh_optimizer, simplify_keeps_error_bound)
+{
+    auto mesh = make_grid(32);
+
+    for (auto& position : mesh.positions) {
+        position.z = std::sin(position.x * 0.2f) * std::cos(position.y * 0.2f) * 2.0f;
+    }
+
+    auto simplify_mesh = [&mesh](float max_error) {
+        return simplify(mesh.indices, get_positions_data(mesh), sizeof(glm::vec3), mesh.positions.size(), 0, max_error);
+    };
+
+    const auto precise = simplify_mesh(0.05f);
+    const auto coarse = simplify_mesh(1.0f);
+
+    CHECK(precise.indices.size() < mesh.indices.size());
+    CHECK(precise.error <= 0.05f);
+    CHECK(coarse.indices.size() < precise.indices.size());
+    CHECK(coarse.error <= 1.0f);
+}
+
+
+TEST_CASE(mesh_optimizer, simplify_respects_can_collapse)
+{
+    const auto mesh = make_grid(8);
+
+    const auto result = simplify(mesh.indices, get_positions_data(mesh), sizeof(glm::vec3), mesh.positions.size(), 0, 1.0f, [](uint32_t, uint32_t) {
+        return false;
+    });
+
+    CHECK(get_sorted_triangles(result.indices) == get_sorted_triangles(mesh.indices));
+}
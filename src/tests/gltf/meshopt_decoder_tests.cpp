@@ -0,0 +1,333 @@
+#include "tests.hpp"
+
+#include <gltf/meshopt_decoder.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace sandbox;
+using namespace sandbox::gltf;
+
+namespace
+{
+    constexpr size_t byte_group_size = 16;
+
+
+    uint8_t zigzag(uint8_t delta)
+    {
+        return uint8_t((delta << 1) ^ uint8_t(int8_t(delta) >> 7));
+    }
+
+
+    // writes the group in the given mode, values which don't fit the bits follow the packed ones as whole bytes.
+    void encode_bytes_group(const uint8_t* values, uint32_t mode, std::vector<uint8_t>& dst)
+    {
+        if (mode == 0) {
+            return;
+        }
+
+        if (mode == 3) {
+            dst.insert(dst.end(), values, values + byte_group_size);
+            return;
+        }
+
+        const uint32_t bits = mode == 1 ? 2 : 4;
+        const uint32_t values_per_byte = 8 / bits;
+        const uint32_t escape = (1u << bits) - 1;
+
+        std::vector<uint8_t> packed(byte_group_size / values_per_byte, 0);
+        std::vector<uint8_t> extra{};
+
+        for (size_t i = 0; i < byte_group_size; ++i) {
+            const uint32_t shift = 8 - bits - uint32_t(i % values_per_byte) * bits;
+            packed[i / values_per_byte] |= uint8_t(std::min<uint32_t>(values[i], escape) << shift);
+
+            if (values[i] >= escape) {
+                extra.push_back(values[i]);
+            }
+        }
+
+        dst.insert(dst.end(), packed.begin(), packed.end());
+        dst.insert(dst.end(), extra.begin(), extra.end());
+    }
+
+
+    // reference encoder of the vertex codec, every group takes the mode which gives the shortest data.
+    std::vector<uint8_t> encode_attributes(const std::vector<uint8_t>& vertices, size_t count, size_t byte_stride)
+    {
+        std::vector<uint8_t> result{0xa0};
+
+        const size_t block_size = std::min<size_t>((8192 / byte_stride) & ~(byte_group_size - 1), 256);
+        std::vector<uint8_t> last_vertex(vertices.begin(), vertices.begin() + byte_stride);
+
+        for (size_t offset = 0; offset < count; offset += block_size) {
+            const size_t block_count = std::min(block_size, count - offset);
+            const size_t aligned_count = (block_count + byte_group_size - 1) & ~(byte_group_size - 1);
+
+            for (size_t k = 0; k < byte_stride; ++k) {
+                std::vector<uint8_t> deltas(aligned_count, 0);
+
+                for (size_t i = 0; i < block_count; ++i) {
+                    const uint8_t value = vertices[(offset + i) * byte_stride + k];
+                    deltas[i] = zigzag(uint8_t(value - last_vertex[k]));
+                    last_vertex[k] = value;
+                }
+
+                const size_t header_offset = result.size();
+                result.resize(result.size() + (aligned_count / byte_group_size + 3) / 4, 0);
+
+                for (size_t group = 0; group < aligned_count / byte_group_size; ++group) {
+                    const uint8_t* values = deltas.data() + group * byte_group_size;
+
+                    uint32_t best_mode = 3;
+                    size_t best_size = byte_group_size;
+
+                    for (uint32_t mode = 0; mode < 3; ++mode) {
+                        std::vector<uint8_t> encoded{};
+
+                        if (mode == 0 && std::any_of(values, values + byte_group_size, [](uint8_t v) { return v != 0; })) {
+                            continue;
+                        }
+
+                        encode_bytes_group(values, mode, encoded);
+
+                        if (encoded.size() < best_size) {
+                            best_mode = mode;
+                            best_size = encoded.size();
+                        }
+                    }
+
+                    result[header_offset + group / 4] |= uint8_t(best_mode << ((group % 4) * 2));
+                    encode_bytes_group(values, best_mode, result);
+                }
+            }
+        }
+
+        // the tail ends with the first vertex, which deltas of the first block start from.
+        const size_t tail_size = std::max<size_t>(byte_stride, 32);
+        result.resize(result.size() + tail_size - byte_stride, 0);
+        result.insert(result.end(), vertices.begin(), vertices.begin() + byte_stride);
+
+        return result;
+    }
+
+
+    std::vector<uint8_t> decode_attributes(const std::vector<uint8_t>& encoded, size_t count, size_t byte_stride)
+    {
+        std::vector<uint8_t> result(count * byte_stride);
+        decode_meshopt_attributes(encoded.data(), encoded.size(), result.data(), count, byte_stride);
+        return result;
+    }
+
+
+    std::array<float, 3> normalize(std::array<float, 3> v)
+    {
+        const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        return {v[0] / length, v[1] / length, v[2] / length};
+    }
+} // namespace
+
+
+// reference data of the meshoptimizer test suite.
+TEST_CASE(meshopt_decoder, triangles)
+{
+    const std::vector<uint8_t> encoded{
+        0xe0, 0xf0, 0x10, 0xfe, 0xff, 0xf0, 0x0c, 0xff, 0x02, 0x02, 0x02, 0x00, 0x76, 0x87,
+        0x56, 0x67, 0x78, 0xa9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00};
+    const std::vector<uint32_t> expected{0, 1, 2, 2, 1, 3, 4, 6, 5, 7, 8, 9};
+
+    std::vector<uint32_t> indices(expected.size());
+    decode_meshopt_triangles(encoded.data(), encoded.size(), reinterpret_cast<uint8_t*>(indices.data()), indices.size(), sizeof(uint32_t));
+    CHECK(indices == expected);
+
+    std::vector<uint16_t> short_indices(expected.size());
+    decode_meshopt_triangles(encoded.data(), encoded.size(), reinterpret_cast<uint8_t*>(short_indices.data()), short_indices.size(), sizeof(uint16_t));
+    CHECK(std::equal(short_indices.begin(), short_indices.end(), expected.begin()));
+}
+
+
+TEST_CASE(meshopt_decoder, indices)
+{
+    const std::vector<uint8_t> encoded{0xd1, 0x00, 0x04, 0xcd, 0x01, 0x04, 0x07, 0x98, 0x1f, 0x00, 0x00, 0x00, 0x00};
+    const std::vector<uint32_t> expected{0, 1, 51, 2, 49, 1000};
+
+    std::vector<uint32_t> indices(expected.size());
+    decode_meshopt_indices(encoded.data(), encoded.size(), reinterpret_cast<uint8_t*>(indices.data()), indices.size(), sizeof(uint32_t));
+
+    CHECK(indices == expected);
+}
+
+
+TEST_CASE(meshopt_decoder, attributes_round_trip)
+{
+    // more vertices than a block holds, so deltas continue across blocks. bytes change by small and large steps,
+    // so groups of every mode are decoded.
+    constexpr size_t byte_stride = 16;
+    constexpr size_t count = 1000;
+
+    std::vector<uint8_t> vertices(count * byte_stride);
+
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t k = 0; k < byte_stride; ++k) {
+            uint8_t value = 0;
+
+            switch (k % 4) {
+                case 0:
+                    value = 7;
+                    break;
+                case 1:
+                    value = uint8_t(i);
+                    break;
+                case 2:
+                    value = uint8_t(i * 3 + (i % 5));
+                    break;
+                default:
+                    value = uint8_t((i * 2654435761u) >> 13);
+                    break;
+            }
+
+            vertices[i * byte_stride + k] = value;
+        }
+    }
+
+    CHECK(decode_attributes(encode_attributes(vertices, count, byte_stride), count, byte_stride) == vertices);
+
+    // a single vertex has one padded group per byte.
+    const std::vector<uint8_t> vertex(vertices.begin(), vertices.begin() + 4);
+    CHECK(decode_attributes(encode_attributes(vertex, 1, 4), 1, 4) == vertex);
+}
+
+
+TEST_CASE(meshopt_decoder, exponential_filter)
+{
+    auto encode = [](int32_t mantissa, int32_t exponent) {
+        return (uint32_t(exponent) << 24) | (uint32_t(mantissa) & 0xffffff);
+    };
+
+    // more values than one simd iteration takes, so the tail is filtered too.
+    std::vector<uint32_t> values{encode(3, -1), encode(-5, 2), encode(0, 0), encode(1, 10), encode(-8388608, -23)};
+    const std::vector<float> expected{1.5f, -20.0f, 0.0f, 1024.0f, -1.0f};
+
+    apply_meshopt_filter(meshopt_compression_filter::exponential, reinterpret_cast<uint8_t*>(values.data()), values.size(), sizeof(uint32_t));
+
+    for (size_t i = 0; i < values.size(); ++i) {
+        float value;
+        std::memcpy(&value, &values[i], sizeof(value));
+        CHECK(value == expected[i]);
+    }
+}
+
+
+TEST_CASE(meshopt_decoder, octahedral_filter)
+{
+    const std::vector<std::array<float, 3>> normals{
+        normalize({0, 0, 1}),
+        normalize({0, 0, -1}),
+        normalize({1, 2, 3}),
+        normalize({-3, 1, -2}),
+        normalize({2, -1, -0.5f}),
+        normalize({-1, -1, 1}),
+    };
+
+    constexpr float max = 32767.0f;
+
+    // x and y are octahedral coordinates, the third component keeps the scale of 1 and w is not filtered.
+    std::vector<std::array<int16_t, 4>> encoded{};
+
+    for (const auto& n : normals) {
+        const float sum = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+        float x = n[0] / sum;
+        float y = n[1] / sum;
+
+        if (n[2] < 0) {
+            const float folded_x = (1 - std::abs(y)) * (x >= 0 ? 1.0f : -1.0f);
+            const float folded_y = (1 - std::abs(x)) * (y >= 0 ? 1.0f : -1.0f);
+            x = folded_x;
+            y = folded_y;
+        }
+
+        encoded.push_back({int16_t(std::round(x * max)), int16_t(std::round(y * max)), int16_t(max), 42});
+    }
+
+    apply_meshopt_filter(meshopt_compression_filter::octahedral, reinterpret_cast<uint8_t*>(encoded.data()), encoded.size(), sizeof(encoded[0]));
+
+    for (size_t i = 0; i < normals.size(); ++i) {
+        for (size_t c = 0; c < 3; ++c) {
+            CHECK(std::abs(float(encoded[i][c]) - normals[i][c] * max) <= 8.0f);
+        }
+
+        CHECK(encoded[i][3] == 42);
+    }
+}
+
+
+TEST_CASE(meshopt_decoder, quaternion_filter)
+{
+    const std::vector<std::array<float, 4>> quaternions{
+        {0, 0, 0, 1},
+        {1, 0, 0, 0},
+        {0.5f, 0.5f, 0.5f, 0.5f},
+        {-0.5f, 0.5f, -0.5f, 0.5f},
+        {0.1825742f, 0.3651484f, 0.5477226f, -0.7302967f},
+    };
+
+    // the largest component is dropped, its index is kept in the lowest bits of w and the rest of w keeps the scale.
+    constexpr int32_t scale = 4095;
+    const float one = float((scale << 2) | 3) * std::sqrt(2.0f);
+
+    std::vector<std::array<int16_t, 4>> encoded{};
+    std::vector<std::array<float, 4>> expected{};
+
+    for (const auto& q : quaternions) {
+        const auto largest = std::max_element(q.begin(), q.end(), [](float l, float r) { return std::abs(l) < std::abs(r); }) - q.begin();
+        const float sign = q[largest] < 0 ? -1.0f : 1.0f;
+
+        std::array<int16_t, 4> element{};
+
+        for (int32_t i = 0; i < 3; ++i) {
+            element[i] = int16_t(std::round(q[(largest + 1 + i) & 3] * sign * one));
+        }
+
+        element[3] = int16_t((scale << 2) | int32_t(largest));
+
+        encoded.push_back(element);
+        expected.push_back({q[0] * sign, q[1] * sign, q[2] * sign, q[3] * sign});
+    }
+
+    apply_meshopt_filter(meshopt_compression_filter::quaternion, reinterpret_cast<uint8_t*>(encoded.data()), encoded.size(), sizeof(encoded[0]));
+
+    for (size_t i = 0; i < quaternions.size(); ++i) {
+        for (size_t c = 0; c < 4; ++c) {
+            CHECK(std::abs(float(encoded[i][c]) - expected[i][c] * 32767.0f) <= 8.0f);
+        }
+    }
+}
+
+
+TEST_CASE(meshopt_decoder, malformed_data)
+{
+    const std::vector<uint8_t> triangles{
+        0xe0, 0xf0, 0x10, 0xfe, 0xff, 0xf0, 0x0c, 0xff, 0x02, 0x02, 0x02, 0x00, 0x76, 0x87,
+        0x56, 0x67, 0x78, 0xa9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00};
+    std::vector<uint32_t> indices(12);
+    auto* dst = reinterpret_cast<uint8_t*>(indices.data());
+
+    CHECK(tests::throws([&]() { decode_meshopt_triangles(triangles.data(), triangles.size() - 1, dst, indices.size(), 4); }));
+    CHECK(tests::throws([&]() { decode_meshopt_triangles(triangles.data(), triangles.size(), dst, indices.size(), 1); }));
+
+    auto bad_header = triangles;
+    bad_header[0] = 0xa0;
+    CHECK(tests::throws([&]() { decode_meshopt_triangles(bad_header.data(), bad_header.size(), dst, indices.size(), 4); }));
+
+    const std::vector<uint8_t> vertices(64, 1);
+    const auto encoded = encode_attributes(vertices, 16, 4);
+    std::vector<uint8_t> decoded(vertices.size());
+
+    CHECK(tests::throws([&]() { decode_meshopt_attributes(encoded.data(), encoded.size() - 1, decoded.data(), 16, 4); }));
+    CHECK(tests::throws([&]() { decode_meshopt_attributes(encoded.data(), encoded.size(), decoded.data(), 16, 6); }));
+
+    CHECK(tests::throws([&]() { apply_meshopt_filter(meshopt_compression_filter::quaternion, decoded.data(), 4, 4); }));
+}
@@ -0,0 +1,46 @@
+#include "tests.hpp"
+
+#include <gltf/gltf_base.hpp>
+
+#include <string>
+
+using namespace sandbox;
+using namespace sandbox::gltf;
+
+namespace
+{
+    // buffers which aren't a glb chunk are loaded with the thread pool.
+    const std::string buffers_json = R"({
+        "asset": {"version": "2.0"},
+        "buffers": [
+            {"byteLength": 4, "uri": "data:application/octet-stream;base64,AQIDBA=="},
+            {"byteLength": 8, "uri": "data:application/octet-stream;base64,AQIDBAUGBwg="}
+        ]
+    })";
+} // namespace
+
+
+TEST_CASE(model, loads_from_pool_task)
+{
+    // the only worker runs the task which loads the model, so waiting for another pool task would never return.
+    utils::thread_pool pool{1};
+
+    for (const bool streaming_parser : {true, false}) {
+        const load_options options{.streaming_parser = streaming_parser, .thread_pool = &pool};
+
+        auto loaded = pool.submit([&options]() {
+            if (options.streaming_parser) {
+                return model{reinterpret_cast<const uint8_t*>(buffers_json.data()), buffers_json.size(), "", std::nullopt, options};
+            }
+
+            return model{nlohmann::json::parse(buffers_json), "", std::nullopt, options};
+        });
+
+        const auto mdl = loaded.get();
+        const auto& buffers = mdl.get_buffers();
+
+        CHECK(buffers.size() == 2);
+        CHECK(buffers[0].get_size() == 4 && buffers[0].get_data()[3] == 4);
+        CHECK(buffers[1].get_size() == 8 && buffers[1].get_data()[7] == 8);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <utils/conditions_helpers.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sandbox::tests
+{
+    struct test_case
+    {
+        std::string suite{};
+        std::string name{};
+        std::function<void()> run{};
+    };
+
+    std::vector<test_case>& get_test_cases();
+
+    // adds the test case from a static initializer of its file, see TEST_CASE.
+    struct test_registrar
+    {
+        test_registrar(const char* suite, const char* name, std::function<void()> run);
+    };
+
+    bool throws(const std::function<void()>& callable);
+} // namespace sandbox::tests
+
+// a test fails if its body throws, e.g. on a failed CHECK.
+#define TEST_CASE(suite, name)                                                                                 \
+    static void suite##_##name();                                                                              \
+    static const sandbox::tests::test_registrar suite##_##name##_registrar{#suite, #name, &suite##_##name}; \
+    static void suite##_##name()
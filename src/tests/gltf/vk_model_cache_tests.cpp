@@ -0,0 +1,229 @@
+#include "tests.hpp"
+
+#include <gltf/vk_model_cache.hpp>
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <random>
+
+using namespace sandbox;
+using namespace sandbox::gltf;
+
+namespace
+{
+    constexpr uint64_t cache_key = 0x1234'5678'9abc'def0;
+    constexpr std::array<uint32_t, 8> vertex_format{106, 106, 103, 0, 0, 0, 0, 0};
+
+
+    // directory with a model source, the cache is saved next to it.
+    struct cache_directory
+    {
+        cache_directory()
+            : path{std::filesystem::temp_directory_path() / ("gltf_tests_" + std::to_string(std::random_device{}()))}
+        {
+            std::filesystem::create_directories(path / "textures");
+            write_file("model.gltf", "{\"asset\":{\"version\":\"2.0\"}}");
+            write_file("textures/albedo.png", "png");
+        }
+
+        ~cache_directory()
+        {
+            std::error_code error{};
+            std::filesystem::remove_all(path, error);
+        }
+
+        void write_file(const std::string& relative_path, const std::string& content) const
+        {
+            std::ofstream stream{path / relative_path, std::ios::binary | std::ios::trunc};
+            stream << content;
+        }
+
+        std::string get_cache_path() const
+        {
+            return (path / "model.cache").string();
+        }
+
+        std::filesystem::path path{};
+    };
+
+
+    vk_model_cache make_cache(const cache_directory& directory, std::vector<vk_model_cache::blob>& blobs)
+    {
+        vk_model_cache result{};
+        result.set_key(cache_key);
+        result.set_vertex_format(vertex_format);
+
+        // sizes aren't multiples of the alignment, so blobs are padded.
+        for (const uint64_t size : {3, 64, 1000}) {
+            blobs.push_back(result.add_blob(size, [size](uint8_t* dst) {
+                std::iota(dst, dst + size, uint8_t(size));
+            }));
+        }
+
+        result.add_source(directory.path.string(), "model.gltf");
+        result.add_source(directory.path.string(), "textures/albedo.png");
+
+        return result;
+    }
+
+
+    void patch_file(const std::string& path, size_t offset, uint32_t value)
+    {
+        std::fstream stream{path, std::ios::binary | std::ios::in | std::ios::out};
+        stream.seekp(std::streamoff(offset));
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+
+    // appends the table with the mesh to the file and points the header to it. tables follow the magic, the version
+    // and the key in the header, meshes are the fourth one.
+    void set_meshes(const std::string& path, const vk_model_cache::mesh& mesh)
+    {
+        const uint64_t table[]{std::filesystem::file_size(path), 1};
+
+        {
+            std::ofstream stream{path, std::ios::binary | std::ios::app};
+            stream.write(reinterpret_cast<const char*>(&mesh), sizeof(mesh));
+        }
+
+        std::fstream stream{path, std::ios::binary | std::ios::in | std::ios::out};
+        stream.seekp(std::streamoff(sizeof(uint32_t) * 2 + sizeof(uint64_t) + sizeof(table) * 3));
+        stream.write(reinterpret_cast<const char*>(table), sizeof(table));
+    }
+} // namespace
+
+
+TEST_CASE(vk_model_cache, round_trip)
+{
+    const cache_directory directory{};
+    std::vector<vk_model_cache::blob> blobs{};
+
+    const auto cache = make_cache(directory, blobs);
+    cache.save(directory.get_cache_path());
+
+    CHECK(!std::filesystem::exists(directory.get_cache_path() + ".tmp"));
+
+    const auto opened = vk_model_cache::open(directory.get_cache_path(), cache_key, directory.path.string());
+
+    CHECK(opened.has_value());
+    CHECK(opened->get_key() == cache_key);
+    CHECK(opened->get_blobs_size() == cache.get_blobs_size());
+    CHECK(opened->get_sources_size() == cache.get_sources_size());
+
+    for (const auto& blob : blobs) {
+        CHECK(blob.offset % vk_model_cache::blob_alignment == 0);
+        CHECK(std::memcmp(opened->get_blob_data(blob), cache.get_blob_data(blob), blob.size) == 0);
+    }
+
+    // blobs of the opened cache are read from the mapped file, so they keep the alignment.
+    CHECK(reinterpret_cast<uintptr_t>(opened->get_blob_data(blobs.front())) % vk_model_cache::blob_alignment == 0);
+}
+
+
+TEST_CASE(vk_model_cache, rejects_other_key)
+{
+    const cache_directory directory{};
+    std::vector<vk_model_cache::blob> blobs{};
+
+    make_cache(directory, blobs).save(directory.get_cache_path());
+
+    CHECK(!vk_model_cache::open(directory.get_cache_path(), cache_key + 1, directory.path.string()));
+}
+
+
+TEST_CASE(vk_model_cache, rejects_other_version)
+{
+    const cache_directory directory{};
+    std::vector<vk_model_cache::blob> blobs{};
+
+    make_cache(directory, blobs).save(directory.get_cache_path());
+    CHECK(vk_model_cache::open(directory.get_cache_path(), cache_key, directory.path.string()));
+
+    // the header starts with the magic and the version.
+    patch_file(directory.get_cache_path(), sizeof(uint32_t), vk_model_cache::version - 1);
+    CHECK(!vk_model_cache::open(directory.get_cache_path(), cache_key, directory.path.string()));
+
+    patch_file(directory.get_cache_path(), sizeof(uint32_t), vk_model_cache::version);
+    patch_file(directory.get_cache_path(), 0, ~vk_model_cache::magic);
+    CHECK(!vk_model_cache::open(directory.get_cache_path(), cache_key, directory.path.string()));
+}
+
+
+TEST_CASE(vk_model_cache, rejects_broken_file)
+{
+    const cache_directory directory{};
+    std::vector<vk_model_cache::blob> blobs{};
+
+    make_cache(directory, blobs).save(directory.get_cache_path());
+
+    const auto size = std::filesystem::file_size(directory.get_cache_path());
+    std::filesystem::resize_file(directory.get_cache_path(), size - 1);
+    CHECK(!vk_model_cache::open(directory.get_cache_path(), cache_key, directory.path.string()));
+
+    std::filesystem::resize_file(directory.get_cache_path(), 8);
+    CHECK(!vk_model_cache::open(directory.get_cache_path(), cache_key, directory.path.string()));
+
+    CHECK(!vk_model_cache::open((directory.path / "missing.cache").string(), cache_key, directory.path.string()));
+
+    // the cache has no primitives and skins, so only the empty mesh without a skin refers to existing records.
+    const std::array<std::pair<vk_model_cache::mesh, bool>, 4> meshes{{
+        {vk_model_cache::mesh{}, true},
+        {vk_model_cache::mesh{.primitives_count = 1}, false},
+        {vk_model_cache::mesh{.first_primitive = 1}, false},
+        {vk_model_cache::mesh{.skin = 0}, false},
+    }};
+
+    for (const auto& [mesh, valid] : meshes) {
+        make_cache(directory, blobs).save(directory.get_cache_path());
+        set_meshes(directory.get_cache_path(), mesh);
+
+        CHECK(vk_model_cache::open(directory.get_cache_path(), cache_key, directory.path.string()).has_value() == valid);
+    }
+}
+
+
+TEST_CASE(vk_model_cache, tracks_sources)
+{
+    const cache_directory directory{};
+    std::vector<vk_model_cache::blob> blobs{};
+
+    make_cache(directory, blobs).save(directory.get_cache_path());
+
+    auto open = [&directory]() {
+        return vk_model_cache::open(directory.get_cache_path(), cache_key, directory.path.string());
+    };
+
+    const auto texture_path = directory.path / "textures/albedo.png";
+    const auto write_time = std::filesystem::last_write_time(texture_path);
+
+    // a new write time alone doesn't invalidate the cache, the content is compared.
+    directory.write_file("textures/albedo.png", "png");
+    std::filesystem::last_write_time(texture_path, write_time + std::chrono::seconds{10});
+    CHECK(open());
+
+    // the content of the same size is changed.
+    directory.write_file("textures/albedo.png", "jpg");
+    std::filesystem::last_write_time(texture_path, write_time + std::chrono::seconds{20});
+    CHECK(!open());
+
+    directory.write_file("textures/albedo.png", "png");
+    CHECK(open());
+
+    directory.write_file("textures/albedo.png", "png image");
+    CHECK(!open());
+
+    directory.write_file("textures/albedo.png", "png");
+    std::filesystem::remove(directory.path / "model.gltf");
+    CHECK(!open());
+
+    // sources are stored relative to the model directory, so the cache moves with them.
+    const cache_directory moved_directory{};
+    std::filesystem::remove_all(moved_directory.path);
+    std::filesystem::rename(directory.path, moved_directory.path);
+    moved_directory.write_file("model.gltf", "{\"asset\":{\"version\":\"2.0\"}}");
+
+    CHECK(vk_model_cache::open(moved_directory.get_cache_path(), cache_key, moved_directory.path.string()));
+}
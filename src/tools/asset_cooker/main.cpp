@@ -0,0 +1,320 @@
+#include <gltf/asset_registry.hpp>
+#include <gltf/glb_writer.hpp>
+#include <gltf/gltf_vk.hpp>
+#include <utils/thread_pool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sandbox;
+
+namespace
+{
+    // cooked caches are used at runtime only if the runtime builder has the same vertex format.
+    constexpr std::array<vk::Format, 8> default_vertex_format{
+        vk::Format::eR32G32B32Sfloat,
+        vk::Format::eR32G32B32Sfloat,
+        vk::Format::eR32G32B32A32Sfloat,
+        vk::Format::eR32G32Sfloat,
+        vk::Format::eR32G32Sfloat,
+        vk::Format::eR32G32B32Sfloat,
+        vk::Format::eR32G32B32A32Uint,
+        vk::Format::eR32G32B32A32Sfloat};
+
+
+    struct cooker_options
+    {
+        std::filesystem::path input_directory{};
+        std::filesystem::path output_directory{};
+        size_t threads_count{std::max(std::thread::hardware_concurrency(), 1u)};
+        bool use_skin{true};
+        bool bake_mips{true};
+        bool keep_quantized{false};
+        bool compact_vertices{false};
+        bool quantize_positions{false};
+        bool optimize_meshes{false};
+        bool build_clusters{false};
+        uint32_t lods_count{0};
+        bool export_glb{false};
+        bool force{false};
+    };
+
+
+    enum class cook_status
+    {
+        cooked,
+        skipped,
+        failed
+    };
+
+
+    struct cook_report
+    {
+        std::filesystem::path relative_path{};
+        cook_status status{cook_status::failed};
+        std::string error{};
+        double time_ms{0};
+        uint64_t input_size{0};
+        uint64_t output_size{0};
+        // only models which were cooked with optimized meshes have it.
+        std::optional<gltf::mesh_optimization_statistics> optimization{};
+    };
+
+
+    void print_usage()
+    {
+        std::printf(
+            "usage: asset_cooker <input directory> [output directory] [options]\n"
+            "  caches are written next to models if the output directory is not set.\n"
+            "  point vk_model_builder::set_cache_directory to the output directory and load models by urls relative to the input one.\n"
+            "  caches are valid only for builders with the same settings, use_skin(true) and bake_mips(true) by default.\n"
+            "options:\n"
+            "  --threads <count>  count of models cooked at once, all cores by default.\n"
+            "  --no-skin          bake models for vk_model_builder::use_skin(false).\n"
+            "  --no-mips          bake models for vk_model_builder::bake_mips(false), mips are generated on gpu.\n"
+            "  --keep-quantized   bake models for vk_model_builder::keep_quantized(true).\n"
+            "  --compact-vertices bake models for vk_model_builder::compact_vertices(true).\n"
+            "  --quantize-positions bake models for vk_model_builder::quantize_positions(true).\n"
+            "  --optimize-meshes  bake models for vk_model_builder::optimize_meshes(true), vertex cache acmr and atvr are reported.\n"
+            "  --build-clusters   bake models for vk_model_builder::build_clusters(true).\n"
+            "  --lods <count>     bake models for vk_model_builder::generate_lods(count), up to 5.\n"
+            "  --export-glb       also write models repacked into tight glb files to the output directory.\n"
+            "  --force            cook models even if their caches are up to date.\n");
+    }
+
+
+    bool parse_options(int argc, const char** argv, cooker_options& options)
+    {
+        std::vector<std::string> positional{};
+
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+                options.threads_count = std::max<size_t>(std::stoul(argv[++i]), 1);
+            } else if (std::strcmp(argv[i], "--no-skin") == 0) {
+                options.use_skin = false;
+            } else if (std::strcmp(argv[i], "--no-mips") == 0) {
+                options.bake_mips = false;
+            } else if (std::strcmp(argv[i], "--keep-quantized") == 0) {
+                options.keep_quantized = true;
+            } else if (std::strcmp(argv[i], "--compact-vertices") == 0) {
+                options.compact_vertices = true;
+            } else if (std::strcmp(argv[i], "--quantize-positions") == 0) {
+                options.quantize_positions = true;
+            } else if (std::strcmp(argv[i], "--optimize-meshes") == 0) {
+                options.optimize_meshes = true;
+            } else if (std::strcmp(argv[i], "--build-clusters") == 0) {
+                options.build_clusters = true;
+            } else if (std::strcmp(argv[i], "--lods") == 0 && i + 1 < argc) {
+                options.lods_count = std::min<uint32_t>(std::stoul(argv[++i]), gltf::vk_model_cache::max_lods - 1);
+            } else if (std::strcmp(argv[i], "--export-glb") == 0) {
+                options.export_glb = true;
+            } else if (std::strcmp(argv[i], "--force") == 0) {
+                options.force = true;
+            } else if (argv[i][0] == '-') {
+                return false;
+            } else {
+                positional.emplace_back(argv[i]);
+            }
+        }
+
+        if (positional.empty() || positional.size() > 2) {
+            return false;
+        }
+
+        options.input_directory = std::filesystem::absolute(positional[0]).lexically_normal();
+
+        if (positional.size() > 1) {
+            options.output_directory = std::filesystem::absolute(positional[1]).lexically_normal();
+        }
+
+        // repacked models written next to the sources would replace glb sources and be found as models on the next run.
+        if (options.export_glb && options.output_directory.empty()) {
+            return false;
+        }
+
+        return std::filesystem::is_directory(options.input_directory);
+    }
+
+
+    std::vector<std::filesystem::path> find_models(const std::filesystem::path& directory)
+    {
+        std::vector<std::filesystem::path> result{};
+
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+            if (!entry.is_regular_file()) {
+                continue;
+            }
+
+            auto extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+
+            if (extension == ".gltf" || extension == ".glb") {
+                result.emplace_back(entry.path().lexically_relative(directory));
+            }
+        }
+
+        // the same order on every run, so reports can be compared.
+        std::sort(result.begin(), result.end());
+
+        return result;
+    }
+
+
+    cook_report cook_model(const cooker_options& options, gltf::asset_registry& assets, const std::filesystem::path& relative_path)
+    {
+        cook_report result{.relative_path = relative_path};
+
+        const auto start = std::chrono::steady_clock::now();
+
+        try {
+            auto builder = gltf::vk_model_builder()
+                               .set_vertex_format(default_vertex_format)
+                               .use_skin(options.use_skin)
+                               .bake_mips(options.bake_mips)
+                               .keep_quantized(options.keep_quantized)
+                               .compact_vertices(options.compact_vertices)
+                               .quantize_positions(options.quantize_positions)
+                               .optimize_meshes(options.optimize_meshes)
+                               .build_clusters(options.build_clusters)
+                               .generate_lods(options.lods_count)
+                               .set_asset_registry(&assets);
+
+            const auto model_path = (options.input_directory / relative_path).string();
+            const auto cache_path = options.output_directory.empty()
+                                        ? model_path + ".vkcache"
+                                        : (options.output_directory / relative_path).string() + ".vkcache";
+
+            std::optional<gltf::vk_model_cache> cache{};
+
+            // the key hashes model content and builder settings, so unchanged models are not parsed at all.
+            if (!options.force) {
+                const auto sources_directory = (options.input_directory / relative_path).parent_path().string();
+                cache = gltf::vk_model_cache::open(cache_path, builder.get_cache_key(model_path), sources_directory);
+            }
+
+            if (cache) {
+                result.status = cook_status::skipped;
+            } else {
+                cache = builder.bake_file(model_path);
+                std::filesystem::create_directories(std::filesystem::path(cache_path).parent_path());
+                cache->save(cache_path);
+                result.status = cook_status::cooked;
+                result.optimization = cache->get_optimization_statistics();
+            }
+
+            if (options.export_glb) {
+                auto glb_path = options.output_directory / relative_path;
+                glb_path.replace_extension(".glb");
+
+                if (result.status == cook_status::cooked || !std::filesystem::exists(glb_path)) {
+                    const auto mdl = gltf::model::from_url(model_path, {.assets = &assets});
+                    std::filesystem::create_directories(glb_path.parent_path());
+                    gltf::save_glb(mdl, glb_path.string());
+                }
+            }
+
+            result.input_size = cache->get_sources_size();
+            result.output_size = std::filesystem::file_size(cache_path);
+        } catch (const std::exception& e) {
+            result.status = cook_status::failed;
+            result.error = e.what();
+        }
+
+        result.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        return result;
+    }
+
+
+    void print_report(const std::vector<cook_report>& reports, double total_time_ms)
+    {
+        constexpr const char* status_names[]{"cooked", "skipped", "failed"};
+
+        std::printf("%-8s %10s %12s %12s  %s\n", "status", "time ms", "input kb", "output kb", "model");
+
+        uint64_t total_input_size = 0;
+        uint64_t total_output_size = 0;
+
+        for (const auto& report : reports) {
+            std::printf(
+                "%-8s %10.1f %12.1f %12.1f  %s\n",
+                status_names[static_cast<size_t>(report.status)],
+                report.time_ms,
+                report.input_size / 1024.,
+                report.output_size / 1024.,
+                report.relative_path.generic_string().c_str());
+
+            if (report.status == cook_status::failed) {
+                std::printf("    %s\n", report.error.c_str());
+            }
+
+            if (report.optimization && report.optimization->before.triangles > 0) {
+                const auto& [before, after] = *report.optimization;
+                std::printf(
+                    "    acmr %.3f -> %.3f, atvr %.3f -> %.3f, %llu triangles\n",
+                    before.get_acmr(),
+                    after.get_acmr(),
+                    before.get_atvr(),
+                    after.get_atvr(),
+                    static_cast<unsigned long long>(before.triangles));
+            }
+
+            total_input_size += report.input_size;
+            total_output_size += report.output_size;
+        }
+
+        const auto count_status = [&reports](cook_status status) {
+            return std::count_if(reports.begin(), reports.end(), [status](const cook_report& r) { return r.status == status; });
+        };
+
+        std::printf(
+            "%zu models: %td cooked, %td skipped, %td failed. %.1f ms, %.1f kb -> %.1f kb.\n",
+            reports.size(),
+            count_status(cook_status::cooked),
+            count_status(cook_status::skipped),
+            count_status(cook_status::failed),
+            total_time_ms,
+            total_input_size / 1024.,
+            total_output_size / 1024.);
+    }
+} // namespace
+
+
+int main(int argc, const char** argv)
+{
+    cooker_options options{};
+
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const auto models = find_models(options.input_directory);
+    std::vector<cook_report> reports(models.size());
+
+    // models which share buffers and images read and decode them once.
+    gltf::asset_registry assets{};
+
+    // models are cooked one per thread, every model is loaded without its own pool.
+    utils::thread_pool pool{options.threads_count - 1};
+    pool.parallel_for(0, models.size(), [&options, &assets, &models, &reports](size_t i) {
+        reports[i] = cook_model(options, assets, models[i]);
+    });
+
+    print_report(reports, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    const bool failed = std::any_of(reports.begin(), reports.end(), [](const cook_report& r) { return r.status == cook_status::failed; });
+
+    return failed ? 1 : 0;
+}